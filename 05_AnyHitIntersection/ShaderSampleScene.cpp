@@ -98,6 +98,10 @@ void ShadersSampleScene::OnDestroy()
     m_device->DeallocateDescriptor(m_outputDescriptor);
     m_device->DeallocateDescriptor(m_tlasDescriptor);
 
+    auto& textureCache = util::TextureCache::GetInstance();
+    textureCache.Release(m_texture, m_device);
+    textureCache.Release(m_whiteTex, m_device);
+
     ImGui_ImplDX12_Shutdown();
     TerminateGraphicsDevice();
 }
@@ -466,8 +470,9 @@ void ShadersSampleScene::CreateSceneObjects()
         m_meshFence.indexCount, 0, istride);
     m_meshFence.shaderName = AppHitGroups::AnyHitModel;
 
-    m_texture = util::LoadTextureFromFile(L"texture.png", m_device);
-    m_whiteTex = util::LoadTextureFromFile(L"white.png", m_device);
+    auto& textureCache = util::TextureCache::GetInstance();
+    m_texture = textureCache.LoadFromFile(L"texture.png", m_device);
+    m_whiteTex = textureCache.LoadFromFile(L"white.png", m_device);
         
     D3D12_RAYTRACING_AABB aabbData{};
     aabbData.MinX = -0.5f;
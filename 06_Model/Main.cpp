@@ -4,14 +4,78 @@
 #define USE_IMGUI
 #include "Win32Application.h"
 
+#include <shellapi.h>
+#include <string>
+
+// R}hC烂fǂݍ݂̐ݒ.
+//  lł͒ǉ̏s킸Aw肳ꂽXCb`̋@\݂̂Lɂ.
+//   -cache            : xCNς݃LbV(.dxrmodel)gp.
+//   -optimize         : _LbVEtFb`ɕבւ.
+//   -weld             : ̒_𓝍.
+//   -compressAttrib   : @EUV kĊi[.
+//   -cluster <count>  : wOp`𒴂v~eBuNX^ɕ.
+//   -mipmaps          : eNX`̃~bv}bv𐶐.
+//   -bc               : eNX`ubNk.
+//   -compressAnim     : Aj[ṼL[팸Eʎq.
+//   -compressSkin     : XL̃EFCg팸Eʎq.
+//   -all              : LׂėLɂ(NX^̎Op` 4096).
+static util::DxrModel::ImportSettings ParseImportSettings(LPWSTR cmdline)
+{
+    util::DxrModel::ImportSettings settings;
+    if (cmdline == nullptr || cmdline[0] == L'\0') {
+        return settings;
+    }
+    int argc = 0;
+    auto argv = CommandLineToArgvW(cmdline, &argc);
+    if (argv == nullptr) {
+        return settings;
+    }
+    for (int i = 0; i < argc; ++i) {
+        std::wstring arg = argv[i];
+        bool all = (arg == L"-all");
+        if (all || arg == L"-cache") {
+            settings.useModelCache = true;
+        }
+        if (all || arg == L"-optimize") {
+            settings.optimizeMeshes = true;
+        }
+        if (all || arg == L"-weld") {
+            settings.weldVertices = true;
+        }
+        if (all || arg == L"-compressAttrib") {
+            settings.compressAttributes = true;
+        }
+        if (all) {
+            settings.maxClusterTriangles = 4096;
+        }
+        if (arg == L"-cluster" && i + 1 < argc) {
+            settings.maxClusterTriangles = UINT(_wtoi(argv[++i]));
+        }
+        if (all || arg == L"-mipmaps") {
+            settings.mipmaps.generateMips = true;
+        }
+        if (all || arg == L"-bc") {
+            settings.textureCompression.compress = true;
+        }
+        if (all || arg == L"-compressAnim") {
+            settings.compressAnimations = true;
+        }
+        if (all || arg == L"-compressSkin") {
+            settings.compressSkinWeights = true;
+        }
+    }
+    LocalFree(argv);
+    return settings;
+}
+
 /* x (C28251) }̂ SAL ߂t^ */
 int APIENTRY wWinMain(
     _In_ HINSTANCE hInstance,
     _In_opt_ HINSTANCE /*hPrevInstance*/,
-    _In_ LPWSTR /*cmdline*/,
+    _In_ LPWSTR cmdline,
     _In_ int /*nCmdShow*/)
 {
     CoInitializeEx(NULL, COINIT_MULTITHREADED);
-    ModelScene theApp(800, 600);
+    ModelScene theApp(800, 600, ParseImportSettings(cmdline));
     return Win32Application::Run(&theApp, hInstance);
 }
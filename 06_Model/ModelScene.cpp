@@ -4,6 +4,7 @@
 
 #include <fstream>
 #include <random>
+#include <chrono>
 #include <DirectXTex.h>
 #include "d3dx12.h"
 #include "imgui.h"
@@ -16,8 +17,9 @@
 using namespace DirectX;
 
 
-ModelScene::ModelScene(UINT width, UINT height) : DxrBookFramework(width, height, L"ModelScene"),
-m_meshPlane(), m_dispatchRayDesc(), m_sceneParam(), m_guiParams()
+ModelScene::ModelScene(UINT width, UINT height, const util::DxrModel::ImportSettings& importSettings)
+: DxrBookFramework(width, height, L"ModelScene"),
+m_meshPlane(), m_dispatchRayDesc(), m_sceneParam(), m_guiParams(), m_importSettings(importSettings)
 {
 }
 
@@ -90,6 +92,7 @@ void ModelScene::OnInit()
 void ModelScene::OnDestroy()
 {
     m_device->WaitForIdleGpu();
+    m_crowdChara.reset();
     m_actorChara.reset();
     m_actorPot1.reset();
     m_actorPot2.reset();
@@ -133,6 +136,16 @@ void ModelScene::OnUpdate()
     ImGui::SliderFloat("Elbow L", &m_guiParams.elbowL, 0.0f, 150.0f, "%.1f");
     ImGui::SliderFloat("Elbow R", &m_guiParams.elbowR, 0.0f, 150.0f, "%.1f");
     ImGui::SliderFloat("Neck", &m_guiParams.neck, -30.0f, 60.0f, "%.1f");
+    if (m_modelChara.GetAnimationCount() > 0) {
+        ImGui::Checkbox("Play Animation", &m_guiParams.playAnimation);
+        ImGui::Text("Animation sample %.3f us", m_guiParams.animationSampleUs);
+    }
+    ImGui::Checkbox("Dual Quaternion Skinning", &m_guiParams.dualQuaternionSkinning);
+    ImGui::Text("Transform update %.3f us", m_guiParams.transformUpdateUs);
+    ImGui::Checkbox("Show Crowd", &m_guiParams.showCrowd);
+    if (m_guiParams.showCrowd) {
+        ImGui::Text("Crowd palette (%u actors) %.3f us", m_crowdChara->GetActorCount(), m_guiParams.crowdPaletteUs);
+    }
 
     ImGui::End();
 
@@ -147,7 +160,16 @@ void ModelScene::OnUpdate()
     m_sceneParam.eyePosition = m_camera.GetPosition();
  
     // XLjOf̍sXV.
-    if (m_actorChara->IsSkinned()) {
+    //  Aj[Vꍇ̓NbvĐA GUI ̒lŊ֐߂𓮂.
+    if (m_guiParams.playAnimation && m_modelChara.GetAnimationCount() > 0) {
+        const auto& clip = m_modelChara.GetAnimation(0);
+        m_guiParams.animationTime = clip.WrapTime(m_guiParams.animationTime + ImGui::GetIO().DeltaTime);
+
+        const auto timeStart = std::chrono::high_resolution_clock::now();
+        m_actorChara->ApplyAnimation(clip, m_guiParams.animationTime);
+        const auto timeEnd = std::chrono::high_resolution_clock::now();
+        m_guiParams.animationSampleUs = std::chrono::duration<double, std::micro>(timeEnd - timeStart).count();
+    } else if (m_actorChara->IsSkinned()) {
         std::shared_ptr<util::DxrModelActor::Node> node;
         node = m_actorChara->SearchNode(L"Ђ.L");
         if (node) {
@@ -167,6 +189,7 @@ void ModelScene::OnUpdate()
     }
 
     // fzuꏊZbg.
+    const auto timeStart = std::chrono::high_resolution_clock::now();
     auto x = 0.75f * sinf(m_frameCount * 0.01f);
     auto z = 0.25f * cosf(m_frameCount * 0.01f) + 0.5f;
     auto mtxTrans = XMMatrixTranslation(x, 0.0f, z);
@@ -185,6 +208,24 @@ void ModelScene::OnUpdate()
     mtxTrans = XMMatrixTranslation(-1.0, 1.04f, -1.0f);
     m_actorPot2->SetWorldMatrix(mtxTrans);
     m_actorPot2->UpdateMatrices();
+
+    // QO̓e[ủɊiqɕׁAĐʒu炵ăAj[V.
+    //  \̊Ԃ͍XVȂ.
+    if (m_guiParams.showCrowd) {
+        const bool playCrowdAnimation = m_guiParams.playAnimation && m_modelChara.GetAnimationCount() > 0;
+        for (UINT i = 0; i < m_crowdChara->GetActorCount(); ++i) {
+            auto actor = m_crowdChara->GetActor(i);
+            if (playCrowdAnimation) {
+                const auto& clip = m_modelChara.GetAnimation(0);
+                actor->ApplyAnimation(clip, clip.WrapTime(m_guiParams.animationTime + 0.37f * i));
+            }
+            auto column = float(i % 4), row = float(i / 4);
+            actor->SetWorldMatrix(XMMatrixTranslation((column - 1.5f) * 1.0f, 0.0f, -3.0f - row * 1.0f));
+        }
+        m_crowdChara->UpdateMatrices();
+    }
+    const auto timeEnd = std::chrono::high_resolution_clock::now();
+    m_guiParams.transformUpdateUs = std::chrono::duration<double, std::micro>(timeEnd - timeStart).count();
 }
 
 void ModelScene::OnRender()
@@ -205,52 +246,13 @@ void ModelScene::OnRender()
     };
     m_commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
-    // XLjOpf[^\XV.
-    if (m_actorChara->IsSkinned()) {
-        // sf[^ GPU ̃obt@ɏ.
-        m_actorChara->ApplyTransform();
+    // XLjO BLAS XVꍇ́Azuł TLAS XV.
+    const bool isGeometryChanged = UpdateSkinning();
 
-        auto model = m_actorChara->GetModel();
-        auto srcPosition = model->GetPositionBuffer();
-        auto srcNormal = model->GetNormalBuffer();
-        auto srcJointWeights = model->GetJointWeightsBuffer();
-        auto srcJointIndices = model->GetJointIndicesBuffer();
-        auto srcJointMatrices = m_actorChara->GetJointMatrixDescriptor();
-        auto dstPosition = m_actorChara->GetDestPositionBuffer();
-        auto dstNormal = m_actorChara->GetDestNormalBuffer();
-        // 
-        m_commandList->SetComputeRootSignature(m_rsSkinningCompute.Get());
-        m_commandList->SetPipelineState(m_psoSkinCompute.Get());
-        m_commandList->SetComputeRootShaderResourceView(0, srcPosition->GetGPUVirtualAddress());
-        m_commandList->SetComputeRootShaderResourceView(1, srcNormal->GetGPUVirtualAddress());
-        m_commandList->SetComputeRootShaderResourceView(2, srcJointWeights->GetGPUVirtualAddress());
-        m_commandList->SetComputeRootShaderResourceView(3, srcJointIndices->GetGPUVirtualAddress());
-        m_commandList->SetComputeRootDescriptorTable(4, srcJointMatrices.hGpu);
-
-        m_commandList->SetComputeRootUnorderedAccessView(5, dstPosition->GetGPUVirtualAddress());
-        m_commandList->SetComputeRootUnorderedAccessView(6, dstNormal->GetGPUVirtualAddress());
-
-        auto vertexCount = m_actorChara->GetSkinVertexCount();
-        m_commandList->Dispatch(vertexCount, 1, 1);
-
-        // obt@XV̂߃oAݒ肷.
-        CD3DX12_RESOURCE_BARRIER barriers[] = {
-            CD3DX12_RESOURCE_BARRIER::UAV(dstPosition.Get()),
-            CD3DX12_RESOURCE_BARRIER::UAV(dstNormal.Get())
-        };
-        m_commandList->ResourceBarrier(_countof(barriers), barriers);
-        m_actorChara->UpdateBLAS(m_commandList);
-    }
+    // XLjOf̊em[h̍s TLAS ̃CX^XsƂēn߁ABLAS ̍XV͕sv.
 
-    // XLjOfsXVsBLASɓns.
-    for (auto& model : { m_actorTable, m_actorPot1, m_actorPot2 }) {
-        model->UpdateMatrices();
-        model->ApplyTransform();
-        model->UpdateBLAS(m_commandList);
-    }
-
-    // ef݂̌̏Ԃ TLAS XV.
-    UpdateSceneTLAS(frameIndex);
+    // zu̕ωf TLAS XV.
+    UpdateSceneTLAS(frameIndex, isGeometryChanged);
 
     m_commandList->SetComputeRootSignature(m_rootSignatureGlobal.Get());
     m_commandList->SetComputeRootDescriptorTable(0, m_tlasDescriptor.hGpu);
@@ -318,7 +320,8 @@ void ModelScene::RenderHUD()
 void ModelScene::CreateSceneTLAS()
 {
     // IuWFNgzu.
-    std::vector<D3D12_RAYTRACING_INSTANCE_DESC> instanceDescs;
+    auto& instanceDescs = m_instanceDescs;
+    instanceDescs.clear();
     DeployObjects(instanceDescs);
 
     auto sizeOfInstanceDescs = UINT(instanceDescs.size() * sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
@@ -367,11 +370,97 @@ void ModelScene::CreateSceneTLAS()
     m_device->WaitForIdleGpu();
 }
 
-void ModelScene::UpdateSceneTLAS(UINT frameIndex)
+bool ModelScene::UpdateSkinning()
 {
-    // IuWFNgzu.
-    std::vector<D3D12_RAYTRACING_INSTANCE_DESC> instanceDescs;
-    DeployObjects(instanceDescs);
+    bool isGeometryChanged = false;
+
+    // XLjO̕؂ւꍇ͎płϊ.
+    const auto skinningMethod = m_guiParams.dualQuaternionSkinning ?
+        util::SkinningMethod::DualQuaternion : util::SkinningMethod::Linear;
+    const bool useDualQuaternion = skinningMethod == util::SkinningMethod::DualQuaternion;
+    const bool isSkinningMethodChanged = m_actorChara->GetSkinningMethod() != skinningMethod;
+    m_actorChara->SetSkinningMethod(skinningMethod);
+
+    // XLjOpf[^\XV.
+    //  ֐߂ĂȂꍇ͕ϊς݂̒_ BLAS ̂܂܎g.
+    if (m_actorChara->IsSkinned() && (m_actorChara->IsPoseChanged() || isSkinningMethodChanged)) {
+        // sf[^ GPU ̃obt@ɏ.
+        m_actorChara->ApplyTransform();
+
+        auto jointData = useDualQuaternion ?
+            m_actorChara->GetJointDualQuaternionDescriptor() : m_actorChara->GetJointMatrixDescriptor();
+        DispatchSkinning(
+            m_actorChara->GetModel(), jointData,
+            m_actorChara->GetDestPositionBuffer(), m_actorChara->GetDestNormalBuffer(),
+            m_actorChara->GetSkinVertexCount(), 1, useDualQuaternion);
+        m_actorChara->UpdateBLAS(m_commandList);
+        isGeometryChanged = true;
+    }
+
+    // QO͑S̊֐߃f[^Aobt@֏݁A1̃fBXpb`ŕϊ.
+    //  \̊Ԃ͍sȂ. ̐؂ւ\_Ŕf.
+    if (!m_guiParams.showCrowd) {
+        return isGeometryChanged;
+    }
+    const bool isCrowdMethodChanged = m_crowdChara->GetSkinningMethod() != skinningMethod;
+    m_crowdChara->SetSkinningMethod(skinningMethod);
+    if (m_crowdChara->IsPoseChanged() || isCrowdMethodChanged) {
+        const auto timeStart = std::chrono::high_resolution_clock::now();
+        m_crowdChara->ApplyTransform();
+        const auto timeEnd = std::chrono::high_resolution_clock::now();
+        m_guiParams.crowdPaletteUs = std::chrono::duration<double, std::micro>(timeEnd - timeStart).count();
+
+        auto jointData = useDualQuaternion ?
+            m_crowdChara->GetJointDualQuaternionDescriptor() : m_crowdChara->GetJointMatrixDescriptor();
+        DispatchSkinning(
+            m_crowdChara->GetModel(), jointData,
+            m_crowdChara->GetDestPositionBuffer(), m_crowdChara->GetDestNormalBuffer(),
+            m_crowdChara->GetSkinVertexCount(), m_crowdChara->GetActorCount(), useDualQuaternion);
+        m_crowdChara->UpdateBLAS(m_commandList);
+        isGeometryChanged = true;
+    }
+    return isGeometryChanged;
+}
+
+void ModelScene::UpdateSceneTLAS(UINT frameIndex, bool isGeometryChanged)
+{
+    // s񂪕ωCX^X̂ݏ. т DeployObjects Ɠ.
+    //  BLAS XVꍇ́ACX^X̍s񂪓ł TLAS XVKv.
+    auto& instanceDescs = m_instanceDescs;
+    bool isChanged = isGeometryChanged;
+    UINT instanceStart = 1; // ̎.
+    auto updateFunc = [&](const std::shared_ptr<util::DxrModelActor>& actor) {
+        if (actor->IsTransformChanged()) {
+            actor->UpdateInstanceDescs(&instanceDescs[instanceStart]);
+            isChanged = true;
+        }
+        instanceStart += actor->GetInstanceCount();
+    };
+    for (const auto& actor : { m_actorTable, m_actorPot1, m_actorPot2, m_actorChara }) {
+        updateFunc(actor);
+    }
+    // QO̕\؂ւꍇ InstanceMask .
+    //  \̊Ԃ͍sXVȂ߁ACX^X̍ŝ܂܂Ƃ.
+    const bool isCrowdVisibilityChanged = m_isCrowdVisible != m_guiParams.showCrowd;
+    m_isCrowdVisible = m_guiParams.showCrowd;
+    for (UINT i = 0; i < m_crowdChara->GetActorCount(); ++i) {
+        auto actor = m_crowdChara->GetActor(i);
+        if (isCrowdVisibilityChanged) {
+            for (UINT j = 0; j < actor->GetInstanceCount(); ++j) {
+                instanceDescs[instanceStart + j].InstanceMask = m_isCrowdVisible ? 0xFF : 0;
+            }
+            isChanged = true;
+        }
+        if (m_isCrowdVisible) {
+            updateFunc(actor);
+        } else {
+            instanceStart += actor->GetInstanceCount();
+        }
+    }
+    // SĐÎ~Ăꍇ͑O TLAS ̂܂܎g.
+    if (!isChanged) {
+        return;
+    }
 
     auto sizeOfInstanceDescs = instanceDescs.size();
     sizeOfInstanceDescs *= sizeof(D3D12_RAYTRACING_INSTANCE_DESC);
@@ -408,20 +497,27 @@ void ModelScene::UpdateSceneTLAS(UINT frameIndex)
 
 void ModelScene::PrepareModels()
 {
-    if (m_modelTable.LoadFromGltf(L"table.glb", m_device) == false) {
+    // ǂݍݎ̒ǉ̓R}hCŎw肳ꂽ̂̂ݗLɂȂ.
+    const auto& settings = m_importSettings;
+
+    if (m_modelTable.LoadFromGltf(L"table.glb", m_device, settings) == false) {
         throw std::runtime_error("Failed load model data.");
     }
 
-    if (m_modelPot.LoadFromGltf(L"teapot.glb", m_device) == false) {
+    if (m_modelPot.LoadFromGltf(L"teapot.glb", m_device, settings) == false) {
         throw std::runtime_error("Failed load model data.");
     }
-    if (m_modelChara.LoadFromGltf(L"alicia.glb", m_device) == false) {
+    if (m_modelChara.LoadFromGltf(L"alicia.glb", m_device, settings) == false) {
         throw std::runtime_error("Failed load model data.");
     }
     m_actorTable = m_modelTable.Create(m_device);
     m_actorPot1 = m_modelPot.Create(m_device);
     m_actorPot2 = m_modelPot.Create(m_device);
     m_actorChara = m_modelChara.Create(m_device);
+    m_crowdChara = m_modelChara.CreateCrowd(m_device, CrowdActorCount);
+    if (!m_crowdChara) {
+        throw std::runtime_error("Failed create crowd.");
+    }
 
     auto assignFunc = [](auto actor, const wchar_t* hitgroup) {
         for (UINT i = 0; i < actor->GetMaterialCount(); ++i) {
@@ -435,6 +531,9 @@ void ModelScene::PrepareModels()
     assignFunc(m_actorPot1, AppHitGroups::StaticModel);
     assignFunc(m_actorPot2, AppHitGroups::StaticModel);
     assignFunc(m_actorChara, AppHitGroups::CharaModel);
+    for (UINT i = 0; i < m_crowdChara->GetActorCount(); ++i) {
+        assignFunc(m_crowdChara->GetActor(i), AppHitGroups::CharaModel);
+    }
 }
 
 void ModelScene::DeployObjects(std::vector<D3D12_RAYTRACING_INSTANCE_DESC>& instanceDescs)
@@ -451,63 +550,29 @@ void ModelScene::DeployObjects(std::vector<D3D12_RAYTRACING_INSTANCE_DESC>& inst
         desc.AccelerationStructure = m_meshPlane.blas->GetGPUVirtualAddress();
         instanceDescs.push_back(desc);
     }
-    auto index = m_device->GetCurrentFrameIndex();
-    UINT instanceHitGroupOffset = 1;
-    {
-        auto mtxTransform = m_actorTable->GetWorldMatrix();
-        D3D12_RAYTRACING_INSTANCE_DESC desc{};
-        XMStoreFloat3x4(
-            reinterpret_cast<XMFLOAT3X4*>(&desc.Transform), mtxTransform);
-        desc.InstanceID = 0;
-        desc.InstanceMask = 0xFF;
-        desc.InstanceContributionToHitGroupIndex = instanceHitGroupOffset;
-        desc.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-        desc.AccelerationStructure = m_actorTable->GetBLAS()->GetGPUVirtualAddress();
-        instanceDescs.push_back(desc);
-
-        instanceHitGroupOffset += m_actorTable->GetMeshCountAll();
-    }
-    {
-        auto mtxTransform = m_actorPot1->GetWorldMatrix();
-        D3D12_RAYTRACING_INSTANCE_DESC desc{};
-        XMStoreFloat3x4(
-            reinterpret_cast<XMFLOAT3X4*>(&desc.Transform), mtxTransform);
-        desc.InstanceID = 0;
-        desc.InstanceMask = 0xFF;
-        desc.InstanceContributionToHitGroupIndex = instanceHitGroupOffset;
-        desc.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-        desc.AccelerationStructure = m_actorPot1->GetBLAS()->GetGPUVirtualAddress();
-        instanceDescs.push_back(desc);
-
-        instanceHitGroupOffset += m_actorPot1->GetMeshCountAll();
-    }
-    {
-        auto mtxTransform = m_actorPot2->GetWorldMatrix();
-        D3D12_RAYTRACING_INSTANCE_DESC desc{};
-        XMStoreFloat3x4(
-            reinterpret_cast<XMFLOAT3X4*>(&desc.Transform), mtxTransform);
-        desc.InstanceID = 0;
-        desc.InstanceMask = 0xFF;
-        desc.InstanceContributionToHitGroupIndex = instanceHitGroupOffset;
-        desc.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-        desc.AccelerationStructure = m_actorPot2->GetBLAS()->GetGPUVirtualAddress();
-        instanceDescs.push_back(desc);
-
-        instanceHitGroupOffset += m_actorPot2->GetMeshCountAll();
+    // ef̓m[hƂ̃CX^XƂĔzu.
+    //  qbgO[ṽR[h̓f̃bVPʂŕׂĂ邽߁A̐Jnʒu炷.
+    //  f琶 Pot ̓bVL邽߁AR[hL.
+    const UINT tableHitGroupOffset = 1;
+    const UINT potHitGroupOffset = tableHitGroupOffset + m_actorTable->GetMeshCountAll();
+    const UINT charaHitGroupOffset = potHitGroupOffset + m_actorPot1->GetMeshCountAll();
+    m_actorTable->AppendInstanceDescs(instanceDescs, tableHitGroupOffset);
+    m_actorPot1->AppendInstanceDescs(instanceDescs, potHitGroupOffset);
+    m_actorPot2->AppendInstanceDescs(instanceDescs, potHitGroupOffset);
+    m_actorChara->AppendInstanceDescs(instanceDescs, charaHitGroupOffset);
+
+    // QO̊e Actor ͕ϊ̒_̎QƐ悪قȂ邽߁AActor ƂɃR[h.
+    //  \̏ꍇ InstanceMask  0 ƂăCȂ悤ɂ.
+    UINT crowdHitGroupOffset = charaHitGroupOffset + m_actorChara->GetMeshCountAll();
+    const size_t crowdInstanceStart = instanceDescs.size();
+    for (UINT i = 0; i < m_crowdChara->GetActorCount(); ++i) {
+        auto actor = m_crowdChara->GetActor(i);
+        actor->AppendInstanceDescs(instanceDescs, crowdHitGroupOffset);
+        crowdHitGroupOffset += actor->GetMeshCountAll();
     }
-    {
-        auto mtxTransform = m_actorChara->GetWorldMatrix();
-        D3D12_RAYTRACING_INSTANCE_DESC desc{};
-        XMStoreFloat3x4(
-            reinterpret_cast<XMFLOAT3X4*>(&desc.Transform), mtxTransform);
-        desc.InstanceID = 0;
-        desc.InstanceMask = 0xFF;
-        desc.InstanceContributionToHitGroupIndex = instanceHitGroupOffset;
-        desc.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-        desc.AccelerationStructure = m_actorChara->GetBLAS()->GetGPUVirtualAddress();
-        instanceDescs.push_back(desc);
-
-        instanceHitGroupOffset += m_actorChara->GetMeshCountAll();
+    m_isCrowdVisible = m_guiParams.showCrowd;
+    for (size_t i = crowdInstanceStart; i < instanceDescs.size(); ++i) {
+        instanceDescs[i].InstanceMask = m_isCrowdVisible ? 0xFF : 0;
     }
 }
 
@@ -632,9 +697,10 @@ void ModelScene::CreateSkinningPipeline()
     rshelper.Add(RootType::SRV, 1); // t1: Normal (in)
     rshelper.Add(RootType::SRV, 2); // t2: Weights (in)
     rshelper.Add(RootType::SRV, 3); // t3: Indices (in)
-    rshelper.Add(RangeType::SRV, 4); // t4: s̃obt@(in).
+    rshelper.Add(RangeType::SRV, 4); // t4: s(܂̓fANH[^jI)̃obt@(in).
     rshelper.Add(RootType::UAV, 0); // u0: Position (out)
     rshelper.Add(RootType::UAV, 1); // u1: Normal (out)
+    rshelper.Add(RootType::CBV, 0); // b0: ֐ߔԍEEFCǧ`.
     m_rsSkinningCompute = rshelper.Create(m_device, false, L"csRootSignature");
     
     D3D12_COMPUTE_PIPELINE_STATE_DESC pipelineDesc{};
@@ -644,6 +710,48 @@ void ModelScene::CreateSkinningPipeline()
     m_device->GetDevice()->CreateComputePipelineState(
         &pipelineDesc, IID_PPV_ARGS(&m_psoSkinCompute)
     );
+
+    // fANH[^jIɂXLjOp. [gVOl`͋.
+    std::vector<char> shaderDQ;
+    util::LoadFile(shaderDQ, L"SkinningComputeDQ.cso");
+    pipelineDesc.CS.BytecodeLength = shaderDQ.size();
+    pipelineDesc.CS.pShaderBytecode = shaderDQ.data();
+    m_device->GetDevice()->CreateComputePipelineState(
+        &pipelineDesc, IID_PPV_ARGS(&m_psoSkinComputeDQ)
+    );
+}
+
+void ModelScene::DispatchSkinning(
+    const util::DxrModel* model, dx12::Descriptor jointData,
+    ComPtr<ID3D12Resource> dstPosition, ComPtr<ID3D12Resource> dstNormal,
+    UINT vertexCount, UINT instanceCount, bool useDualQuaternion)
+{
+    auto srcPosition = model->GetPositionBuffer();
+    auto srcNormal = model->GetNormalBuffer();
+    auto srcJointWeights = model->GetJointWeightsBuffer();
+    auto srcJointIndices = model->GetJointIndicesBuffer();
+
+    m_commandList->SetComputeRootSignature(m_rsSkinningCompute.Get());
+    m_commandList->SetPipelineState(useDualQuaternion ? m_psoSkinComputeDQ.Get() : m_psoSkinCompute.Get());
+    m_commandList->SetComputeRootShaderResourceView(0, srcPosition->GetGPUVirtualAddress());
+    m_commandList->SetComputeRootShaderResourceView(1, srcNormal->GetGPUVirtualAddress());
+    m_commandList->SetComputeRootShaderResourceView(2, srcJointWeights->GetGPUVirtualAddress());
+    m_commandList->SetComputeRootShaderResourceView(3, srcJointIndices->GetGPUVirtualAddress());
+    m_commandList->SetComputeRootDescriptorTable(4, jointData.hGpu);
+
+    m_commandList->SetComputeRootUnorderedAccessView(5, dstPosition->GetGPUVirtualAddress());
+    m_commandList->SetComputeRootUnorderedAccessView(6, dstNormal->GetGPUVirtualAddress());
+    m_commandList->SetComputeRootConstantBufferView(7, model->GetSkinningParametersBuffer()->GetGPUVirtualAddress());
+
+    // Y  Actor ̔ԍƂȂ.
+    m_commandList->Dispatch(vertexCount, instanceCount, 1);
+
+    // obt@XV̂߃oAݒ肷.
+    CD3DX12_RESOURCE_BARRIER barriers[] = {
+        CD3DX12_RESOURCE_BARRIER::UAV(dstPosition.Get()),
+        CD3DX12_RESOURCE_BARRIER::UAV(dstNormal.Get())
+    };
+    m_commandList->ResourceBarrier(_countof(barriers), barriers);
 }
 
 void ModelScene::CreateStateObject()
@@ -826,7 +934,6 @@ void ModelScene::CreateModelLocalRootSignature()
     rshelper.Add(RangeType::SRV, 3, spaceGeom); // t3, _UV.
     rshelper.Add(RangeType::SRV, 0, spaceMate); // t0, fBt[YeNX`.
     rshelper.Add(RootType::CBV, 0, spaceMate); // b0, bV`pp[^.
-    rshelper.Add(RangeType::SRV, 4, spaceGeom); // t4,
     const auto isLocal = true;
     m_rsModel = rshelper.Create(m_device, isLocal, L"lrsModel");
 }
@@ -874,11 +981,15 @@ void ModelScene::CreateShaderTable()
     hitGroupCount += 1; // .
 
     // f̒ɎĂ BLAS ̃bVlăJEg.
-    for (const auto& model : { m_actorTable, /*m_actorChara,*/ m_actorPot1, m_actorPot2 }) {
+    //  Pot2  Pot1 ƃbVL邽߁AR[hL.
+    for (const auto& model : { m_actorTable, m_actorPot1, m_actorChara }) {
         for (UINT groupIndex = 0; groupIndex < model->GetMeshGroupCount(); ++groupIndex) {
             hitGroupCount += model->GetMeshCount(groupIndex);
         }
     }
+    for (UINT i = 0; i < m_crowdChara->GetActorCount(); ++i) {
+        hitGroupCount += m_crowdChara->GetActor(i)->GetMeshCountAll();
+    }
 
     // VF[_[e[ũTCY߂.
     UINT raygenSize = 1 * raygenRecordSize; // 1 Ray Generation VF[_[.
@@ -953,8 +1064,10 @@ void ModelScene::CreateShaderTable()
         // ef̃Gg.
         recordStart = WriteHitgroupShaderRecord(recordStart, m_actorTable, hitgroupRecordSize);
         recordStart = WriteHitgroupShaderRecord(recordStart, m_actorPot1, hitgroupRecordSize);
-        recordStart = WriteHitgroupShaderRecord(recordStart, m_actorPot2, hitgroupRecordSize);
         recordStart = WriteHitgroupShaderRecord(recordStart, m_actorChara, hitgroupRecordSize);
+        for (UINT i = 0; i < m_crowdChara->GetActorCount(); ++i) {
+            recordStart = WriteHitgroupShaderRecord(recordStart, m_crowdChara->GetActor(i), hitgroupRecordSize);
+        }
     }
 
     m_shaderTable->Unmap(0, nullptr);
@@ -1025,7 +1138,6 @@ uint8_t* ModelScene::WriteHitgroupShaderRecord(uint8_t* dst, std::shared_ptr<uti
             dst += util::WriteGPUDescriptor(dst, mesh.GetTexcoord());
             dst += util::WriteGPUDescriptor(dst, material->GetTextureDescriptor());
             dst += util::WriteGpuResourceAddr(dst, mesh.GetMeshParametersCB());
-            dst += util::WriteGPUDescriptor(dst, actor->GetBLASMatrixDescriptor());
 
             dst = recordStart + hgRecordSize;
         }
@@ -14,7 +14,9 @@ namespace AppHitGroups {
 
 class ModelScene : public DxrBookFramework {
 public:
-    ModelScene(UINT width, UINT height);
+    // importSettings ̓fǂݍݎ̐ݒ. l̂܂܂ł͒ǉ̏sȂ.
+    ModelScene(UINT width, UINT height,
+        const util::DxrModel::ImportSettings& importSettings = util::DxrModel::ImportSettings());
 
     void OnInit() override;
     void OnDestroy() override;
@@ -35,6 +37,13 @@ private:
 
     void CreateSkinningPipeline();
 
+    // XLjÕRs[gVF[_[s.
+    //  instanceCount ̊̕֐߃f[^Əo͐悪AĂꍇ Y ɕׂ1ŏ.
+    void DispatchSkinning(
+        const util::DxrModel* model, dx12::Descriptor jointData,
+        ComPtr<ID3D12Resource> dstPosition, ComPtr<ID3D12Resource> dstNormal,
+        UINT vertexCount, UINT instanceCount, bool useDualQuaternion);
+
     // Cg[VOp StateObject \z܂.
     void CreateStateObject();
 
@@ -58,7 +67,10 @@ private:
 
     void RenderHUD();
 
-    void UpdateSceneTLAS(UINT frameIndex);
+    // XLjOf̒_ BLAS XV. BLAS XVꍇ true Ԃ.
+    bool UpdateSkinning();
+
+    void UpdateSceneTLAS(UINT frameIndex, bool isGeometryChanged);
 
     // ff[^̏.
     void PrepareModels();
@@ -92,6 +104,7 @@ private:
 
     // TLAS 
     util::DynamicBuffer m_instanceDescsBuffer;
+    std::vector<D3D12_RAYTRACING_INSTANCE_DESC> m_instanceDescs; // ݂̔zu. ωCX^X̂ݏ.
     ComPtr<ID3D12Resource> m_tlas;
     ComPtr<ID3D12Resource> m_tlasUpdate;
     dx12::Descriptor m_tlasDescriptor;
@@ -103,6 +116,7 @@ private:
     ComPtr<ID3D12RootSignature> m_rsModel; // XtBÃ[J[gVOl`.
     ComPtr<ID3D12RootSignature> m_rsSkinningCompute;
     ComPtr<ID3D12PipelineState> m_psoSkinCompute;
+    ComPtr<ID3D12PipelineState> m_psoSkinComputeDQ;
 
     // DXR ʏݗpobt@.
     ComPtr<ID3D12Resource> m_dxrOutput;
@@ -133,12 +147,20 @@ private:
         float elbowL;
         float elbowR;
         float neck;
+        bool  playAnimation = false;
+        float animationTime = 0.0f;
+        bool  dualQuaternionSkinning = false;
+        double animationSampleUs = 0.0; // Nbv]ɂ.
+        double transformUpdateUs = 0.0; // Sf̃m[hs̍XVɂ.
+        double crowdPaletteUs = 0.0;    // QO̊֐߃f[^݂̏ɂ.
+        bool  showCrowd = false;
     };
     GUIParams m_guiParams;
 
     util::Camera m_camera;
     util::DynamicConstantBuffer m_sceneCB;
 
+    util::DxrModel::ImportSettings m_importSettings;
     util::DxrModel m_modelTable;
     util::DxrModel m_modelPot;
     util::DxrModel m_modelChara;
@@ -147,4 +169,10 @@ private:
     std::shared_ptr<util::DxrModelActor> m_actorPot1;
     std::shared_ptr<util::DxrModelActor> m_actorPot2;
     std::shared_ptr<util::DxrModelActor> m_actorChara;
+
+    // LN^[fׂQO. XLjO͑S܂Ƃ߂čs.
+    //  \̊Ԃ InstanceMask  0 ƂăCȂ悤ɂAXVƃXLjOsȂ.
+    static const UINT CrowdActorCount = 16;
+    std::shared_ptr<util::DxrModelCrowd> m_crowdChara;
+    bool m_isCrowdVisible = false;  // CX^X̃}XN֔fς݂̕\.
 };
\ No newline at end of file
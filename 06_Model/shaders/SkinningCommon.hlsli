@@ -0,0 +1,26 @@
+// ֐ߔԍƃEFCg͌` 2 ނ邽߁AoCgƂĎQƂ.
+//  0: uint4 / float4, 1: 8bit x4 (uint / unorm).
+ByteAddressBuffer srcJointWeightsBuffer : register(t2);
+ByteAddressBuffer srcJointIndicesBuffer : register(t3);
+
+// QOł SV_DispatchThreadID.y  Actor ̔ԍƂA1̂̐炵ĎQƂ.
+cbuffer SkinningParameters : register(b0)
+{
+    uint influenceEncoding;
+    uint jointCount;  // 1̂̊֐ߐ.
+    uint vertexCount; // 1̂̒_.
+};
+
+void LoadInfluences(uint index, out uint4 jointIndices, out float4 jointWeights)
+{
+    if (influenceEncoding == 1) {
+        uint joints = srcJointIndicesBuffer.Load(index * 4);
+        uint weights = srcJointWeightsBuffer.Load(index * 4);
+        uint4 shift = uint4(0, 8, 16, 24);
+        jointIndices = (joints >> shift) & 0xFF;
+        jointWeights = float4((weights >> shift) & 0xFF) / 255.0;
+    } else {
+        jointIndices = srcJointIndicesBuffer.Load4(index * 16);
+        jointWeights = asfloat(srcJointWeightsBuffer.Load4(index * 16));
+    }
+}
@@ -1,7 +1,7 @@
+#include "SkinningCommon.hlsli"
+
 StructuredBuffer<float3> srcPositionBuffer : register(t0);
 StructuredBuffer<float3> srcNormalBuffer : register(t1);
-StructuredBuffer<float4> srcJointWeightsBuffer : register(t2);
-StructuredBuffer<uint4>  srcJointIndicesBuffer : register(t3);
 StructuredBuffer<float4x4> srcJointMatrices : register(t4);
 
 
@@ -12,20 +12,23 @@ RWStructuredBuffer<float3> dstNormalBuffer : register(u1);
 void mainCS( uint3 dtid : SV_DispatchThreadID )
 {
     int index = dtid.x;
+    uint jointBase = dtid.y * jointCount;
+    uint dstIndex = dtid.y * vertexCount + index;
     float3 position = srcPositionBuffer[index];
     float3 normal = srcNormalBuffer[index];
 
-    uint4 jointIndices = srcJointIndicesBuffer[index];
-    float4 jointWeights = srcJointWeightsBuffer[index];
+    uint4 jointIndices;
+    float4 jointWeights;
+    LoadInfluences(index, jointIndices, jointWeights);
 
     float weights[4] = {
         jointWeights.x, jointWeights.y, jointWeights.z, jointWeights.w,
     };
     float4x4 matrices[4] = {
-        srcJointMatrices[jointIndices.x],
-        srcJointMatrices[jointIndices.y],
-        srcJointMatrices[jointIndices.z],
-        srcJointMatrices[jointIndices.w],
+        srcJointMatrices[jointBase + jointIndices.x],
+        srcJointMatrices[jointBase + jointIndices.y],
+        srcJointMatrices[jointBase + jointIndices.z],
+        srcJointMatrices[jointBase + jointIndices.w],
     };
     float4x4 mtx = (float4x4)0;
     for (int i = 0; i < 4; ++i) {
@@ -35,6 +38,6 @@ void mainCS( uint3 dtid : SV_DispatchThreadID )
     float4 deformPos = mul(float4(position, 1), mtx);
     float3 deformNrm = mul(normal, (float3x3)mtx);
 
-    dstPositionBuffer[index] = deformPos.xyz;
-    dstNormalBuffer[index] = normalize(deformNrm);
+    dstPositionBuffer[dstIndex] = deformPos.xyz;
+    dstNormalBuffer[dstIndex] = normalize(deformNrm);
 }
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "SkinningCommon.hlsli"
+
+StructuredBuffer<float3> srcPositionBuffer : register(t0);
+StructuredBuffer<float3> srcNormalBuffer : register(t1);
+// ֐߂Ƃ [, oΕ]  2 vf.
+//  QOł Actor Ƃ̗̈悪֐ߍsƓԊu(֐ߐ x4 vf)ŕ.
+StructuredBuffer<float4> srcJointDualQuats : register(t4);
+
+
+RWStructuredBuffer<float3> dstPositionBuffer : register(u0);
+RWStructuredBuffer<float3> dstNormalBuffer : register(u1);
+
+float3 RotateVector(float3 v, float4 q)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+[numthreads(1, 1, 1)]
+void mainCS( uint3 dtid : SV_DispatchThreadID )
+{
+    int index = dtid.x;
+    uint dqBase = dtid.y * jointCount * 4;
+    uint dstIndex = dtid.y * vertexCount + index;
+    float3 position = srcPositionBuffer[index];
+    float3 normal = srcNormalBuffer[index];
+
+    uint4 jointIndices;
+    float4 jointWeights;
+    LoadInfluences(index, jointIndices, jointWeights);
+
+    uint joints[4] = {
+        jointIndices.x, jointIndices.y, jointIndices.z, jointIndices.w,
+    };
+    float weights[4] = {
+        jointWeights.x, jointWeights.y, jointWeights.z, jointWeights.w,
+    };
+
+    // q  -q ͓]̂߁Aŏ̊֐߂ƌ낦č.
+    float4 pivot = srcJointDualQuats[dqBase + joints[0] * 2];
+    float4 real = (float4)0;
+    float4 dual = (float4)0;
+    for (int i = 0; i < 4; ++i) {
+        float4 r = srcJointDualQuats[dqBase + joints[i] * 2];
+        float4 d = srcJointDualQuats[dqBase + joints[i] * 2 + 1];
+        float w = dot(pivot, r) < 0 ? -weights[i] : weights[i];
+        real += r * w;
+        dual += d * w;
+    }
+    float invLength = 1.0 / length(real);
+    real *= invLength;
+    dual *= invLength;
+
+    // sړ 2 * dual * conj(real) ̃xNg.
+    float3 translation = 2.0 * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+
+    dstPositionBuffer[dstIndex] = RotateVector(position, real) + translation;
+    dstNormalBuffer[dstIndex] = normalize(RotateVector(normal, real));
+}
\ No newline at end of file
@@ -4,25 +4,27 @@ struct VertexPNT {
     float3 Position;
     float3 Normal;
     float2 Texcoord;
+
+    // eNX`̏ڍדx̌vZp.
+    float3 Edge1;
+    float3 Edge2;
+    float  TexcoordArea;
 };
 
 // Local Root Signature (for HitGroup)
-StructuredBuffer<uint>   indexBuffer : register(t0, space1);
+ByteAddressBuffer        indexBuffer : register(t0, space1);
 StructuredBuffer<float3> vtxPositionBuffer: register(t1, space1);
-StructuredBuffer<float3> vtxNormalBuffer : register(t2, space1);
-StructuredBuffer<float2> vtxTexcoordBuffer:register(t3, space1);
+Buffer<float3>           vtxNormalBuffer : register(t2, space1);  // R32G32B32_FLOAT or R16G16_SNORM
+Buffer<float2>           vtxTexcoordBuffer:register(t3, space1);  // R32G32_FLOAT or R16G16_FLOAT
 
 Texture2D<float4> texDiffuse: register(t0, space2);
 
 struct MeshParameter {
     float4 diffuseColor;
-    uint matrixBufferStride;
-    uint matrixIndex;
+    uint indexStride; // CfbNX1̃oCg(2 or 4).
+    uint normalEncoding; // 0: float3, 1: ʑ̃GR[h.
 };
 ConstantBuffer<MeshParameter> meshParams : register(b0, space2);
-// BLAS ̍spf[^.
-StructuredBuffer<float4> blasMatrixBuffer : register(t4, space1);
-
 
 float4x4 GetTlasMatrix44() {
     float4x4 mtxTlas;
@@ -35,51 +37,79 @@ float4x4 GetTlasMatrix44() {
     return mtxTlas;
 }
 
-float4x4 GetBlasMatrix44() {
-    int matrixRange = meshParams.matrixBufferStride; // float4Zł̌.
-    int frameOffset = matrixRange * gSceneParam.frameIndex;
-    // matrixIndexXMFLOAT3X4Pʂł̃CfbNXl.
-    int index = meshParams.matrixIndex * 3; 
-    index += frameOffset; // ݃t[ŃANZXׂs̏ꏊ.
-
-    // float4 ̃f[^VF[_[Ŏg߂float4x4s\.
-    float4 m0 = blasMatrixBuffer[index + 0];
-    float4 m1 = blasMatrixBuffer[index + 1];
-    float4 m2 = blasMatrixBuffer[index + 2];
-
-    float4x4 mtx;
-    mtx[0] = m0;
-    mtx[1] = m1;
-    mtx[2] = m2;
-    mtx[3] = float4(0, 0, 0, 1);
-    return transpose(mtx);
+// qbgOp`̒_CfbNX擾.
+//  16bit CfbNX̏ꍇ 4 oCgEǂݎĎo.
+uint3 GetTriangleIndices(uint primitiveIndex) {
+    if (meshParams.indexStride == 2) {
+        uint offset = primitiveIndex * 3 * 2;
+        uint2 words = indexBuffer.Load2(offset & ~3);
+        if ((offset & 2) == 0) {
+            return uint3(words.x & 0xFFFF, words.x >> 16, words.y & 0xFFFF);
+        }
+        return uint3(words.x >> 16, words.y & 0xFFFF, words.y >> 16);
+    }
+    return indexBuffer.Load3(primitiveIndex * 3 * 4);
 }
 
+float3 GetVertexNormal(uint index) {
+    float3 n = vtxNormalBuffer[index];
+    if (meshParams.normalEncoding == 1) {
+        n = DecodeOctahedralNormal(n.xy);
+    }
+    return n;
+}
 
 VertexPNT GetHitVertexPNT(MyAttribute attrib)
 {
     VertexPNT v = (VertexPNT)0;
     float3 barycentrics = CalcBarycentrics(attrib.barys);
-    uint start = PrimitiveIndex() * 3; // Triangle List ̂.
+    uint3 indices = GetTriangleIndices(PrimitiveIndex()); // Triangle List ̂.
 
     float3 positions[3], normals[3];
     float2 texcoords[3];
     for (int i = 0; i < 3; ++i) {
-        uint index = indexBuffer[start + i];
+        uint index = indices[i];
         positions[i] = vtxPositionBuffer[index];
-        normals[i] = vtxNormalBuffer[index];
+        normals[i] = GetVertexNormal(index);
         texcoords[i] = vtxTexcoordBuffer[index];
     }
     v.Position = CalcHitAttribute3(positions, attrib.barys);
     v.Normal = CalcHitAttribute3(normals, attrib.barys);
     v.Texcoord = CalcHitAttribute2(texcoords, attrib.barys);
     v.Normal = normalize(v.Normal);
+
+    // Op`̕ӂ UV Ԃł̖ʐ(slӌ`̖ʐ).
+    float2 uv1 = texcoords[1] - texcoords[0];
+    float2 uv2 = texcoords[2] - texcoords[0];
+    v.Edge1 = positions[1] - positions[0];
+    v.Edge2 = positions[2] - positions[0];
+    v.TexcoordArea = abs(uv1.x * uv2.y - uv1.y * uv2.x);
     return v;
 }
 
-float3 GetDiffuse(float2 uv) {
+// CR[̋ߎɂeNX`̏ڍדx(~bvx)߂.
+//  f̍Lp̓vWFNVsƏo͉𑜓x狁߁A
+//  ˃Cł͒ŐԂ݂̋̂ŋߎ.
+float CalcTextureLod(VertexPNT vtx, float4x4 mtx, float3 worldNormal) {
+    uint width, height, levels;
+    texDiffuse.GetDimensions(0, width, height, levels);
+
+    float3 e1 = mul(vtx.Edge1, (float3x3)mtx);
+    float3 e2 = mul(vtx.Edge2, (float3x3)mtx);
+    float worldArea = max(length(cross(e1, e2)), 1e-12);
+    float texelArea = vtx.TexcoordArea * width * height;
+
+    float spreadAngle = 2.0 / (gSceneParam.mtxProj._22 * DispatchRaysDimensions().y);
+    float coneWidth = RayTCurrent() * spreadAngle;
+    float cosine = max(abs(dot(normalize(WorldRayDirection()), worldNormal)), 1e-3);
+
+    float lod = 0.5 * log2(texelArea / worldArea) + log2(coneWidth / cosine);
+    return clamp(lod, 0, float(levels - 1));
+}
+
+float3 GetDiffuse(float2 uv, float lod) {
     float3 diffuse = meshParams.diffuseColor.xyz;
-    diffuse *= texDiffuse.SampleLevel(gSampler, uv, 0).xyz;
+    diffuse *= texDiffuse.SampleLevel(gSampler, uv, lod).xyz;
     return diffuse;
 }
 
@@ -110,11 +140,9 @@ void mainModelCHS(inout Payload payload, MyAttribute attrib) {
         return;
     }
     VertexPNT vtx = GetHitVertexPNT(attrib);
-//    float3 v = blasMatrix.blasMatrix._m30_m31_m32;
 
-    float4x4 mtxBlas = GetBlasMatrix44();
-    float4x4 mtxTlas = GetTlasMatrix44();
-    float4x4 mtx = mul(mtxBlas, mtxTlas);
+    // m[h̍s̓CX^X̍sɊ܂܂.
+    float4x4 mtx = GetTlasMatrix44();
 
     float3 worldPosition = mul(float4(vtx.Position, 1), mtx).xyz;
     float3 worldNormal = mul(vtx.Normal, (float3x3)mtx);
@@ -123,7 +151,7 @@ void mainModelCHS(inout Payload payload, MyAttribute attrib) {
     worldNormal = normalize(worldNormal);
     toEyeDirection = normalize(toEyeDirection);
    
-    float3 diffuse = GetDiffuse(vtx.Texcoord);
+    float3 diffuse = GetDiffuse(vtx.Texcoord, CalcTextureLod(vtx, mtx, worldNormal));
     float3 color = doLambert(worldNormal, diffuse);
     color += CalcSpecular(toEyeDirection, worldNormal);
 
@@ -147,9 +175,7 @@ void mainModelCharaCHS(inout Payload payload, MyAttribute attrib) {
     }
     VertexPNT vtx = GetHitVertexPNT(attrib);
 
-    float4x4 mtxBlas = GetBlasMatrix44();
-    float4x4 mtxTlas = GetTlasMatrix44();
-    float4x4 mtx = mul(mtxBlas, mtxTlas);
+    float4x4 mtx = GetTlasMatrix44();
 
     float3 worldPosition = mul(float4(vtx.Position, 1), mtx).xyz;
 
@@ -159,7 +185,7 @@ void mainModelCharaCHS(inout Payload payload, MyAttribute attrib) {
     worldNormal = normalize(worldNormal);
     toEyeDirection = normalize(toEyeDirection);
 
-    float3 diffuse = GetDiffuse(vtx.Texcoord);
+    float3 diffuse = GetDiffuse(vtx.Texcoord, CalcTextureLod(vtx, mtx, worldNormal));
     float3 color = doLambert(worldNormal, diffuse);
     // LN^ɂ̓XyLȂɂĂ.
     //color += CalcSpecular(toEyeDirection, worldNormal);
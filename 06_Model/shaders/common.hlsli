@@ -42,6 +42,15 @@ inline float2 CalcHitAttribute2(float2 vertexAttribute[3], float2 barycentrics)
     return ret;
 }
 
+// ʑ̃GR[hꂽ@(snorm16x2 œǂݎl)𕜌.
+float3 DecodeOctahedralNormal(float2 e)
+{
+    float3 n = float3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy -= (step(0.0, n.xy) * 2.0 - 1.0) * t;
+    return normalize(n);
+}
+
 float3 CalcHitAttribute3(float3 vertexAttribute[3], float2 barycentrics)
 {
     float3 ret;
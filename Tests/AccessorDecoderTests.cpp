@@ -0,0 +1,317 @@
+﻿#include "TestFramework.h"
+#include "util/AccessorDecoder.h"
+
+#include <cstring>
+
+using util::AccessorLayout;
+using util::ComponentType;
+
+namespace {
+    const ComponentType AllComponentTypes[] = {
+        ComponentType::Byte, ComponentType::UnsignedByte,
+        ComponentType::Short, ComponentType::UnsignedShort,
+        ComponentType::UnsignedInt, ComponentType::Float,
+    };
+
+    const char* GetComponentTypeName(ComponentType type) {
+        switch (type) {
+        case ComponentType::Byte: return "s8";
+        case ComponentType::UnsignedByte: return "u8";
+        case ComponentType::Short: return "s16";
+        case ComponentType::UnsignedShort: return "u16";
+        case ComponentType::UnsignedInt: return "u32";
+        case ComponentType::Float: return "f32";
+        }
+        return "?";
+    }
+
+    // 決まった系列を返す簡易な乱数.
+    class Random {
+    public:
+        explicit Random(uint32_t seed) : m_state(seed) { }
+        uint32_t Next() {
+            m_state = m_state * 1664525u + 1013904223u;
+            return m_state >> 8;
+        }
+    private:
+        uint32_t m_state;
+    };
+
+    // 要素の間に stride - elementSize バイトの隙間を持つデータを作る.
+    //  成分の値は乱数とし、先頭の要素には各型の最小値・最大値を入れておく.
+    std::vector<uint8_t> CreateComponentData(
+        ComponentType type, uint32_t componentCount, size_t count, size_t stride, uint32_t seed) {
+        const auto componentSize = util::GetComponentSize(type);
+        std::vector<uint8_t> data(stride * count, 0xCD);
+        Random random(seed);
+        for (size_t i = 0; i < count; ++i) {
+            for (uint32_t c = 0; c < componentCount; ++c) {
+                auto p = data.data() + i * stride + c * componentSize;
+                const auto k = i * componentCount + c;
+                if (type == ComponentType::Float) {
+                    float v = float(int32_t(random.Next() & 0xFFFF) - 0x8000) / 256.0f;
+                    memcpy(p, &v, sizeof(v));
+                } else {
+                    uint32_t v = random.Next();
+                    if (k == 0) { v = 0x80808080u; } // 符号付きの最小値(-128, -32768).
+                    if (k == 1) { v = 0x7F7F7F7Fu; }
+                    if (k == 2) { v = 0xFFFFFFFFu; }
+                    if (k == 3) { v = 0; }
+                    memcpy(p, &v, componentSize);
+                }
+            }
+        }
+        return data;
+    }
+
+    // 一括変換の境界(8 または 16 成分単位)の前後と端数を含む要素数.
+    const size_t ElementCounts[] = { 1, 2, 3, 4, 5, 7, 8, 15, 16, 17, 31, 33, 257 };
+
+    // DecodeAccessor の結果を、成分ごとに ReadComponentAsFloat で読み取った値と比較する.
+    //  dst の末尾には書き込まれないことを確認するための番兵を置く.
+    void CheckFloatDecode(
+        ComponentType type, uint32_t componentCount, uint32_t dstComponents,
+        size_t count, size_t extraStride, bool normalized) {
+        const auto componentSize = util::GetComponentSize(type);
+        const auto elementSize = componentSize * componentCount;
+        const auto stride = elementSize + extraStride;
+        const auto data = CreateComponentData(type, componentCount, count, stride, uint32_t(count * 31 + componentCount));
+
+        AccessorLayout layout;
+        layout.data = data.data();
+        layout.count = count;
+        layout.stride = extraStride ? stride : 0;
+        layout.componentType = type;
+        layout.componentCount = componentCount;
+        layout.normalized = normalized;
+
+        const float Sentinel = 12345.0f;
+        std::vector<float> decoded(count * dstComponents + 1, Sentinel);
+        util::DecodeAccessor(decoded.data(), dstComponents, layout);
+
+        bool isMatched = true;
+        for (size_t i = 0; i < count; ++i) {
+            for (uint32_t c = 0; c < dstComponents; ++c) {
+                float expected = 0.0f;
+                if (c < componentCount) {
+                    expected = util::ReadComponentAsFloat(
+                        data.data() + i * stride + c * componentSize, type, normalized);
+                }
+                isMatched &= (memcmp(&decoded[i * dstComponents + c], &expected, sizeof(float)) == 0);
+            }
+        }
+        if (!isMatched) {
+            test::Log("mismatch: %s x%u -> x%u, count %zu, stride +%zu, normalized %d",
+                GetComponentTypeName(type), componentCount, dstComponents, count, extraStride, int(normalized));
+        }
+        CHECK(isMatched);
+        CHECK(decoded.back() == Sentinel);
+    }
+
+    void CheckUintDecode(
+        ComponentType type, uint32_t componentCount, uint32_t dstComponents,
+        size_t count, size_t extraStride) {
+        const auto componentSize = util::GetComponentSize(type);
+        const auto elementSize = componentSize * componentCount;
+        const auto stride = elementSize + extraStride;
+        const auto data = CreateComponentData(type, componentCount, count, stride, uint32_t(count * 17 + componentCount));
+
+        AccessorLayout layout;
+        layout.data = data.data();
+        layout.count = count;
+        layout.stride = extraStride ? stride : 0;
+        layout.componentType = type;
+        layout.componentCount = componentCount;
+
+        const uint32_t Sentinel = 0xDEADBEEFu;
+        std::vector<uint32_t> decoded(count * dstComponents + 1, Sentinel);
+        util::DecodeAccessor(decoded.data(), dstComponents, layout);
+
+        bool isMatched = true;
+        for (size_t i = 0; i < count; ++i) {
+            for (uint32_t c = 0; c < dstComponents; ++c) {
+                uint32_t expected = 0;
+                if (c < componentCount) {
+                    expected = util::ReadComponentAsUint(data.data() + i * stride + c * componentSize, type);
+                }
+                isMatched &= (decoded[i * dstComponents + c] == expected);
+            }
+        }
+        if (!isMatched) {
+            test::Log("mismatch: %s x%u -> x%u, count %zu, stride +%zu",
+                GetComponentTypeName(type), componentCount, dstComponents, count, extraStride);
+        }
+        CHECK(isMatched);
+        CHECK(decoded.back() == Sentinel);
+    }
+}
+
+// 成分の型 x 正規化の有無 x 密/インターリーブの全組み合わせで、一括変換が成分単位の読み取りと一致すること.
+TEST_CASE(AccessorDecoder_FloatMatchesScalarReference)
+{
+    for (auto type : AllComponentTypes) {
+        for (bool normalized : { false, true }) {
+            if (type == ComponentType::Float && normalized) {
+                continue;
+            }
+            for (uint32_t componentCount = 1; componentCount <= 4; ++componentCount) {
+                for (auto count : ElementCounts) {
+                    // 密に詰まったデータ(一括変換)と、隙間を持つデータ(要素単位の変換).
+                    CheckFloatDecode(type, componentCount, componentCount, count, 0, normalized);
+                    CheckFloatDecode(type, componentCount, componentCount, count, 4, normalized);
+                    CheckFloatDecode(type, componentCount, componentCount, count, 1, normalized);
+                    // 出力の成分数が異なる場合は切り捨て・0 埋め.
+                    CheckFloatDecode(type, componentCount, componentCount + 1, count, 0, normalized);
+                    if (componentCount > 1) {
+                        CheckFloatDecode(type, componentCount, componentCount - 1, count, 0, normalized);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE(AccessorDecoder_UintMatchesScalarReference)
+{
+    for (auto type : AllComponentTypes) {
+        if (type == ComponentType::Float) {
+            continue;
+        }
+        for (uint32_t componentCount = 1; componentCount <= 4; ++componentCount) {
+            for (auto count : ElementCounts) {
+                CheckUintDecode(type, componentCount, componentCount, count, 0);
+                CheckUintDecode(type, componentCount, componentCount, count, 4);
+                CheckUintDecode(type, componentCount, componentCount, count, 2);
+                CheckUintDecode(type, componentCount, componentCount + 1, count, 0);
+            }
+        }
+    }
+}
+
+// snorm の最小値(-128, -32768)は -1 にクランプされること. SSE2 の処理範囲と端数の両方で確認する.
+TEST_CASE(AccessorDecoder_SnormClampsToMinusOne)
+{
+    for (size_t count : { size_t(5), size_t(16), size_t(21) }) {
+        std::vector<int8_t> bytes(count, -128);
+        bytes[1] = -127;
+        bytes[2] = 127;
+        AccessorLayout layout;
+        layout.data = reinterpret_cast<const uint8_t*>(bytes.data());
+        layout.count = count;
+        layout.componentType = ComponentType::Byte;
+        layout.normalized = true;
+        std::vector<float> decoded(count);
+        util::DecodeAccessor(decoded.data(), 1, layout);
+        for (size_t i = 0; i < count; ++i) {
+            if (i == 2) {
+                CHECK(decoded[i] == 1.0f);
+            } else {
+                CHECK(decoded[i] == -1.0f);
+            }
+        }
+
+        std::vector<int16_t> shorts(count, -32768);
+        shorts[1] = -32767;
+        shorts[2] = 32767;
+        layout.data = reinterpret_cast<const uint8_t*>(shorts.data());
+        layout.componentType = ComponentType::Short;
+        util::DecodeAccessor(decoded.data(), 1, layout);
+        for (size_t i = 0; i < count; ++i) {
+            if (i == 2) {
+                CHECK(decoded[i] == 1.0f);
+            } else {
+                CHECK(decoded[i] == -1.0f);
+            }
+        }
+
+        // 正規化しない場合はクランプしない.
+        layout.normalized = false;
+        util::DecodeAccessor(decoded.data(), 1, layout);
+        CHECK(decoded[0] == -32768.0f);
+    }
+}
+
+TEST_CASE(AccessorDecoder_NullDataIsZero)
+{
+    AccessorLayout layout;
+    layout.count = 5;
+    layout.componentCount = 3;
+    std::vector<float> decoded(15, 1.0f);
+    util::DecodeAccessor(decoded.data(), 3, layout);
+    CHECK(std::all_of(decoded.begin(), decoded.end(), [](float v) { return v == 0.0f; }));
+
+    std::vector<uint32_t> indices(15, 1);
+    util::DecodeAccessor(indices.data(), 3, layout);
+    CHECK(std::all_of(indices.begin(), indices.end(), [](uint32_t v) { return v == 0; }));
+}
+
+// 形式ごとの展開速度. 密に詰まったデータ(一括変換)、隙間を持つデータ、成分単位の読み取りを比較する.
+BENCHMARK(AccessorDecoder_DecodeThroughput)
+{
+    const size_t ElementCount = 1 << 20;
+    const uint32_t ComponentCount = 4;
+    std::vector<float> decoded(ElementCount * ComponentCount);
+
+    for (auto type : AllComponentTypes) {
+        for (bool normalized : { false, true }) {
+            if (type == ComponentType::Float && normalized) {
+                continue;
+            }
+            const auto componentSize = util::GetComponentSize(type);
+            const auto elementSize = componentSize * ComponentCount;
+            const auto packed = CreateComponentData(type, ComponentCount, ElementCount, elementSize, 1);
+            const auto strided = CreateComponentData(type, ComponentCount, ElementCount, elementSize + 4, 1);
+
+            AccessorLayout layout;
+            layout.count = ElementCount;
+            layout.componentType = type;
+            layout.componentCount = ComponentCount;
+            layout.normalized = normalized;
+
+            layout.data = packed.data();
+            const double packedMs = test::MeasureMilliseconds([&]() {
+                util::DecodeAccessor(decoded.data(), ComponentCount, layout);
+            });
+
+            layout.data = strided.data();
+            layout.stride = elementSize + 4;
+            const double stridedMs = test::MeasureMilliseconds([&]() {
+                util::DecodeAccessor(decoded.data(), ComponentCount, layout);
+            });
+
+            const double scalarMs = test::MeasureMilliseconds([&]() {
+                const auto n = ElementCount * ComponentCount;
+                for (size_t i = 0; i < n; ++i) {
+                    decoded[i] = util::ReadComponentAsFloat(packed.data() + i * componentSize, type, normalized);
+                }
+            });
+
+            const double megaBytes = double(ElementCount * elementSize) / (1024.0 * 1024.0);
+            test::Log("%-3s%s x4: packed %7.3f ms (%7.0f MB/s), strided %7.3f ms, scalar %7.3f ms (x%.1f)",
+                GetComponentTypeName(type), normalized ? "n" : " ",
+                packedMs, megaBytes / (packedMs / 1000.0), stridedMs, scalarMs, scalarMs / packedMs);
+        }
+    }
+
+    // インデックス・ジョイント番号向けの整数展開.
+    std::vector<uint32_t> indices(ElementCount);
+    for (auto type : { ComponentType::UnsignedByte, ComponentType::UnsignedShort, ComponentType::UnsignedInt }) {
+        const auto componentSize = util::GetComponentSize(type);
+        const auto packed = CreateComponentData(type, 1, ElementCount, componentSize, 2);
+        AccessorLayout layout;
+        layout.data = packed.data();
+        layout.count = ElementCount;
+        layout.componentType = type;
+        const double packedMs = test::MeasureMilliseconds([&]() {
+            util::DecodeAccessor(indices.data(), 1, layout);
+        });
+        const double scalarMs = test::MeasureMilliseconds([&]() {
+            for (size_t i = 0; i < ElementCount; ++i) {
+                indices[i] = util::ReadComponentAsUint(packed.data() + i * componentSize, type);
+            }
+        });
+        test::Log("%-3s  x1 -> uint: packed %7.3f ms (%7.0f M/s), scalar %7.3f ms (x%.1f)",
+            GetComponentTypeName(type), packedMs, double(ElementCount) / (packedMs * 1000.0),
+            scalarMs, scalarMs / packedMs);
+    }
+}
@@ -0,0 +1,240 @@
+﻿#include "TestFramework.h"
+#include "util/AffineTransform.h"
+
+using namespace DirectX;
+
+namespace {
+    // 決まった系列を返す簡易な乱数.
+    class Random {
+    public:
+        explicit Random(uint32_t seed) : m_state(seed) { }
+        uint32_t Next() {
+            m_state = m_state * 1664525u + 1013904223u;
+            return m_state >> 8;
+        }
+        float NextFloat() { return float(Next() & 0xFFFF) / 65535.0f; }
+        float NextSigned() { return NextFloat() * 2.0f - 1.0f; }
+    private:
+        uint32_t m_state;
+    };
+
+    // S * R * T のアフィン変換行列を作る.
+    XMMATRIX CreateAffine(Random& random, FXMVECTOR scale, float translationRange) {
+        const auto rotation = XMQuaternionRotationRollPitchYaw(
+            random.NextSigned() * 3.0f, random.NextSigned() * 3.0f, random.NextSigned() * 3.0f);
+        const auto translation = XMVectorScale(
+            XMVectorSet(random.NextSigned(), random.NextSigned(), random.NextSigned(), 0.0f), translationRange);
+        return XMMatrixScalingFromVector(scale) * XMMatrixRotationQuaternion(rotation) * XMMatrixTranslationFromVector(translation);
+    }
+
+    XMMATRIX CreateAffine(Random& random) {
+        return CreateAffine(random, XMVectorSet(
+            0.5f + random.NextFloat(), 0.5f + random.NextFloat(), 0.5f + random.NextFloat(), 0.0f), 10.0f);
+    }
+
+    float GetMaxDifference(FXMMATRIX a, CXMMATRIX b) {
+        float maxDifference = 0.0f;
+        for (int r = 0; r < 4; ++r) {
+            const auto d = XMVectorAbs(XMVectorSubtract(a.r[r], b.r[r]));
+            maxDifference = std::max(maxDifference, std::max(
+                std::max(XMVectorGetX(d), XMVectorGetY(d)), std::max(XMVectorGetZ(d), XMVectorGetW(d))));
+        }
+        return maxDifference;
+    }
+
+    // アフィン変換の逆行列を double で求め、float の結果との差を要素の大きさに対する比で返す.
+    double GetInverseError(FXMMATRIX m, CXMMATRIX inverse) {
+        XMFLOAT4X4 src, inv;
+        XMStoreFloat4x4(&src, m);
+        XMStoreFloat4x4(&inv, inverse);
+        double a[3][3], r[4][3];
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                a[i][j] = src.m[i][j];
+            }
+        }
+        const double det =
+            a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+            a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+            a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                // 余因子行列の転置.
+                const int j1 = (j + 1) % 3, j2 = (j + 2) % 3, i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+                r[i][j] = (a[j1][i1] * a[j2][i2] - a[j1][i2] * a[j2][i1]) / det;
+            }
+        }
+        for (int j = 0; j < 3; ++j) {
+            r[3][j] = -(src.m[3][0] * r[0][j] + src.m[3][1] * r[1][j] + src.m[3][2] * r[2][j]);
+        }
+        double maxMagnitude = 0.0, maxError = 0.0;
+        for (int i = 0; i < 4; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                maxMagnitude = std::max(maxMagnitude, std::abs(r[i][j]));
+                maxError = std::max(maxError, std::abs(r[i][j] - double(inv.m[i][j])));
+            }
+        }
+        return maxError / maxMagnitude;
+    }
+
+    // ComputeJointPalette 導入前と同じく、4x4 の汎用演算で関節行列を求める.
+    void ComputeJointPaletteReference(
+        const XMMATRIX* invBindMatrices, const XMFLOAT3X4A* worldMatrices,
+        const uint32_t* jointIndices, size_t jointCount, FXMMATRIX mtxMeshInv, XMFLOAT4X4* output) {
+        for (size_t i = 0; i < jointCount; ++i) {
+            const XMMATRIX world = XMLoadFloat3x4A(&worldMatrices[jointIndices[i]]);
+            const XMMATRIX mtx = XMMatrixMultiply(XMMatrixMultiply(invBindMatrices[i], world), mtxMeshInv);
+            XMStoreFloat4x4(&output[i], XMMatrixTranspose(mtx));
+        }
+    }
+
+    // 関節数 jointCount のパレットの入力. 関節の参照先はノード配列の中に散らばるようにする.
+    struct PaletteInput {
+        std::vector<XMMATRIX> invBindMatrices;
+        std::vector<XMFLOAT3X4A> worldMatrices;
+        std::vector<uint32_t> jointIndices;
+        XMMATRIX meshInv;
+    };
+
+    PaletteInput CreatePaletteInput(size_t jointCount, uint32_t seed) {
+        Random random(seed);
+        PaletteInput input;
+        input.worldMatrices.resize(jointCount * 2);
+        for (auto& world : input.worldMatrices) {
+            XMStoreFloat3x4A(&world, CreateAffine(random));
+        }
+        for (size_t i = 0; i < jointCount; ++i) {
+            input.invBindMatrices.push_back(XMMatrixInverse(nullptr, CreateAffine(random)));
+            input.jointIndices.push_back(uint32_t((i * 7 + random.Next() % 2) % input.worldMatrices.size()));
+        }
+        input.meshInv = util::InverseAffine(CreateAffine(random));
+        return input;
+    }
+}
+
+// MultiplyAffine が XMMatrixMultiply と一致すること(b は射影を含む任意の行列).
+TEST_CASE(AffineTransform_MultiplyAffineMatchesXMMatrixMultiply)
+{
+    Random random(1);
+    float maxDifference = 0.0f;
+    for (int i = 0; i < 1000; ++i) {
+        const auto a = CreateAffine(random);
+        auto b = CreateAffine(random);
+        if (i % 2) {
+            b = XMMatrixMultiply(b, XMMatrixPerspectiveFovLH(0.8f, 1.5f, 0.1f, 100.0f));
+        }
+        maxDifference = std::max(maxDifference, GetMaxDifference(util::MultiplyAffine(a, b), XMMatrixMultiply(a, b)));
+    }
+    test::Log("max difference %g", maxDifference);
+    CHECK(maxDifference < 1.0e-4f);
+}
+
+// InverseAffine の精度を double で求めた逆行列と比べ、XMMatrixInverse と同程度であること.
+//  スケールが極端に小さい・大きい、軸ごとに大きく異なる(特異に近い)行列も含める.
+TEST_CASE(AffineTransform_InverseAffineMatchesXMMatrixInverse)
+{
+    struct Case {
+        const char* name;
+        XMFLOAT3 scale;
+        float translationRange;
+    };
+    const Case cases[] = {
+        { "unit",            { 1.0f, 1.0f, 1.0f },       10.0f },
+        { "uniform 1e-3",    { 1.0e-3f, 1.0e-3f, 1.0e-3f }, 10.0f },
+        { "uniform 1e3",     { 1.0e3f, 1.0e3f, 1.0e3f },  10.0f },
+        { "far translation", { 1.0f, 1.0f, 1.0f },       1.0e4f },
+        { "non-uniform",     { 1.0e-3f, 1.0f, 1.0e3f },   10.0f },
+        { "near-singular",   { 1.0f, 1.0f, 1.0e-5f },     10.0f },
+    };
+    Random random(2);
+    for (const auto& c : cases) {
+        double maxError = 0.0, maxReferenceError = 0.0;
+        float maxIdentityError = 0.0f;
+        for (int i = 0; i < 200; ++i) {
+            const auto m = CreateAffine(random, XMLoadFloat3(&c.scale), c.translationRange);
+            const auto inverse = util::InverseAffine(m);
+            maxError = std::max(maxError, GetInverseError(m, inverse));
+            maxReferenceError = std::max(maxReferenceError, GetInverseError(m, XMMatrixInverse(nullptr, m)));
+            // 4 列目は厳密に (0,0,0,1) となること.
+            XMFLOAT4X4 stored;
+            XMStoreFloat4x4(&stored, inverse);
+            maxIdentityError = std::max({ maxIdentityError,
+                std::abs(stored._14), std::abs(stored._24), std::abs(stored._34), std::abs(stored._44 - 1.0f) });
+        }
+        test::Log("%-16s InverseAffine %.3g, XMMatrixInverse %.3g (relative to the largest element)",
+            c.name, maxError, maxReferenceError);
+        CHECK(maxError <= std::max(maxReferenceError * 4.0, 1.0e-5));
+        CHECK(maxIdentityError == 0.0f);
+    }
+}
+
+// ComputeJointPalette が 4x4 の汎用演算で求めた関節行列(転置)と一致すること.
+TEST_CASE(AffineTransform_JointPaletteMatchesMatrixMultiply)
+{
+    const size_t JointCount = 256;
+    const auto input = CreatePaletteInput(JointCount, 3);
+    std::vector<XMFLOAT4X4> palette(JointCount), expected(JointCount);
+    util::ComputeJointPalette(
+        input.invBindMatrices.data(), input.worldMatrices.data(), input.jointIndices.data(),
+        JointCount, input.meshInv, palette.data());
+    ComputeJointPaletteReference(
+        input.invBindMatrices.data(), input.worldMatrices.data(), input.jointIndices.data(),
+        JointCount, input.meshInv, expected.data());
+    float maxDifference = 0.0f;
+    for (size_t i = 0; i < JointCount; ++i) {
+        maxDifference = std::max(maxDifference,
+            GetMaxDifference(XMLoadFloat4x4(&palette[i]), XMLoadFloat4x4(&expected[i])));
+        CHECK(palette[i]._41 == 0.0f && palette[i]._42 == 0.0f && palette[i]._43 == 0.0f && palette[i]._44 == 1.0f);
+    }
+    test::Log("max difference %g", maxDifference);
+    CHECK(maxDifference < 1.0e-4f);
+}
+
+// 関節数ごとの ComputeJointPalette の時間. 4x4 の汎用演算と転置で求める場合と比べる.
+BENCHMARK(AffineTransform_ComputeJointPalette)
+{
+    for (size_t jointCount : { size_t(64), size_t(256), size_t(1024) }) {
+        const auto input = CreatePaletteInput(jointCount, 4);
+        std::vector<XMFLOAT4X4> palette(jointCount);
+        const int Repeat = 1000;
+        const double ms = test::MeasureMilliseconds([&]() {
+            for (int i = 0; i < Repeat; ++i) {
+                util::ComputeJointPalette(
+                    input.invBindMatrices.data(), input.worldMatrices.data(), input.jointIndices.data(),
+                    jointCount, input.meshInv, palette.data());
+            }
+        });
+        const double referenceMs = test::MeasureMilliseconds([&]() {
+            for (int i = 0; i < Repeat; ++i) {
+                ComputeJointPaletteReference(
+                    input.invBindMatrices.data(), input.worldMatrices.data(), input.jointIndices.data(),
+                    jointCount, input.meshInv, palette.data());
+            }
+        });
+        const double toNs = 1.0e6 / (double(Repeat) * double(jointCount));
+        test::Log("%4zu joints: ComputeJointPalette %6.2f us (%5.2f ns/joint), 4x4 reference %6.2f us (%5.2f ns/joint)",
+            jointCount, ms * 1000.0 / Repeat, ms * toNs, referenceMs * 1000.0 / Repeat, referenceMs * toNs);
+    }
+}
+
+// 関節数ごとの ComputeJointDualQuaternions (関節行列からデュアルクォータニオンへの変換)の時間.
+BENCHMARK(AffineTransform_ComputeJointDualQuaternions)
+{
+    for (size_t jointCount : { size_t(64), size_t(256), size_t(1024) }) {
+        const auto input = CreatePaletteInput(jointCount, 5);
+        std::vector<XMFLOAT4X4> palette(jointCount);
+        util::ComputeJointPalette(
+            input.invBindMatrices.data(), input.worldMatrices.data(), input.jointIndices.data(),
+            jointCount, input.meshInv, palette.data());
+        std::vector<XMFLOAT4> dualQuaternions(jointCount * 2);
+        const int Repeat = 1000;
+        const double ms = test::MeasureMilliseconds([&]() {
+            for (int i = 0; i < Repeat; ++i) {
+                util::ComputeJointDualQuaternions(palette.data(), jointCount, dualQuaternions.data());
+            }
+        });
+        const double nsPerJoint = ms * 1.0e6 / (double(Repeat) * double(jointCount));
+        test::Log("%4zu joints: %6.2f us (%5.2f ns/joint, %6.1f M joints/s)",
+            jointCount, ms * 1000.0 / Repeat, nsPerJoint, 1.0e3 / nsPerJoint);
+    }
+}
@@ -0,0 +1,385 @@
+﻿#include "TestFramework.h"
+#include "util/AnimationClip.h"
+
+#include <cstring>
+
+using namespace DirectX;
+using util::AnimationClip;
+using util::AnimationInterpolation;
+using util::AnimationPath;
+using util::QuaternionBlend;
+
+namespace {
+    // 決まった系列を返す簡易な乱数.
+    class Random {
+    public:
+        explicit Random(uint32_t seed) : m_state(seed) { }
+        uint32_t Next() {
+            m_state = m_state * 1664525u + 1013904223u;
+            return m_state >> 8;
+        }
+        float NextFloat() { return float(Next() & 0xFFFF) / 65535.0f; }
+        float NextSigned() { return NextFloat() * 2.0f - 1.0f; }
+    private:
+        uint32_t m_state;
+    };
+
+    XMFLOAT4 RandomQuaternion(Random& random) {
+        XMFLOAT4 q;
+        XMStoreFloat4(&q, XMQuaternionRotationRollPitchYaw(
+            random.NextSigned() * 3.0f, random.NextSigned() * 3.0f, random.NextSigned() * 3.0f));
+        return q;
+    }
+
+    // 関節ごとに平行移動(線形補間)・回転(線形補間)・スケール(ステップ)のトラックを持つクリップを作る.
+    //  glTF と同様にトラックごとにキー数と時刻が異なるようにし、一部の関節の回転は CubicSpline とする.
+    AnimationClip CreateTestClip(int jointCount, int keyCount, uint32_t seed) {
+        Random random(seed);
+        AnimationClip clip;
+        const float FrameTime = 1.0f / 30.0f;
+        for (int joint = 0; joint < jointCount; ++joint) {
+            for (auto path : { AnimationPath::Translation, AnimationPath::Rotation, AnimationPath::Scale }) {
+                auto interpolation = AnimationInterpolation::Linear;
+                if (path == AnimationPath::Scale) {
+                    interpolation = AnimationInterpolation::Step;
+                } else if (path == AnimationPath::Rotation && joint % 4 == 3) {
+                    interpolation = AnimationInterpolation::CubicSpline;
+                }
+                const int count = std::max(1, keyCount - (joint * 3 + int(path)) % 7);
+                const float offset = float(joint % 3) * 0.25f * FrameTime;
+                std::vector<float> times(count);
+                std::vector<XMFLOAT4> values;
+                for (int k = 0; k < count; ++k) {
+                    times[k] = offset + (float(k) + 0.3f * float(k % 2)) * FrameTime;
+                    XMFLOAT4 value;
+                    if (path == AnimationPath::Rotation) {
+                        value = RandomQuaternion(random);
+                    } else if (path == AnimationPath::Scale) {
+                        value = XMFLOAT4(1.0f + random.NextFloat(), 1.0f + random.NextFloat(), 1.0f + random.NextFloat(), 0.0f);
+                    } else {
+                        value = XMFLOAT4(random.NextSigned(), random.NextSigned(), random.NextSigned(), 0.0f);
+                    }
+                    if (interpolation == AnimationInterpolation::CubicSpline) {
+                        // (入力接線, 値, 出力接線).
+                        values.push_back(XMFLOAT4(random.NextSigned(), random.NextSigned(), random.NextSigned(), random.NextSigned()));
+                        values.push_back(value);
+                        values.push_back(XMFLOAT4(random.NextSigned(), random.NextSigned(), random.NextSigned(), random.NextSigned()));
+                    } else {
+                        values.push_back(value);
+                    }
+                }
+                clip.AddChannel(joint, path, interpolation, times.data(), times.size(), values.data());
+            }
+        }
+        return clip;
+    }
+
+    float Dot4(const XMFLOAT4& a, const XMFLOAT4& b) {
+        return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+    }
+
+    XMFLOAT4 Normalize4(const XMFLOAT4& a) {
+        const float length = std::sqrt(Dot4(a, a));
+        return XMFLOAT4(a.x / length, a.y / length, a.z / length, a.w / length);
+    }
+
+    XMFLOAT4 Lerp4(const XMFLOAT4& a, const XMFLOAT4& b, float t) {
+        return XMFLOAT4(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t);
+    }
+
+    // glTF の仕様どおりに1チャンネルを評価する(DirectXMath を使わないスカラー実装).
+    XMFLOAT4 SampleReference(const AnimationClip& clip, const AnimationClip::Channel& channel, float time, QuaternionBlend blend) {
+        const float* times = clip.GetTimes().data() + channel.keyStart;
+        const XMFLOAT4* values = clip.GetValues().data() + channel.valueStart;
+        const bool isCubic = channel.interpolation == AnimationInterpolation::CubicSpline;
+        auto value = [&](uint32_t k) { return isCubic ? values[k * 3 + 1] : values[k]; };
+
+        uint32_t k = 0;
+        while (k + 1 < channel.keyCount && times[k + 1] <= time) {
+            ++k;
+        }
+        if (k + 1 >= channel.keyCount || time <= times[0]) {
+            return value(time <= times[0] ? 0 : channel.keyCount - 1);
+        }
+        const float dt = times[k + 1] - times[k];
+        const float t = (time - times[k]) / dt;
+        const XMFLOAT4 v0 = value(k), v1 = value(k + 1);
+        const bool isRotation = channel.path == AnimationPath::Rotation;
+        switch (channel.interpolation) {
+        case AnimationInterpolation::Step:
+            return v0;
+        case AnimationInterpolation::CubicSpline: {
+            const XMFLOAT4& m0 = values[k * 3 + 2];
+            const XMFLOAT4& m1 = values[(k + 1) * 3 + 0];
+            const float t2 = t * t, t3 = t2 * t;
+            const float h00 = 2 * t3 - 3 * t2 + 1, h10 = (t3 - 2 * t2 + t) * dt;
+            const float h01 = -2 * t3 + 3 * t2, h11 = (t3 - t2) * dt;
+            XMFLOAT4 result(
+                h00 * v0.x + h10 * m0.x + h01 * v1.x + h11 * m1.x,
+                h00 * v0.y + h10 * m0.y + h01 * v1.y + h11 * m1.y,
+                h00 * v0.z + h10 * m0.z + h01 * v1.z + h11 * m1.z,
+                h00 * v0.w + h10 * m0.w + h01 * v1.w + h11 * m1.w);
+            return isRotation ? Normalize4(result) : result;
+        }
+        default:
+            break;
+        }
+        if (!isRotation) {
+            return Lerp4(v0, v1, t);
+        }
+        // 最短経路となるように符号を揃える.
+        const float sign = Dot4(v0, v1) < 0.0f ? -1.0f : 1.0f;
+        const XMFLOAT4 q1(v1.x * sign, v1.y * sign, v1.z * sign, v1.w * sign);
+        if (blend == QuaternionBlend::Nlerp) {
+            return Normalize4(Lerp4(v0, q1, t));
+        }
+        const float c = std::min(Dot4(v0, q1), 1.0f);
+        if (c > 0.9999f) {
+            return Normalize4(Lerp4(v0, q1, t));
+        }
+        const float omega = std::acos(c);
+        const float s0 = std::sin((1.0f - t) * omega) / std::sin(omega);
+        const float s1 = std::sin(t * omega) / std::sin(omega);
+        return XMFLOAT4(
+            v0.x * s0 + q1.x * s1, v0.y * s0 + q1.y * s1, v0.z * s0 + q1.z * s1, v0.w * s0 + q1.w * s1);
+    }
+
+    // 関節の連鎖を根元から枝分かれさせた骨格を作る. 関節の間隔は jointSpacing.
+    util::AnimationSkeleton CreateChainSkeleton(int jointCount, int chainLength, float jointSpacing) {
+        util::AnimationSkeleton skeleton;
+        for (int i = 0; i < jointCount; ++i) {
+            const int parent = i == 0 ? -1 : ((i - 1) % chainLength == 0 ? 0 : i - 1);
+            skeleton.parents.push_back(parent);
+            skeleton.translations.push_back(XMFLOAT3(0.0f, i == 0 ? 0.0f : jointSpacing, 0.0f));
+            skeleton.rotations.push_back(XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+            skeleton.scales.push_back(XMFLOAT3(1.0f, 1.0f, 1.0f));
+        }
+        return skeleton;
+    }
+
+    // DxrModel と同じく、各ノードの影響範囲を子孫のノードまでの最大距離とする.
+    std::vector<float> ComputeJointLengths(const util::AnimationSkeleton& skeleton) {
+        std::vector<float> lengths(skeleton.parents.size(), 0.0f);
+        // 子は親より後ろにあるため、末尾から親へ伝える.
+        for (int i = int(skeleton.parents.size()) - 1; i > 0; --i) {
+            const auto& t = skeleton.translations[i];
+            const float offset = std::sqrt(t.x * t.x + t.y * t.y + t.z * t.z);
+            auto& parentLength = lengths[skeleton.parents[i]];
+            parentLength = std::max(parentLength, offset + lengths[i]);
+        }
+        return lengths;
+    }
+
+    // 各関節を正弦波で揺らす滑らかなクリップ(30fps). 根は平行移動もし、スケールは一定とする.
+    AnimationClip CreateSmoothClip(const util::AnimationSkeleton& skeleton, int keyCount, uint32_t seed) {
+        Random random(seed);
+        AnimationClip clip;
+        const float FrameTime = 1.0f / 30.0f;
+        std::vector<float> times(keyCount);
+        for (int k = 0; k < keyCount; ++k) {
+            times[k] = float(k) * FrameTime;
+        }
+        std::vector<XMFLOAT4> values(keyCount);
+        for (int joint = 0; joint < int(skeleton.parents.size()); ++joint) {
+            const auto axis = XMVector3Normalize(XMVectorSet(random.NextSigned(), random.NextSigned(), random.NextSigned() + 2.0f, 0.0f));
+            const float amplitude = 0.2f + 0.6f * random.NextFloat();
+            const float frequency = 1.0f + 3.0f * random.NextFloat();
+            const float phase = random.NextFloat() * 6.0f;
+            for (int k = 0; k < keyCount; ++k) {
+                XMStoreFloat4(&values[k], XMQuaternionRotationAxis(axis, amplitude * std::sin(frequency * times[k] + phase)));
+            }
+            clip.AddChannel(joint, AnimationPath::Rotation, AnimationInterpolation::Linear, times.data(), keyCount, values.data());
+            for (int k = 0; k < keyCount; ++k) {
+                values[k] = XMFLOAT4(1.0f, 1.0f, 1.0f, 0.0f);
+            }
+            clip.AddChannel(joint, AnimationPath::Scale, AnimationInterpolation::Linear, times.data(), keyCount, values.data());
+        }
+        for (int k = 0; k < keyCount; ++k) {
+            values[k] = XMFLOAT4(0.5f * std::sin(times[k]), 0.05f * std::sin(times[k] * 7.0f), 0.3f * times[k], 0.0f);
+        }
+        clip.AddChannel(0, AnimationPath::Translation, AnimationInterpolation::Linear, times.data(), keyCount, values.data());
+        return clip;
+    }
+
+    // 比較用の時刻. 範囲外・キー時刻ちょうど・区間の途中を含める.
+    std::vector<float> GetSampleTimes(const AnimationClip& clip) {
+        std::vector<float> times = { -1.0f, 0.0f, clip.GetDuration(), clip.GetDuration() + 1.0f };
+        for (float time : clip.GetTimes()) {
+            times.push_back(time);
+        }
+        Random random(99);
+        for (int i = 0; i < 200; ++i) {
+            times.push_back(random.NextFloat() * clip.GetDuration());
+        }
+        return times;
+    }
+}
+
+// Sample の結果が、全補間方法・全区間でスカラー実装と一致すること.
+TEST_CASE(AnimationClip_SampleMatchesScalarReference)
+{
+    const auto clip = CreateTestClip(16, 24, 7);
+    const size_t channelCount = clip.GetChannelCount();
+    std::vector<XMVECTOR> output(channelCount);
+    for (auto blend : { QuaternionBlend::Nlerp, QuaternionBlend::Slerp }) {
+        float maxError = 0.0f;
+        for (float time : GetSampleTimes(clip)) {
+            clip.Sample(time, output.data(), blend);
+            for (size_t i = 0; i < channelCount; ++i) {
+                const auto& channel = clip.GetChannel(i);
+                const auto expected = SampleReference(clip, channel, time, blend);
+                XMFLOAT4 actual;
+                XMStoreFloat4(&actual, output[i]);
+                // 回転は q と -q が同じ回転を表すため、向きを揃えて比べる.
+                float sign = 1.0f;
+                if (channel.path == AnimationPath::Rotation && Dot4(actual, expected) < 0.0f) {
+                    sign = -1.0f;
+                }
+                const int componentCount = channel.path == AnimationPath::Rotation ? 4 : 3;
+                for (int c = 0; c < componentCount; ++c) {
+                    maxError = std::max(maxError, std::abs((&actual.x)[c] * sign - (&expected.x)[c]));
+                }
+            }
+        }
+        test::Log("%s: max error %g", blend == QuaternionBlend::Nlerp ? "nlerp" : "slerp", maxError);
+        CHECK(maxError < 1.0e-4f);
+    }
+}
+
+// クリップ1つを全チャンネル評価する時間. 関節数とキー数の異なるクリップで、圧縮前後を比較する.
+BENCHMARK(AnimationClip_Sample)
+{
+    struct ClipSize {
+        const char* name;
+        int jointCount;
+        int keyCount;
+    };
+    const ClipSize sizes[] = {
+        { "small",    20,   30 },
+        { "humanoid", 60,  240 },
+        { "large",   200, 1200 },
+    };
+    for (const auto& size : sizes) {
+        auto clip = CreateTestClip(size.jointCount, size.keyCount, 11);
+        const size_t channelCount = clip.GetChannelCount();
+        std::vector<XMVECTOR> output(channelCount);
+        const int SampleCount = 1000;
+        for (int pass = 0; pass < 2; ++pass) {
+            if (pass == 1) {
+                clip.Compress(util::AnimationCompressSettings(), std::vector<float>());
+            }
+            for (auto blend : { QuaternionBlend::Nlerp, QuaternionBlend::Slerp }) {
+                const double ms = test::MeasureMilliseconds([&]() {
+                    for (int i = 0; i < SampleCount; ++i) {
+                        clip.Sample(clip.GetDuration() * float(i) / SampleCount, output.data(), blend);
+                    }
+                }, 5);
+                const double us = ms * 1000.0 / SampleCount;
+                test::Log("%-8s %4d joints %4d keys %-10s %s: %8.2f us/sample (%6.1f ns/channel)",
+                    size.name, size.jointCount, size.keyCount, pass == 0 ? "raw" : "compressed",
+                    blend == QuaternionBlend::Nlerp ? "nlerp" : "slerp", us, us * 1000.0 / double(channelCount));
+            }
+        }
+    }
+}
+
+// モデル空間での誤差は、親の回転の誤差が子孫の位置へ伝わった分を含むこと.
+//  長さ 0.9 の連鎖の根元だけを θ 回転させると、先端は 2 * 0.9 * sin(θ/2) 動く.
+TEST_CASE(AnimationClip_ObjectSpaceErrorAccumulatesAlongChain)
+{
+    const int JointCount = 10;
+    const auto skeleton = CreateChainSkeleton(JointCount, JointCount, 0.1f);
+    const float Angle = 0.01f;
+    const float time = 0.0f;
+    XMFLOAT4 identity(0.0f, 0.0f, 0.0f, 1.0f), rotated;
+    XMStoreFloat4(&rotated, XMQuaternionRotationAxis(XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), Angle));
+    AnimationClip a, b;
+    a.AddChannel(0, AnimationPath::Rotation, AnimationInterpolation::Linear, &time, 1, &identity);
+    b.AddChannel(0, AnimationPath::Rotation, AnimationInterpolation::Linear, &time, 1, &rotated);
+    const float error = util::MeasureObjectSpaceError(a, b, skeleton, { 0.0f });
+    CHECK_NEAR(error, 2.0f * 0.9f * std::sin(Angle * 0.5f), 1.0e-5);
+    CHECK(util::MeasureObjectSpaceError(a, a, skeleton, { 0.0f }) == 0.0f);
+}
+
+// 圧縮後のモデル空間での誤差が、ノード単独の許容誤差を階層の深さ分累積した範囲に収まること.
+TEST_CASE(AnimationClip_CompressedObjectErrorIsBoundedByDepth)
+{
+    const int ChainLength = 6;
+    const auto skeleton = CreateChainSkeleton(31, ChainLength, 0.1f);
+    const auto jointLengths = ComputeJointLengths(skeleton);
+    for (float maxError : { 1.0e-4f, 1.0e-3f }) {
+        auto clip = CreateSmoothClip(skeleton, 120, 3);
+        util::AnimationCompressSettings settings;
+        settings.maxError = maxError;
+        util::AnimationCompressReport report;
+        clip.Compress(settings, jointLengths, &report, &skeleton);
+        test::Log("max error %g: keys %zu -> %zu, per node %g, object space %g",
+            maxError, report.sourceKeys, report.compressedKeys, report.maxError, report.maxObjectError);
+        CHECK(report.compressedKeys < report.sourceKeys);
+        CHECK(report.maxError <= maxError);
+        // 根元と連鎖の関節の誤差が先端へ累積する.
+        CHECK(report.maxObjectError <= maxError * float(ChainLength + 1));
+        CHECK(report.maxObjectError > 0.0f);
+    }
+}
+
+// 合成したクリップの圧縮率と誤差. 許容誤差ごとに、ノード単独とモデル空間での最大誤差を比べる.
+BENCHMARK(AnimationClip_CompressionReport)
+{
+    struct ClipSize {
+        const char* name;
+        int jointCount;
+        int chainLength;
+        int keyCount;
+    };
+    const ClipSize sizes[] = {
+        { "humanoid", 61, 12, 240 },
+        { "large",   201, 20, 1200 },
+    };
+    for (const auto& size : sizes) {
+        const auto skeleton = CreateChainSkeleton(size.jointCount, size.chainLength, 0.1f);
+        const auto jointLengths = ComputeJointLengths(skeleton);
+        for (float maxError : { 1.0e-4f, 1.0e-3f, 1.0e-2f }) {
+            auto clip = CreateSmoothClip(skeleton, size.keyCount, 5);
+            util::AnimationCompressSettings settings;
+            settings.maxError = maxError;
+            util::AnimationCompressReport report;
+            clip.Compress(settings, jointLengths, &report, &skeleton);
+            test::Log("%-8s tolerance %6g: %8zu -> %7zu bytes (%5.1f%%), %6zu -> %6zu keys, max error %.6f (object space %.6f)",
+                size.name, maxError, report.sourceBytes, report.compressedBytes,
+                100.0 * double(report.compressedBytes) / double(report.sourceBytes),
+                report.sourceKeys, report.compressedKeys, report.maxError, report.maxObjectError);
+        }
+    }
+}
+
+// 圧縮したクリップの復元(評価)のスループット. 再生順の時刻とランダムな時刻で、圧縮前と比べる.
+BENCHMARK(AnimationClip_DecompressThroughput)
+{
+    const auto skeleton = CreateChainSkeleton(61, 12, 0.1f);
+    auto raw = CreateSmoothClip(skeleton, 240, 9);
+    auto compressed = raw;
+    compressed.Compress(util::AnimationCompressSettings(), ComputeJointLengths(skeleton));
+
+    const int SampleCount = 2000;
+    std::vector<float> sequentialTimes(SampleCount), randomTimes(SampleCount);
+    Random random(17);
+    for (int i = 0; i < SampleCount; ++i) {
+        sequentialTimes[i] = raw.GetDuration() * float(i) / SampleCount;
+        randomTimes[i] = raw.GetDuration() * random.NextFloat();
+    }
+    std::vector<XMVECTOR> output(raw.GetChannelCount());
+    for (const auto* clip : { &raw, &compressed }) {
+        for (const auto* times : { &sequentialTimes, &randomTimes }) {
+            const double ms = test::MeasureMilliseconds([&]() {
+                for (float time : *times) {
+                    clip->Sample(time, output.data());
+                }
+            }, 5);
+            const double channels = double(SampleCount) * double(clip->GetChannelCount());
+            test::Log("%-10s %-10s %7zu bytes: %8.2f Mchannels/s (%6.2f us/sample)",
+                clip->IsCompressed() ? "compressed" : "raw", times == &sequentialTimes ? "sequential" : "random",
+                clip->GetDataSize(), channels / (ms * 1000.0), ms * 1000.0 / SampleCount);
+        }
+    }
+}
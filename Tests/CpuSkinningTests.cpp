@@ -0,0 +1,276 @@
+﻿#include "TestFramework.h"
+#include "util/CpuSkinning.h"
+#include "util/AffineTransform.h"
+
+#include <cstring>
+#include <execution>
+#include <thread>
+
+using namespace DirectX;
+
+namespace {
+    // 決まった系列を返す簡易な乱数.
+    class Random {
+    public:
+        explicit Random(uint32_t seed) : m_state(seed) { }
+        uint32_t Next() {
+            m_state = m_state * 1664525u + 1013904223u;
+            return m_state >> 8;
+        }
+        float NextFloat() { return float(Next() & 0xFFFF) / 65535.0f; }
+        float NextSigned() { return NextFloat() * 2.0f - 1.0f; }
+    private:
+        uint32_t m_state;
+    };
+
+    // スキニングの入力となる頂点ストリームと関節行列.
+    struct SkinningInput {
+        std::vector<XMFLOAT3> positions;
+        std::vector<XMFLOAT3> normals;
+        std::vector<XMUINT4> jointIndices;
+        std::vector<XMFLOAT4> jointWeights;
+        std::vector<XMFLOAT4X4> palette;
+
+        util::SkinningStreams GetStreams() const {
+            util::SkinningStreams streams;
+            streams.positions = positions.data();
+            streams.normals = normals.data();
+            streams.jointIndices = jointIndices.data();
+            streams.jointWeights = jointWeights.data();
+            streams.vertexCount = positions.size();
+            return streams;
+        }
+    };
+
+    // isRigid の場合は回転と平行移動のみ(剛体)の関節とする.
+    XMMATRIX CreateJoint(Random& random, bool isRigid) {
+        const auto rotation = XMQuaternionRotationRollPitchYaw(
+            random.NextSigned() * 3.0f, random.NextSigned() * 3.0f, random.NextSigned() * 3.0f);
+        const auto translation = XMVectorSet(random.NextSigned(), random.NextSigned(), random.NextSigned(), 0.0f);
+        const float scale = isRigid ? 1.0f : 0.8f + 0.4f * random.NextFloat();
+        return XMMatrixScaling(scale, scale, scale) * XMMatrixRotationQuaternion(rotation) * XMMatrixTranslationFromVector(translation);
+    }
+
+    // 1頂点あたり 1～4 個の関節を参照し、ウェイトの合計を 1 とする.
+    SkinningInput CreateSkinningInput(size_t vertexCount, size_t jointCount, bool isRigid, uint32_t seed) {
+        Random random(seed);
+        SkinningInput input;
+        for (size_t i = 0; i < jointCount; ++i) {
+            XMFLOAT4X4 joint;
+            XMStoreFloat4x4(&joint, XMMatrixTranspose(CreateJoint(random, isRigid)));
+            input.palette.push_back(joint);
+        }
+        input.positions.resize(vertexCount);
+        input.normals.resize(vertexCount);
+        input.jointIndices.resize(vertexCount);
+        input.jointWeights.resize(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            input.positions[v] = XMFLOAT3(random.NextSigned(), random.NextSigned(), random.NextSigned());
+            XMStoreFloat3(&input.normals[v], XMVector3Normalize(
+                XMVectorSet(random.NextSigned(), random.NextSigned(), random.NextSigned() + 2.0f, 0.0f)));
+            uint32_t joints[4];
+            float weights[4] = {};
+            const uint32_t usedCount = 1 + random.Next() % 4;
+            float sum = 0.0f;
+            for (uint32_t i = 0; i < 4; ++i) {
+                joints[i] = random.Next() % uint32_t(jointCount);
+                if (i < usedCount) {
+                    weights[i] = 0.1f + random.NextFloat();
+                    sum += weights[i];
+                }
+            }
+            input.jointIndices[v] = XMUINT4(joints[0], joints[1], joints[2], joints[3]);
+            input.jointWeights[v] = XMFLOAT4(weights[0] / sum, weights[1] / sum, weights[2] / sum, weights[3] / sum);
+        }
+        return input;
+    }
+
+    // SkinningCompute.hlsl の計算をスカラーで再現する.
+    //  StructuredBuffer<float4x4> は列優先で読み込まれるため、転置して格納した関節行列は元の行列として扱われる.
+    //  mtx = Σ matrices[i] * weights[i], pos = mul(float4(position, 1), mtx), nrm = normalize(mul(normal, (float3x3)mtx)).
+    void SkinVertexReference(const SkinningInput& input, size_t v, XMFLOAT3& position, XMFLOAT3& normal) {
+        const uint32_t joints[4] = {
+            input.jointIndices[v].x, input.jointIndices[v].y, input.jointIndices[v].z, input.jointIndices[v].w };
+        const float weights[4] = {
+            input.jointWeights[v].x, input.jointWeights[v].y, input.jointWeights[v].z, input.jointWeights[v].w };
+        double mtx[4][4] = {};
+        for (int i = 0; i < 4; ++i) {
+            const auto& joint = input.palette[joints[i]];
+            for (int r = 0; r < 4; ++r) {
+                for (int c = 0; c < 4; ++c) {
+                    mtx[r][c] += double(joint.m[c][r]) * weights[i];
+                }
+            }
+        }
+        const double p[4] = { input.positions[v].x, input.positions[v].y, input.positions[v].z, 1.0 };
+        const double n[3] = { input.normals[v].x, input.normals[v].y, input.normals[v].z };
+        double dp[3], dn[3];
+        for (int c = 0; c < 3; ++c) {
+            dp[c] = p[0] * mtx[0][c] + p[1] * mtx[1][c] + p[2] * mtx[2][c] + p[3] * mtx[3][c];
+            dn[c] = n[0] * mtx[0][c] + n[1] * mtx[1][c] + n[2] * mtx[2][c];
+        }
+        const double length = std::sqrt(dn[0] * dn[0] + dn[1] * dn[1] + dn[2] * dn[2]);
+        position = XMFLOAT3(float(dp[0]), float(dp[1]), float(dp[2]));
+        normal = XMFLOAT3(float(dn[0] / length), float(dn[1] / length), float(dn[2] / length));
+    }
+
+    float GetDistance(const XMFLOAT3& a, const XMFLOAT3& b) {
+        return XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&a), XMLoadFloat3(&b))));
+    }
+}
+
+// SkinVertices が HLSL と同じ計算(スカラーで再現したもの)と誤差の範囲で一致すること.
+TEST_CASE(CpuSkinning_MatchesShaderReference)
+{
+    const size_t VertexCount = 10000;
+    const auto input = CreateSkinningInput(VertexCount, 64, false, 1);
+    const auto streams = input.GetStreams();
+    std::vector<XMFLOAT3> positions(VertexCount), normals(VertexCount);
+    util::SkinVertices(streams, input.palette.data(), 0, VertexCount, positions.data(), normals.data());
+
+    float maxPositionError = 0.0f, maxNormalError = 0.0f;
+    for (size_t v = 0; v < VertexCount; ++v) {
+        XMFLOAT3 position, normal;
+        SkinVertexReference(input, v, position, normal);
+        maxPositionError = std::max(maxPositionError, GetDistance(positions[v], position));
+        maxNormalError = std::max(maxNormalError, GetDistance(normals[v], normal));
+    }
+    test::Log("max error: position %g, normal %g", maxPositionError, maxNormalError);
+    CHECK(maxPositionError < 1.0e-5f);
+    CHECK(maxNormalError < 1.0e-5f);
+}
+
+// SkinVerticesParallel はスレッド数によらず、SkinVertices と同じ結果になること.
+//  頂点数がスレッド数より少ない場合や、割り切れない場合も含める.
+TEST_CASE(CpuSkinning_ParallelMatchesSerial)
+{
+    for (size_t vertexCount : { size_t(0), size_t(5), size_t(1001), size_t(10000) }) {
+        const auto input = CreateSkinningInput(vertexCount, 64, false, 2);
+        const auto streams = input.GetStreams();
+        std::vector<XMFLOAT3> positions(vertexCount), normals(vertexCount);
+        util::SkinVertices(streams, input.palette.data(), 0, vertexCount, positions.data(), normals.data());
+
+        for (uint32_t threadCount : { 0u, 1u, 3u, 4u, 16u }) {
+            std::vector<XMFLOAT3> parallelPositions(vertexCount, XMFLOAT3(NAN, NAN, NAN));
+            std::vector<XMFLOAT3> parallelNormals(vertexCount, XMFLOAT3(NAN, NAN, NAN));
+            util::SkinVerticesParallel(streams, input.palette.data(),
+                parallelPositions.data(), parallelNormals.data(), threadCount);
+            bool isSame = true;
+            for (size_t v = 0; v < vertexCount; ++v) {
+                isSame = isSame &&
+                    memcmp(&positions[v], &parallelPositions[v], sizeof(XMFLOAT3)) == 0 &&
+                    memcmp(&normals[v], &parallelNormals[v], sizeof(XMFLOAT3)) == 0;
+            }
+            CHECK(isSame);
+        }
+    }
+}
+
+// 剛体の関節では、デュアルクォータニオンと線形ブレンドの結果が誤差の範囲で一致すること.
+//  ブレンドした結果が一致するのは、参照する関節の変換が同じ場合と、1つの関節のみを参照する場合.
+TEST_CASE(CpuSkinning_DualQuaternionMatchesLinearForRigidPalette)
+{
+    const size_t VertexCount = 10000;
+    auto input = CreateSkinningInput(VertexCount, 64, true, 4);
+    auto compare = [&](const char* name) {
+        const auto streams = input.GetStreams();
+        std::vector<XMFLOAT4> dualQuaternions(input.palette.size() * 2);
+        util::ComputeJointDualQuaternions(input.palette.data(), input.palette.size(), dualQuaternions.data());
+        std::vector<XMFLOAT3> linearPositions(VertexCount), linearNormals(VertexCount);
+        std::vector<XMFLOAT3> dqPositions(VertexCount), dqNormals(VertexCount);
+        util::SkinVertices(streams, input.palette.data(), 0, VertexCount, linearPositions.data(), linearNormals.data());
+        util::SkinVerticesDualQuaternion(streams, dualQuaternions.data(), 0, VertexCount, dqPositions.data(), dqNormals.data());
+        float maxPositionError = 0.0f, maxNormalError = 0.0f;
+        for (size_t v = 0; v < VertexCount; ++v) {
+            maxPositionError = std::max(maxPositionError, GetDistance(linearPositions[v], dqPositions[v]));
+            maxNormalError = std::max(maxNormalError, GetDistance(linearNormals[v], dqNormals[v]));
+        }
+        test::Log("%-14s max difference: position %g, normal %g", name, maxPositionError, maxNormalError);
+        CHECK(maxPositionError < 1.0e-5f);
+        CHECK(maxNormalError < 1.0e-5f);
+    };
+
+    // 各頂点が1つの関節のみを参照する.
+    const auto weights = input.jointWeights;
+    for (auto& weight : input.jointWeights) {
+        weight = XMFLOAT4(1.0f, 0.0f, 0.0f, 0.0f);
+    }
+    compare("single joint");
+
+    // 全関節が同じ変換で、複数の関節をブレンドする.
+    input.jointWeights = weights;
+    std::fill(input.palette.begin(), input.palette.end(), input.palette[0]);
+    compare("same joints");
+}
+
+// 群衆の関節データ(BuildJointData)の作成時間. DxrModelCrowd::ApplyTransform と同じく、
+//  全インスタンス分を連結したバッファへ書き出す. 1体ずつ順に処理する場合と、インスタンス単位で並列に処理する場合を比べる.
+BENCHMARK(CpuSkinning_BuildJointData)
+{
+    const size_t JointCount = 100;
+    Random random(5);
+    std::vector<XMMATRIX> invBindMatrices(JointCount);
+    std::vector<uint32_t> jointIndices(JointCount);
+    for (size_t i = 0; i < JointCount; ++i) {
+        invBindMatrices[i] = XMMatrixInverse(nullptr, CreateJoint(random, false));
+        jointIndices[i] = uint32_t(i + 1);
+    }
+    struct Instance {
+        std::vector<XMFLOAT3X4A> worldMatrices;
+        std::vector<XMFLOAT4X4> palette;
+        size_t offset;
+    };
+
+    for (size_t instanceCount : { size_t(10), size_t(100), size_t(1000) }) {
+        std::vector<Instance> instances(instanceCount);
+        for (size_t i = 0; i < instanceCount; ++i) {
+            instances[i].worldMatrices.resize(JointCount + 1);
+            for (auto& world : instances[i].worldMatrices) {
+                XMStoreFloat3x4A(&world, CreateJoint(random, false));
+            }
+            instances[i].offset = sizeof(XMFLOAT4X4) * JointCount * i;
+        }
+        std::vector<uint8_t> buffer(sizeof(XMFLOAT4X4) * JointCount * instanceCount);
+        auto build = [&](Instance& instance, util::SkinningMethod method) {
+            util::BuildJointData(
+                invBindMatrices.data(), instance.worldMatrices.data(), jointIndices.data(), JointCount,
+                XMMatrixIdentity(), method, instance.palette, buffer.data() + instance.offset);
+        };
+        for (auto method : { util::SkinningMethod::Linear, util::SkinningMethod::DualQuaternion }) {
+            const double ms = test::MeasureMilliseconds([&]() {
+                for (auto& instance : instances) {
+                    build(instance, method);
+                }
+            });
+            const double parallelMs = test::MeasureMilliseconds([&]() {
+                std::for_each(std::execution::par, instances.begin(), instances.end(),
+                    [&](Instance& instance) { build(instance, method); });
+            });
+            test::Log("%4zu instances, %-15s serial %9.3f us (%6.2f us/instance), parallel %9.3f us",
+                instanceCount, method == util::SkinningMethod::Linear ? "linear" : "dual quaternion",
+                ms * 1000.0, ms * 1000.0 / instanceCount, parallelMs * 1000.0);
+        }
+    }
+}
+
+// スレッド数ごとの SkinVerticesParallel / SkinVerticesDualQuaternionParallel の処理速度(頂点/秒).
+BENCHMARK(CpuSkinning_SkinVerticesParallel)
+{
+    const size_t VertexCount = 1000000;
+    const auto input = CreateSkinningInput(VertexCount, 128, false, 3);
+    const auto streams = input.GetStreams();
+    std::vector<XMFLOAT4> dualQuaternions(input.palette.size() * 2);
+    util::ComputeJointDualQuaternions(input.palette.data(), input.palette.size(), dualQuaternions.data());
+    std::vector<XMFLOAT3> positions(VertexCount), normals(VertexCount);
+    test::Log("hardware threads: %u", std::thread::hardware_concurrency());
+    for (uint32_t threadCount : { 1u, 4u, 16u }) {
+        const double ms = test::MeasureMilliseconds([&]() {
+            util::SkinVerticesParallel(streams, input.palette.data(), positions.data(), normals.data(), threadCount);
+        });
+        const double dqMs = test::MeasureMilliseconds([&]() {
+            util::SkinVerticesDualQuaternionParallel(streams, dualQuaternions.data(), positions.data(), normals.data(), threadCount);
+        });
+        test::Log("%2u threads: linear %8.3f ms (%7.1f M vertices/s), dual quaternion %8.3f ms (%7.1f M vertices/s)",
+            threadCount, ms, VertexCount / (ms * 1000.0), dqMs, VertexCount / (dqMs * 1000.0));
+    }
+}
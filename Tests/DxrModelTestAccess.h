@@ -0,0 +1,198 @@
+﻿#pragma once
+// テストから DxrModel の読み込み処理の各段階を直接呼び出すためのアクセサ.
+//  DxrModel 側で friend として宣言している.
+#include "util/DxrModel.h"
+#include "tiny_gltf.h"
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace util {
+    struct DxrModelTestAccess {
+        using ImportSettings = DxrModel::ImportSettings;
+        using VertexAttributeVisitor = DxrModel::VertexAttributeVisitor;
+        using ImportedStreams = DxrModel::ImportedStreams;
+        using VertexStreamSource = DxrModel::VertexStreamSource;
+        using ImageSource = DxrModel::ImageSource;
+        using CacheStamp = DxrModel::CacheStamp;
+
+        // テスト用に比較しやすい形へ取り出したメッシュの情報.
+        struct MeshInfo {
+            UINT indexStart;
+            UINT vertexStart;
+            UINT indexCount;
+            UINT vertexCount;
+            UINT materialIndex;
+            UINT indexByteOffset;
+            UINT indexStride;
+            DirectX::XMFLOAT3 boundsMin;
+            DirectX::XMFLOAT3 boundsMax;
+        };
+
+        // glTF のメッシュを展開する. バッファは tinygltf が保持する実データを参照する.
+        static void LoadMesh(
+            DxrModel& model, const tinygltf::Model& inModel,
+            const ImportSettings& settings, VertexAttributeVisitor& visitor) {
+            DxrModel::BufferTable buffers;
+            for (const auto& buffer : inModel.buffers) {
+                buffers.push_back(buffer.data.data());
+            }
+            model.LoadMesh(inModel, buffers, settings, visitor);
+        }
+
+        // GPU を使用しない読み込み処理までを行う.
+        static void ImportGltf(
+            DxrModel& model, const tinygltf::Model& inModel, const ImportSettings& settings,
+            ImportedStreams& imported, VertexStreamSource& streams) {
+            DxrModel::BufferTable buffers;
+            for (const auto& buffer : inModel.buffers) {
+                buffers.push_back(buffer.data.data());
+            }
+            model.ImportGltf(inModel, buffers, settings, imported, streams);
+        }
+
+        static bool SaveCache(
+            const DxrModel& model, const std::wstring& cacheFile, const CacheStamp& stamp,
+            const VertexStreamSource& streams, const std::vector<ImageSource>& images) {
+            return model.SaveCache(cacheFile, stamp, streams, images);
+        }
+        static bool LoadCache(
+            DxrModel& model, const uint8_t* data, size_t size,
+            VertexStreamSource& streams, std::vector<ImageSource>& images) {
+            if (!model.LoadCache(data, size, streams, images)) {
+                return false;
+            }
+            model.BuildNodeIndex();
+            return true;
+        }
+        // アニメーション圧縮の誤差の評価に使うノード階層と影響範囲.
+        static void BuildAnimationSkeleton(
+            const DxrModel& model, AnimationSkeleton& skeleton, std::vector<float>& jointLengths) {
+            model.BuildAnimationSkeleton(skeleton, jointLengths);
+        }
+        static bool ReadCacheStamp(const uint8_t* data, size_t size, CacheStamp& stamp) {
+            return DxrModel::ReadCacheStamp(data, size, stamp);
+        }
+        static bool UpdateCacheStamp(const std::wstring& cacheFile, const CacheStamp& stamp) {
+            return DxrModel::UpdateCacheStamp(cacheFile, stamp);
+        }
+
+        // 読み込み結果の各テーブル(ノード・メッシュ・マテリアル・スキン・アニメーション)を比較する.
+        //  異なる場合は最初に見つかったテーブルの名前を返し、一致する場合は空文字列を返す.
+        static std::string FindTableDifference(const DxrModel& a, const DxrModel& b) {
+            auto isSameBytes = [](const auto& x, const auto& y) {
+                using T = typename std::decay_t<decltype(x)>::value_type;
+                return x.size() == y.size() && (x.empty() || memcmp(x.data(), y.data(), sizeof(T) * x.size()) == 0);
+            };
+            auto isSameVector = [](DirectX::XMVECTOR x, DirectX::XMVECTOR y) {
+                return DirectX::XMVector4Equal(x, y);
+            };
+
+            if (a.m_nodes.size() != b.m_nodes.size()) {
+                return "nodes";
+            }
+            for (size_t i = 0; i < a.m_nodes.size(); ++i) {
+                const auto& x = *a.m_nodes[i];
+                const auto& y = *b.m_nodes[i];
+                if (x.name != y.name || x.meshIndex != y.meshIndex || x.children != y.children ||
+                    !isSameVector(x.translation, y.translation) || !isSameVector(x.rotation, y.rotation) ||
+                    !isSameVector(x.scale, y.scale)) {
+                    return "nodes";
+                }
+            }
+            if (a.m_rootNodes != b.m_rootNodes) {
+                return "rootNodes";
+            }
+            if (a.m_nodeOrder != b.m_nodeOrder || a.m_nodeParents != b.m_nodeParents ||
+                a.m_nodeNameSlots != b.m_nodeNameSlots || a.m_nodeNameHashes != b.m_nodeNameHashes) {
+                return "nodeIndex";
+            }
+
+            if (a.m_meshGroups.size() != b.m_meshGroups.size()) {
+                return "meshGroups";
+            }
+            for (size_t i = 0; i < a.m_meshGroups.size(); ++i) {
+                if (a.m_meshGroups[i].m_nodeIndices != b.m_meshGroups[i].m_nodeIndices) {
+                    return "meshGroups";
+                }
+            }
+            if (!isSameBytes(GetMeshes(a), GetMeshes(b))) {
+                return "meshes";
+            }
+
+            if (a.m_materials.size() != b.m_materials.size()) {
+                return "materials";
+            }
+            for (size_t i = 0; i < a.m_materials.size(); ++i) {
+                const auto& x = a.m_materials[i];
+                const auto& y = b.m_materials[i];
+                if (x.m_name != y.m_name || x.m_textureIndex != y.m_textureIndex ||
+                    x.m_normalTextureIndex != y.m_normalTextureIndex ||
+                    memcmp(&x.m_diffuseColor, &y.m_diffuseColor, sizeof(x.m_diffuseColor)) != 0) {
+                    return "materials";
+                }
+            }
+
+            if (a.m_hasSkin != b.m_hasSkin || a.m_skinInfo.name != b.m_skinInfo.name ||
+                a.m_skinInfo.joints != b.m_skinInfo.joints ||
+                !isSameBytes(a.m_skinInfo.invBindMatrices, b.m_skinInfo.invBindMatrices)) {
+                return "skin";
+            }
+
+            if (a.m_animations.size() != b.m_animations.size()) {
+                return "animations";
+            }
+            for (size_t i = 0; i < a.m_animations.size(); ++i) {
+                const auto& x = a.m_animations[i];
+                const auto& y = b.m_animations[i];
+                if (x.GetName() != y.GetName() || x.IsCompressed() != y.IsCompressed() ||
+                    x.GetDuration() != y.GetDuration() ||
+                    !isSameBytes(x.GetChannels(), y.GetChannels()) ||
+                    !isSameBytes(x.GetTimes(), y.GetTimes()) || !isSameBytes(x.GetValues(), y.GetValues()) ||
+                    !isSameBytes(x.GetPackedTimes(), y.GetPackedTimes()) ||
+                    !isSameBytes(x.GetPackedValues(), y.GetPackedValues())) {
+                    return "animations";
+                }
+            }
+            return std::string();
+        }
+
+        // 頂点属性・インデックスの GPU バッファのサイズ(バイト単位). 作成されていないものは 0.
+        struct GeometryBufferSizes {
+            UINT64 position = 0;
+            UINT64 normal = 0;
+            UINT64 texcoord = 0;
+            UINT64 jointIndices = 0;
+            UINT64 jointWeights = 0;
+            UINT64 index = 0;
+            UINT64 GetTotal() const { return position + normal + texcoord + jointIndices + jointWeights + index; }
+        };
+        static GeometryBufferSizes GetGeometryBufferSizes(const DxrModel& model) {
+            auto getWidth = [](const auto& resource) { return resource ? resource->GetDesc().Width : UINT64(0); };
+            GeometryBufferSizes sizes;
+            sizes.position = getWidth(model.m_vertexAttrib.Position);
+            sizes.normal = getWidth(model.m_vertexAttrib.Normal);
+            sizes.texcoord = getWidth(model.m_vertexAttrib.Texcoord);
+            sizes.jointIndices = getWidth(model.m_vertexAttrib.JointIndices);
+            sizes.jointWeights = getWidth(model.m_vertexAttrib.JointWeights);
+            sizes.index = getWidth(model.m_indexBuffer);
+            return sizes;
+        }
+
+        // 全メッシュグループのメッシュをグループ順に並べて取得する.
+        static std::vector<MeshInfo> GetMeshes(const DxrModel& model) {
+            std::vector<MeshInfo> meshes;
+            for (const auto& group : model.m_meshGroups) {
+                for (const auto& mesh : group.m_meshes) {
+                    meshes.push_back(MeshInfo{
+                        mesh.indexStart, mesh.vertexStart, mesh.indexCount, mesh.vertexCount,
+                        mesh.materialIndex, mesh.indexByteOffset, mesh.indexStride,
+                        mesh.boundsMin, mesh.boundsMax });
+                }
+            }
+            return meshes;
+        }
+    };
+}
@@ -0,0 +1,787 @@
+﻿#include "TestFramework.h"
+#include "DxrModelTestAccess.h"
+
+#include <cstring>
+#include <filesystem>
+
+using namespace DirectX;
+using util::DxrModelTestAccess;
+
+namespace {
+    // テスト用の glTF モデルを組み立てる. データは全て buffers[0] に追加する.
+    class GltfBuilder {
+    public:
+        GltfBuilder() { model.buffers.resize(1); }
+
+        // count 要素のアクセサを追加する. byteStride が 0 以外の場合は、その間隔で要素を並べる.
+        int AddAccessor(
+            const void* data, size_t count, int componentType, int type, size_t elementSize,
+            size_t byteStride = 0, bool normalized = false) {
+            auto& buffer = model.buffers[0].data;
+            buffer.resize((buffer.size() + 3) & ~size_t(3));
+
+            tinygltf::BufferView view;
+            view.buffer = 0;
+            view.byteOffset = buffer.size();
+            view.byteStride = byteStride;
+            const size_t stride = byteStride ? byteStride : elementSize;
+            view.byteLength = stride * count;
+            buffer.resize(buffer.size() + view.byteLength, 0xCD); // 要素間の隙間は読まれないことを確認するため埋めておく.
+            for (size_t i = 0; i < count; ++i) {
+                memcpy(buffer.data() + view.byteOffset + stride * i,
+                    static_cast<const uint8_t*>(data) + elementSize * i, elementSize);
+            }
+            model.bufferViews.push_back(view);
+
+            tinygltf::Accessor accessor;
+            accessor.bufferView = int(model.bufferViews.size() - 1);
+            accessor.componentType = componentType;
+            accessor.type = type;
+            accessor.count = count;
+            accessor.normalized = normalized;
+            model.accessors.push_back(accessor);
+            return int(model.accessors.size() - 1);
+        }
+
+        tinygltf::Model model;
+    };
+
+    // 決まった系列を返す簡易な乱数.
+    class Random {
+    public:
+        explicit Random(uint32_t seed) : m_state(seed) { }
+        uint32_t Next() {
+            m_state = m_state * 1664525u + 1013904223u;
+            return m_state >> 8;
+        }
+        float NextFloat() { return float(Next() & 0xFFFF) / 65535.0f; }
+    private:
+        uint32_t m_state;
+    };
+
+    // 形式の異なるプリミティブを多数含むモデルを作る.
+    //  重複した頂点を含み、最後のプリミティブは頂点を持たない(法線のみの)ものとする.
+    tinygltf::Model CreateMixedPrimitiveModel() {
+        GltfBuilder builder;
+        Random random(1234);
+        const int MeshCount = 8, PrimitivesPerMesh = 6;
+        for (int m = 0; m < MeshCount; ++m) {
+            tinygltf::Mesh mesh;
+            for (int p = 0; p < PrimitivesPerMesh; ++p) {
+                const int k = m * PrimitivesPerMesh + p;
+                const size_t vertexCount = 24 + (k % 7) * 37;
+                const size_t triangleCount = vertexCount + (k % 5) * 11;
+
+                std::vector<XMFLOAT3> positions(vertexCount), normals(vertexCount);
+                std::vector<uint16_t> texcoords(vertexCount * 2);
+                std::vector<uint8_t> joints(vertexCount * 4);
+                std::vector<XMFLOAT4> weights(vertexCount);
+                for (size_t i = 0; i < vertexCount; ++i) {
+                    // 5頂点ごとに直前の頂点と同じ属性にして、統合の対象を作る.
+                    const size_t src = (i % 5 == 4) ? i - 1 : i;
+                    if (src != i) {
+                        positions[i] = positions[src];
+                        normals[i] = normals[src];
+                        texcoords[i * 2 + 0] = texcoords[src * 2 + 0];
+                        texcoords[i * 2 + 1] = texcoords[src * 2 + 1];
+                        memcpy(&joints[i * 4], &joints[src * 4], 4);
+                        weights[i] = weights[src];
+                        continue;
+                    }
+                    positions[i] = XMFLOAT3(random.NextFloat() * 10.0f, random.NextFloat() * 10.0f, float(k));
+                    XMStoreFloat3(&normals[i], XMVector3Normalize(
+                        XMVectorSet(random.NextFloat() - 0.5f, random.NextFloat() - 0.5f, 0.25f, 0.0f)));
+                    texcoords[i * 2 + 0] = uint16_t(random.Next());
+                    texcoords[i * 2 + 1] = uint16_t(random.Next());
+                    for (int j = 0; j < 4; ++j) {
+                        joints[i * 4 + j] = uint8_t(random.Next() % 32);
+                    }
+                    weights[i] = XMFLOAT4(0.4f, 0.3f, 0.2f, 0.1f);
+                }
+                std::vector<uint32_t> indices(triangleCount * 3);
+                for (auto& index : indices) {
+                    index = random.Next() % uint32_t(vertexCount);
+                }
+
+                tinygltf::Primitive primitive;
+                primitive.mode = TINYGLTF_MODE_TRIANGLES;
+                primitive.material = k % 3;
+                // 位置・法線は密に詰めたものと、ストライド付きのものを交互に使う.
+                const size_t stride = (k % 2) ? 20 : 0;
+                primitive.attributes["POSITION"] = builder.AddAccessor(
+                    positions.data(), vertexCount, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, sizeof(XMFLOAT3), stride);
+                primitive.attributes["NORMAL"] = builder.AddAccessor(
+                    normals.data(), vertexCount, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, sizeof(XMFLOAT3), stride);
+                primitive.attributes["TEXCOORD_0"] = builder.AddAccessor(
+                    texcoords.data(), vertexCount, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_VEC2,
+                    sizeof(uint16_t) * 2, 0, true);
+                if (k % 4 == 0) {
+                    primitive.attributes["JOINTS_0"] = builder.AddAccessor(
+                        joints.data(), vertexCount, TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, TINYGLTF_TYPE_VEC4, 4);
+                    primitive.attributes["WEIGHTS_0"] = builder.AddAccessor(
+                        weights.data(), vertexCount, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC4, sizeof(XMFLOAT4));
+                }
+                // インデックスは 8/16/32bit を混在させる.
+                if (k % 3 == 0 && vertexCount <= 0xFF) {
+                    std::vector<uint8_t> indices8(indices.begin(), indices.end());
+                    primitive.indices = builder.AddAccessor(
+                        indices8.data(), indices8.size(), TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, TINYGLTF_TYPE_SCALAR, 1);
+                } else if (k % 3 == 1) {
+                    std::vector<uint16_t> indices16(indices.begin(), indices.end());
+                    primitive.indices = builder.AddAccessor(
+                        indices16.data(), indices16.size(), TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_SCALAR, 2);
+                } else {
+                    primitive.indices = builder.AddAccessor(
+                        indices.data(), indices.size(), TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, TINYGLTF_TYPE_SCALAR, 4);
+                }
+                mesh.primitives.push_back(primitive);
+            }
+            builder.model.meshes.push_back(mesh);
+        }
+
+        // 頂点を持たないプリミティブ. 頂点ストリームの末尾に配置される.
+        tinygltf::Mesh emptyMesh;
+        tinygltf::Primitive emptyPrimitive;
+        const XMFLOAT3 normal(0.0f, 0.0f, 1.0f);
+        emptyPrimitive.attributes["NORMAL"] = builder.AddAccessor(
+            &normal, 1, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, sizeof(XMFLOAT3));
+        emptyMesh.primitives.push_back(emptyPrimitive);
+        builder.model.meshes.push_back(emptyMesh);
+        return builder.model;
+    }
+
+    // ノード階層・スキン・マテリアル・アニメーションを持つモデルを作る.
+    tinygltf::Model CreateSkinnedModel() {
+        GltfBuilder builder;
+        const int GridSize = 9;
+        std::vector<XMFLOAT3> positions, normals;
+        std::vector<XMFLOAT2> texcoords;
+        std::vector<uint16_t> joints;
+        std::vector<XMFLOAT4> weights;
+        for (int y = 0; y < GridSize; ++y) {
+            for (int x = 0; x < GridSize; ++x) {
+                const float t = float(y) / float(GridSize - 1);
+                positions.push_back(XMFLOAT3(float(x) * 0.1f, float(y) * 0.2f, 0.0f));
+                normals.push_back(XMFLOAT3(0.0f, 0.0f, 1.0f));
+                texcoords.push_back(XMFLOAT2(float(x) / float(GridSize - 1), t));
+                const uint16_t joint = uint16_t(std::min(y / 3, 2));
+                const uint16_t influences[4] = { joint, uint16_t(std::min(joint + 1, 2)), 0, 0 };
+                joints.insert(joints.end(), influences, influences + 4);
+                weights.push_back(XMFLOAT4(1.0f - t * 0.5f, t * 0.5f, 0.0f, 0.0f));
+            }
+        }
+        std::vector<uint16_t> indices;
+        for (int y = 0; y + 1 < GridSize; ++y) {
+            for (int x = 0; x + 1 < GridSize; ++x) {
+                const uint16_t v = uint16_t(y * GridSize + x);
+                const uint16_t quad[6] = {
+                    v, uint16_t(v + 1), uint16_t(v + GridSize),
+                    uint16_t(v + 1), uint16_t(v + GridSize + 1), uint16_t(v + GridSize) };
+                indices.insert(indices.end(), quad, quad + 6);
+            }
+        }
+        const size_t vertexCount = positions.size();
+
+        tinygltf::Primitive primitive;
+        primitive.mode = TINYGLTF_MODE_TRIANGLES;
+        primitive.material = 0;
+        primitive.attributes["POSITION"] = builder.AddAccessor(
+            positions.data(), vertexCount, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, sizeof(XMFLOAT3));
+        primitive.attributes["NORMAL"] = builder.AddAccessor(
+            normals.data(), vertexCount, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, sizeof(XMFLOAT3));
+        primitive.attributes["TEXCOORD_0"] = builder.AddAccessor(
+            texcoords.data(), vertexCount, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC2, sizeof(XMFLOAT2));
+        primitive.attributes["JOINTS_0"] = builder.AddAccessor(
+            joints.data(), vertexCount, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_VEC4, sizeof(uint16_t) * 4);
+        primitive.attributes["WEIGHTS_0"] = builder.AddAccessor(
+            weights.data(), vertexCount, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC4, sizeof(XMFLOAT4));
+        primitive.indices = builder.AddAccessor(
+            indices.data(), indices.size(), TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_SCALAR, sizeof(uint16_t));
+        tinygltf::Mesh mesh;
+        mesh.name = "Body";
+        mesh.primitives.push_back(primitive);
+        builder.model.meshes.push_back(mesh);
+
+        // ノード 0 がメッシュを持ち、1 から 3 が関節の連鎖.
+        const char* names[] = { "Root", "Hips", "Spine", "Head" };
+        for (int i = 0; i < 4; ++i) {
+            tinygltf::Node node;
+            node.name = names[i];
+            if (i == 0) {
+                node.mesh = 0;
+                node.skin = 0;
+            } else {
+                node.translation = { 0.0, i == 1 ? 0.0 : 0.6, 0.0 };
+            }
+            if (i == 1 || i == 2) {
+                node.children = { i + 1 };
+            }
+            builder.model.nodes.push_back(node);
+        }
+
+        tinygltf::Skin skin;
+        skin.name = "Skeleton";
+        skin.joints = { 1, 2, 3 };
+        std::vector<XMFLOAT4X4> inverseBindMatrices(3);
+        for (int i = 0; i < 3; ++i) {
+            XMStoreFloat4x4(&inverseBindMatrices[i], XMMatrixTranslation(0.0f, -0.6f * float(i), 0.0f));
+        }
+        skin.inverseBindMatrices = builder.AddAccessor(
+            inverseBindMatrices.data(), 3, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_MAT4, sizeof(XMFLOAT4X4));
+        builder.model.skins.push_back(skin);
+
+        tinygltf::Material material;
+        material.name = "BodyMaterial";
+        material.values["baseColorFactor"].number_array = { 0.8, 0.5, 0.25, 1.0 };
+        builder.model.materials.push_back(material);
+
+        // 関節を揺らすアニメーション.
+        const int KeyCount = 12;
+        std::vector<float> times;
+        std::vector<XMFLOAT4> rotations, translations;
+        for (int i = 0; i < KeyCount; ++i) {
+            times.push_back(float(i) / 10.0f);
+            XMFLOAT4 rotation;
+            XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(0.0f, 0.0f, std::sin(float(i)) * 0.5f));
+            rotations.push_back(rotation);
+            translations.push_back(XMFLOAT4(0.0f, 0.6f + 0.01f * float(i % 3), 0.0f, 0.0f));
+        }
+        const int input = builder.AddAccessor(
+            times.data(), times.size(), TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_SCALAR, sizeof(float));
+        std::vector<XMFLOAT3> translations3;
+        for (const auto& t : translations) {
+            translations3.push_back(XMFLOAT3(t.x, t.y, t.z));
+        }
+        tinygltf::Animation animation;
+        animation.name = "Sway";
+        tinygltf::AnimationSampler rotationSampler;
+        rotationSampler.input = input;
+        rotationSampler.output = builder.AddAccessor(
+            rotations.data(), rotations.size(), TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC4, sizeof(XMFLOAT4));
+        rotationSampler.interpolation = "LINEAR";
+        tinygltf::AnimationSampler translationSampler;
+        translationSampler.input = input;
+        translationSampler.output = builder.AddAccessor(
+            translations3.data(), translations3.size(), TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, sizeof(XMFLOAT3));
+        translationSampler.interpolation = "STEP";
+        animation.samplers = { rotationSampler, translationSampler };
+        tinygltf::AnimationChannel rotationChannel;
+        rotationChannel.sampler = 0;
+        rotationChannel.target_node = 2;
+        rotationChannel.target_path = "rotation";
+        tinygltf::AnimationChannel translationChannel;
+        translationChannel.sampler = 1;
+        translationChannel.target_node = 3;
+        translationChannel.target_path = "translation";
+        animation.channels = { rotationChannel, translationChannel };
+        builder.model.animations.push_back(animation);
+
+        tinygltf::Scene scene;
+        scene.nodes = { 0, 1 };
+        builder.model.scenes.push_back(scene);
+        return builder.model;
+    }
+
+    // 頂点属性の形式ごとの1頂点あたりのバイト数.
+    size_t GetVertexFormatSize(DXGI_FORMAT format) {
+        switch (format) {
+        case DXGI_FORMAT_R32G32B32_FLOAT:
+            return sizeof(float) * 3;
+        case DXGI_FORMAT_R32G32_FLOAT:
+            return sizeof(float) * 2;
+        case DXGI_FORMAT_R16G16_SNORM:
+        case DXGI_FORMAT_R16G16_FLOAT:
+            return sizeof(uint16_t) * 2;
+        case DXGI_FORMAT_R32G32B32A32_UINT:
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            return sizeof(uint32_t) * 4;
+        case DXGI_FORMAT_R8G8B8A8_UINT:
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+            return sizeof(uint8_t) * 4;
+        default:
+            return 0;
+        }
+    }
+
+    // 骨格のみを持つモデル. 8 関節ずつの連鎖を、それまでに追加した関節から枝分かれさせる.
+    //  名前は実際のリグと同じく共通の接頭辞を持たせる.
+    tinygltf::Model CreateSkeletonModel(int jointCount) {
+        tinygltf::Model model;
+        for (int i = 0; i < jointCount; ++i) {
+            tinygltf::Node node;
+            char name[64];
+            snprintf(name, sizeof(name), "mixamorig:Bone%03d", i);
+            node.name = name;
+            node.translation = { 0.0, 0.1, 0.0 };
+            model.nodes.push_back(node);
+            if (i > 0) {
+                const int parent = (i - 1) % 8 == 0 ? (i - 1) / 2 : i - 1;
+                model.nodes[parent].children.push_back(i);
+            }
+        }
+        tinygltf::Scene scene;
+        scene.nodes = { 0 };
+        model.scenes.push_back(scene);
+        return model;
+    }
+
+    // SearchNode の索引化前と同じく、子を shared_ptr で持つノードの木を名前で再帰的に探す.
+    struct NamedNode {
+        std::wstring name;
+        int index;
+        std::vector<std::shared_ptr<NamedNode>> children;
+    };
+
+    std::shared_ptr<NamedNode> SearchNodeRecursive(const std::shared_ptr<NamedNode>& node, const std::wstring& name) {
+        if (node->name == name) {
+            return node;
+        }
+        std::shared_ptr<NamedNode> result = nullptr;
+        for (auto child : node->children) {
+            result = SearchNodeRecursive(child, name);
+            if (result) {
+                break;
+            }
+        }
+        return result;
+    }
+
+    std::shared_ptr<NamedNode> CreateNamedNodeTree(const tinygltf::Model& model, int index) {
+        auto node = std::make_shared<NamedNode>();
+        node->name = std::wstring(model.nodes[index].name.begin(), model.nodes[index].name.end());
+        node->index = index;
+        for (auto child : model.nodes[index].children) {
+            node->children.push_back(CreateNamedNodeTree(model, child));
+        }
+        return node;
+    }
+
+    // --model で指定された GLB を読み込む. 未指定または読み込めない場合は CreateSkinnedModel の結果を返す.
+    //  同梱のモデルはアニメーションを持たないため、アニメーションの計測にはこちらを使う.
+    tinygltf::Model LoadAnimationModel(std::wstring& name) {
+        const auto modelPath = test::GetModelPath(L"");
+        if (!modelPath.empty()) {
+            tinygltf::TinyGLTF loader;
+            tinygltf::Model model;
+            std::string err, warn;
+            if (loader.LoadBinaryFromFile(&model, &err, &warn, std::filesystem::path(modelPath).string())) {
+                name = std::filesystem::path(modelPath).filename().wstring();
+                return model;
+            }
+            test::Log("failed to load %ls: %s", modelPath.c_str(), err.c_str());
+        }
+        name = L"(synthetic)";
+        return CreateSkinnedModel();
+    }
+
+    bool IsSameBytes(const void* a, const void* b, size_t size) {
+        return size == 0 || (a != nullptr && b != nullptr && memcmp(a, b, size) == 0);
+    }
+
+    template<class T>
+    bool IsSameBytes(const std::vector<T>& a, const std::vector<T>& b) {
+        return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), sizeof(T) * a.size()) == 0);
+    }
+}
+
+// プリミティブ単位の並列処理の結果が、1スレッドで順に処理した結果とバイト単位で一致すること.
+TEST_CASE(DxrModel_ParallelImportMatchesSerial)
+{
+    const auto inModel = CreateMixedPrimitiveModel();
+
+    DxrModelTestAccess::ImportSettings decodeOnly;
+    DxrModelTestAccess::ImportSettings processed;
+    processed.weldVertices = true;
+    processed.optimizeMeshes = true;
+    processed.maxClusterTriangles = 16;
+
+    for (const auto& base : { decodeOnly, processed }) {
+        util::DxrModel parallelModel, serialModel;
+        DxrModelTestAccess::VertexAttributeVisitor parallelResult, serialResult;
+        auto settings = base;
+        settings.parallelImport = true;
+        DxrModelTestAccess::LoadMesh(parallelModel, inModel, settings, parallelResult);
+        settings.parallelImport = false;
+        DxrModelTestAccess::LoadMesh(serialModel, inModel, settings, serialResult);
+
+        CHECK(!serialResult.positionBuffer.empty());
+        CHECK(IsSameBytes(parallelResult.indexBuffer, serialResult.indexBuffer));
+        CHECK(IsSameBytes(parallelResult.positionBuffer, serialResult.positionBuffer));
+        CHECK(IsSameBytes(parallelResult.normalBuffer, serialResult.normalBuffer));
+        CHECK(IsSameBytes(parallelResult.texcoordBuffer, serialResult.texcoordBuffer));
+        CHECK(IsSameBytes(parallelResult.jointBuffer, serialResult.jointBuffer));
+        CHECK(IsSameBytes(parallelResult.weightBuffer, serialResult.weightBuffer));
+        CHECK(IsSameBytes(DxrModelTestAccess::GetMeshes(parallelModel), DxrModelTestAccess::GetMeshes(serialModel)));
+    }
+}
+
+// GLB の読み込み時間とメモリ使用量を、メモリマップと util::LoadFile による読み込みとで比較する.
+//  ピークのワーキングセットはプロセス全体で単調に増えるため、増分の小さいメモリマップから計測する.
+BENCHMARK(DxrModel_LoadMappedVsLoadFile)
+{
+    auto& device = test::GetDevice();
+    if (!device) {
+        test::Log("skipped: D3D12 device is not available.");
+        return;
+    }
+    const auto fileName = test::GetModelPath(L"table.glb");
+    for (bool useFileMapping : { true, false }) {
+        util::DxrModel::ImportSettings settings;
+        settings.useFileMapping = useFileMapping;
+
+        const auto memoryBefore = test::GetProcessMemory();
+        bool isLoaded = true;
+        const double ms = test::MeasureMilliseconds([&]() {
+            util::DxrModel model;
+            isLoaded &= model.LoadFromGltf(fileName, device, settings);
+            model.Destroy(device);
+        }, 5);
+        const auto memoryAfter = test::GetProcessMemory();
+        CHECK(isLoaded);
+
+        test::Log("%-8s %8.3f ms, peak working set +%.2f MB",
+            useFileMapping ? "mapped" : "LoadFile", ms,
+            double(memoryAfter.peakWorkingSet - memoryBefore.peakWorkingSet) / (1024.0 * 1024.0));
+    }
+}
+
+// ベイクしたキャッシュを読み込んだ結果が、glTF からの読み込み結果と全ストリーム・全テーブルで一致すること.
+TEST_CASE(DxrModel_CacheRoundTrip)
+{
+    using Access = DxrModelTestAccess;
+    const auto inModel = CreateSkinnedModel();
+    const auto cacheFile = (std::filesystem::temp_directory_path() / L"DxrModel_CacheRoundTrip.dxrmodel").wstring();
+    const uint8_t imageBytes[] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A, 1, 2, 3, 4, 5 };
+
+    Access::ImportSettings plain;
+    Access::ImportSettings compressed;
+    compressed.weldVertices = true;
+    compressed.optimizeMeshes = true;
+    compressed.compressAttributes = true;
+    compressed.compressSkinWeights = true;
+    compressed.compressAnimations = true;
+
+    for (const auto& settings : { plain, compressed }) {
+        util::DxrModel baked;
+        Access::ImportedStreams imported;
+        Access::VertexStreamSource streams;
+        Access::ImportGltf(baked, inModel, settings, imported, streams);
+
+        std::vector<Access::ImageSource> images(1);
+        images[0].name = L"BaseColor";
+        images[0].data = imageBytes;
+        images[0].size = sizeof(imageBytes);
+
+        Access::CacheStamp stamp;
+        stamp.settingsHash = 1;
+        stamp.sourceSize = 2;
+        stamp.sourceWriteTime = 3;
+        stamp.sourceHash = 4;
+        CHECK(Access::SaveCache(baked, cacheFile, stamp, streams, images));
+
+        util::MappedFile file;
+        CHECK(file.Open(cacheFile));
+        Access::CacheStamp loadedStamp;
+        CHECK(Access::ReadCacheStamp(file.GetData(), file.GetSize(), loadedStamp));
+        CHECK(memcmp(&loadedStamp, &stamp, sizeof(stamp)) == 0);
+
+        util::DxrModel loaded;
+        Access::VertexStreamSource loadedStreams;
+        std::vector<Access::ImageSource> loadedImages;
+        CHECK(Access::LoadCache(loaded, file.GetData(), file.GetSize(), loadedStreams, loadedImages));
+
+        // 頂点ストリーム.
+        CHECK(loadedStreams.vertexCount == streams.vertexCount);
+        CHECK(loadedStreams.skinVertexCount == streams.skinVertexCount);
+        CHECK(loadedStreams.indexBufferSize == streams.indexBufferSize);
+        CHECK(loadedStreams.normalFormat == streams.normalFormat);
+        CHECK(loadedStreams.texcoordFormat == streams.texcoordFormat);
+        CHECK(loadedStreams.jointFormat == streams.jointFormat);
+        CHECK(loadedStreams.weightFormat == streams.weightFormat);
+        CHECK(IsSameBytes(loadedStreams.indices, streams.indices, streams.indexBufferSize));
+        CHECK(IsSameBytes(loadedStreams.positions, streams.positions, sizeof(XMFLOAT3) * streams.vertexCount));
+        CHECK(IsSameBytes(loadedStreams.normals, streams.normals,
+            GetVertexFormatSize(streams.normalFormat) * streams.vertexCount));
+        CHECK(IsSameBytes(loadedStreams.texcoords, streams.texcoords,
+            GetVertexFormatSize(streams.texcoordFormat) * streams.vertexCount));
+        CHECK(IsSameBytes(loadedStreams.joints, streams.joints,
+            GetVertexFormatSize(streams.jointFormat) * streams.skinVertexCount));
+        CHECK(IsSameBytes(loadedStreams.weights, streams.weights,
+            GetVertexFormatSize(streams.weightFormat) * streams.skinVertexCount));
+
+        // 埋め込み画像.
+        CHECK(loadedImages.size() == 1);
+        if (loadedImages.size() == 1) {
+            CHECK(loadedImages[0].name == images[0].name);
+            CHECK(loadedImages[0].size == images[0].size);
+            CHECK(IsSameBytes(loadedImages[0].data, images[0].data, images[0].size));
+        }
+
+        // ノード・メッシュ・マテリアル・スキン・アニメーション.
+        const auto difference = Access::FindTableDifference(baked, loaded);
+        CHECK(difference.empty());
+        if (!difference.empty()) {
+            test::Log("different table: %s", difference.c_str());
+        }
+        CHECK(loaded.GetAnimationCount() == 1);
+        CHECK(loaded.GetAnimation(0).IsCompressed() == settings.compressAnimations);
+
+        // 更新日時のみが変わった場合のスタンプの書き換え.
+        file.Close();
+        stamp.sourceWriteTime = 5;
+        CHECK(Access::UpdateCacheStamp(cacheFile, stamp));
+        CHECK(file.Open(cacheFile));
+        CHECK(Access::ReadCacheStamp(file.GetData(), file.GetSize(), loadedStamp));
+        CHECK(memcmp(&loadedStamp, &stamp, sizeof(stamp)) == 0);
+        util::DxrModel reloaded;
+        CHECK(Access::LoadCache(reloaded, file.GetData(), file.GetSize(), loadedStreams, loadedImages));
+        file.Close();
+    }
+    std::error_code ec;
+    std::filesystem::remove(cacheFile, ec);
+}
+
+// キャッシュが無い場合(glTF から読み込んでベイク)、有効なキャッシュがある場合、
+//  元ファイルの更新日時のみが変わった場合(内容のハッシュ値で照合)の読み込み時間を比較する.
+BENCHMARK(DxrModel_CacheColdVsWarm)
+{
+    auto& device = test::GetDevice();
+    if (!device) {
+        test::Log("skipped: D3D12 device is not available.");
+        return;
+    }
+    // 元のファイルの更新日時を変えないよう、一時フォルダへ複製して使用する.
+    const std::filesystem::path source = test::GetModelPath(L"table.glb");
+    const auto work = std::filesystem::temp_directory_path() / source.filename();
+    auto cachePath = work;
+    cachePath.replace_extension(L".dxrmodel");
+    std::filesystem::copy_file(source, work, std::filesystem::copy_options::overwrite_existing);
+
+    util::DxrModel::ImportSettings settings;
+    settings.useModelCache = true;
+    bool isLoaded = true;
+    auto load = [&]() {
+        util::DxrModel model;
+        isLoaded &= model.LoadFromGltf(work.wstring(), device, settings);
+        model.Destroy(device);
+    };
+    const double coldMs = test::MeasureMilliseconds([&]() {
+        std::filesystem::remove(cachePath);
+        load();
+    }, 5);
+    const double warmMs = test::MeasureMilliseconds(load, 5);
+    const double touchedMs = test::MeasureMilliseconds([&]() {
+        std::filesystem::last_write_time(work, std::filesystem::file_time_type::clock::now());
+        load();
+    }, 5);
+    CHECK(isLoaded);
+    test::Log("cold (import + bake) %8.3f ms", coldMs);
+    test::Log("warm (size + time)   %8.3f ms", warmMs);
+    test::Log("warm (content hash)  %8.3f ms", touchedMs);
+
+    std::error_code ec;
+    std::filesystem::remove(cachePath, ec);
+    std::filesystem::remove(work, ec);
+}
+
+// 法線・UV の圧縮の有無による GPU バッファのサイズ(各バッファの GetDesc().Width の合計).
+//  --model 指定時はそのモデルのみ、未指定時は同梱のモデルを計測する.
+BENCHMARK(DxrModel_AttributeCompressionMemory)
+{
+    auto& device = test::GetDevice();
+    if (!device) {
+        test::Log("skipped: D3D12 device is not available.");
+        return;
+    }
+    std::vector<std::wstring> files = { L"table.glb", L"teapot.glb", L"alicia.glb" };
+    const auto modelPath = test::GetModelPath(L"");
+    if (!modelPath.empty()) {
+        files = { modelPath };
+    }
+    const double KiB = 1024.0;
+    for (const auto& file : files) {
+        DxrModelTestAccess::GeometryBufferSizes sizes[2];
+        for (bool compressAttributes : { false, true }) {
+            util::DxrModel::ImportSettings settings;
+            settings.compressAttributes = compressAttributes;
+            util::DxrModel model;
+            const bool isLoaded = model.LoadFromGltf(file, device, settings);
+            CHECK(isLoaded);
+            if (isLoaded) {
+                sizes[compressAttributes] = DxrModelTestAccess::GetGeometryBufferSizes(model);
+            }
+            model.Destroy(device);
+        }
+        const auto& raw = sizes[0];
+        const auto& packed = sizes[1];
+        test::Log("%ls: normal %.1f -> %.1f KiB, texcoord %.1f -> %.1f KiB, total %.1f -> %.1f KiB (%.1f%%)",
+            std::filesystem::path(file).filename().c_str(),
+            raw.normal / KiB, packed.normal / KiB, raw.texcoord / KiB, packed.texcoord / KiB,
+            raw.GetTotal() / KiB, packed.GetTotal() / KiB,
+            raw.GetTotal() ? 100.0 * double(packed.GetTotal()) / double(raw.GetTotal()) : 0.0);
+        CHECK(packed.GetTotal() <= raw.GetTotal());
+    }
+}
+
+// モデルの各アニメーションクリップを全チャンネル評価する時間(GPU は使用しない).
+//  --model で指定したモデル、未指定時は合成したモデルのクリップを、圧縮の有無で比較する.
+BENCHMARK(DxrModel_SampleAnimationClips)
+{
+    using Access = DxrModelTestAccess;
+    std::wstring name;
+    const auto inModel = LoadAnimationModel(name);
+    for (bool compressAnimations : { false, true }) {
+        Access::ImportSettings settings;
+        settings.compressAnimations = compressAnimations;
+        util::DxrModel model;
+        Access::ImportedStreams imported;
+        Access::VertexStreamSource streams;
+        Access::ImportGltf(model, inModel, settings, imported, streams);
+        if (model.GetAnimationCount() == 0) {
+            test::Log("%ls: no animation clips.", name.c_str());
+            return;
+        }
+        for (UINT i = 0; i < model.GetAnimationCount(); ++i) {
+            const auto& clip = model.GetAnimation(i);
+            std::vector<XMVECTOR> output(clip.GetChannelCount());
+            const int SampleCount = 1000;
+            const double ms = test::MeasureMilliseconds([&]() {
+                for (int s = 0; s < SampleCount; ++s) {
+                    clip.Sample(clip.GetDuration() * float(s) / SampleCount, output.data());
+                }
+            }, 5);
+            const double us = ms * 1000.0 / SampleCount;
+            test::Log("%ls %-24ls %-10s %4zu channels %6zu keys: %8.2f us/sample (%6.1f ns/channel)",
+                name.c_str(), clip.GetName().c_str(), compressAnimations ? "compressed" : "raw",
+                clip.GetChannelCount(), clip.GetKeyCount(), us,
+                clip.GetChannelCount() ? us * 1000.0 / double(clip.GetChannelCount()) : 0.0);
+        }
+    }
+}
+
+// モデルの各アニメーションクリップの圧縮率と誤差(GPU は使用しない).
+//  --model で指定したモデル、未指定時は合成したモデルのクリップを対象とする.
+BENCHMARK(DxrModel_AnimationCompressionReport)
+{
+    using Access = DxrModelTestAccess;
+    std::wstring name;
+    const auto inModel = LoadAnimationModel(name);
+    util::DxrModel model;
+    Access::ImportedStreams imported;
+    Access::VertexStreamSource streams;
+    Access::ImportGltf(model, inModel, Access::ImportSettings(), imported, streams);
+    if (model.GetAnimationCount() == 0) {
+        test::Log("%ls: no animation clips.", name.c_str());
+        return;
+    }
+    util::AnimationSkeleton skeleton;
+    std::vector<float> jointLengths;
+    Access::BuildAnimationSkeleton(model, skeleton, jointLengths);
+    for (float maxError : { 1.0e-4f, 1.0e-3f }) {
+        util::AnimationCompressSettings settings;
+        settings.maxError = maxError;
+        for (UINT i = 0; i < model.GetAnimationCount(); ++i) {
+            auto clip = model.GetAnimation(i);
+            util::AnimationCompressReport report;
+            clip.Compress(settings, jointLengths, &report, &skeleton);
+            test::Log("%ls %-24ls tolerance %6g: %8zu -> %7zu bytes (%5.1f%%), %6zu -> %6zu keys, max error %.6f (object space %.6f)",
+                name.c_str(), clip.GetName().c_str(), maxError, report.sourceBytes, report.compressedBytes,
+                report.sourceBytes ? 100.0 * double(report.compressedBytes) / double(report.sourceBytes) : 0.0,
+                report.sourceKeys, report.compressedKeys, report.maxError, report.maxObjectError);
+        }
+    }
+}
+
+// Actor 生成時の名前による関節の解決(リターゲット用の対応表など)にかかる時間.
+//  約 200 関節の骨格で、モデルの名前の索引を引く FindNodes と、ノードの木を再帰的にたどる検索とを比べる.
+BENCHMARK(DxrModel_ResolveNodeNames)
+{
+    using Access = DxrModelTestAccess;
+    const int JointCount = 200;
+    const auto inModel = CreateSkeletonModel(JointCount);
+    util::DxrModel model;
+    Access::ImportedStreams imported;
+    Access::VertexStreamSource streams;
+    Access::ImportGltf(model, inModel, Access::ImportSettings(), imported, streams);
+    const auto root = CreateNamedNodeTree(inModel, 0);
+
+    // 全関節の名前と、見つからない名前(再帰的な検索では全ノードをたどる)を引く.
+    std::vector<std::wstring> names;
+    for (const auto& node : inModel.nodes) {
+        names.push_back(std::wstring(node.name.begin(), node.name.end()));
+    }
+    names.push_back(L"mixamorig:Missing");
+    const size_t nameCount = names.size();
+
+    std::vector<int> indexed(nameCount), recursive(nameCount);
+    const int Repeat = 100;
+    const double indexedMs = test::MeasureMilliseconds([&]() {
+        for (int r = 0; r < Repeat; ++r) {
+            model.FindNodes(names.data(), nameCount, indexed.data());
+        }
+    });
+    const double recursiveMs = test::MeasureMilliseconds([&]() {
+        for (int r = 0; r < Repeat; ++r) {
+            for (size_t i = 0; i < nameCount; ++i) {
+                auto node = SearchNodeRecursive(root, names[i]);
+                recursive[i] = node ? node->index : -1;
+            }
+        }
+    });
+    CHECK(indexed == recursive);
+    const double toUs = 1000.0 / Repeat;
+    test::Log("%d joints, %zu names per spawn: FindNodes %8.2f us (%6.1f ns/name), recursive %8.2f us (%6.1f ns/name)",
+        JointCount, nameCount, indexedMs * toUs, indexedMs * toUs * 1000.0 / nameCount,
+        recursiveMs * toUs, recursiveMs * toUs * 1000.0 / nameCount);
+}
+
+// 静的なモデル(table.glb)の Actor を 10k 体生成する時間とメモリ.
+//  初回の生成は共有する BLAS とディスクリプタを作るため、2体目以降と分けて計測する.
+//  共有前は全 Actor が初回と同じ処理を行っていたため、その見積もりも出力する.
+BENCHMARK(DxrModel_SpawnStaticProps)
+{
+    auto& device = test::GetDevice();
+    if (!device) {
+        test::Log("skipped: D3D12 device is not available.");
+        return;
+    }
+    const auto fileName = test::GetModelPath(L"table.glb");
+    util::DxrModel model;
+    if (!model.LoadFromGltf(fileName, device)) {
+        CHECK(false);
+        return;
+    }
+    const size_t ActorCount = 10000;
+    std::vector<std::shared_ptr<util::DxrModelActor>> actors;
+    actors.reserve(ActorCount);
+
+    const auto memoryStart = test::GetProcessMemory();
+    const auto firstStart = std::chrono::high_resolution_clock::now();
+    actors.push_back(model.Create(device));
+    const auto firstEnd = std::chrono::high_resolution_clock::now();
+    const auto memoryFirst = test::GetProcessMemory();
+    for (size_t i = 1; i < ActorCount; ++i) {
+        actors.push_back(model.Create(device));
+    }
+    const auto restEnd = std::chrono::high_resolution_clock::now();
+    const auto memoryEnd = test::GetProcessMemory();
+    CHECK(actors.back() != nullptr);
+
+    const double firstMs = std::chrono::duration<double, std::milli>(firstEnd - firstStart).count();
+    const double restMs = std::chrono::duration<double, std::milli>(restEnd - firstEnd).count();
+    const double MiB = 1024.0 * 1024.0;
+    const double restBytes = double(memoryEnd.privateBytes) - double(memoryFirst.privateBytes);
+    test::Log("%ls: %zu instances per actor", std::filesystem::path(fileName).filename().c_str(), actors[0]->GetInstanceCount());
+    test::Log("first actor: %8.3f ms, private bytes +%.2f MB", firstMs,
+        (double(memoryFirst.privateBytes) - double(memoryStart.privateBytes)) / MiB);
+    test::Log("%zu more actors: %8.3f ms (%.2f us/actor), private bytes +%.2f MB (%.0f bytes/actor)",
+        ActorCount - 1, restMs, restMs * 1000.0 / double(ActorCount - 1), restBytes / MiB, restBytes / double(ActorCount - 1));
+    test::Log("without sharing (first-actor cost for every actor): about %.1f s", firstMs * double(ActorCount) / 1000.0);
+
+    const auto destroyStart = std::chrono::high_resolution_clock::now();
+    actors.clear();
+    const auto destroyEnd = std::chrono::high_resolution_clock::now();
+    test::Log("release: %8.3f ms", std::chrono::duration<double, std::milli>(destroyEnd - destroyStart).count());
+    device->WaitForIdleGpu();
+    model.Destroy(device);
+}
@@ -0,0 +1,121 @@
+﻿#include "TestFramework.h"
+#include "GraphicsDevice.h"
+#include <psapi.h>
+
+#include <cstdarg>
+#include <cstring>
+#include <filesystem>
+#include <exception>
+
+namespace test {
+    static int s_failureCount = 0;
+    static std::wstring s_modelPath;
+    static std::unique_ptr<dx12::GraphicsDevice> s_device;
+    static bool s_deviceInitialized = false;
+
+    std::vector<TestEntry>& GetRegistry() {
+        static std::vector<TestEntry> registry;
+        return registry;
+    }
+
+    void ReportFailure(const char* file, int line, const char* message) {
+        printf("  %s(%d): CHECK failed: %s\n", std::filesystem::path(file).filename().string().c_str(), line, message);
+        ++s_failureCount;
+    }
+
+    void Log(const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        printf("  ");
+        vprintf(format, args);
+        printf("\n");
+        va_end(args);
+    }
+
+    std::unique_ptr<dx12::GraphicsDevice>& GetDevice() {
+        if (!s_deviceInitialized) {
+            s_deviceInitialized = true;
+            s_device = std::make_unique<dx12::GraphicsDevice>();
+            if (!s_device->OnInit()) {
+                s_device.reset();
+            }
+        }
+        return s_device;
+    }
+
+    ProcessMemory GetProcessMemory() {
+        ProcessMemory memory;
+        PROCESS_MEMORY_COUNTERS_EX counters{};
+        counters.cb = sizeof(counters);
+        if (GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters))) {
+            memory.workingSet = counters.WorkingSetSize;
+            memory.peakWorkingSet = counters.PeakWorkingSetSize;
+            memory.privateBytes = counters.PrivateUsage;
+        }
+        return memory;
+    }
+
+    std::wstring GetModelPath(const wchar_t* defaultPath) {
+        return s_modelPath.empty() ? std::wstring(defaultPath) : s_modelPath;
+    }
+}
+
+// 使い方:
+//  Tests.exe [--benchmark] [--filter 名前の一部] [--model モデルファイル] [--data データフォルダ]
+//  --data にはモデルや white.png を置いたフォルダを指定する(既定は ..\06_Model).
+int wmain(int argc, wchar_t* argv[])
+{
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+    bool runBenchmarks = false;
+    std::string filter;
+    std::filesystem::path dataDir = L"..\\06_Model";
+    for (int i = 1; i < argc; ++i) {
+        std::wstring arg = argv[i];
+        if (arg == L"--benchmark") {
+            runBenchmarks = true;
+        } else if (arg == L"--filter" && i + 1 < argc) {
+            filter = std::filesystem::path(argv[++i]).string();
+        } else if (arg == L"--model" && i + 1 < argc) {
+            test::s_modelPath = std::filesystem::absolute(argv[++i]).wstring();
+        } else if (arg == L"--data" && i + 1 < argc) {
+            dataDir = argv[++i];
+        }
+    }
+    std::error_code ec;
+    std::filesystem::current_path(dataDir, ec);
+
+    auto entries = test::GetRegistry();
+    std::sort(entries.begin(), entries.end(),
+        [](const test::TestEntry& a, const test::TestEntry& b) { return strcmp(a.name, b.name) < 0; });
+
+    int runCount = 0, failedCount = 0;
+    for (const auto& entry : entries) {
+        if (entry.isBenchmark != runBenchmarks) {
+            continue;
+        }
+        if (!filter.empty() && strstr(entry.name, filter.c_str()) == nullptr) {
+            continue;
+        }
+        printf("[ RUN      ] %s\n", entry.name);
+        const int failuresBefore = test::s_failureCount;
+        try {
+            entry.func();
+        } catch (const std::exception& e) {
+            test::ReportFailure(__FILE__, __LINE__, e.what());
+        }
+        const bool isPassed = test::s_failureCount == failuresBefore;
+        printf("[ %s ] %s\n", isPassed ? "      OK" : "  FAILED", entry.name);
+        ++runCount;
+        failedCount += isPassed ? 0 : 1;
+    }
+    printf("%d %s, %d failed.\n", runCount, runBenchmarks ? "benchmarks" : "tests", failedCount);
+
+    if (test::s_device) {
+        test::s_device->WaitForIdleGpu();
+        test::s_device->OnDestroy();
+        test::s_device.reset();
+    }
+    CoUninitialize();
+    return failedCount == 0 ? 0 : 1;
+}
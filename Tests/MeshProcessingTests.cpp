@@ -0,0 +1,495 @@
+﻿#include "TestFramework.h"
+#include "util/MeshProcessing.h"
+
+#include <cstring>
+#include <map>
+#include <thread>
+#include <tuple>
+
+using namespace DirectX;
+
+namespace {
+    // 決まった系列を返す簡易な乱数.
+    class Random {
+    public:
+        explicit Random(uint32_t seed) : m_state(seed) { }
+        uint32_t Next() {
+            m_state = m_state * 1664525u + 1013904223u;
+            return m_state >> 8;
+        }
+    private:
+        uint32_t m_state;
+    };
+
+    // chsModel.hlsl の GetTriangleIndices と同じ方法で、範囲の先頭から primitiveIndex 番目の三角形を読み取る.
+    //  ByteAddressBuffer の Load は 4 バイト単位のため、読み取る位置が範囲(4 バイト境界に切り上げ)内であることも確認する.
+    bool LoadTriangleIndices(
+        const std::vector<uint8_t>& stream, const util::IndexRange& range,
+        uint32_t primitiveIndex, uint32_t indices[3]) {
+        const auto rangeSize = (size_t(range.indexCount) * range.indexStride + 3) & ~size_t(3);
+        auto load = [&](size_t offset, uint32_t count, uint32_t* words) {
+            if (offset % 4 != 0 || offset + count * 4 > rangeSize) {
+                return false;
+            }
+            memcpy(words, stream.data() + range.byteOffset + offset, count * 4);
+            return true;
+        };
+        uint32_t words[3];
+        if (range.indexStride == 2) {
+            const uint32_t offset = primitiveIndex * 3 * 2;
+            if (!load(offset & ~3u, 2, words)) {
+                return false;
+            }
+            if ((offset & 2) == 0) {
+                indices[0] = words[0] & 0xFFFF; indices[1] = words[0] >> 16; indices[2] = words[1] & 0xFFFF;
+            } else {
+                indices[0] = words[0] >> 16; indices[1] = words[1] & 0xFFFF; indices[2] = words[1] >> 16;
+            }
+            return true;
+        }
+        if (!load(primitiveIndex * 3 * 4, 3, words)) {
+            return false;
+        }
+        memcpy(indices, words, sizeof(words));
+        return true;
+    }
+
+    // 詰めたインデックスを全て読み戻し、元のインデックス列と一致することを確認する.
+    bool IsSameTriangles(
+        const std::vector<uint32_t>& indices, const std::vector<util::IndexRange>& ranges,
+        const std::vector<uint8_t>& stream) {
+        for (const auto& range : ranges) {
+            if (range.byteOffset % 4 != 0) {
+                return false;
+            }
+            for (uint32_t t = 0; t < range.indexCount / 3; ++t) {
+                uint32_t loaded[3];
+                if (!LoadTriangleIndices(stream, range, t, loaded)) {
+                    return false;
+                }
+                for (int k = 0; k < 3; ++k) {
+                    if (loaded[k] != indices[range.indexStart + t * 3 + k]) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // 最大のインデックスが maxIndex となる三角形 triangleCount 個を追加し、その範囲を返す.
+    util::IndexRange AppendTriangles(
+        std::vector<uint32_t>& indices, uint32_t triangleCount, uint32_t maxIndex, Random& random) {
+        util::IndexRange range;
+        range.indexStart = uint32_t(indices.size());
+        range.indexCount = triangleCount * 3;
+        for (uint32_t i = 0; i < range.indexCount; ++i) {
+            indices.push_back(random.Next() % (maxIndex + 1));
+        }
+        if (range.indexCount > 0) {
+            indices[range.indexStart + range.indexCount / 2] = maxIndex;
+        }
+        return range;
+    }
+
+    // size x size の格子状のメッシュを作り、三角形の順序と(shuffleVertices の場合は)頂点番号を乱数で並べ替える.
+    //  並べ替えの最適化処理にとって最も不利な入力となる.
+    std::vector<uint32_t> CreateShuffledGrid(uint32_t size, uint32_t seed, bool shuffleVertices = true) {
+        const uint32_t row = size + 1;
+        std::vector<uint32_t> indices;
+        indices.reserve(size_t(size) * size * 6);
+        for (uint32_t y = 0; y < size; ++y) {
+            for (uint32_t x = 0; x < size; ++x) {
+                const uint32_t v0 = y * row + x, v1 = v0 + 1, v2 = v0 + row, v3 = v2 + 1;
+                const uint32_t quad[6] = { v0, v2, v1, v1, v2, v3 };
+                indices.insert(indices.end(), quad, quad + 6);
+            }
+        }
+        Random random(seed);
+        const size_t triangleCount = indices.size() / 3;
+        for (size_t i = triangleCount - 1; i > 0; --i) {
+            const size_t j = random.Next() % (i + 1);
+            for (int k = 0; k < 3; ++k) {
+                std::swap(indices[i * 3 + k], indices[j * 3 + k]);
+            }
+        }
+        if (!shuffleVertices) {
+            return indices;
+        }
+        std::vector<uint32_t> vertexOrder(size_t(row) * row);
+        for (uint32_t i = 0; i < vertexOrder.size(); ++i) {
+            vertexOrder[i] = i;
+        }
+        for (size_t i = vertexOrder.size() - 1; i > 0; --i) {
+            std::swap(vertexOrder[i], vertexOrder[random.Next() % (i + 1)]);
+        }
+        for (auto& index : indices) {
+            index = vertexOrder[index];
+        }
+        return indices;
+    }
+
+    // 格子の頂点位置. 高さ方向にも起伏を付ける.
+    std::vector<XMFLOAT3> CreateGridPositions(uint32_t size) {
+        std::vector<XMFLOAT3> positions;
+        for (uint32_t y = 0; y <= size; ++y) {
+            for (uint32_t x = 0; x <= size; ++x) {
+                positions.push_back(XMFLOAT3(float(x), std::sin(float(x + y) * 0.1f) * 4.0f, float(y)));
+            }
+        }
+        return positions;
+    }
+}
+
+// 頂点数 65,535 / 65,536 のメッシュは 16bit、65,537 のメッシュは 32bit となること.
+TEST_CASE(MeshProcessing_PackIndexStreamSelectsIndex16)
+{
+    Random random(1);
+    std::vector<uint32_t> indices;
+    std::vector<util::IndexRange> ranges;
+    ranges.push_back(AppendTriangles(indices, 100, 65534, random));
+    ranges.push_back(AppendTriangles(indices, 100, 65535, random));
+    ranges.push_back(AppendTriangles(indices, 100, 65536, random));
+
+    std::vector<uint8_t> stream;
+    util::PackIndexStream(indices, ranges, true, stream);
+    CHECK(ranges[0].indexStride == 2);
+    CHECK(ranges[1].indexStride == 2);
+    CHECK(ranges[2].indexStride == 4);
+    CHECK(stream.size() == 600 + 600 + 1200);
+    CHECK(IsSameTriangles(indices, ranges, stream));
+
+    // 無効にした場合は全て 32bit.
+    util::PackIndexStream(indices, ranges, false, stream);
+    for (const auto& range : ranges) {
+        CHECK(range.indexStride == 4);
+    }
+    CHECK(stream.size() == indices.size() * 4);
+    CHECK(IsSameTriangles(indices, ranges, stream));
+}
+
+// 16bit と 32bit の範囲が混在する場合も、各範囲の開始位置が 4 バイト境界に揃い、正しく読み戻せること.
+TEST_CASE(MeshProcessing_PackIndexStreamMixedFormats)
+{
+    Random random(2);
+    std::vector<uint32_t> indices;
+    std::vector<util::IndexRange> ranges;
+    // 三角形数が奇数の 16bit 範囲は 6 バイト単位のため、次の範囲の前に詰め物が入る.
+    const uint32_t triangleCounts[] = { 1, 3, 2, 5, 0, 7, 1, 4 };
+    const uint32_t maxIndices[] = { 10, 70000, 65535, 100, 0, 1u << 20, 3, 65536 };
+    for (int i = 0; i < 8; ++i) {
+        ranges.push_back(AppendTriangles(indices, triangleCounts[i], maxIndices[i], random));
+    }
+    // 範囲の順序と元のインデックス列での位置は一致していなくてもよい.
+    std::swap(ranges[1], ranges[6]);
+
+    std::vector<uint8_t> stream;
+    util::PackIndexStream(indices, ranges, true, stream);
+
+    size_t expectedOffset = 0;
+    for (const auto& range : ranges) {
+        const auto begin = indices.begin() + range.indexStart;
+        const bool is16 = std::all_of(begin, begin + range.indexCount, [](uint32_t v) { return v <= 0xFFFF; });
+        CHECK(range.indexStride == (is16 ? 2u : 4u));
+        CHECK(range.byteOffset == expectedOffset);
+        CHECK(range.byteOffset % 4 == 0);
+        expectedOffset += (size_t(range.indexCount) * range.indexStride + 3) & ~size_t(3);
+    }
+    CHECK(stream.size() == expectedOffset);
+    CHECK(IsSameTriangles(indices, ranges, stream));
+
+    // 詰め物の部分は 0 で埋められる.
+    const auto& odd = ranges[0];
+    CHECK(odd.indexStride == 2 && odd.indexCount == 3);
+    CHECK(stream[odd.byteOffset + 6] == 0 && stream[odd.byteOffset + 7] == 0);
+}
+
+// 統合の前後で、インデックスを展開した三角形の頂点属性が(量子化の誤差の範囲で)変わらないこと.
+TEST_CASE(MeshProcessing_WeldVerticesKeepsTriangles)
+{
+    // 四角形ごとに独立した4頂点を持つ格子. 隣の四角形と共有する角は重複した頂点になる.
+    //  左右で法線が異なるため、中央の列の頂点は統合されずに残る.
+    const uint32_t Size = 16;
+    const float Epsilon = 1.0e-4f;
+    struct Vertex {
+        XMFLOAT3 position;
+        XMFLOAT3 normal;
+        XMFLOAT2 texcoord;
+    };
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    Random random(7);
+    for (uint32_t y = 0; y < Size; ++y) {
+        for (uint32_t x = 0; x < Size; ++x) {
+            const auto base = uint32_t(vertices.size());
+            const XMFLOAT3 normal = x < Size / 2 ? XMFLOAT3(0.0f, 0.0f, 1.0f) : XMFLOAT3(0.0f, 1.0f, 0.0f);
+            for (uint32_t k = 0; k < 4; ++k) {
+                const uint32_t cx = x + (k & 1), cy = y + (k >> 1);
+                // 量子化の単位より十分小さい揺らぎを加え、完全一致でない重複も作る.
+                const float jitter = float(random.Next() % 64) / 64.0f * Epsilon * 0.25f;
+                Vertex v;
+                v.position = XMFLOAT3(float(cx) * 0.5f + jitter, float(cy) * 0.5f, 0.0f);
+                v.normal = normal;
+                v.texcoord = XMFLOAT2(float(cx) / Size, float(cy) / Size - jitter);
+                vertices.push_back(v);
+            }
+            const uint32_t quad[6] = { base, base + 2, base + 1, base + 1, base + 2, base + 3 };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+    // 参照されない頂点も1つ加えておく.
+    vertices.push_back(vertices.front());
+
+    const size_t KeyStride = 8;
+    std::vector<uint64_t> keys(vertices.size() * KeyStride);
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const float* values[] = { &vertices[i].position.x, &vertices[i].normal.x, &vertices[i].texcoord.x };
+        const size_t counts[] = { 3, 3, 2 };
+        auto key = &keys[i * KeyStride];
+        for (int a = 0; a < 3; ++a) {
+            for (size_t c = 0; c < counts[a]; ++c) {
+                *key++ = util::QuantizeVertexValue(values[a][c], Epsilon);
+            }
+        }
+    }
+
+    const auto source = vertices;
+    const auto sourceIndices = indices;
+    std::vector<uint32_t> remap;
+    const auto weldedCount = util::WeldVertices(
+        indices.data(), indices.size(), keys.data(), KeyStride, vertices.size(), remap);
+    util::RemapVertexStream(vertices.data(), vertices.size(), remap);
+    vertices.resize(weldedCount);
+
+    CHECK(weldedCount == size_t(Size + 1) * (Size + 1) + (Size + 1));
+    CHECK(indices.size() == sourceIndices.size());
+    bool isSameTriangles = true;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        if (indices[i] >= weldedCount) {
+            isSameTriangles = false;
+            break;
+        }
+        const auto& before = source[sourceIndices[i]];
+        const auto& after = vertices[indices[i]];
+        const float diffs[] = {
+            before.position.x - after.position.x, before.position.y - after.position.y,
+            before.position.z - after.position.z,
+            before.normal.x - after.normal.x, before.normal.y - after.normal.y, before.normal.z - after.normal.z,
+            before.texcoord.x - after.texcoord.x, before.texcoord.y - after.texcoord.y,
+        };
+        for (float d : diffs) {
+            isSameTriangles &= std::abs(d) <= Epsilon;
+        }
+    }
+    CHECK(isSameTriangles);
+
+    // 三角形の巻き方向(頂点の並び)も保たれ、縮退した三角形は生じない.
+    for (size_t t = 0; t < indices.size(); t += 3) {
+        CHECK(indices[t] != indices[t + 1] && indices[t + 1] != indices[t + 2] && indices[t] != indices[t + 2]);
+    }
+}
+
+// 八面体エンコードした法線の復元誤差. 極、下半球の折り返し、赤道、長さ 0 の入力を含む.
+TEST_CASE(MeshProcessing_OctahedralNormalRoundTrip)
+{
+    std::vector<XMFLOAT3> normals = {
+        { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+        { 0.7071068f, 0.7071068f, 0 }, { -0.7071068f, 0.7071068f, 0 }, // 赤道(折り返しの境界).
+        { 0.6f, -0.8f, -1.0e-7f }, { 0.0f, 0.8f, -0.6f }, { -0.577f, -0.577f, -0.577f },
+        { 1.0e-4f, -1.0e-4f, -1.0f }, // 下の極の近傍. 折り返し後は八面体の角に寄る.
+    };
+    // 球面上に一様に分布する方向.
+    Random random(8);
+    for (int i = 0; i < 20000; ++i) {
+        const float z = float(random.Next() % 65536) / 32767.5f - 1.0f;
+        const float phi = float(random.Next() % 65536) / 65536.0f * 6.2831853f;
+        const float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+        normals.push_back(XMFLOAT3(r * std::cos(phi), r * std::sin(phi), z));
+    }
+
+    std::vector<uint32_t> packed(normals.size());
+    util::EncodeOctahedralNormals(packed.data(), normals.data(), normals.size());
+    double maxErrorDegrees = 0.0;
+    for (size_t i = 0; i < normals.size(); ++i) {
+        const auto decoded = util::DecodeOctahedralNormal(packed[i]);
+        CHECK_NEAR(XMVectorGetX(XMVector3Length(XMLoadFloat3(&decoded))), 1.0, 1.0e-5);
+        // 微小な角度を求めるため、倍精度で外積の長さと内積から角度を求める.
+        const double a[3] = { normals[i].x, normals[i].y, normals[i].z };
+        const double b[3] = { decoded.x, decoded.y, decoded.z };
+        const double cross[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+        const double sine = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+        const double cosine = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        maxErrorDegrees = std::max(maxErrorDegrees, std::atan2(sine, cosine) * 180.0 / 3.14159265358979);
+    }
+    test::Log("octahedral snorm16: max error %.5f degrees", maxErrorDegrees);
+    CHECK(maxErrorDegrees < 0.01);
+
+    // 正規化されていない入力は方向のみを保ち、長さ 0 の入力は +Z となる.
+    const XMFLOAT3 special[] = { { 0, 0, 0 }, { 0, 0, -3 }, { 2, 2, 0 } };
+    uint32_t specialPacked[3];
+    util::EncodeOctahedralNormals(specialPacked, special, 3);
+    const auto zero = util::DecodeOctahedralNormal(specialPacked[0]);
+    CHECK(zero.x == 0.0f && zero.y == 0.0f && zero.z == 1.0f);
+    const auto down = util::DecodeOctahedralNormal(specialPacked[1]);
+    CHECK_NEAR(down.z, -1.0, 1.0e-6);
+    const auto diagonal = util::DecodeOctahedralNormal(specialPacked[2]);
+    CHECK_NEAR(diagonal.x, 0.7071068, 1.0e-4);
+    CHECK_NEAR(diagonal.y, 0.7071068, 1.0e-4);
+    CHECK_NEAR(diagonal.z, 0.0, 1.0e-4);
+}
+
+// 半精度で格納した UV の復元誤差. 仮数部 10bit のため、相対誤差は 2^-11 以内となる.
+TEST_CASE(MeshProcessing_HalfTexcoordRoundTrip)
+{
+    std::vector<XMFLOAT2> texcoords = {
+        { 0.0f, 1.0f }, { 0.5f, 0.25f }, { -1.0f, 2.0f }, { 1.0e-5f, -1.0e-5f }, { 16.0f, -16.0f },
+    };
+    Random random(9);
+    for (int i = 0; i < 20000; ++i) {
+        texcoords.push_back(XMFLOAT2(
+            float(random.Next() % 65536) / 65536.0f, float(int(random.Next() % 65536) - 32768) / 4096.0f));
+    }
+    std::vector<uint32_t> packed(texcoords.size());
+    util::EncodeHalfTexcoords(packed.data(), texcoords.data(), texcoords.size());
+
+    double maxRelativeError = 0.0;
+    for (size_t i = 0; i < texcoords.size(); ++i) {
+        const auto decoded = util::DecodeHalfTexcoord(packed[i]);
+        const float src[2] = { texcoords[i].x, texcoords[i].y };
+        const float dst[2] = { decoded.x, decoded.y };
+        for (int c = 0; c < 2; ++c) {
+            const double error = std::abs(double(src[c]) - dst[c]);
+            // 非正規化数の範囲(2^-14 未満)は絶対誤差で評価する.
+            CHECK(error <= std::max(std::abs(double(src[c])) * (1.0 / 2048.0), 1.0 / (1 << 25)));
+            if (std::abs(src[c]) >= 1.0f / 16384.0f) {
+                maxRelativeError = std::max(maxRelativeError, error / std::abs(src[c]));
+            }
+        }
+    }
+    test::Log("half texcoord: max relative error %.3g", maxRelativeError);
+
+    // 0, 1, 0.5 などの値は誤差なく格納される.
+    const auto exact = util::DecodeHalfTexcoord(packed[1]);
+    CHECK(exact.x == 0.5f && exact.y == 0.25f);
+    const auto ends = util::DecodeHalfTexcoord(packed[0]);
+    CHECK(ends.x == 0.0f && ends.y == 1.0f);
+}
+
+// 頂点キャッシュ・頂点フェッチ向けの並べ替えにかかる CPU 時間(100 万三角形あたり).
+BENCHMARK(MeshProcessing_OptimizeVertexCacheAndFetch)
+{
+    for (uint32_t size : { 64u, 256u, 708u }) {
+        const auto source = CreateShuffledGrid(size, size);
+        const size_t vertexCount = size_t(size + 1) * (size + 1);
+        const double megaTriangles = double(source.size() / 3) / 1.0e6;
+
+        std::vector<uint32_t> indices;
+        const int iterations = size > 256 ? 3 : 10;
+        const double cacheMs = test::MeasureMilliseconds([&]() {
+            indices = source;
+            util::OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+        }, iterations);
+        const auto optimized = indices;
+
+        std::vector<uint32_t> remap;
+        const double fetchMs = test::MeasureMilliseconds([&]() {
+            indices = optimized;
+            util::OptimizeVertexFetch(indices.data(), indices.size(), vertexCount, remap);
+        }, iterations);
+
+        const auto before = util::AnalyzeVertexCache(source.data(), source.size(), vertexCount);
+        const auto after = util::AnalyzeVertexCache(optimized.data(), optimized.size(), vertexCount);
+        test::Log("%8zu triangles: cache %8.2f ms (%7.1f ms/Mtri), fetch %7.2f ms (%6.1f ms/Mtri), ACMR %.3f -> %.3f",
+            source.size() / 3, cacheMs, cacheMs / megaTriangles, fetchMs, fetchMs / megaTriangles,
+            before.GetACMR(), after.GetACMR());
+    }
+}
+
+// クラスタ分割は同じ入力に対して常に同じ結果となり(並列に実行した場合も)、
+//  三角形の集合を保ったままクラスタごとに連続して並ぶこと.
+TEST_CASE(MeshProcessing_BuildMeshClustersIsDeterministic)
+{
+    const uint32_t Size = 48;
+    const size_t MaxTriangles = 100;
+    const auto source = CreateShuffledGrid(Size, 3, false);
+    const auto positions = CreateGridPositions(Size);
+
+    auto build = [&](std::vector<uint32_t>& indices, std::vector<util::MeshCluster>& clusters) {
+        indices = source;
+        util::BuildMeshClusters(indices.data(), indices.size(), positions.data(), MaxTriangles, clusters);
+    };
+    std::vector<uint32_t> indices;
+    std::vector<util::MeshCluster> clusters;
+    build(indices, clusters);
+
+    // 別々のスレッドで同時に実行しても同じ結果となる.
+    const int ThreadCount = 4;
+    std::vector<std::vector<uint32_t>> threadIndices(ThreadCount);
+    std::vector<std::vector<util::MeshCluster>> threadClusters(ThreadCount);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < ThreadCount; ++i) {
+        threads.emplace_back([&, i]() { build(threadIndices[i], threadClusters[i]); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (int i = 0; i < ThreadCount; ++i) {
+        CHECK(threadIndices[i] == indices);
+        CHECK(threadClusters[i].size() == clusters.size() &&
+            memcmp(threadClusters[i].data(), clusters.data(), sizeof(util::MeshCluster) * clusters.size()) == 0);
+    }
+
+    // 各三角形の元の番号を求める(格子の三角形は全て異なる).
+    std::map<std::tuple<uint32_t, uint32_t, uint32_t>, uint32_t> triangleIds;
+    for (uint32_t t = 0; t < source.size() / 3; ++t) {
+        triangleIds[std::make_tuple(source[t * 3], source[t * 3 + 1], source[t * 3 + 2])] = t;
+    }
+    std::vector<bool> isUsed(source.size() / 3, false);
+    uint32_t nextStart = 0;
+    for (const auto& cluster : clusters) {
+        CHECK(cluster.indexStart == nextStart);
+        CHECK(cluster.indexCount > 0 && cluster.indexCount <= MaxTriangles * 3);
+        nextStart = cluster.indexStart + cluster.indexCount;
+
+        int64_t previousId = -1;
+        for (uint32_t i = cluster.indexStart; i < cluster.indexStart + cluster.indexCount; i += 3) {
+            auto found = triangleIds.find(std::make_tuple(indices[i], indices[i + 1], indices[i + 2]));
+            CHECK(found != triangleIds.end());
+            if (found == triangleIds.end()) {
+                continue;
+            }
+            CHECK(!isUsed[found->second]);
+            isUsed[found->second] = true;
+            // クラスタ内では元の相対順序を保つ.
+            CHECK(int64_t(found->second) > previousId);
+            previousId = found->second;
+            for (int k = 0; k < 3; ++k) {
+                const auto& p = positions[indices[i + k]];
+                CHECK(p.x >= cluster.boundsMin.x && p.y >= cluster.boundsMin.y && p.z >= cluster.boundsMin.z);
+                CHECK(p.x <= cluster.boundsMax.x && p.y <= cluster.boundsMax.y && p.z <= cluster.boundsMax.z);
+            }
+        }
+    }
+    CHECK(nextStart == source.size());
+    CHECK(std::all_of(isUsed.begin(), isUsed.end(), [](bool used) { return used; }));
+}
+
+// クラスタ分割にかかる CPU 時間(100 万三角形あたり).
+BENCHMARK(MeshProcessing_BuildMeshClusters)
+{
+    for (uint32_t size : { 256u, 708u }) {
+        const auto source = CreateShuffledGrid(size, size, false);
+        const auto positions = CreateGridPositions(size);
+        const double megaTriangles = double(source.size() / 3) / 1.0e6;
+        for (size_t maxTriangles : { size_t(256), size_t(4096) }) {
+            std::vector<uint32_t> indices;
+            std::vector<util::MeshCluster> clusters;
+            const double ms = test::MeasureMilliseconds([&]() {
+                indices = source;
+                util::BuildMeshClusters(indices.data(), indices.size(), positions.data(), maxTriangles, clusters);
+            }, 5);
+            test::Log("%8zu triangles, max %4zu per cluster: %8.2f ms (%7.1f ms/Mtri), %zu clusters",
+                source.size() / 3, maxTriangles, ms, ms / megaTriangles, clusters.size());
+        }
+    }
+}
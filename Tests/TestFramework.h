@@ -0,0 +1,92 @@
+﻿#pragma once
+// 共通ライブラリ(common/)の単体テストとベンチマークを記述するための簡易フレームワーク.
+//  TEST_CASE は既定で実行され、BENCHMARK は --benchmark 指定時のみ実行される.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace dx12 {
+    class GraphicsDevice;
+}
+
+namespace test {
+    using TestFunc = void(*)();
+
+    struct TestEntry {
+        const char* name;
+        TestFunc func;
+        bool isBenchmark;
+    };
+    std::vector<TestEntry>& GetRegistry();
+
+    // 静的初期化でテストを登録する.
+    struct Registrar {
+        Registrar(const char* name, TestFunc func, bool isBenchmark) {
+            GetRegistry().push_back(TestEntry{ name, func, isBenchmark });
+        }
+    };
+
+    // 失敗した条件を記録する. 実行中のテストは継続する.
+    void ReportFailure(const char* file, int line, const char* message);
+
+    // ベンチマークの結果などを出力する(printf 形式).
+    void Log(const char* format, ...);
+
+    // GPU を使うベンチマーク用のデバイス. 初回呼び出し時にスワップチェインなしで初期化する.
+    //  デバイスが作成できない環境では nullptr を保持した参照を返す.
+    std::unique_ptr<dx12::GraphicsDevice>& GetDevice();
+
+    // --model で指定されたモデルファイル. 未指定の場合は defaultPath を返す.
+    std::wstring GetModelPath(const wchar_t* defaultPath);
+
+    // プロセスのメモリ使用量(バイト単位).
+    struct ProcessMemory {
+        size_t workingSet = 0;
+        size_t peakWorkingSet = 0;
+        size_t privateBytes = 0;
+    };
+    ProcessMemory GetProcessMemory();
+
+    // func を iterations 回実行し、1回あたりの時間(ミリ秒)の中央値を返す.
+    template<class Func>
+    double MeasureMilliseconds(Func func, int iterations = 10) {
+        std::vector<double> samples;
+        for (int i = 0; i < iterations; ++i) {
+            const auto timeStart = std::chrono::high_resolution_clock::now();
+            func();
+            const auto timeEnd = std::chrono::high_resolution_clock::now();
+            samples.push_back(std::chrono::duration<double, std::milli>(timeEnd - timeStart).count());
+        }
+        std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+        return samples[samples.size() / 2];
+    }
+}
+
+#define TEST_CONCAT_(a, b) a##b
+#define TEST_CONCAT(a, b) TEST_CONCAT_(a, b)
+
+#define TEST_REGISTER_(name, isBenchmark) \
+    static void name(); \
+    static test::Registrar TEST_CONCAT(name, _registrar)(#name, name, isBenchmark); \
+    static void name()
+
+#define TEST_CASE(name) TEST_REGISTER_(name, false)
+#define BENCHMARK(name) TEST_REGISTER_(name, true)
+
+#define CHECK(expr) \
+    do { if (!(expr)) { test::ReportFailure(__FILE__, __LINE__, #expr); } } while (0)
+
+#define CHECK_NEAR(a, b, epsilon) \
+    do { \
+        const double test_a_ = double(a), test_b_ = double(b); \
+        if (!(std::abs(test_a_ - test_b_) <= double(epsilon))) { \
+            char test_message_[256]; \
+            snprintf(test_message_, sizeof(test_message_), "%s (%g) != %s (%g), epsilon %g", \
+                #a, test_a_, #b, test_b_, double(epsilon)); \
+            test::ReportFailure(__FILE__, __LINE__, test_message_); \
+        } \
+    } while (0)
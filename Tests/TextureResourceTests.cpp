@@ -0,0 +1,294 @@
+﻿#include "TestFramework.h"
+#include "util/TextureResource.h"
+#include "tiny_gltf.h"
+
+#include <cmath>
+#include <filesystem>
+
+namespace {
+    // glTF に埋め込まれた画像のエンコード済みデータ.
+    struct EmbeddedImage {
+        std::string name;
+        std::vector<uint8_t> data;
+        util::TextureUsage usage = util::TextureUsage::Color;
+    };
+
+    // GLB ファイル内のテクスチャ画像を取り出す(GPU は使用しない).
+    std::vector<EmbeddedImage> LoadEmbeddedImages(const std::wstring& fileName) {
+        std::vector<EmbeddedImage> images;
+        tinygltf::TinyGLTF loader;
+        tinygltf::Model model;
+        std::string err, warn;
+        const auto path = std::filesystem::path(fileName).string();
+        if (!loader.LoadBinaryFromFile(&model, &err, &warn, path)) {
+            return images;
+        }
+        std::vector<int> imageOfTexture(model.textures.size(), -1);
+        for (size_t i = 0; i < model.textures.size(); ++i) {
+            const auto& image = model.images[model.textures[i].source];
+            if (image.bufferView < 0) {
+                continue;
+            }
+            imageOfTexture[i] = int(images.size());
+            const auto& view = model.bufferViews[image.bufferView];
+            const auto begin = model.buffers[view.buffer].data.begin() + view.byteOffset;
+            EmbeddedImage embedded;
+            embedded.name = image.name;
+            embedded.data.assign(begin, begin + view.byteLength);
+            images.push_back(std::move(embedded));
+        }
+        for (const auto& material : model.materials) {
+            const auto index = material.normalTexture.index;
+            if (index >= 0 && imageOfTexture[index] >= 0) {
+                images[imageOfTexture[index]].usage = util::TextureUsage::Normal;
+            }
+        }
+        return images;
+    }
+
+    // --model 指定時はそのモデル、未指定時は同梱のモデルを対象とする.
+    std::vector<std::wstring> GetBenchmarkModels() {
+        const auto modelPath = test::GetModelPath(L"");
+        if (!modelPath.empty()) {
+            return { modelPath };
+        }
+        return { L"table.glb", L"teapot.glb", L"alicia.glb" };
+    }
+
+    std::vector<util::ImageMemory> GetImageMemories(const std::vector<EmbeddedImage>& images) {
+        std::vector<util::ImageMemory> sources;
+        for (const auto& image : images) {
+            util::ImageMemory source;
+            source.data = image.data.data();
+            source.size = image.data.size();
+            source.usage = image.usage;
+            sources.push_back(source);
+        }
+        return sources;
+    }
+
+    // アルファテスト用の模様を持つ RGBA8 画像を作る. アルファは周期の異なる正弦波の積で、一部が 1 に張り付く.
+    util::DecodedImage CreateAlphaTestImage(size_t size) {
+        util::DecodedImage decoded;
+        decoded.image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, size, size, 1, 1);
+        decoded.metadata = decoded.image.GetMetadata();
+        const auto image = decoded.image.GetImage(0, 0, 0);
+        for (size_t y = 0; y < size; ++y) {
+            auto row = image->pixels + y * image->rowPitch;
+            for (size_t x = 0; x < size; ++x) {
+                const float alpha = 2.0f * std::sin(float(x) * 0.37f) * std::sin(float(y) * 0.23f);
+                row[x * 4 + 0] = 255;
+                row[x * 4 + 1] = 255;
+                row[x * 4 + 2] = 255;
+                row[x * 4 + 3] = uint8_t(std::lround(std::min(std::max(alpha, 0.0f), 1.0f) * 255.0f));
+            }
+        }
+        return decoded;
+    }
+
+    // アルファテストを通過する面積の割合(RGBA8 のみ).
+    //  DirectXTex の ScaleMipMapsAlphaForCoverage と同じく、隣接 2x2 テクセル間を 8x8 点で双線形補間して数える.
+    float ComputeAlphaCoverage(const DirectX::Image& image, float alphaReference) {
+        auto alphaAt = [&](size_t x, size_t y) {
+            return float(image.pixels[y * image.rowPitch + x * 4 + 3]) / 255.0f;
+        };
+        if (image.width < 2 || image.height < 2) {
+            return alphaAt(0, 0) > alphaReference ? 1.0f : 0.0f;
+        }
+        const int SampleCount = 8;
+        size_t passed = 0;
+        for (size_t y = 0; y + 1 < image.height; ++y) {
+            for (size_t x = 0; x + 1 < image.width; ++x) {
+                const float a00 = alphaAt(x, y), a10 = alphaAt(x + 1, y);
+                const float a01 = alphaAt(x, y + 1), a11 = alphaAt(x + 1, y + 1);
+                for (int sy = 0; sy < SampleCount; ++sy) {
+                    const float fy = (float(sy) + 0.5f) / SampleCount;
+                    const float left = a00 * (1.0f - fy) + a01 * fy;
+                    const float right = a10 * (1.0f - fy) + a11 * fy;
+                    for (int sx = 0; sx < SampleCount; ++sx) {
+                        const float fx = (float(sx) + 0.5f) / SampleCount;
+                        passed += (left * (1.0f - fx) + right * fx) > alphaReference;
+                    }
+                }
+            }
+        }
+        return float(double(passed) / (double(image.width - 1) * double(image.height - 1) * SampleCount * SampleCount));
+    }
+}
+
+// アルファの補正を有効にしたミップマップは、各レベルでアルファテストを通過する面積が元画像とほぼ同じになること.
+//  補正しない場合は縮小でアルファが平均化され、面積が減ることも確認する.
+TEST_CASE(TextureResource_MipAlphaCoverageIsPreserved)
+{
+    const float AlphaReference = 0.5f;
+    util::MipmapSettings mipmaps;
+    mipmaps.generateMips = true;
+    mipmaps.gammaCorrect = false;
+    mipmaps.alphaReference = AlphaReference;
+    auto scaled = CreateAlphaTestImage(256);
+    CHECK(util::GenerateMipChain(scaled, mipmaps));
+
+    mipmaps.alphaReference = 0.0f;
+    auto unscaled = CreateAlphaTestImage(256);
+    CHECK(util::GenerateMipChain(unscaled, mipmaps));
+
+    CHECK(scaled.metadata.mipLevels == 9);
+    CHECK(unscaled.metadata.mipLevels == 9);
+    if (scaled.metadata.mipLevels != 9 || unscaled.metadata.mipLevels != 9) {
+        return;
+    }
+    const float target = ComputeAlphaCoverage(*scaled.image.GetImage(0, 0, 0), AlphaReference);
+    for (size_t level = 1; level < scaled.metadata.mipLevels; ++level) {
+        const auto& image = *scaled.image.GetImage(level, 0, 0);
+        const float coverage = ComputeAlphaCoverage(image, AlphaReference);
+        const float unscaledCoverage = ComputeAlphaCoverage(*unscaled.image.GetImage(level, 0, 0), AlphaReference);
+        test::Log("level %zu (%3zux%3zu): coverage %.3f (target %.3f), without scaling %.3f",
+            level, image.width, image.height, coverage, target, unscaledCoverage);
+        // 2x2 以下のレベルは補間できる範囲が狭すぎるため対象外とする.
+        if (image.width >= 8) {
+            CHECK_NEAR(coverage, target, 0.03);
+        }
+    }
+    // 補正しない場合は 32x32 のレベルで面積の大半が失われる.
+    CHECK(ComputeAlphaCoverage(*unscaled.image.GetImage(3, 0, 0), AlphaReference) < target - 0.1f);
+}
+
+// ミップマップ生成(アルファ補正の有無)にかかる時間. 元画像 1M ピクセルあたりで比較する.
+BENCHMARK(TextureResource_GenerateMipChain)
+{
+    for (size_t size : { size_t(1024), size_t(2048) }) {
+        const double megaPixels = double(size * size) / 1.0e6;
+        const auto source = CreateAlphaTestImage(size);
+        for (float alphaReference : { 0.0f, 0.5f }) {
+            util::MipmapSettings mipmaps;
+            mipmaps.generateMips = true;
+            mipmaps.alphaReference = alphaReference;
+            bool isGenerated = true;
+            const double ms = test::MeasureMilliseconds([&]() {
+                util::DecodedImage decoded;
+                decoded.metadata = source.metadata;
+                decoded.image.InitializeFromImage(*source.image.GetImage(0, 0, 0));
+                isGenerated &= util::GenerateMipChain(decoded, mipmaps);
+            }, 5);
+            CHECK(isGenerated);
+            test::Log("%4zux%-4zu %-14s %8.2f ms (%7.2f ms/Mpixel)",
+                size, size, alphaReference > 0.0f ? "alpha coverage" : "box", ms, ms / megaPixels);
+        }
+    }
+}
+
+// モデル読み込み時の画像のデコード(CPU のみ)にかかる時間.
+//  1枚ずつ順に処理した場合と並列に処理した場合、ミップマップ生成を含めた場合を比較する.
+BENCHMARK(TextureResource_DecodeImages)
+{
+    for (const auto& file : GetBenchmarkModels()) {
+        const auto images = LoadEmbeddedImages(file);
+        const auto sources = GetImageMemories(images);
+        if (sources.empty()) {
+            test::Log("%ls: no embedded images.", file.c_str());
+            continue;
+        }
+
+        size_t pixelCount = 0;
+        bool isDecoded = true;
+        const double serialMs = test::MeasureMilliseconds([&]() {
+            pixelCount = 0;
+            for (const auto& source : sources) {
+                util::DecodedImage decoded;
+                isDecoded &= util::DecodeImage(source, decoded);
+                pixelCount += decoded.metadata.width * decoded.metadata.height;
+            }
+        }, 5);
+        const double parallelMs = test::MeasureMilliseconds([&]() {
+            auto decoded = util::DecodeImages(sources);
+            for (const auto& image : decoded) {
+                isDecoded &= image.image.GetImageCount() > 0;
+            }
+        }, 5);
+
+        util::MipmapSettings boxMips;
+        boxMips.generateMips = true;
+        const double boxMs = test::MeasureMilliseconds([&]() {
+            util::DecodeImages(sources, boxMips);
+        }, 5);
+        auto triangleMips = boxMips;
+        triangleMips.filter = util::MipmapSettings::Filter::Triangle;
+        const double triangleMs = test::MeasureMilliseconds([&]() {
+            util::DecodeImages(sources, triangleMips);
+        }, 5);
+        CHECK(isDecoded);
+
+        const double megaPixels = double(pixelCount) / 1.0e6;
+        test::Log("%ls: %zu images, %.2f Mpixels", std::filesystem::path(file).filename().c_str(), sources.size(), megaPixels);
+        test::Log("  decode serial   %8.2f ms (%6.1f Mpixels/s)", serialMs, megaPixels / (serialMs / 1000.0));
+        test::Log("  decode parallel %8.2f ms (%6.1f Mpixels/s)", parallelMs, megaPixels / (parallelMs / 1000.0));
+        test::Log("  + box mips      %8.2f ms", boxMs);
+        test::Log("  + triangle mips %8.2f ms", triangleMs);
+    }
+}
+
+// ブロック圧縮の品質(PSNR)と速度. 各モデルの画像を BC1/BC3/BC5/BC7 で圧縮・展開して比較する.
+//  BC5 は RG の2成分のみを格納するため、B とアルファを除いて PSNR を求める.
+BENCHMARK(TextureResource_BlockCompression)
+{
+    struct FormatInfo {
+        DXGI_FORMAT format;
+        const char* name;
+        DirectX::CMSE_FLAGS mseFlags;
+    };
+    const FormatInfo formats[] = {
+        { DXGI_FORMAT_BC1_UNORM, "BC1", DirectX::CMSE_DEFAULT },
+        { DXGI_FORMAT_BC3_UNORM, "BC3", DirectX::CMSE_DEFAULT },
+        { DXGI_FORMAT_BC5_UNORM, "BC5", DirectX::CMSE_IGNORE_BLUE | DirectX::CMSE_IGNORE_ALPHA },
+        { DXGI_FORMAT_BC7_UNORM, "BC7", DirectX::CMSE_DEFAULT },
+    };
+    for (const auto& file : GetBenchmarkModels()) {
+        const auto images = LoadEmbeddedImages(file);
+        test::Log("%ls: %zu images", std::filesystem::path(file).filename().c_str(), images.size());
+        for (const auto& embedded : images) {
+            util::ImageMemory source;
+            source.data = embedded.data.data();
+            source.size = embedded.data.size();
+            util::DecodedImage decoded;
+            if (!util::DecodeImage(source, decoded)) {
+                test::Log("  %s: failed to decode.", embedded.name.c_str());
+                continue;
+            }
+            const auto& original = *decoded.image.GetImage(0, 0, 0);
+            if ((original.width % 4) != 0 || (original.height % 4) != 0) {
+                test::Log("  %s: %zux%zu is not a multiple of 4.", embedded.name.c_str(), original.width, original.height);
+                continue;
+            }
+            const double blockCount = double(original.width / 4) * double(original.height / 4);
+            for (const auto& info : formats) {
+                // 最上位レベルのみを圧縮する. 圧縮前の画像の複製は計測に含めない.
+                util::DecodedImage work;
+                work.image.InitializeFromImage(original);
+                work.metadata = work.image.GetMetadata();
+                bool isCompressed = false;
+                const double compressMs = test::MeasureMilliseconds([&]() {
+                    isCompressed = util::CompressImage(work, info.format);
+                }, 1);
+                CHECK(isCompressed);
+                if (!isCompressed) {
+                    continue;
+                }
+
+                DirectX::ScratchImage restored;
+                HRESULT hr = S_OK;
+                const double decompressMs = test::MeasureMilliseconds([&]() {
+                    hr = DirectX::Decompress(*work.image.GetImage(0, 0, 0), original.format, restored);
+                }, 3);
+                CHECK(SUCCEEDED(hr));
+                float mse = 0.0f;
+                float psnr = 0.0f;
+                if (SUCCEEDED(hr) && SUCCEEDED(DirectX::ComputeMSE(original, *restored.GetImage(0, 0, 0), mse, nullptr, info.mseFlags))) {
+                    psnr = mse > 0.0f ? 10.0f * std::log10(1.0f / mse) : 99.0f;
+                }
+                test::Log("  %-24s %4zux%-4zu %s: PSNR %6.2f dB, compress %9.2f ms (%7.3f Mblocks/s), decompress %7.2f ms (%7.2f Mblocks/s)",
+                    embedded.name.c_str(), original.width, original.height, info.name, psnr,
+                    compressMs, blockCount / (compressMs * 1000.0), decompressMs, blockCount / (decompressMs * 1000.0));
+            }
+        }
+    }
+}
@@ -0,0 +1,249 @@
+﻿#include "TestFramework.h"
+#include "util/TransformHierarchy.h"
+
+#include <memory>
+
+using namespace DirectX;
+using util::TransformHierarchy;
+
+namespace {
+    // 決まった系列を返す簡易な乱数.
+    class Random {
+    public:
+        explicit Random(uint32_t seed) : m_state(seed) { }
+        uint32_t Next() {
+            m_state = m_state * 1664525u + 1013904223u;
+            return m_state >> 8;
+        }
+        float NextFloat() { return float(Next() & 0xFFFF) / 65535.0f; }
+        float NextSigned() { return NextFloat() * 2.0f - 1.0f; }
+    private:
+        uint32_t m_state;
+    };
+
+    // TransformHierarchy 導入前の DxrModelActor::Node と同じ、子を shared_ptr で持つノードの再帰的な更新.
+    struct RecursiveNode {
+        XMVECTOR translation;
+        XMVECTOR rotation;
+        XMVECTOR scale;
+        XMMATRIX mtxLocal;
+        XMMATRIX mtxWorld;
+        std::vector<std::shared_ptr<RecursiveNode>> children;
+        std::weak_ptr<RecursiveNode> parent;
+
+        void UpdateLocalMatrix() {
+            auto mtxT = XMMatrixTranslationFromVector(translation);
+            auto mtxR = XMMatrixRotationQuaternion(rotation);
+            auto mtxS = XMMatrixScalingFromVector(scale);
+            mtxLocal = mtxS * mtxR * mtxT;
+        }
+        void UpdateWorldMatrix(XMMATRIX mtxParent) {
+            mtxWorld = mtxLocal * mtxParent;
+        }
+        void UpdateMatrixHierarchy(XMMATRIX mtxParent) {
+            UpdateLocalMatrix();
+            UpdateWorldMatrix(mtxParent);
+            for (auto& child : children) {
+                child->UpdateMatrixHierarchy(this->mtxWorld);
+            }
+        }
+    };
+
+    // 同じ階層と TRS を両方の形式で作る.
+    //  nodesPerActor 個ずつのノードを1体分の階層とし、各ノードの親は同じ階層内の先に追加したノードから選ぶ.
+    struct TestHierarchy {
+        TransformHierarchy hierarchy;
+        std::vector<std::shared_ptr<RecursiveNode>> nodes;
+        std::vector<std::shared_ptr<RecursiveNode>> roots;
+    };
+
+    void SetRandomTransform(Random& random, XMVECTOR& t, XMVECTOR& r, XMVECTOR& s) {
+        t = XMVectorSet(random.NextSigned(), random.NextSigned(), random.NextSigned(), 0.0f);
+        r = XMQuaternionRotationRollPitchYaw(random.NextSigned(), random.NextSigned(), random.NextSigned());
+        const float scale = 0.9f + 0.2f * random.NextFloat();
+        s = XMVectorSet(scale, scale, scale, 0.0f);
+    }
+
+    std::unique_ptr<TestHierarchy> CreateTestHierarchy(uint32_t nodeCount, uint32_t nodesPerActor, uint32_t seed) {
+        auto result = std::make_unique<TestHierarchy>();
+        Random random(seed);
+        result->hierarchy.Reserve(nodeCount);
+        result->nodes.reserve(nodeCount);
+        for (uint32_t i = 0; i < nodeCount; ++i) {
+            int parent = TransformHierarchy::InvalidParent;
+            const uint32_t actorStart = i - i % nodesPerActor;
+            if (i > actorStart) {
+                parent = int(actorStart + random.Next() % (i - actorStart));
+            }
+            XMVECTOR t, r, s;
+            SetRandomTransform(random, t, r, s);
+            result->hierarchy.AddNode(parent, t, r, s);
+
+            auto node = std::make_shared<RecursiveNode>();
+            node->translation = t;
+            node->rotation = r;
+            node->scale = s;
+            if (parent == TransformHierarchy::InvalidParent) {
+                result->roots.push_back(node);
+            } else {
+                result->nodes[parent]->children.push_back(node);
+                node->parent = result->nodes[parent];
+            }
+            result->nodes.push_back(node);
+        }
+        return result;
+    }
+
+    void UpdateRecursive(TestHierarchy& test, FXMMATRIX mtxRoot) {
+        for (auto& root : test.roots) {
+            root->UpdateMatrixHierarchy(mtxRoot);
+        }
+    }
+
+    float GetMaxDifference(const TestHierarchy& test) {
+        float maxDifference = 0.0f;
+        for (uint32_t i = 0; i < uint32_t(test.nodes.size()); ++i) {
+            const auto expected = test.nodes[i]->mtxWorld;
+            const auto actual = test.hierarchy.GetWorldMatrix(i);
+            for (int r = 0; r < 4; ++r) {
+                const auto d = XMVectorAbs(XMVectorSubtract(expected.r[r], actual.r[r]));
+                maxDifference = std::max(maxDifference, std::max(
+                    std::max(XMVectorGetX(d), XMVectorGetY(d)), std::max(XMVectorGetZ(d), XMVectorGetW(d))));
+            }
+        }
+        return maxDifference;
+    }
+}
+
+// SoA の一括更新が、再帰的な更新と同じワールド行列になること.
+//  一部のノードを変更した後は、そのノードと子孫のみが計算し直されること.
+TEST_CASE(TransformHierarchy_MatchesRecursiveUpdate)
+{
+    const uint32_t NodeCount = 10000;
+    auto test = CreateTestHierarchy(NodeCount, 100, 21);
+    const auto mtxRoot = XMMatrixRotationY(0.3f) * XMMatrixTranslation(1.0f, 2.0f, 3.0f);
+    UpdateRecursive(*test, mtxRoot);
+    auto result = test->hierarchy.UpdateMatrices(mtxRoot);
+    CHECK(result.localChanged == NodeCount);
+    CHECK(result.worldChanged == NodeCount);
+    test::Log("initial: max difference %g", GetMaxDifference(*test));
+    CHECK(GetMaxDifference(*test) < 1.0e-3f);
+
+    // 変更が無ければ何も計算しない.
+    result = test->hierarchy.UpdateMatrices(mtxRoot);
+    CHECK(result.localChanged == 0);
+    CHECK(result.worldChanged == 0);
+
+    Random random(5);
+    std::vector<bool> isAffected(NodeCount, false);
+    size_t changedCount = 0;
+    for (int i = 0; i < 100; ++i) {
+        const uint32_t index = random.Next() % NodeCount;
+        XMVECTOR t, r, s;
+        SetRandomTransform(random, t, r, s);
+        test->hierarchy.SetTranslation(index, t);
+        test->hierarchy.SetRotation(index, r);
+        test->hierarchy.SetScale(index, s);
+        auto& node = *test->nodes[index];
+        node.translation = t;
+        node.rotation = r;
+        node.scale = s;
+        changedCount += isAffected[index] ? 0 : 1;
+        isAffected[index] = true;
+    }
+    size_t expectedChanged = 0;
+    for (uint32_t i = 0; i < NodeCount; ++i) {
+        const int parent = test->hierarchy.GetParent(i);
+        if (parent != TransformHierarchy::InvalidParent && isAffected[parent]) {
+            isAffected[i] = true;
+        }
+        expectedChanged += isAffected[i] ? 1 : 0;
+    }
+    UpdateRecursive(*test, mtxRoot);
+    result = test->hierarchy.UpdateMatrices(mtxRoot);
+    test::Log("partial: %zu local, %zu world changed, max difference %g",
+        result.localChanged, result.worldChanged, GetMaxDifference(*test));
+    CHECK(result.localChanged == changedCount);
+    CHECK(result.worldChanged == expectedChanged);
+    CHECK(GetMaxDifference(*test) < 1.0e-3f);
+    for (uint32_t i = 0; i < NodeCount; ++i) {
+        CHECK(test->hierarchy.IsWorldChanged(i) == isAffected[i]);
+    }
+}
+
+// 前回と同じ値を設定したノードは、行列を計算し直さないこと.
+TEST_CASE(TransformHierarchy_SettingSameValueKeepsClean)
+{
+    auto test = CreateTestHierarchy(1000, 100, 4);
+    const auto mtxRoot = XMMatrixIdentity();
+    test->hierarchy.UpdateMatrices(mtxRoot);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        test->hierarchy.SetTranslation(i, test->hierarchy.GetTranslation(i));
+        test->hierarchy.SetRotation(i, test->hierarchy.GetRotation(i));
+        test->hierarchy.SetScale(i, test->hierarchy.GetScale(i));
+    }
+    auto result = test->hierarchy.UpdateMatrices(mtxRoot);
+    CHECK(result.localChanged == 0);
+    CHECK(result.worldChanged == 0);
+
+    // 1成分でも異なれば変更として扱う.
+    test->hierarchy.SetTranslation(10, XMVectorAdd(test->hierarchy.GetTranslation(10), XMVectorSet(0.0f, 0.0f, 1.0e-6f, 0.0f)));
+    result = test->hierarchy.UpdateMatrices(mtxRoot);
+    CHECK(result.localChanged == 1);
+    CHECK(test->hierarchy.IsWorldChanged(10));
+}
+
+// 100k ノード(100 ノードの階層 1000 体)のワールド行列の更新時間.
+//  再帰的な更新と、SoA の全更新・一部更新・変更なしを比べる.
+BENCHMARK(TransformHierarchy_UpdateVsRecursive)
+{
+    const uint32_t NodeCount = 100000;
+    auto test = CreateTestHierarchy(NodeCount, 100, 33);
+    Random random(8);
+    float angle = 0.0f;
+    auto nextRoot = [&]() {
+        angle += 0.01f;
+        return XMMatrixRotationY(angle);
+    };
+    auto log = [&](const char* name, double ms) {
+        test::Log("%-24s %8.3f ms (%6.2f ns/node)", name, ms, ms * 1.0e6 / NodeCount);
+    };
+
+    log("recursive (shared_ptr)", test::MeasureMilliseconds([&]() {
+        UpdateRecursive(*test, nextRoot());
+    }));
+
+    // ルート行列が毎回変わるため、全ノードのワールド行列を計算し直す(ローカル行列は初回のみ).
+    test->hierarchy.UpdateMatrices(nextRoot());
+    log("SoA, root moved", test::MeasureMilliseconds([&]() {
+        test->hierarchy.UpdateMatrices(nextRoot());
+    }));
+
+    // アニメーションのように全ノードの TRS を変更する.
+    std::vector<XMVECTOR> rotations(NodeCount);
+    for (auto& rotation : rotations) {
+        rotation = XMQuaternionRotationRollPitchYaw(random.NextSigned(), random.NextSigned(), random.NextSigned());
+    }
+    log("SoA, all TRS changed", test::MeasureMilliseconds([&]() {
+        for (uint32_t i = 0; i < NodeCount; ++i) {
+            test->hierarchy.SetRotation(i, rotations[(i + uint32_t(angle * 100.0f)) % NodeCount]);
+        }
+        test->hierarchy.UpdateMatrices(nextRoot());
+    }));
+
+    const auto mtxRoot = nextRoot();
+    test->hierarchy.UpdateMatrices(mtxRoot);
+    size_t worldChanged = 0;
+    log("SoA, 1% TRS changed", test::MeasureMilliseconds([&]() {
+        for (uint32_t i = 0; i < NodeCount / 100; ++i) {
+            const uint32_t index = random.Next() % NodeCount;
+            test->hierarchy.SetRotation(index, rotations[(index + i) % NodeCount]);
+        }
+        worldChanged = test->hierarchy.UpdateMatrices(mtxRoot).worldChanged;
+    }));
+    test::Log("  (%zu world matrices recomputed per update)", worldChanged);
+
+    log("SoA, unchanged", test::MeasureMilliseconds([&]() {
+        test->hierarchy.UpdateMatrices(mtxRoot);
+    }));
+}
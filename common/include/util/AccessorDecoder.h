@@ -0,0 +1,42 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+
+namespace util {
+
+    // glTF アクセサの成分の型(値は glTF の componentType と同じ).
+    enum class ComponentType : int {
+        Byte = 5120,
+        UnsignedByte = 5121,
+        Short = 5122,
+        UnsignedShort = 5123,
+        UnsignedInt = 5125,
+        Float = 5126,
+    };
+
+    // アクセサが参照するデータの配置.
+    struct AccessorLayout {
+        const uint8_t* data = nullptr;  // nullptr の場合は全て 0 として扱う.
+        size_t count = 0;               // 要素数.
+        size_t stride = 0;              // 要素間のバイト数(0 の場合は密に詰まっている).
+        ComponentType componentType = ComponentType::Float;
+        uint32_t componentCount = 1;    // 1要素あたりの成分数(SCALAR=1, VEC2=2, ...).
+        bool normalized = false;
+    };
+
+    // 成分1つあたりのバイト数を求める.
+    size_t GetComponentSize(ComponentType type);
+
+    // 成分1つを読み取る. 要素が密に詰まっていないデータの処理に使用する.
+    //  DecodeAccessor の一括変換と同じ結果になる.
+    float ReadComponentAsFloat(const uint8_t* p, ComponentType type, bool normalized);
+    uint32_t ReadComponentAsUint(const uint8_t* p, ComponentType type);
+
+    // アクセサの内容を float 配列へ展開する.
+    //  normalized 指定の整数は glTF の規則に従い [0,1] または [-1,1] へ変換する.
+    //  出力の成分数の方が少ない場合は切り捨て、多い場合は 0 で埋める.
+    void DecodeAccessor(float* dst, uint32_t dstComponents, const AccessorLayout& src);
+
+    // アクセサの内容を符号なし整数配列へ展開する(インデックスやジョイント番号用).
+    void DecodeAccessor(uint32_t* dst, uint32_t dstComponents, const AccessorLayout& src);
+}
@@ -0,0 +1,65 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <DirectXMath.h>
+
+namespace util {
+
+    // 4列目が (0,0,0,1) であるアフィン変換行列向けの演算.
+    //  汎用の 4x4 演算に比べて、不要な列の計算を省いている.
+
+    // a * b. a はアフィン変換であること(b は任意).
+    inline DirectX::XMMATRIX XM_CALLCONV MultiplyAffine(DirectX::FXMMATRIX a, DirectX::CXMMATRIX b)
+    {
+        using namespace DirectX;
+        XMMATRIX result;
+        for (int i = 0; i < 3; ++i) {
+            XMVECTOR row = XMVectorMultiply(XMVectorSplatX(a.r[i]), b.r[0]);
+            row = XMVectorMultiplyAdd(XMVectorSplatY(a.r[i]), b.r[1], row);
+            result.r[i] = XMVectorMultiplyAdd(XMVectorSplatZ(a.r[i]), b.r[2], row);
+        }
+        XMVECTOR row = XMVectorMultiplyAdd(XMVectorSplatX(a.r[3]), b.r[0], b.r[3]);
+        row = XMVectorMultiplyAdd(XMVectorSplatY(a.r[3]), b.r[1], row);
+        result.r[3] = XMVectorMultiplyAdd(XMVectorSplatZ(a.r[3]), b.r[2], row);
+        return result;
+    }
+
+    // アフィン変換の逆行列. 3x3 部分は余因子(行ベクトルの外積)から求める.
+    inline DirectX::XMMATRIX XM_CALLCONV InverseAffine(DirectX::FXMMATRIX m)
+    {
+        using namespace DirectX;
+        const XMVECTOR c0 = XMVector3Cross(m.r[1], m.r[2]);
+        const XMVECTOR c1 = XMVector3Cross(m.r[2], m.r[0]);
+        const XMVECTOR c2 = XMVector3Cross(m.r[0], m.r[1]);
+        const XMVECTOR invDet = XMVectorReciprocal(XMVector3Dot(m.r[0], c0));
+
+        // 余因子を行に並べたものの転置が逆行列の 3x3 部分.
+        XMMATRIX adjugate;
+        adjugate.r[0] = XMVectorMultiply(c0, invDet);
+        adjugate.r[1] = XMVectorMultiply(c1, invDet);
+        adjugate.r[2] = XMVectorMultiply(c2, invDet);
+        adjugate.r[3] = g_XMZero;
+        XMMATRIX result = XMMatrixTranspose(adjugate);
+
+        // 平行移動は -t * (3x3 部分の逆行列).
+        XMVECTOR t = XMVectorMultiply(XMVectorSplatX(m.r[3]), result.r[0]);
+        t = XMVectorMultiplyAdd(XMVectorSplatY(m.r[3]), result.r[1], t);
+        t = XMVectorMultiplyAdd(XMVectorSplatZ(m.r[3]), result.r[2], t);
+        result.r[3] = XMVectorSelect(g_XMIdentityR3, XMVectorNegate(t), g_XMSelect1110);
+        return result;
+    }
+
+    // スキニング用の関節行列を求め、シェーダーで参照する形式(転置した 4x4)で書き出す.
+    //  output[i] = transpose(invBindMatrices[i] * worldMatrices[jointIndices[i]] * mtxMeshInv)
+    //  output には書き込みのみを行うため、マップしたアップロードバッファを直接渡せる.
+    void ComputeJointPalette(
+        const DirectX::XMMATRIX* invBindMatrices, const DirectX::XMFLOAT3X4A* worldMatrices,
+        const uint32_t* jointIndices, size_t jointCount, DirectX::FXMMATRIX mtxMeshInv,
+        DirectX::XMFLOAT4X4* output);
+
+    // ComputeJointPalette で求めた関節行列をデュアルクォータニオンへ変換する.
+    //  output[i * 2] に回転を表す実部、output[i * 2 + 1] に平行移動を表す双対部を格納する.
+    //  回転と平行移動のみを扱うため、関節行列のスケールは無視される.
+    void ComputeJointDualQuaternions(
+        const DirectX::XMFLOAT4X4* palette, size_t jointCount, DirectX::XMFLOAT4* output);
+}
@@ -0,0 +1,144 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <DirectXMath.h>
+
+namespace util {
+
+    // アニメーションで変化させるノードの要素.
+    enum class AnimationPath : uint32_t {
+        Translation,
+        Rotation,
+        Scale,
+    };
+
+    // キー間の補間方法(glTF の interpolation に対応).
+    enum class AnimationInterpolation : uint32_t {
+        Linear,
+        Step,
+        CubicSpline,
+    };
+
+    // 回転の補間方法.
+    enum class QuaternionBlend {
+        Nlerp,  // 線形補間後に正規化する. 高速だが角速度が一定にならない.
+        Slerp,
+    };
+
+    // アニメーション圧縮の設定.
+    struct AnimationCompressSettings {
+        // 許容誤差. 各ノード単独の値の差を、そのノードの影響範囲の端での変位に換算して評価する.
+        //  親ノードの誤差は子へ累積するため、モデル空間での誤差は階層の深さに応じてこれより大きくなりうる.
+        float maxError = 1.0e-4f;
+        // 子を持たないノードの影響範囲とみなす長さ.
+        float minimumJointLength = 0.1f;
+        // CubicSpline のトラックを線形補間のキーへ変換する際の1区間あたりの分割数.
+        uint32_t cubicSubdivision = 4;
+    };
+
+    // アニメーション圧縮の結果.
+    struct AnimationCompressReport {
+        size_t sourceBytes = 0;
+        size_t compressedBytes = 0;
+        size_t sourceKeys = 0;
+        size_t compressedKeys = 0;
+        float maxError = 0.0f;          // 元のキー時刻とその中間で評価した、ノード単独の最大誤差.
+        float maxObjectError = 0.0f;    // 同じ時刻でのノードの原点のモデル空間での最大誤差. skeleton 指定時のみ.
+        double sourceSampleUs = 0.0;    // Sample 1回あたりの時間.
+        double compressedSampleUs = 0.0;
+    };
+
+    // 誤差の評価に使うノード階層と基本姿勢. 配列の添え字はチャンネルの targetNode と同じノード番号.
+    struct AnimationSkeleton {
+        std::vector<int> parents;       // 親のノード番号. ルートは -1.
+        std::vector<DirectX::XMFLOAT3> translations;
+        std::vector<DirectX::XMFLOAT4> rotations;
+        std::vector<DirectX::XMFLOAT3> scales;
+    };
+
+    // アニメーションクリップ.
+    //  全チャンネルのキー時刻と値はそれぞれ1つの配列に詰めて保持し、
+    //  チャンネルはその範囲を指す.
+    //  圧縮後は時刻と値を 16bit に量子化した配列のみを保持する.
+    class AnimationClip {
+    public:
+        // ノード1つの TRS 要素1つ分のトラック.
+        struct Channel {
+            int targetNode;         // モデルのノード番号.
+            AnimationPath path;
+            AnimationInterpolation interpolation;
+            uint32_t keyStart;      // キー時刻配列での開始位置.
+            uint32_t keyCount;
+            uint32_t valueStart;    // 値配列での開始位置. CubicSpline は1キーあたり(入力接線, 値, 出力接線)の3要素.
+            // 圧縮後の平行移動・スケールの量子化範囲.
+            DirectX::XMFLOAT3 rangeMin;
+            DirectX::XMFLOAT3 rangeExtent;
+        };
+
+        const std::wstring& GetName() const { return m_name; }
+        float GetDuration() const { return m_duration; }
+        size_t GetChannelCount() const { return m_channels.size(); }
+        const Channel& GetChannel(size_t index) const { return m_channels[index]; }
+        size_t GetKeyCount() const;
+        bool IsCompressed() const { return m_isCompressed; }
+        // キーデータが占めるバイト数.
+        size_t GetDataSize() const;
+
+        // 時刻をクリップの範囲内に巡回させる.
+        float WrapTime(float time) const;
+
+        // 全チャンネルを時刻 time で評価する. output[i] は i 番目のチャンネルの値.
+        //  平行移動・スケールは xyz、回転はクォータニオンとして格納される.
+        void Sample(float time, DirectX::XMVECTOR* output, QuaternionBlend blend = QuaternionBlend::Nlerp) const;
+
+        // トラックを追加する. values には keyCount 個(CubicSpline は 3 倍)の値を渡す.
+        void AddChannel(
+            int targetNode, AnimationPath path, AnimationInterpolation interpolation,
+            const float* times, size_t keyCount, const DirectX::XMFLOAT4* values);
+
+        // 許容誤差内で冗長なキーを取り除き、値を量子化する.
+        //  回転は最大成分を除く3成分(smallest-three)、平行移動・スケールはトラックごとの範囲で 16bit に量子化する.
+        //  jointLengths はノード番号ごとの影響範囲(子孫までの距離).
+        //  skeleton を指定した場合は、report にモデル空間での誤差も求める.
+        void Compress(
+            const AnimationCompressSettings& settings, const std::vector<float>& jointLengths,
+            AnimationCompressReport* report = nullptr, const AnimationSkeleton* skeleton = nullptr);
+
+        void SetName(const std::wstring& name) { m_name = name; }
+
+        // キャッシュファイルとの間でのデータの受け渡し用.
+        const std::vector<Channel>& GetChannels() const { return m_channels; }
+        const std::vector<float>& GetTimes() const { return m_times; }
+        const std::vector<DirectX::XMFLOAT4>& GetValues() const { return m_values; }
+        const std::vector<uint16_t>& GetPackedTimes() const { return m_packedTimes; }
+        const std::vector<uint16_t>& GetPackedValues() const { return m_packedValues; }
+        //  範囲外を指すチャンネルがある場合は false を返す.
+        bool Assign(
+            std::vector<Channel> channels, std::vector<float> times,
+            std::vector<DirectX::XMFLOAT4> values);
+        bool AssignCompressed(
+            std::vector<Channel> channels, std::vector<uint16_t> packedTimes,
+            std::vector<uint16_t> packedValues, float duration);
+
+    private:
+        DirectX::XMVECTOR SampleChannel(const Channel& channel, float time, QuaternionBlend blend) const;
+        DirectX::XMVECTOR SampleCompressedChannel(const Channel& channel, float time, QuaternionBlend blend) const;
+
+        std::wstring m_name;
+        float m_duration = 0.0f;
+        bool m_isCompressed = false;
+        std::vector<Channel> m_channels;
+        std::vector<float> m_times;
+        std::vector<DirectX::XMFLOAT4> m_values;
+        std::vector<uint16_t> m_packedTimes;    // クリップの長さで正規化した時刻.
+        std::vector<uint16_t> m_packedValues;   // 1値あたり 3 要素.
+    };
+
+    // 2つのクリップを times の各時刻で評価し、各ノードの原点のモデル空間での位置の差の最大値を返す.
+    //  アニメーションしない要素は skeleton の基本姿勢の値とする.
+    float MeasureObjectSpaceError(
+        const AnimationClip& a, const AnimationClip& b,
+        const AnimationSkeleton& skeleton, const std::vector<float>& times);
+}
@@ -0,0 +1,62 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <DirectXMath.h>
+
+namespace util {
+
+    // スキニングの入力となる頂点ストリーム.
+    //  SkinningCompute.hlsl の t0～t3 と同じ形式.
+    struct SkinningStreams {
+        const DirectX::XMFLOAT3* positions = nullptr;
+        const DirectX::XMFLOAT3* normals = nullptr;
+        const DirectX::XMUINT4* jointIndices = nullptr;
+        const DirectX::XMFLOAT4* jointWeights = nullptr;
+        size_t vertexCount = 0;
+    };
+
+    // スキニングの方式.
+    enum class SkinningMethod {
+        Linear,         // 関節行列の線形ブレンド.
+        DualQuaternion, // デュアルクォータニオンのブレンド. 捻りによる体積の減少が起きない.
+    };
+
+    // 1体分の関節データを、シェーダーへ渡す形式で output へ書き出す.
+    //  Linear は ComputeJointPalette の関節行列、DualQuaternion は ComputeJointDualQuaternions の結果(関節ごとに 2 要素).
+    //  DualQuaternion の場合は関節行列を palette に求めてから変換する(palette は作業用).
+    //  output には書き込みのみを行うため、マップしたアップロードバッファを直接渡せる.
+    void BuildJointData(
+        const DirectX::XMMATRIX* invBindMatrices, const DirectX::XMFLOAT3X4A* worldMatrices,
+        const uint32_t* jointIndices, size_t jointCount, DirectX::FXMMATRIX mtxMeshInv,
+        SkinningMethod method, std::vector<DirectX::XMFLOAT4X4>& palette, void* output);
+
+    // CPU での線形ブレンドスキニング. SkinningCompute.hlsl と同じ計算を行う.
+    //  検証や CPU 側でのピッキングなど、GPU の結果を読み戻せない場合に使用する.
+    //  palette は ComputeJointPalette で求めた(GPU へ書き込むものと同じ)関節行列.
+
+    // [first, first + count) の範囲の頂点を変換する.
+    void SkinVertices(
+        const SkinningStreams& src, const DirectX::XMFLOAT4X4* palette,
+        size_t first, size_t count,
+        DirectX::XMFLOAT3* dstPositions, DirectX::XMFLOAT3* dstNormals);
+
+    // 全頂点を threadCount 個の連続した範囲に分け、それぞれを別のスレッドで変換する.
+    //  呼び出したスレッドも1つの範囲を受け持つ. threadCount が 0 の場合はハードウェアのスレッド数とする.
+    void SkinVerticesParallel(
+        const SkinningStreams& src, const DirectX::XMFLOAT4X4* palette,
+        DirectX::XMFLOAT3* dstPositions, DirectX::XMFLOAT3* dstNormals,
+        uint32_t threadCount = 0);
+
+    // デュアルクォータニオンによるスキニング. SkinningComputeDQ.hlsl と同じ計算を行う.
+    //  dualQuaternions は ComputeJointDualQuaternions で求めたもの(関節ごとに 2 要素).
+    void SkinVerticesDualQuaternion(
+        const SkinningStreams& src, const DirectX::XMFLOAT4* dualQuaternions,
+        size_t first, size_t count,
+        DirectX::XMFLOAT3* dstPositions, DirectX::XMFLOAT3* dstNormals);
+
+    void SkinVerticesDualQuaternionParallel(
+        const SkinningStreams& src, const DirectX::XMFLOAT4* dualQuaternions,
+        DirectX::XMFLOAT3* dstPositions, DirectX::XMFLOAT3* dstNormals,
+        uint32_t threadCount = 0);
+}
@@ -25,6 +25,31 @@ namespace util {
 
     bool LoadFile(std::vector<char>& out, const std::wstring& fileName);
 
+    // ファイルを読み取り専用でメモリマップして参照するクラス.
+    //  ファイル内容をヒープへコピーせずに直接参照できる.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        bool Open(const std::wstring& fileName);
+        void Close();
+
+        const uint8_t* GetData() const { return m_data; }
+        size_t GetSize() const { return m_size; }
+    private:
+        HANDLE m_file = INVALID_HANDLE_VALUE;
+        HANDLE m_mapping = nullptr;
+        const uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+    };
+
+    // データ内容から 64bit のハッシュ値を求める(FNV-1a ベース).
+    //  キャッシュの一致判定用であり、暗号学的な強度は持たない.
+    uint64_t ComputeHash64(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull);
+
     struct AccelerationStructureBuffers {
         ComPtr<ID3D12Resource> scratch;
         ComPtr<ID3D12Resource> asbuffer;
@@ -69,6 +94,13 @@ namespace util {
         ComPtr<ID3D12Resource> resource,
         UINT numElements, UINT firstElement, UINT stride);
 
+    // ByteAddressBuffer 用のシェーダーリソースビューを生成します.
+    //  要素数と開始位置は 32bit 単位で指定します.
+    dx12::Descriptor CreateByteAddressSRV(
+        std::unique_ptr<dx12::GraphicsDevice>& device,
+        ComPtr<ID3D12Resource> resource,
+        UINT numElements, UINT firstElement);
+
     // StructuredBuffer 用の UAV ディスクリプタを生成します.
     dx12::Descriptor CreateStructuredUAV(
         std::unique_ptr<dx12::GraphicsDevice>& device,
@@ -90,6 +122,7 @@ namespace util {
         UINT vertexCount = 0;
         UINT indexCount = 0;
         UINT vertexStride = 0;
+        DXGI_FORMAT indexFormat = DXGI_FORMAT_R32_UINT;
 
         // BLAS 用バッファ.
         ComPtr<ID3D12Resource> blas;
@@ -6,19 +6,27 @@
 #include <unordered_map>
 #include <wrl.h>
 #include <stdexcept>
+#include <chrono>
 
 #include "GraphicsDevice.h"
 #include "util/TextureResource.h"
 #include "util/DxrBookUtility.h"
+#include "util/MeshProcessing.h"
+#include "util/AnimationClip.h"
+#include "util/TransformHierarchy.h"
+#include "util/CpuSkinning.h"
 
 namespace tinygltf {
     class Node;
     class Model;
     struct Mesh;
+    struct Primitive;
 }
 namespace util {
 
     class DxrModelActor;
+    class DxrModelCrowd;
+    struct DxrModelSharedGeometry;
 
     // ff[^\NX.
     class DxrModel {
@@ -39,14 +47,79 @@ namespace util {
 
         void Destroy(std::unique_ptr<dx12::GraphicsDevice>& device);
 
+        // fǂݍݎ̐ݒ.
+        struct ImportSettings {
+            // GLB t@C}bvĎQƂ.
+            //  BIN `N𒼐ړǂݎ邽߁At@CŜ̃Rs[svɂȂ.
+            bool useFileMapping = true;
+
+            // ǂݍ݌ʂ .dxrmodel ƂăxCNAȍ~͂炩ǂݍ.
+            //  t@C̃TCYƍXVŏƍÂ݈قȂꍇ͓ẽnbVlŏƍ.
+            //  vȂꍇɂ glTF ǂݒ.
+            bool useModelCache = false;
+
+            // _ 65536 ȉ̃bṼCfbNX 16bit Ŋi[.
+            bool allowIndex16 = true;
+
+            // _LbVE_tFb`̌ǂȂ悤ɎOp`ƒ_בւ.
+            bool optimizeMeshes = false;
+
+            // v(epsilon PʂŗʎqĔr)_𓝍.
+            bool weldVertices = false;
+            float weldEpsilon = 1.0e-5f;
+
+            // @𔪖ʑ̃GR[h(4oCg)AUV 𔼐x(4oCg)Ŋi[.
+            //  XLjOf̖@͕ϊ̂ float3 ̂܂܂Ƃ.
+            bool compressAttributes = false;
+
+            // Op`̒l𒴂v~eBuԓIȃNX^ɕA
+            //  NX^Ƃ BLAS ̃WIgƂ(0 ŕȂ).
+            UINT maxClusterTriangles = 0;
+
+            // eNX`̃~bv}bv.
+            util::MipmapSettings mipmaps;
+
+            // eNX`̃ubNk.
+            util::TextureCompressSettings textureCompression;
+
+            // Aj[ṼL[팸Eʎqĕێ.
+            bool compressAnimations = false;
+            AnimationCompressSettings animationCompression;
+
+            // XL̃EFCg skinWeightThreshold ̉e菜A
+            //  ֐ߔԍ 8bit x4AEFCg unorm8 x4 Ŋi[(֐ߐ 256 𒴂ꍇ͎菜̂).
+            bool compressSkinWeights = false;
+            float skinWeightThreshold = 0.01f;
+
+            // XLjO̓(_ʒuE@E֐ߔԍEEFCg) CPU ɂێ.
+            //  CPU ł̃XLjO(؂sbLO)Ɏgp.
+            bool keepSkinningSource = false;
+
+            // v~eBuPʂ̏(fR[hE_̓EבւENX^)ɍs.
+            //  ɂ1Xbhŏɏ. ʂ͂ǂłɂȂ.
+            bool parallelImport = true;
+        };
+
         // f̃[h.
         bool LoadFromGltf(
             const std::wstring& fileName,
             std::unique_ptr<dx12::GraphicsDevice>& device);
+        bool LoadFromGltf(
+            const std::wstring& fileName,
+            std::unique_ptr<dx12::GraphicsDevice>& device,
+            const ImportSettings& settings);
 
         // `p̃AN^𐶐.
+        //  XLjOȂfł BLAS ƃbVE}eÃfBXNv^SAN^ŋL邽߁A
+        //  2̖ڈȍ~̓CX^X̔zû݂𐶐.
         std::shared_ptr<DxrModelActor> Create(std::unique_ptr<dx12::GraphicsDevice>& device);
 
+        // XLjOf Actor  count ̂܂Ƃ߂Đ(QOp).
+        //  ֐߃f[^̃obt@ƕϊ̒_obt@͑S Actor ŘAċLA
+        //  XLjO Actor  Y Ƃ1̃fBXpb`ōs.
+        //  XLjOȂf̏ꍇ nullptr Ԃ.
+        std::shared_ptr<DxrModelCrowd> CreateCrowd(std::unique_ptr<dx12::GraphicsDevice>& device, UINT count);
+
         // eKw֐߂\m[hNX.
         class Node {
         public:
@@ -64,6 +137,7 @@ namespace util {
             Node* parent = nullptr;
             int meshIndex = -1;
             friend class DxrModel;
+            friend struct DxrModelTestAccess;
         };
 
         // |S.
@@ -74,16 +148,23 @@ namespace util {
             UINT indexCount;
             UINT vertexCount;
             UINT materialIndex;
+            UINT indexByteOffset; // CfbNXobt@̊Jnʒu(oCgP).
+            UINT indexStride;     // CfbNX1̃oCg(2 or 4).
+            XMFLOAT3 boundsMin;   // QƂ钸_̋E(f).
+            XMFLOAT3 boundsMax;
 
             friend class DxrModel;
+            friend struct DxrModelTestAccess;
         };
 
-        // m[hɊ֘A|SbV𑩂˂f[^.
+        // glTF ̃bV1̃|SbV𑩂˂f[^.
+        //  ̃m[hQƂꍇ́Am[hƂ̃CX^XƂĔzu.
         class MeshGroup {
         private:
             std::vector<Mesh> m_meshes;
-            int m_nodeIndex;
+            std::vector<int> m_nodeIndices;
             friend class DxrModel;
+            friend struct DxrModelTestAccess;
         };
 
         // XLjOp.
@@ -98,16 +179,18 @@ namespace util {
         // }eA.
         class Material {
         public:
-            Material() : m_name(), m_textureIndex(-1), m_diffuseColor(1, 1, 1) { }
+            Material() : m_name(), m_textureIndex(-1), m_normalTextureIndex(-1), m_diffuseColor(1, 1, 1) { }
             std::wstring GetName() const { return m_name; }
             int GetTextureIndex() const { return m_textureIndex; }
             XMFLOAT3 GetDiffuseColor() const { return m_diffuseColor; }
         private:
             std::wstring m_name;
             int m_textureIndex;
+            int m_normalTextureIndex;
             XMFLOAT3 m_diffuseColor;
 
             friend class DxrModel;
+            friend struct DxrModelTestAccess;
         };
 
         // ʒuobt@̎擾.
@@ -121,8 +204,30 @@ namespace util {
         D3D12Resource GetJointIndicesBuffer() const { return m_vertexAttrib.JointIndices; }
         // WCgpEFCgobt@̎擾.
         D3D12Resource GetJointWeightsBuffer() const { return m_vertexAttrib.JointWeights; }
+        // XLjOp̒萔obt@(֐ߔԍEEFCǧ`)̎擾.
+        D3D12Resource GetSkinningParametersBuffer() const { return m_skinningParameters; }
+
+        // CPU ɕێXLjO̓͂擾.
+        //  ImportSettings::keepSkinningSource ̏ꍇ͒_ 0 ƂȂ.
+        SkinningStreams GetSkinningStreams() const;
+
+        // Aj[VNbv̎擾.
+        UINT GetAnimationCount() const { return UINT(m_animations.size()); }
+        const AnimationClip& GetAnimation(UINT index) const { return m_animations[index]; }
+        // OŃNbv. Ȃꍇ -1.
+        int FindAnimation(const std::wstring& name) const;
+
+        // OŃm[h. Ȃꍇ -1.
+        //  ̃m[hꍇ́A[g[DłǂčŏɌ̂Ԃ.
+        int FindNode(const std::wstring& name) const;
+        // ̖O܂Ƃ߂Č. ^[Qbgp̑Ή\̍쐬ȂǂɎgp.
+        void FindNodes(const std::wstring* names, size_t count, int* nodeIndices) const;
 
     private:
+        // crowd w肵ꍇ́A crowdIndex ԖڂƂċLobt@̈ꕔ蓖Ă.
+        std::shared_ptr<DxrModelActor> CreateActor(
+            std::unique_ptr<dx12::GraphicsDevice>& device, const DxrModelCrowd* crowd, UINT crowdIndex);
+
         struct VertexAttributeVisitor {
             std::vector<UINT> indexBuffer;
             std::vector<XMFLOAT3> positionBuffer;
@@ -133,11 +238,138 @@ namespace util {
             std::vector<XMFLOAT4> weightBuffer;
         };
 
-        void LoadNode(const tinygltf::Model& inModel);
-        void LoadMesh(const tinygltf::Model& inModel, VertexAttributeVisitor& visitor);
+        // glTF ̊eobt@̎f[^擪AhX.
+        //  }bvɂ BIN `N𒼐ڎw.
+        using BufferTable = std::vector<const uint8_t*>;
+
+        // v~eBu1̊eXg[̔zu.
+        struct PrimitiveLayout {
+            const tinygltf::Primitive* primitive;
+            // Ή郁bV m_meshGroups[groupIndex].m_meshes[meshIndex].
+            //  z̍ĊmۂŖɂȂȂ悤A|C^ł͂ȂԍŎ.
+            UINT groupIndex;
+            UINT meshIndex;
+            UINT vertexStart;
+            UINT vertexCount;
+            UINT indexStart;
+            UINT indexCount;
+        };
 
-        void LoadSkin(const tinygltf::Model& inModel);
+        void LoadNode(const tinygltf::Model& inModel);
+        // m[h̓o^ƖO̍쐬. m[h̓ǂݍ݌ɌĂяo.
+        void BuildNodeIndex();
+        void LoadMesh(
+            const tinygltf::Model& inModel, const BufferTable& buffers,
+            const ImportSettings& settings, VertexAttributeVisitor& visitor);
+        static void DecodePrimitive(
+            const tinygltf::Model& inModel, const BufferTable& buffers,
+            const PrimitiveLayout& layout, VertexAttributeVisitor& visitor);
+
+        static void WeldPrimitive(
+            PrimitiveLayout& layout, VertexAttributeVisitor& visitor, float epsilon);
+
+        // v~eBuPʂł̕בւ̌.
+        struct MeshOptimizeReport {
+            VertexCacheStatistics before;
+            VertexCacheStatistics after;
+        };
+        static void OptimizePrimitive(
+            PrimitiveLayout& layout, VertexAttributeVisitor& visitor, MeshOptimizeReport& report);
+        // v~eBu̎Op`NX^ɕAeNX^͈̔͂ƋE߂.
+        static void ClusterPrimitive(
+            const PrimitiveLayout& layout, VertexAttributeVisitor& visitor,
+            UINT maxClusterTriangles, std::vector<MeshCluster>& clusters);
+        // NX^ƂɃbV𕪂ăbVO[vgݒ.
+        void SplitMeshClusters(const std::vector<std::vector<MeshCluster>>& clusters);
+        // _v~eBǔԂl߂āAeXg[k߂.
+        void CompactVertexStreams(
+            std::vector<PrimitiveLayout>& layouts, VertexAttributeVisitor& visitor);
+
+        void LoadSkin(const tinygltf::Model& inModel, const BufferTable& buffers);
         void LoadMaterial(const tinygltf::Model& inModel);
+        void LoadAnimation(const tinygltf::Model& inModel, const BufferTable& buffers);
+        // Aj[Vǩ덷̕]Ɏgm[hKwƁAem[h̉e͈(q̃m[h܂ł̍ő勗)߂.
+        void BuildAnimationSkeleton(AnimationSkeleton& skeleton, std::vector<float>& jointLengths) const;
+        void CompressAnimations(const AnimationCompressSettings& settings);
+
+        // bVƂɃCfbNX̌`߁AGPU p̃CfbNXobt@\.
+        void BuildIndexStream(const std::vector<UINT>& indices, bool allowIndex16, std::vector<uint8_t>& indexStream);
+
+        // GPU obt@̌ɂȂ钸_Xg[.
+        //  glTF ̓WJʁA܂̓LbVt@C̃f[^w.
+        struct VertexStreamSource {
+            const uint8_t* indices = nullptr;
+            const XMFLOAT3* positions = nullptr;
+            const void* normals = nullptr;
+            const void* texcoords = nullptr;
+            DXGI_FORMAT normalFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+            DXGI_FORMAT texcoordFormat = DXGI_FORMAT_R32G32_FLOAT;
+            const void* joints = nullptr;
+            const void* weights = nullptr;
+            DXGI_FORMAT jointFormat = DXGI_FORMAT_R32G32B32A32_UINT;
+            DXGI_FORMAT weightFormat = DXGI_FORMAT_R32G32B32A32_FLOAT;
+            size_t indexBufferSize = 0; // oCgP.
+            size_t vertexCount = 0;
+            size_t skinVertexCount = 0;
+        };
+        // GR[hς݂̖ߍ݉摜.
+        struct ImageSource {
+            std::wstring name;
+            const void* data = nullptr;
+            size_t size = 0;
+        };
+        // @ UV k`֕ϊ.
+        void CompressAttributes(
+            const VertexAttributeVisitor& visitor, VertexStreamSource& streams,
+            std::vector<uint32_t>& packedNormals, std::vector<uint32_t>& packedTexcoords) const;
+        // XL̃EFCg̍팸 8bit ւ̈k. ̃EFCgƂ̃XLjOʂ̍o͂.
+        void CompressSkinWeights(
+            VertexAttributeVisitor& visitor, float threshold, VertexStreamSource& streams,
+            std::vector<uint32_t>& packedJoints, std::vector<uint32_t>& packedWeights) const;
+        void CreateVertexBuffers(
+            std::unique_ptr<dx12::GraphicsDevice>& device, const VertexStreamSource& streams, bool keepSkinningSource);
+        void CreateTextures(
+            std::unique_ptr<dx12::GraphicsDevice>& device, const std::vector<ImageSource>& images,
+            const ImportSettings& settings);
+
+        // glTF WJ_Xg[̎. VertexStreamSource ͂QƂ.
+        struct ImportedStreams {
+            VertexAttributeVisitor visitor;
+            std::vector<uint8_t> indexStream;
+            std::vector<uint32_t> packedJoints;
+            std::vector<uint32_t> packedWeights;
+            std::vector<uint32_t> packedNormals;
+            std::vector<uint32_t> packedTexcoords;
+        };
+        // GPU gpȂǂݍݏ. m[hEbVEXLE}eAEAj[VWJA
+        //  ݒɏ]Ē_HXg[ streams ɐݒ肷.
+        void ImportGltf(
+            const tinygltf::Model& model, const BufferTable& buffers, const ImportSettings& settings,
+            ImportedStreams& imported, VertexStreamSource& streams);
+
+        // LbVt@CƓǂݍݐݒɑΉĂ邩𔻒肷邽߂̏.
+        struct CacheStamp {
+            uint64_t settingsHash = 0;      // ǂݍݎ̉H̐ݒ.
+            uint64_t sourceSize = 0;        // t@C̃TCY.
+            uint64_t sourceWriteTime = 0;   // t@C̍XV.
+            uint64_t sourceHash = 0;        // t@C̓ẽnbVl.
+        };
+
+        // xCNς݃fLbV̏oƓǂݍ.
+        bool SaveCache(
+            const std::wstring& cacheFile, const CacheStamp& stamp,
+            const VertexStreamSource& streams, const std::vector<ImageSource>& images) const;
+        bool LoadCache(
+            const uint8_t* data, size_t size,
+            VertexStreamSource& streams, std::vector<ImageSource>& images);
+        // LbV̐擪 CacheStamp ǂݎ. `قȂꍇ false.
+        static bool ReadCacheStamp(const uint8_t* data, size_t size, CacheStamp& stamp);
+        // LbVt@C CacheStamp ݂̂.
+        static bool UpdateCacheStamp(const std::wstring& cacheFile, const CacheStamp& stamp);
+
+        static void OutputLoadTime(
+            const std::wstring& fileName,
+            std::chrono::high_resolution_clock::time_point timeStart, const wchar_t* mode);
         
         // e_Ƃ̃obt@(Xg[)
         struct VertexAttribute
@@ -149,6 +381,9 @@ namespace util {
             D3D12Resource JointWeights;
         } m_vertexAttrib;
         D3D12Resource m_indexBuffer;
+        D3D12Resource m_skinningParameters;
+        DXGI_FORMAT m_normalFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+        DXGI_FORMAT m_texcoordFormat = DXGI_FORMAT_R32G32_FLOAT;
 
         std::vector<util::TextureResource> m_textures;
 
@@ -156,6 +391,12 @@ namespace util {
         std::vector<Material> m_materials;
         std::vector<std::shared_ptr<Node>> m_nodes;
         std::vector<int> m_rootNodes; // V[[gɑ݂m[h̃CfbNXl.
+        std::vector<int> m_nodeOrder;   // eqOɂȂ悤A[g[Dłǂ̃m[hԍ.
+        std::vector<int> m_nodeParents; // m_nodeOrder ŐɌẽm[hԍ.  -1.
+
+        // m[h̍(I[vAhX@). Xbgɂ̓m[hԍi[A󂫂 -1.
+        std::vector<int> m_nodeNameSlots;
+        std::vector<uint64_t> m_nodeNameHashes; // m[hƂ̖ÕnbVl.
 
         struct SkinInfo {
             std::wstring name;
@@ -165,9 +406,23 @@ namespace util {
         } m_skinInfo;
         bool m_hasSkin = false;
 
+        // CPU XLjOpɕێXLjO̓.
+        struct SkinningSource {
+            std::vector<XMFLOAT3> positions;
+            std::vector<XMFLOAT3> normals;
+            std::vector<XMUINT4> jointIndices;
+            std::vector<XMFLOAT4> jointWeights;
+        } m_skinningSource;
+
+        std::vector<AnimationClip> m_animations;
+
         util::TextureResource m_whiteTex;
 
+        // XLjOf Actor ԂŋLf[^. ŏ Create ō쐬.
+        std::shared_ptr<DxrModelSharedGeometry> m_sharedGeometry;
+
         friend class DxrModelActor;
+        friend struct DxrModelTestAccess;
     };
 
     // `ŎgpAN^NX.
@@ -193,35 +448,25 @@ namespace util {
         using SpNode = std::shared_ptr<Node>;
         using SpMaterial = std::shared_ptr<Material>;
 
+        // m[h̑pnh. TRS ƍs̎̂ Actor  TransformHierarchy .
         class Node {
         public:
             Node();
             ~Node();
-            const std::wstring GetName() const { return name; }
+            const std::wstring& GetName() const { return *name; }
 
-            void UpdateLocalMatrix();
-            void UpdateWorldMatrix(XMMATRIX mtxParent);
-
-            void UpdateMatrixHierarchy(XMMATRIX mtxParent);
-
-            XMMATRIX GetWorldMatrix() { return mtxWorld; }
-            XMMATRIX GetLocalMatrix() { return mtxLocal; }
+            XMMATRIX GetWorldMatrix() const { return m_hierarchy->GetWorldMatrix(m_index); }
+            XMMATRIX GetLocalMatrix() const { return m_hierarchy->GetLocalMatrix(m_index); }
             auto GetParent() const { return parent; }
 
-            void SetTranslation(XMVECTOR t) { translation = t; }
-            void SetRotation(XMVECTOR r) { rotation = r; }
-            void SetScale(XMVECTOR s) { scale = s; }
+            void SetTranslation(XMVECTOR t) { m_hierarchy->SetTranslation(m_index, t); }
+            void SetRotation(XMVECTOR r) { m_hierarchy->SetRotation(m_index, r); }
+            void SetScale(XMVECTOR s) { m_hierarchy->SetScale(m_index, s); }
         private:
-            XMVECTOR translation;
-            XMVECTOR rotation;
-            XMVECTOR scale;
-            XMMATRIX mtxLocal;
-            XMMATRIX mtxWorld;
-            std::wstring name;
+            const std::wstring* name = nullptr; // O̎̂ DxrModel ̃m[h.
             std::weak_ptr<Node> parent;
-            std::vector<SpNode> children;
-            std::vector<UINT> m_meshes;
-            int m_meshGroupIndex = -1;
+            TransformHierarchy* m_hierarchy = nullptr;
+            UINT m_index = 0;   // TransformHierarchy ł̔ԍ.
 
             friend class DxrModel;
             friend class DxrModelActor;
@@ -256,10 +501,13 @@ namespace util {
 
         class Mesh {
         public:
-            UINT GetIndexStart() const { return indexStart; }
+            UINT GetIndexByteOffset() const { return indexByteOffset; }
             UINT GetIndexCount() const { return indexCount; }
+            DXGI_FORMAT GetIndexFormat() const { return indexFormat; }
             UINT GetVertexStart() const { return vertexStart; }
             UINT GetVertexCount() const { return vertexCount; }
+            XMFLOAT3 GetBoundsMin() const { return boundsMin; }
+            XMFLOAT3 GetBoundsMax() const { return boundsMax; }
 
             dx12::Descriptor GetPosition() const { return vbAttrPosision; }
             dx12::Descriptor GetNormal() const   { return vbAttrNormal; }
@@ -269,10 +517,13 @@ namespace util {
             SpMaterial GetMaterial() const { return material; }
             ComPtr<ID3D12Resource> GetMeshParametersCB() const { return meshParameters; }
         private:
-            UINT indexStart;
+            UINT indexByteOffset;
             UINT indexCount;
+            DXGI_FORMAT indexFormat;
             UINT vertexStart;
             UINT vertexCount;
+            XMFLOAT3 boundsMin;
+            XMFLOAT3 boundsMax;
 
             dx12::Descriptor vbAttrPosision;
             dx12::Descriptor vbAttrNormal;
@@ -282,22 +533,35 @@ namespace util {
 
             struct MeshParameters {
                 XMFLOAT4 diffuse;
-                UINT     strideOfMatrixBuffer;
-                UINT     meshGroupIndex;
+                UINT     indexStride;
+                UINT     normalEncoding; // 0: float3, 1: ʑ̃GR[h.
             };
             ComPtr<ID3D12Resource> meshParameters;
 
             friend class DxrModel;
         };
+        // bVPʂ̃f[^. BLAS ͂̒Pʂō쐬AQƂSCX^XŋL.
         class MeshGroup {
         public:
-            const SpNode GetNode() const { return m_node; }
-
             UINT GetMeshCount() const { return UINT(m_meshes.size()); }
             const Mesh& GetMesh(int index) const { return m_meshes[index]; }
+            BLASResource GetBLAS() const { return m_blas; }
         private:
-            SpNode m_node;
             std::vector<Mesh> m_meshes;
+            BLASResource m_blas;
+            BLASResource m_blasUpdateBuffer;
+            friend class DxrModel;
+            friend class DxrModelActor;
+        };
+
+        // TLAS ɔzuCX^X. bVQƂm[h1ɑΉ.
+        class Instance {
+        public:
+            const SpNode GetNode() const { return m_node; }
+            UINT GetMeshGroupIndex() const { return m_meshGroupIndex; }
+        private:
+            SpNode m_node;
+            UINT m_meshGroupIndex;
             friend class DxrModel;
             friend class DxrModelActor;
         };
@@ -314,10 +578,28 @@ namespace util {
         const DxrModel* GetModel() const { return m_modelReference; }
 
         // em[h̍sXV.
+        //  m[h TRS zus񂪕ύXꂽ݂̂vZ.
         void UpdateMatrices();
+
+        // O UpdateMatrices Ń[hs񂪕ωm[h邩.
+        bool IsTransformChanged() const { return m_transformUpdate.worldChanged > 0; }
+        // O UpdateMatrices Ńm[h TRS ω(XLjOs̍XVKv).
+        bool IsPoseChanged() const { return m_transformUpdate.localChanged > 0; }
         
-        // BLAS ̎擾.
-        BLASResource GetBLAS() const { return m_blas; }
+        // bV BLAS ̎擾.
+        BLASResource GetBLAS(UINT groupIndex) const { return m_meshGroups[groupIndex].m_blas; }
+
+        // CX^X擾.
+        UINT GetInstanceCount() const { return UINT(m_instances.size()); }
+        const Instance& GetInstance(UINT index) const { return m_instances[index]; }
+
+        // eCX^X TLAS ̃CX^XƂĒǉ.
+        //  qbgO[ṽR[h̓bVPʂ hitGroupOffset  GetMeshCountAll() ׂ̂ƂA
+        //  bṼCX^X͓R[hQƂ.
+        void AppendInstanceDescs(std::vector<D3D12_RAYTRACING_INSTANCE_DESC>& instanceDescs, UINT hitGroupOffset) const;
+        // [hs񂪕ωCX^X̍ŝ݂.
+        //  instanceDescs  AppendInstanceDescs Œǉ͈͂̐擪.
+        void UpdateInstanceDescs(D3D12_RAYTRACING_INSTANCE_DESC* instanceDescs) const;
 
         // bVO[v擾.
         UINT GetMeshGroupCount() const { return UINT(m_meshGroups.size()); }
@@ -353,33 +635,45 @@ namespace util {
         BufferResource GetDestNormalBuffer() const;
         BufferResource GetJointMatrixBuffer() const;
         dx12::Descriptor GetJointMatrixDescriptor() const;
+        // SkinningMethod::DualQuaternion ɎQƂ֐߂̃fANH[^jI(֐߂Ƃ float4 x2).
+        dx12::Descriptor GetJointDualQuaternionDescriptor() const;
+
+        // XLjO̕. ApplyTransform ŏފ֐߃f[^̌`؂ւ.
+        void SetSkinningMethod(SkinningMethod method) { m_skinningMethod = method; }
+        SkinningMethod GetSkinningMethod() const { return m_skinningMethod; }
 
         // BLAS XV.
         void UpdateBLAS(ComPtr<ID3D12GraphicsCommandList4> commandList);
 
-        // e[hs GPU ̃obt@ɏ.
+        // Aj[VNbv time ŕ]Aem[h TRS ɏ.
+        //  time ̓Nbv͈̔͂ɏ񂳂ɂ̂܂܎gp.
+        void ApplyAnimation(const AnimationClip& clip, float time, QuaternionBlend blend = QuaternionBlend::Nlerp);
+
+        // XLjOp̍s GPU ̃obt@ɏ.
+        //  ֐ߍs̓Abv[hobt@֒ڏo.
+        //  SkinningMethod::DualQuaternion ̏ꍇ͓obt@փfANH[^jIo.
         void ApplyTransform();
+        // XLjOp̍s CPU ̔zɋ߂. ` ApplyTransform ŏނ̂Ɠ.
+        //  DxrModel::GetSkinningStreams Ƒgݍ킹 SkinVertices ɓn.
+        void GetJointPalette(std::vector<DirectX::XMFLOAT4X4>& palette) const;
+        // ֐߂̃fANH[^jI CPU ̔zɋ߂. SkinVerticesDualQuaternion ɓn.
+        void GetJointDualQuaternions(std::vector<DirectX::XMFLOAT4>& dualQuaternions) const;
 
         // wm[ȟ.
         std::shared_ptr<Node> SearchNode(const std::wstring& name);
+        // m[ḧꊇ. ȂOɂ nullptr .
+        void SearchNodes(const std::wstring* names, size_t count, SpNode* nodes);
 
 
         UINT GetMaterialCount() const { return UINT(m_materials.size()); }
         std::shared_ptr<Material> GetMaterial(UINT idx) const { return m_materials[idx]; }
-
-        dx12::Descriptor GetBLASMatrixDescriptor() {
-            return m_blasMatrixDescriptor;
-        }
-        BufferResource GetBlasMatrices() const {
-            return m_blasMatrices;
-        }
     private:
         DxrModelActor(std::unique_ptr<dx12::GraphicsDevice>& device, const DxrModel* model);
 
-        void CreateMatrixBufferBLAS(UINT matrixCount);
         void CreateBLAS();
-        void CreateRtGeometryDesc(std::vector<D3D12_RAYTRACING_GEOMETRY_DESC>& rtGeomDesc);
-        SpNode SearchNode(SpNode node, const std::wstring& name);
+        // ֐߃f[^ SkinningMethod ɉ` dst ֏o.
+        void WriteJointData(void* dst);
+        void CreateRtGeometryDesc(const MeshGroup& meshGroup, std::vector<D3D12_RAYTRACING_GEOMETRY_DESC>& rtGeomDesc);
         UINT GetWriteIndex() const {
             return m_device->GetCurrentFrameIndex();
         }
@@ -387,32 +681,111 @@ namespace util {
         XMMATRIX m_mtxWorld;
         const DxrModel* m_modelReference;
 
-        std::vector<SpNode> m_nodes;
+        TransformHierarchy m_hierarchy;
+        TransformUpdateResult m_transformUpdate;
+        std::vector<SpNode> m_nodes;        // m_hierarchy Ɠ(e)ɕׂSm[h.
+        std::vector<SpNode> m_nodeTable;    // f̃m[hԍɕׂSm[h.
         std::vector<SpMaterial> m_materials;
         std::vector<MeshGroup> m_meshGroups;
-
-        BufferResource m_blas;
-        BufferResource m_blasUpdateBuffer;
-
-        ComPtr<ID3D12Resource> m_blasMatrices;
-        dx12::Descriptor m_blasMatrixDescriptor;
+        std::vector<Instance> m_instances;
+        std::vector<XMVECTOR> m_animationValues; // Aj[V]ʂ̍Ɨ̈.
 
         struct SkinInfo {
             std::vector<XMMATRIX> invBindMatrices;
             std::vector<SpNode> jointList;
+            std::vector<uint32_t> jointIndices; // e֐߂ TransformHierarchy ł̔ԍ.
 
             dx12::Descriptor jointMatricesDescriptor;
             dx12::Descriptor vbPositionDescriptor;
             dx12::Descriptor vbNormalDescriptor;
             std::vector<dx12::Descriptor> bufJointMatricesDescriptors;
+            std::vector<dx12::Descriptor> bufJointDualQuatsDescriptors;
+            std::vector<DirectX::XMFLOAT4X4> palette; // fANH[^jIϊp̍Ɨ̈.
 
 
             BufferResource   vbPositionTransformed;
             BufferResource   vbNormalTransformed;
             BufferResource   bufJointMatrices;
             UINT skinVertexCount;
+
+            // QOł͕ϊ̒_E֐߃f[^̃obt@AċL邽߁Ag͈̔͂.
+            UINT vertexOffset = 0;      // ϊ̒_obt@ł̐擪̒_ԍ.
+            UINT jointBufferOffset = 0; // ֐߃f[^̃t[Ƃ̗̈ł̐擪(oCg).
+            UINT jointBufferStride = 0; // ֐߃f[^̃t[Ƃ̗̈TCY(oCg).
         } m_skinInfo;
         bool m_hasSkin = false;
+        SkinningMethod m_skinningMethod = SkinningMethod::Linear;
+        std::unique_ptr<dx12::GraphicsDevice>& m_device;
+        friend class DxrModel;
+        friend class DxrModelCrowd;
+    };
+
+    //  DxrModel 琶XLjO Actor L BLAS ƃbVE}eA.
+    //  e Actor ͎Q(ComPtr/shared_ptr)Rs[Ď.
+    struct DxrModelSharedGeometry {
+        std::vector<DxrModelActor::SpMaterial> materials;
+        std::vector<DxrModelActor::MeshGroup> meshGroups;
+    };
+
+    // XLjOf琶 Actor ̏W܂(QO).
+    //  ֐߃f[^ƕϊ̒_ Actor ̏ɘA1̃obt@Ɋi[.
+    //  XLjO Dispatch(_, Actor , 1) ƂAVF[_[ Y  Actor ̔ԍƂĈ.
+    //  DxrModel::CreateCrowd 萶.
+    class DxrModelCrowd {
+    public:
+        template<class T>
+        using ComPtr = Microsoft::WRL::ComPtr<T>;
+        using BufferResource = ComPtr<ID3D12Resource>;
+
+        DxrModelCrowd() = delete;
+        ~DxrModelCrowd();
+
+        UINT GetActorCount() const { return m_actorCount; }
+        std::shared_ptr<DxrModelActor> GetActor(UINT index) const { return m_actors[index]; }
+        const DxrModel* GetModel() const { return m_modelReference; }
+
+        // S Actor  UpdateMatrices ɍs.
+        void UpdateMatrices();
+        // O UpdateMatrices łꂩ Actor ̎pω.
+        bool IsPoseChanged() const;
+
+        // S Actor ̊֐߃f[^Aobt@֕ɏo.
+        //  e Actor ̏ݐ͏dȂȂ߁AActor Pʂŕ.
+        void ApplyTransform();
+
+        // XLjO̕. 1̃fBXpb`ŏ邽ߑS Actor ŋʂƂ.
+        void SetSkinningMethod(SkinningMethod method);
+        SkinningMethod GetSkinningMethod() const { return m_skinningMethod; }
+
+        // 1̂̊֐ߐƒ_.
+        UINT GetJointCount() const { return m_jointCount; }
+        UINT GetSkinVertexCount() const { return m_skinVertexCount; }
+
+        BufferResource GetDestPositionBuffer() const { return m_vbPositionTransformed; }
+        BufferResource GetDestNormalBuffer() const { return m_vbNormalTransformed; }
+        BufferResource GetJointMatrixBuffer() const { return m_bufJointMatrices; }
+        // S Actor ̊֐ߍs(fANH[^jI)QƂfBXNv^.
+        dx12::Descriptor GetJointMatrixDescriptor() const;
+        dx12::Descriptor GetJointDualQuaternionDescriptor() const;
+
+        // S Actor  BLAS XV.
+        void UpdateBLAS(ComPtr<ID3D12GraphicsCommandList4> commandList);
+    private:
+        DxrModelCrowd(std::unique_ptr<dx12::GraphicsDevice>& device, const DxrModel* model);
+
+        const DxrModel* m_modelReference;
+        std::vector<std::shared_ptr<DxrModelActor>> m_actors;
+        UINT m_actorCount = 0;
+        UINT m_jointCount = 0;
+        UINT m_skinVertexCount = 0;
+        SkinningMethod m_skinningMethod = SkinningMethod::Linear;
+
+        BufferResource m_vbPositionTransformed;
+        BufferResource m_vbNormalTransformed;
+        BufferResource m_bufJointMatrices;
+        std::vector<dx12::Descriptor> m_bufJointMatricesDescriptors;
+        std::vector<dx12::Descriptor> m_bufJointDualQuatsDescriptors;
+
         std::unique_ptr<dx12::GraphicsDevice>& m_device;
         friend class DxrModel;
     };
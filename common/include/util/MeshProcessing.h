@@ -0,0 +1,123 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <cmath>
+#include <DirectXMath.h>
+
+namespace util {
+
+    // 参照されなくなった頂点を表す値.
+    static const uint32_t InvalidVertexIndex = ~0u;
+
+    // 頂点キャッシュの効率を表す統計情報.
+    struct VertexCacheStatistics {
+        size_t cacheMisses = 0;
+        size_t triangleCount = 0;
+        size_t vertexCount = 0;
+
+        // 三角形あたりのキャッシュミス数 (Average Cache Miss Ratio).
+        float GetACMR() const { return triangleCount ? float(cacheMisses) / triangleCount : 0.0f; }
+        // 頂点あたりのキャッシュミス数 (Average Transformed Vertex Ratio).
+        float GetATVR() const { return vertexCount ? float(cacheMisses) / vertexCount : 0.0f; }
+
+        VertexCacheStatistics& operator+=(const VertexCacheStatistics& rhs) {
+            cacheMisses += rhs.cacheMisses;
+            triangleCount += rhs.triangleCount;
+            vertexCount += rhs.vertexCount;
+            return *this;
+        }
+    };
+
+    // FIFO の頂点キャッシュを想定してキャッシュミス数を求める.
+    VertexCacheStatistics AnalyzeVertexCache(
+        const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+    // 頂点キャッシュで再利用されやすいように三角形の順序を並べ替える.
+    //  Tom Forsyth の Linear-Speed Vertex Cache Optimisation に基づく.
+    void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+    // 頂点を初めて参照される順に並べ替える対応表を作成し、インデックスを書き換える.
+    //  remap[旧頂点番号] = 新頂点番号 となり、参照されない頂点は InvalidVertexIndex となる.
+    //  戻り値は参照される頂点の数.
+    size_t OptimizeVertexFetch(
+        uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& remap);
+
+    // 比較用のキーが一致する頂点を1つに統合する対応表を作成し、インデックスを書き換える.
+    //  keys は1頂点あたり keyStride 個の値を持ち、remap[旧頂点番号] = 新頂点番号 となる.
+    //  統合後の頂点番号は元の並び順を保つ. 戻り値は統合後の頂点数.
+    size_t WeldVertices(
+        uint32_t* indices, size_t indexCount,
+        const uint64_t* keys, size_t keyStride, size_t vertexCount, std::vector<uint32_t>& remap);
+
+    // 頂点比較用に値を epsilon 単位で量子化する.
+    inline uint64_t QuantizeVertexValue(float value, float epsilon) {
+        return uint64_t(std::llround(double(value) / epsilon));
+    }
+
+    // 法線を八面体エンコードし、2成分の snorm16 (DXGI_FORMAT_R16G16_SNORM) として格納する.
+    void EncodeOctahedralNormals(uint32_t* dst, const DirectX::XMFLOAT3* src, size_t count);
+    // 八面体エンコードされた法線を復元する.
+    DirectX::XMFLOAT3 DecodeOctahedralNormal(uint32_t packed);
+
+    // UV を半精度浮動小数点 (DXGI_FORMAT_R16G16_FLOAT) として格納する.
+    void EncodeHalfTexcoords(uint32_t* dst, const DirectX::XMFLOAT2* src, size_t count);
+    DirectX::XMFLOAT2 DecodeHalfTexcoord(uint32_t packed);
+
+    // ウェイトが threshold 未満の関節の影響を取り除き、残りのウェイトの合計が 1 となるよう正規化する.
+    //  各頂点の影響はウェイトの大きい順に並べ替え、取り除いた枠は関節 0、ウェイト 0 とする.
+    //  最も大きいウェイトの影響は常に残す. 戻り値は取り除いた影響の数.
+    size_t PruneSkinWeights(
+        DirectX::XMUINT4* joints, DirectX::XMFLOAT4* weights, size_t count, float threshold);
+
+    // 関節番号を 8bit x4 (DXGI_FORMAT_R8G8B8A8_UINT)、ウェイトを unorm8 x4 (DXGI_FORMAT_R8G8B8A8_UNORM) として格納する.
+    //  量子化後のウェイトの合計が 255 となるよう、丸め誤差は最も大きいウェイトで吸収する.
+    //  関節番号は 256 未満であること.
+    void EncodeSkinInfluences(
+        uint32_t* dstJoints, uint32_t* dstWeights,
+        const DirectX::XMUINT4* joints, const DirectX::XMFLOAT4* weights, size_t count);
+    void DecodeSkinInfluences(
+        uint32_t packedJoints, uint32_t packedWeights, DirectX::XMUINT4& joints, DirectX::XMFLOAT4& weights);
+
+    // 空間的にまとまった三角形の集まり.
+    struct MeshCluster {
+        uint32_t indexStart = 0;  // 並べ替え後のインデックス列での開始位置.
+        uint32_t indexCount = 0;
+        DirectX::XMFLOAT3 boundsMin;
+        DirectX::XMFLOAT3 boundsMax;
+    };
+
+    // 三角形をクラスタへ分割し、クラスタごとに連続するようインデックスを並べ替える.
+    //  三角形の重心を最長軸の中央値で再帰的に2分割するため、同じ入力には同じ結果となる.
+    //  クラスタ内の三角形は元の相対順序を保つ.
+    void BuildMeshClusters(
+        uint32_t* indices, size_t indexCount, const DirectX::XMFLOAT3* positions,
+        size_t maxTrianglesPerCluster, std::vector<MeshCluster>& clusters);
+
+    // インデックス列のうちメッシュ1つ分の範囲と、その格納形式.
+    struct IndexRange {
+        uint32_t indexStart = 0;  // 元のインデックス列での開始位置.
+        uint32_t indexCount = 0;
+        uint32_t indexStride = 0; // 格納後の1インデックスのバイト数(2 または 4).
+        uint32_t byteOffset = 0;  // 格納先での開始位置(バイト単位、4 の倍数).
+    };
+
+    // 範囲ごとにインデックスの形式を決め、1つのバッファへ詰めて格納する.
+    //  全インデックスが 0xFFFF 以下の範囲は allowIndex16 の場合に 16bit、それ以外は 32bit とする.
+    //  各範囲の開始位置は 4 バイト境界に揃える(ByteAddressBuffer から読み取るため).
+    //  ranges の indexStride と byteOffset を設定する.
+    void PackIndexStream(
+        const std::vector<uint32_t>& indices, std::vector<IndexRange>& ranges,
+        bool allowIndex16, std::vector<uint8_t>& stream);
+
+    // 対応表に従って頂点データを並べ替える.
+    template<class T>
+    void RemapVertexStream(T* vertices, size_t vertexCount, const std::vector<uint32_t>& remap) {
+        std::vector<T> src(vertices, vertices + vertexCount);
+        for (size_t i = 0; i < vertexCount; ++i) {
+            if (remap[i] != InvalidVertexIndex) {
+                vertices[remap[i]] = src[i];
+            }
+        }
+    }
+}
@@ -2,8 +2,12 @@
 #include <wrl.h>
 #include <d3d12.h>
 #include "GraphicsDevice.h"
+#include <DirectXTex.h>
 
 #include <memory>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
 
 namespace util {
     
@@ -16,7 +20,160 @@ namespace util {
         const void* data, UINT64 size, 
         std::unique_ptr<dx12::GraphicsDevice>& device);
 
+    // eNX`̗pr. k`tB^̑IɎg.
+    enum class TextureUsage {
+        Color,
+        Normal,
+    };
+
+    // ̉摜t@C(DDS ܂ WIC ň`).
+    struct ImageMemory {
+        const void* data;
+        UINT64 size;
+        TextureUsage usage = TextureUsage::Color;
+    };
+
+    // fR[hς݂̉摜. sɂ image ƂȂ.
+    struct DecodedImage {
+        DirectX::TexMetadata metadata;
+        DirectX::ScratchImage image;
+    };
+
+    // fR[h̃~bv}bv̐ݒ.
+    struct MipmapSettings {
+        enum class Filter {
+            Box,      // 2x2 ̒P.
+            Triangle, // אڃeNZɂd݂egtB^.
+        };
+
+        // ~bvxȂ摜ɑSx𐶐.
+        bool generateMips = false;
+        Filter filter = Filter::Box;
+
+        // F sRGB Ƃ݂ȂAjAԂŕς.
+        bool gammaCorrect = true;
+
+        // 0 傫ꍇA̒lł̃At@eXg̒ʉߗexŕۂ.
+        float alphaReference = 0.0f;
+    };
+
+    // 摜 CPU ŃfR[h. GPU gpȂߒPƂŌvł.
+    bool DecodeImage(const ImageMemory& source, DecodedImage& decoded, const MipmapSettings& mipmaps = MipmapSettings());
+
+    // fR[hς݂̉摜ɏk~bvxǉ.
+    bool GenerateMipChain(DecodedImage& decoded, const MipmapSettings& mipmaps);
+
+    // ̉摜[J[XbhŕɃfR[h.
+    std::vector<DecodedImage> DecodeImages(const std::vector<ImageMemory>& sources, const MipmapSettings& mipmaps = MipmapSettings());
+
+    // ubNk̐ݒ.
+    struct TextureCompressSettings {
+        bool compress = false;
+
+        // J[ BC7 ňk. false ̏ꍇ̓At@̗Lɂ BC1/BC3 Ƃ.
+        //  @}bv͏ BC5 Ƃ.
+        bool highQuality = true;
+
+        // kʂ DDS ƂĕۑfBNg.
+        //  摜̃nbVlt@CƂAȍ~͈kς݂̃f[^ǂݍ.
+        std::wstring cacheDirectory = L"texcache";
+    };
+
+    // prƉ摜̓eubNǩ`I.
+    //  kłȂ摜(E4̔{łȂ)ɂ DXGI_FORMAT_UNKNOWN Ԃ.
+    DXGI_FORMAT SelectBlockCompressionFormat(
+        TextureUsage usage, const DecodedImage& decoded, bool highQuality);
+
+    // SxubNk. ex̃ubN͕ɏ.
+    //  psnr w肵ꍇɂ͍ŏʃx PSNR(dB) i[.
+    bool CompressImage(DecodedImage& decoded, DXGI_FORMAT format, float* psnr = nullptr);
+
+    // 摜1̎荞݌.
+    struct TextureImportReport {
+        bool cacheHit = false;
+        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+        size_t pixelCount = 0;    // 摜̃sNZ.
+        double decodeMs = 0.0;    // ~bv}bv܂.
+        size_t blockCount = 0;    // kubN(Sx).
+        double compressMs = 0.0;
+        float psnr = 0.0f;
+    };
+
+    // fR[hE~bv}bvEubNks.
+    //  kɂ̓fBXÑLbVD悵Ďgp.
+    bool ImportImage(
+        const ImageMemory& source, DecodedImage& decoded,
+        const MipmapSettings& mipmaps, const TextureCompressSettings& compression,
+        TextureImportReport* report = nullptr);
+
+    // ̉摜Ɏ荞.
+    std::vector<DecodedImage> ImportImages(
+        const std::vector<ImageMemory>& sources,
+        const MipmapSettings& mipmaps, const TextureCompressSettings& compression,
+        std::vector<TextureImportReport>* reports = nullptr);
+
+    // fR[hς݂̉摜eNX`𐶐.
+    //  ]1̃Xe[WOobt@ƃR}hXgɂ܂Ƃ߁A҂͍Ō1̂ݍs.
+    std::vector<TextureResource> CreateTexturesFromImages(
+        const std::vector<DecodedImage>& images,
+        std::unique_ptr<dx12::GraphicsDevice>& device);
+
     TextureResource LoadTextureFromFile(
         const std::wstring& fileName, 
         std::unique_ptr<dx12::GraphicsDevice>& device);
+
+    // vZXŜŋLeNX`̃LbV.
+    //  GR[hς݃f[^̃nbVl(t@C̏ꍇ̓pX)L[ƂA
+    //  摜̃fR[hE]ESRV 1ɂ܂Ƃ߂.
+    //  擾eNX`͎QƃJEgŊǗARelease őSĉ SRV .
+    class TextureCache {
+    public:
+        static TextureCache& GetInstance();
+
+        // 摜t@Cǂݍ.
+        TextureResource LoadFromFile(
+            const std::wstring& fileName,
+            std::unique_ptr<dx12::GraphicsDevice>& device);
+
+        // ̉摜ǂݍ.
+        TextureResource LoadFromMemory(
+            const void* data, UINT64 size,
+            std::unique_ptr<dx12::GraphicsDevice>& device);
+
+        // ̉摜荞. LbVɖ̂܂Ƃ߂ăfR[hE].
+        //  reports ɂ͐VɎ荞񂾉摜̌ʂ݂̂i[.
+        std::vector<TextureResource> Import(
+            const std::vector<ImageMemory>& sources,
+            const MipmapSettings& mipmaps, const TextureCompressSettings& compression,
+            std::unique_ptr<dx12::GraphicsDevice>& device,
+            std::vector<TextureImportReport>* reports = nullptr);
+
+        // QƂ1.
+        void Release(const TextureResource& texture, std::unique_ptr<dx12::GraphicsDevice>& device);
+
+        struct Statistics {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t entryCount = 0;
+        };
+        Statistics GetStatistics() const;
+
+    private:
+        TextureCache() = default;
+
+        struct Entry {
+            TextureResource texture;
+            UINT refCount = 0;
+        };
+        // ȉ m_mutex bNԂŌĂяo.
+        //  o^ς݂łΎQƂ𑝂₵ĕԂ.
+        bool AcquireLocked(uint64_t key, TextureResource& texture);
+        //  QƃJEg 0 œo^.
+        void RegisterLocked(uint64_t key, TextureResource& texture, std::unique_ptr<dx12::GraphicsDevice>& device);
+
+        mutable std::mutex m_mutex;
+        std::unordered_map<uint64_t, Entry> m_entries;
+        std::unordered_map<ID3D12Resource*, uint64_t> m_keyOfResource;
+        Statistics m_statistics;
+    };
 }
@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <DirectXMath.h>
+
+namespace util {
+
+    // UpdateMatrices で更新したノードの数.
+    struct TransformUpdateResult {
+        size_t localChanged = 0;    // TRS が変更されていたノード.
+        size_t worldChanged = 0;    // ワールド行列を計算し直したノード(変更のあったノードとその子孫).
+    };
+
+    // ノードの階層構造を、親が子より前に並ぶ順序の配列(SoA)として保持する.
+    //  TRS・ローカル行列・ワールド行列・親の番号をそれぞれ別の配列に格納し、
+    //  ワールド行列は先頭から1回走査するだけで求まる.
+    //  TRS の変更は変更フラグとして記録し、変更のあったノードとその子孫の行列のみを計算し直す.
+    class TransformHierarchy {
+    public:
+        static const int InvalidParent = -1;
+
+        void Clear();
+        void Reserve(size_t nodeCount);
+
+        // ノードを末尾に追加し、その番号を返す. parent は追加済みのノード(ルートは InvalidParent).
+        uint32_t AddNode(int parent, DirectX::FXMVECTOR translation, DirectX::FXMVECTOR rotation, DirectX::FXMVECTOR scale);
+
+        size_t GetNodeCount() const { return m_parents.size(); }
+        int GetParent(uint32_t index) const { return m_parents[index]; }
+
+        // 値が前回と同じ場合は変更フラグを立てない(静止している関節の行列は計算し直さない).
+        void SetTranslation(uint32_t index, DirectX::FXMVECTOR t) { SetIfChanged(m_translations[index], index, t); }
+        void SetRotation(uint32_t index, DirectX::FXMVECTOR r) { SetIfChanged(m_rotations[index], index, r); }
+        void SetScale(uint32_t index, DirectX::FXMVECTOR s) { SetIfChanged(m_scales[index], index, s); }
+        DirectX::XMVECTOR GetTranslation(uint32_t index) const { return DirectX::XMLoadFloat4A(&m_translations[index]); }
+        DirectX::XMVECTOR GetRotation(uint32_t index) const { return DirectX::XMLoadFloat4A(&m_rotations[index]); }
+        DirectX::XMVECTOR GetScale(uint32_t index) const { return DirectX::XMLoadFloat4A(&m_scales[index]); }
+
+        DirectX::XMMATRIX GetLocalMatrix(uint32_t index) const { return DirectX::XMLoadFloat3x4A(&m_localMatrices[index]); }
+        DirectX::XMMATRIX GetWorldMatrix(uint32_t index) const { return DirectX::XMLoadFloat3x4A(&m_worldMatrices[index]); }
+        const DirectX::XMFLOAT3X4A* GetWorldMatrices() const { return m_worldMatrices.data(); }
+
+        // 変更のあったノードとその子孫のローカル行列とワールド行列を更新する.
+        //  ルートノードの親は mtxRoot とし、前回と異なる場合は全ノードを更新する.
+        TransformUpdateResult UpdateMatrices(DirectX::FXMMATRIX mtxRoot);
+
+        // 直前の UpdateMatrices でワールド行列が更新されたか.
+        bool IsWorldChanged(uint32_t index) const { return m_worldChanged[index] != 0; }
+
+    private:
+        void SetIfChanged(DirectX::XMFLOAT4A& value, uint32_t index, DirectX::FXMVECTOR v) {
+            if (!DirectX::XMVector4Equal(DirectX::XMLoadFloat4A(&value), v)) {
+                DirectX::XMStoreFloat4A(&value, v);
+                m_localDirty[index] = 1;
+            }
+        }
+
+        std::vector<DirectX::XMFLOAT4A> m_translations;
+        std::vector<DirectX::XMFLOAT4A> m_rotations;
+        std::vector<DirectX::XMFLOAT4A> m_scales;
+        std::vector<DirectX::XMFLOAT3X4A> m_localMatrices;
+        std::vector<DirectX::XMFLOAT3X4A> m_worldMatrices;
+        std::vector<int> m_parents;
+        std::vector<uint8_t> m_localDirty;
+        std::vector<uint8_t> m_worldChanged;
+        DirectX::XMFLOAT4X4 m_rootMatrix;
+        bool m_hasRootMatrix = false;
+    };
+}
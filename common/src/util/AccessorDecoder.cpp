@@ -0,0 +1,298 @@
+﻿#include "util/AccessorDecoder.h"
+
+#include <emmintrin.h>
+#include <algorithm>
+#include <cstring>
+#include <cfloat>
+
+namespace util {
+
+    size_t GetComponentSize(ComponentType type)
+    {
+        switch (type) {
+        case ComponentType::Byte:
+        case ComponentType::UnsignedByte:
+            return 1;
+        case ComponentType::Short:
+        case ComponentType::UnsignedShort:
+            return 2;
+        case ComponentType::UnsignedInt:
+        case ComponentType::Float:
+            return 4;
+        }
+        return 0;
+    }
+
+    // 密に詰まった成分列の変換処理.
+    //  SSE2 で 16 バイト単位に処理し、端数はスカラーで処理する.
+    namespace {
+        void ConvertU8ToU32(uint32_t* dst, const uint8_t* src, size_t n)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                __m128i lo = _mm_unpacklo_epi8(v, zero);
+                __m128i hi = _mm_unpackhi_epi8(v, zero);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 0), _mm_unpacklo_epi16(lo, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(lo, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpacklo_epi16(hi, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 12), _mm_unpackhi_epi16(hi, zero));
+            }
+            for (; i < n; ++i) {
+                dst[i] = src[i];
+            }
+        }
+
+        void ConvertU16ToU32(uint32_t* dst, const uint16_t* src, size_t n)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 0), _mm_unpacklo_epi16(v, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(v, zero));
+            }
+            for (; i < n; ++i) {
+                dst[i] = src[i];
+            }
+        }
+
+        // 整数を float へ変換して scale を乗算し、minValue でクランプする.
+        void StoreScaled(float* dst, __m128i v, __m128 scale, __m128 minValue)
+        {
+            __m128 f = _mm_mul_ps(_mm_cvtepi32_ps(v), scale);
+            _mm_storeu_ps(dst, _mm_max_ps(f, minValue));
+        }
+
+        void ConvertU8ToFloat(float* dst, const uint8_t* src, size_t n, float scale)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128 vscale = _mm_set1_ps(scale);
+            const __m128 vmin = _mm_setzero_ps();
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                __m128i lo = _mm_unpacklo_epi8(v, zero);
+                __m128i hi = _mm_unpackhi_epi8(v, zero);
+                StoreScaled(dst + i + 0, _mm_unpacklo_epi16(lo, zero), vscale, vmin);
+                StoreScaled(dst + i + 4, _mm_unpackhi_epi16(lo, zero), vscale, vmin);
+                StoreScaled(dst + i + 8, _mm_unpacklo_epi16(hi, zero), vscale, vmin);
+                StoreScaled(dst + i + 12, _mm_unpackhi_epi16(hi, zero), vscale, vmin);
+            }
+            for (; i < n; ++i) {
+                dst[i] = src[i] * scale;
+            }
+        }
+
+        void ConvertS8ToFloat(float* dst, const int8_t* src, size_t n, float scale, float minValue)
+        {
+            const __m128 vscale = _mm_set1_ps(scale);
+            const __m128 vmin = _mm_set1_ps(minValue);
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                // 上位側へ複製してから算術シフトすることで符号拡張する.
+                __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+                __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+                StoreScaled(dst + i + 0, _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16), vscale, vmin);
+                StoreScaled(dst + i + 4, _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16), vscale, vmin);
+                StoreScaled(dst + i + 8, _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16), vscale, vmin);
+                StoreScaled(dst + i + 12, _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16), vscale, vmin);
+            }
+            for (; i < n; ++i) {
+                dst[i] = std::max(src[i] * scale, minValue);
+            }
+        }
+
+        void ConvertU16ToFloat(float* dst, const uint16_t* src, size_t n, float scale)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128 vscale = _mm_set1_ps(scale);
+            const __m128 vmin = _mm_setzero_ps();
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                StoreScaled(dst + i + 0, _mm_unpacklo_epi16(v, zero), vscale, vmin);
+                StoreScaled(dst + i + 4, _mm_unpackhi_epi16(v, zero), vscale, vmin);
+            }
+            for (; i < n; ++i) {
+                dst[i] = src[i] * scale;
+            }
+        }
+
+        void ConvertS16ToFloat(float* dst, const int16_t* src, size_t n, float scale, float minValue)
+        {
+            const __m128 vscale = _mm_set1_ps(scale);
+            const __m128 vmin = _mm_set1_ps(minValue);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                StoreScaled(dst + i + 0, _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16), vscale, vmin);
+                StoreScaled(dst + i + 4, _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16), vscale, vmin);
+            }
+            for (; i < n; ++i) {
+                dst[i] = std::max(src[i] * scale, minValue);
+            }
+        }
+
+        // 成分数が一致し、要素が密に詰まっていれば成分の一次元配列として一括変換できる.
+        bool IsPackedLayout(const AccessorLayout& src, uint32_t dstComponents)
+        {
+            auto elementSize = GetComponentSize(src.componentType) * src.componentCount;
+            return src.componentCount == dstComponents &&
+                (src.stride == 0 || src.stride == elementSize);
+        }
+
+        size_t GetElementStride(const AccessorLayout& src)
+        {
+            if (src.stride != 0) {
+                return src.stride;
+            }
+            return GetComponentSize(src.componentType) * src.componentCount;
+        }
+    }
+
+    // 一括変換と結果を揃えるため、正規化は除算ではなく逆数の乗算で行う.
+    float ReadComponentAsFloat(const uint8_t* p, ComponentType type, bool normalized)
+    {
+        switch (type) {
+        case ComponentType::Byte: {
+            int8_t v; memcpy(&v, p, sizeof(v));
+            return normalized ? std::max(v * (1.0f / 127.0f), -1.0f) : float(v);
+        }
+        case ComponentType::UnsignedByte: {
+            uint8_t v = *p;
+            return normalized ? v * (1.0f / 255.0f) : float(v);
+        }
+        case ComponentType::Short: {
+            int16_t v; memcpy(&v, p, sizeof(v));
+            return normalized ? std::max(v * (1.0f / 32767.0f), -1.0f) : float(v);
+        }
+        case ComponentType::UnsignedShort: {
+            uint16_t v; memcpy(&v, p, sizeof(v));
+            return normalized ? v * (1.0f / 65535.0f) : float(v);
+        }
+        case ComponentType::UnsignedInt: {
+            uint32_t v; memcpy(&v, p, sizeof(v));
+            return normalized ? float(v / 4294967295.0) : float(v);
+        }
+        case ComponentType::Float: {
+            float v; memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        }
+        return 0.0f;
+    }
+
+    uint32_t ReadComponentAsUint(const uint8_t* p, ComponentType type)
+    {
+        switch (type) {
+        case ComponentType::Byte:
+        case ComponentType::UnsignedByte:
+            return *p;
+        case ComponentType::Short:
+        case ComponentType::UnsignedShort: {
+            uint16_t v; memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        case ComponentType::UnsignedInt: {
+            uint32_t v; memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        case ComponentType::Float: {
+            float v; memcpy(&v, p, sizeof(v));
+            return uint32_t(v);
+        }
+        }
+        return 0;
+    }
+
+    void DecodeAccessor(float* dst, uint32_t dstComponents, const AccessorLayout& src)
+    {
+        const size_t n = src.count * dstComponents;
+        if (src.data == nullptr) {
+            std::fill(dst, dst + n, 0.0f);
+            return;
+        }
+
+        if (IsPackedLayout(src, dstComponents)) {
+            const float minValue = src.normalized ? -1.0f : -FLT_MAX;
+            switch (src.componentType) {
+            case ComponentType::Float:
+                memcpy(dst, src.data, sizeof(float) * n);
+                return;
+            case ComponentType::UnsignedByte:
+                ConvertU8ToFloat(dst, src.data, n, src.normalized ? 1.0f / 255.0f : 1.0f);
+                return;
+            case ComponentType::Byte:
+                ConvertS8ToFloat(dst, reinterpret_cast<const int8_t*>(src.data), n, src.normalized ? 1.0f / 127.0f : 1.0f, minValue);
+                return;
+            case ComponentType::UnsignedShort:
+                ConvertU16ToFloat(dst, reinterpret_cast<const uint16_t*>(src.data), n, src.normalized ? 1.0f / 65535.0f : 1.0f);
+                return;
+            case ComponentType::Short:
+                ConvertS16ToFloat(dst, reinterpret_cast<const int16_t*>(src.data), n, src.normalized ? 1.0f / 32767.0f : 1.0f, minValue);
+                return;
+            default:
+                break;
+            }
+        }
+
+        // インターリーブされたデータや成分数の異なるデータは要素ごとに処理する.
+        const auto componentSize = GetComponentSize(src.componentType);
+        const auto stride = GetElementStride(src);
+        const auto count = std::min(src.componentCount, dstComponents);
+        for (size_t i = 0; i < src.count; ++i) {
+            auto element = src.data + i * stride;
+            auto out = dst + i * dstComponents;
+            uint32_t c = 0;
+            for (; c < count; ++c) {
+                out[c] = ReadComponentAsFloat(element + c * componentSize, src.componentType, src.normalized);
+            }
+            for (; c < dstComponents; ++c) {
+                out[c] = 0.0f;
+            }
+        }
+    }
+
+    void DecodeAccessor(uint32_t* dst, uint32_t dstComponents, const AccessorLayout& src)
+    {
+        const size_t n = src.count * dstComponents;
+        if (src.data == nullptr) {
+            std::fill(dst, dst + n, 0u);
+            return;
+        }
+
+        if (IsPackedLayout(src, dstComponents)) {
+            switch (src.componentType) {
+            case ComponentType::UnsignedInt:
+                memcpy(dst, src.data, sizeof(uint32_t) * n);
+                return;
+            case ComponentType::UnsignedByte:
+                ConvertU8ToU32(dst, src.data, n);
+                return;
+            case ComponentType::UnsignedShort:
+                ConvertU16ToU32(dst, reinterpret_cast<const uint16_t*>(src.data), n);
+                return;
+            default:
+                break;
+            }
+        }
+
+        const auto componentSize = GetComponentSize(src.componentType);
+        const auto stride = GetElementStride(src);
+        const auto count = std::min(src.componentCount, dstComponents);
+        for (size_t i = 0; i < src.count; ++i) {
+            auto element = src.data + i * stride;
+            auto out = dst + i * dstComponents;
+            uint32_t c = 0;
+            for (; c < count; ++c) {
+                out[c] = ReadComponentAsUint(element + c * componentSize, src.componentType);
+            }
+            for (; c < dstComponents; ++c) {
+                out[c] = 0;
+            }
+        }
+    }
+}
@@ -0,0 +1,40 @@
+﻿#include "util/AffineTransform.h"
+
+namespace util {
+    using namespace DirectX;
+
+    void ComputeJointPalette(
+        const XMMATRIX* invBindMatrices, const XMFLOAT3X4A* worldMatrices,
+        const uint32_t* jointIndices, size_t jointCount, FXMMATRIX mtxMeshInv,
+        XMFLOAT4X4* output)
+    {
+        const XMMATRIX meshInv = mtxMeshInv;
+        for (size_t i = 0; i < jointCount; ++i) {
+            const XMMATRIX world = XMLoadFloat3x4A(&worldMatrices[jointIndices[i]]);
+            const XMMATRIX mtx = MultiplyAffine(invBindMatrices[i], MultiplyAffine(world, meshInv));
+
+            // 転置した行列の 4 行目は (0,0,0,1) となるため、
+            //  3x4 として格納(転置される)した後に 4 行目を埋める.
+            XMStoreFloat3x4(reinterpret_cast<XMFLOAT3X4*>(&output[i]), mtx);
+            XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&output[i].m[3][0]), g_XMIdentityR3);
+        }
+    }
+
+    void ComputeJointDualQuaternions(const XMFLOAT4X4* palette, size_t jointCount, XMFLOAT4* output)
+    {
+        for (size_t i = 0; i < jointCount; ++i) {
+            // 転置して格納されているため、3x4 として読み込むと元の行列に戻る.
+            const XMMATRIX mtx = XMLoadFloat3x4(reinterpret_cast<const XMFLOAT3X4*>(&palette[i]));
+            const XMVECTOR real = XMQuaternionNormalize(XMQuaternionRotationMatrix(mtx));
+
+            // 双対部は 0.5 * t * real (t は平行移動を純虚クォータニオンとしたもの).
+            const XMVECTOR t = mtx.r[3];
+            XMVECTOR dual = XMVectorMultiplyAdd(XMVectorSplatW(real), t, XMVector3Cross(t, real));
+            dual = XMVectorSelect(XMVectorNegate(XMVector3Dot(t, real)), dual, g_XMSelect1110);
+            dual = XMVectorScale(dual, 0.5f);
+
+            XMStoreFloat4(&output[i * 2], real);
+            XMStoreFloat4(&output[i * 2 + 1], dual);
+        }
+    }
+}
@@ -0,0 +1,550 @@
+﻿#include "util/AnimationClip.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace util {
+    using namespace DirectX;
+
+    namespace {
+        // 3次エルミート補間. glTF の CUBICSPLINE の定義に従い、接線にはキー間隔を掛ける.
+        XMVECTOR HermiteInterpolate(
+            FXMVECTOR v0, FXMVECTOR outTangent0, FXMVECTOR v1, GXMVECTOR inTangent1, float t, float dt)
+        {
+            const float t2 = t * t;
+            const float t3 = t2 * t;
+            XMVECTOR result = XMVectorScale(v0, 2.0f * t3 - 3.0f * t2 + 1.0f);
+            result = XMVectorMultiplyAdd(outTangent0, XMVectorReplicate((t3 - 2.0f * t2 + t) * dt), result);
+            result = XMVectorMultiplyAdd(v1, XMVectorReplicate(-2.0f * t3 + 3.0f * t2), result);
+            result = XMVectorMultiplyAdd(inTangent1, XMVectorReplicate((t3 - t2) * dt), result);
+            return result;
+        }
+
+        XMVECTOR BlendQuaternion(FXMVECTOR q0, FXMVECTOR q1, float t, QuaternionBlend blend)
+        {
+            if (blend == QuaternionBlend::Slerp) {
+                return XMQuaternionSlerp(q0, q1, t);
+            }
+            // 最短経路となるように符号を揃えてから補間する.
+            auto sign = XMVectorSelect(
+                g_XMOne, g_XMNegativeOne, XMVectorLess(XMVector4Dot(q0, q1), XMVectorZero()));
+            return XMQuaternionNormalize(XMVectorLerp(q0, XMVectorMultiply(q1, sign), t));
+        }
+
+        const float InvSqrt2 = 0.70710678f;
+        const float PackedTimeMax = 65535.0f;
+
+        // 最大成分を除いた3成分を 15bit ずつに量子化する.
+        //  除いた成分の位置(2bit)は1, 2番目の要素の最上位ビットに格納する.
+        //  最大成分は正となるよう符号を揃えるため、復元時には残りの成分から求められる.
+        void PackRotation(FXMVECTOR q, uint16_t* dst)
+        {
+            XMFLOAT4 v;
+            XMStoreFloat4(&v, XMQuaternionNormalize(q));
+            const float c[4] = { v.x, v.y, v.z, v.w };
+            int largest = 0;
+            for (int i = 1; i < 4; ++i) {
+                if (std::fabs(c[i]) > std::fabs(c[largest])) {
+                    largest = i;
+                }
+            }
+            const float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+            uint16_t packed[3];
+            for (int i = 0, n = 0; i < 4; ++i) {
+                if (i == largest) {
+                    continue;
+                }
+                // 残りの成分は [-1/√2, 1/√2] に収まる.
+                float x = std::clamp(c[i] * sign / InvSqrt2, -1.0f, 1.0f);
+                packed[n++] = uint16_t(std::lround((x * 0.5f + 0.5f) * 32767.0f));
+            }
+            dst[0] = uint16_t(packed[0] | ((largest & 1) << 15));
+            dst[1] = uint16_t(packed[1] | ((largest >> 1) << 15));
+            dst[2] = packed[2];
+        }
+
+        XMVECTOR UnpackRotation(const uint16_t* src)
+        {
+            const int largest = (src[0] >> 15) | ((src[1] >> 15) << 1);
+            XMVECTOR v = XMVectorSet(float(src[0] & 0x7FFF), float(src[1] & 0x7FFF), float(src[2] & 0x7FFF), 0.0f);
+            v = XMVectorMultiplyAdd(v, XMVectorReplicate(2.0f / 32767.0f * InvSqrt2), XMVectorReplicate(-InvSqrt2));
+            const float w = std::sqrt(std::max(0.0f, 1.0f - XMVectorGetX(XMVector3Dot(v, v))));
+
+            // 除いた位置に最大成分を戻す.
+            XMFLOAT4 abc;
+            XMStoreFloat4(&abc, v);
+            float c[4];
+            for (int i = 0, n = 0; i < 4; ++i) {
+                c[i] = i == largest ? w : (&abc.x)[n++];
+            }
+            return XMVectorSet(c[0], c[1], c[2], c[3]);
+        }
+
+        // トラックの範囲内で各成分を 16bit に量子化する.
+        void PackRange(FXMVECTOR value, const AnimationClip::Channel& channel, uint16_t* dst)
+        {
+            XMFLOAT3 v;
+            XMStoreFloat3(&v, value);
+            const float* src = &v.x;
+            const float* minValue = &channel.rangeMin.x;
+            const float* extent = &channel.rangeExtent.x;
+            for (int i = 0; i < 3; ++i) {
+                float x = extent[i] > 0.0f ? (src[i] - minValue[i]) / extent[i] : 0.0f;
+                dst[i] = uint16_t(std::lround(std::clamp(x, 0.0f, 1.0f) * 65535.0f));
+            }
+        }
+
+        XMVECTOR UnpackRange(const uint16_t* src, const AnimationClip::Channel& channel)
+        {
+            XMVECTOR v = XMVectorSet(float(src[0]), float(src[1]), float(src[2]), 0.0f);
+            XMVECTOR scale = XMVectorScale(XMLoadFloat3(&channel.rangeExtent), 1.0f / 65535.0f);
+            return XMVectorMultiplyAdd(v, scale, XMLoadFloat3(&channel.rangeMin));
+        }
+
+        // 2つの値の差をノードの影響範囲の端での変位に換算する.
+        //  ノード単独の誤差であり、親から累積する誤差は含まない(モデル空間での誤差は MeasureObjectSpaceError で求める).
+        float MeasureError(AnimationPath path, FXMVECTOR a, FXMVECTOR b, float jointLength)
+        {
+            switch (path) {
+            case AnimationPath::Rotation: {
+                // 回転角 θ は、符号を揃えた2つのクォータニオンの差の長さ 2sin(θ/4) から求める.
+                //  内積の acos は 1 付近で float の精度が足りず、小さな角度を 0 か 3e-4 rad 以上としか区別できない.
+                const auto qa = XMQuaternionNormalize(a);
+                auto qb = XMQuaternionNormalize(b);
+                if (XMVectorGetX(XMVector4Dot(qa, qb)) < 0.0f) {
+                    qb = XMVectorNegate(qb);
+                }
+                const float chord = XMVectorGetX(XMVector4Length(XMVectorSubtract(qa, qb)));
+                return 4.0f * std::asin(std::min(chord * 0.5f, 1.0f)) * jointLength;
+            }
+            case AnimationPath::Scale:
+                return XMVectorGetX(XMVector3Length(XMVectorSubtract(a, b))) * jointLength;
+            default:
+                return XMVectorGetX(XMVector3Length(XMVectorSubtract(a, b)));
+            }
+        }
+
+        // 許容誤差内で補間により再現できるキーを取り除き、残すキーの番号を返す.
+        std::vector<uint32_t> ReduceKeys(
+            const std::vector<float>& times, const std::vector<XMVECTOR>& values,
+            AnimationPath path, AnimationInterpolation interpolation, float jointLength, float maxError)
+        {
+            const uint32_t keyCount = uint32_t(times.size());
+            std::vector<uint32_t> kept = { 0 };
+
+            // 全キーが先頭の値と同じとみなせる場合は1キーとする.
+            bool isConstant = true;
+            for (uint32_t i = 1; i < keyCount && isConstant; ++i) {
+                isConstant = MeasureError(path, values[0], values[i], jointLength) <= maxError;
+            }
+            if (isConstant) {
+                return kept;
+            }
+
+            if (interpolation == AnimationInterpolation::Step) {
+                for (uint32_t i = 1; i < keyCount; ++i) {
+                    if (MeasureError(path, values[kept.back()], values[i], jointLength) > maxError) {
+                        kept.push_back(i);
+                    }
+                }
+                return kept;
+            }
+
+            // 直前に残したキーから end までを線形補間し、間のキーを再現できなくなったら end-1 を残す.
+            uint32_t anchor = 0;
+            for (uint32_t end = 2; end < keyCount; ++end) {
+                const float span = times[end] - times[anchor];
+                for (uint32_t j = anchor + 1; j < end; ++j) {
+                    const float t = span > 0.0f ? (times[j] - times[anchor]) / span : 0.0f;
+                    auto approx = path == AnimationPath::Rotation ?
+                        BlendQuaternion(values[anchor], values[end], t, QuaternionBlend::Nlerp) :
+                        XMVectorLerp(values[anchor], values[end], t);
+                    if (MeasureError(path, approx, values[j], jointLength) > maxError) {
+                        anchor = end - 1;
+                        kept.push_back(anchor);
+                        break;
+                    }
+                }
+            }
+            if (keyCount > 1) {
+                kept.push_back(keyCount - 1);
+            }
+            return kept;
+        }
+
+        // 親が子より先に来るノードの順序.
+        std::vector<int> SortParentFirst(const AnimationSkeleton& skeleton)
+        {
+            const int nodeCount = int(skeleton.parents.size());
+            std::vector<int> order;
+            std::vector<bool> visited(nodeCount, false);
+            std::vector<int> chain;
+            for (int i = 0; i < nodeCount; ++i) {
+                // 未処理の祖先を辿ってから、根の側から順に追加する.
+                for (int node = i; node >= 0 && node < nodeCount && !visited[node]; node = skeleton.parents[node]) {
+                    visited[node] = true;
+                    chain.push_back(node);
+                }
+                order.insert(order.end(), chain.rbegin(), chain.rend());
+                chain.clear();
+            }
+            return order;
+        }
+
+        // クリップの評価結果を基本姿勢に適用し、各ノードの原点のモデル空間での位置を求める.
+        void ComputeNodePositions(
+            const AnimationClip& clip, const XMVECTOR* values, const AnimationSkeleton& skeleton,
+            const std::vector<int>& order, std::vector<XMVECTOR>& trs, std::vector<XMMATRIX>& world,
+            std::vector<XMVECTOR>& positions)
+        {
+            const size_t nodeCount = skeleton.parents.size();
+            for (size_t i = 0; i < nodeCount; ++i) {
+                trs[i * 3 + 0] = XMLoadFloat3(&skeleton.translations[i]);
+                trs[i * 3 + 1] = XMLoadFloat4(&skeleton.rotations[i]);
+                trs[i * 3 + 2] = XMLoadFloat3(&skeleton.scales[i]);
+            }
+            for (size_t i = 0; i < clip.GetChannelCount(); ++i) {
+                const auto& channel = clip.GetChannel(i);
+                if (channel.targetNode >= 0 && size_t(channel.targetNode) < nodeCount) {
+                    trs[size_t(channel.targetNode) * 3 + size_t(channel.path)] = values[i];
+                }
+            }
+            for (int node : order) {
+                const auto local = XMMatrixAffineTransformation(
+                    trs[node * 3 + 2], XMVectorZero(), trs[node * 3 + 1], trs[node * 3 + 0]);
+                const int parent = skeleton.parents[node];
+                world[node] = parent >= 0 ? XMMatrixMultiply(local, world[parent]) : local;
+                positions[node] = world[node].r[3];
+            }
+        }
+    }
+
+    float MeasureObjectSpaceError(
+        const AnimationClip& a, const AnimationClip& b,
+        const AnimationSkeleton& skeleton, const std::vector<float>& times)
+    {
+        const size_t nodeCount = skeleton.parents.size();
+        const auto order = SortParentFirst(skeleton);
+        std::vector<XMVECTOR> valuesA(a.GetChannelCount()), valuesB(b.GetChannelCount());
+        std::vector<XMVECTOR> trs(nodeCount * 3);
+        std::vector<XMMATRIX> world(nodeCount);
+        std::vector<XMVECTOR> positionsA(nodeCount), positionsB(nodeCount);
+        float maxError = 0.0f;
+        for (float time : times) {
+            a.Sample(time, valuesA.data());
+            b.Sample(time, valuesB.data());
+            ComputeNodePositions(a, valuesA.data(), skeleton, order, trs, world, positionsA);
+            ComputeNodePositions(b, valuesB.data(), skeleton, order, trs, world, positionsB);
+            for (size_t i = 0; i < nodeCount; ++i) {
+                maxError = std::max(maxError, XMVectorGetX(XMVector3Length(XMVectorSubtract(positionsA[i], positionsB[i]))));
+            }
+        }
+        return maxError;
+    }
+
+    float AnimationClip::WrapTime(float time) const
+    {
+        if (m_duration <= 0.0f) {
+            return 0.0f;
+        }
+        time = std::fmod(time, m_duration);
+        return time < 0.0f ? time + m_duration : time;
+    }
+
+    size_t AnimationClip::GetKeyCount() const
+    {
+        return m_isCompressed ? m_packedTimes.size() : m_times.size();
+    }
+
+    size_t AnimationClip::GetDataSize() const
+    {
+        return sizeof(Channel) * m_channels.size() +
+            sizeof(float) * m_times.size() + sizeof(XMFLOAT4) * m_values.size() +
+            sizeof(uint16_t) * (m_packedTimes.size() + m_packedValues.size());
+    }
+
+    void AnimationClip::Sample(float time, XMVECTOR* output, QuaternionBlend blend) const
+    {
+        if (m_isCompressed) {
+            for (size_t i = 0; i < m_channels.size(); ++i) {
+                output[i] = SampleCompressedChannel(m_channels[i], time, blend);
+            }
+        } else {
+            for (size_t i = 0; i < m_channels.size(); ++i) {
+                output[i] = SampleChannel(m_channels[i], time, blend);
+            }
+        }
+    }
+
+    XMVECTOR AnimationClip::SampleChannel(const Channel& channel, float time, QuaternionBlend blend) const
+    {
+        const float* times = m_times.data() + channel.keyStart;
+        const XMFLOAT4* values = m_values.data() + channel.valueStart;
+        const bool isRotation = channel.path == AnimationPath::Rotation;
+        const bool isCubic = channel.interpolation == AnimationInterpolation::CubicSpline;
+        // CubicSpline では値の本体は各キーの2番目の要素.
+        const uint32_t valueStride = isCubic ? 3 : 1;
+        const uint32_t valueOffset = isCubic ? 1 : 0;
+
+        // 範囲外は端のキーの値とする.
+        const uint32_t last = channel.keyCount - 1;
+        if (channel.keyCount == 1 || time <= times[0]) {
+            return XMLoadFloat4(&values[valueOffset]);
+        }
+        if (time >= times[last]) {
+            return XMLoadFloat4(&values[last * valueStride + valueOffset]);
+        }
+
+        // time を挟むキー区間 [k, k+1] を求める.
+        const uint32_t k = uint32_t(std::upper_bound(times, times + channel.keyCount, time) - times) - 1;
+        const float dt = times[k + 1] - times[k];
+        const float t = dt > 0.0f ? (time - times[k]) / dt : 0.0f;
+
+        const auto v0 = XMLoadFloat4(&values[k * valueStride + valueOffset]);
+        const auto v1 = XMLoadFloat4(&values[(k + 1) * valueStride + valueOffset]);
+        switch (channel.interpolation) {
+        case AnimationInterpolation::Step:
+            return v0;
+        case AnimationInterpolation::CubicSpline: {
+            auto result = HermiteInterpolate(
+                v0, XMLoadFloat4(&values[k * 3 + 2]), v1, XMLoadFloat4(&values[(k + 1) * 3 + 0]), t, dt);
+            return isRotation ? XMQuaternionNormalize(result) : result;
+        }
+        default:
+            return isRotation ? BlendQuaternion(v0, v1, t, blend) : XMVectorLerp(v0, v1, t);
+        }
+    }
+
+    XMVECTOR AnimationClip::SampleCompressedChannel(const Channel& channel, float time, QuaternionBlend blend) const
+    {
+        // 非圧縮時と同じ手順で、区間の両端のキーのみを復元する.
+        const uint16_t* times = m_packedTimes.data() + channel.keyStart;
+        const uint16_t* values = m_packedValues.data() + size_t(channel.valueStart) * 3;
+        const bool isRotation = channel.path == AnimationPath::Rotation;
+        auto decode = [&](uint32_t k) {
+            return isRotation ? UnpackRotation(values + k * 3) : UnpackRange(values + k * 3, channel);
+        };
+
+        const float packedTime = m_duration > 0.0f ? time * (PackedTimeMax / m_duration) : 0.0f;
+        const uint32_t last = channel.keyCount - 1;
+        if (channel.keyCount == 1 || packedTime <= float(times[0])) {
+            return decode(0);
+        }
+        if (packedTime >= float(times[last])) {
+            return decode(last);
+        }
+
+        const uint32_t k = uint32_t(std::upper_bound(times, times + channel.keyCount, packedTime,
+            [](float value, uint16_t key) { return value < float(key); }) - times) - 1;
+        const auto v0 = decode(k);
+        if (channel.interpolation == AnimationInterpolation::Step) {
+            return v0;
+        }
+        const float dt = float(times[k + 1]) - float(times[k]);
+        const float t = dt > 0.0f ? (packedTime - float(times[k])) / dt : 0.0f;
+        const auto v1 = decode(k + 1);
+        return isRotation ? BlendQuaternion(v0, v1, t, blend) : XMVectorLerp(v0, v1, t);
+    }
+
+    void AnimationClip::AddChannel(
+        int targetNode, AnimationPath path, AnimationInterpolation interpolation,
+        const float* times, size_t keyCount, const XMFLOAT4* values)
+    {
+        if (keyCount == 0) {
+            return;
+        }
+        const size_t valueCount = interpolation == AnimationInterpolation::CubicSpline ? keyCount * 3 : keyCount;
+
+        Channel channel;
+        channel.targetNode = targetNode;
+        channel.path = path;
+        channel.interpolation = interpolation;
+        channel.keyStart = uint32_t(m_times.size());
+        channel.keyCount = uint32_t(keyCount);
+        channel.valueStart = uint32_t(m_values.size());
+        channel.rangeMin = XMFLOAT3(0.0f, 0.0f, 0.0f);
+        channel.rangeExtent = XMFLOAT3(0.0f, 0.0f, 0.0f);
+        m_channels.push_back(channel);
+
+        m_times.insert(m_times.end(), times, times + keyCount);
+        m_values.insert(m_values.end(), values, values + valueCount);
+        m_duration = std::max(m_duration, times[keyCount - 1]);
+    }
+
+    bool AnimationClip::Assign(
+        std::vector<Channel> channels, std::vector<float> times, std::vector<XMFLOAT4> values)
+    {
+        for (const auto& channel : channels) {
+            const size_t valueCount = channel.interpolation == AnimationInterpolation::CubicSpline ?
+                size_t(channel.keyCount) * 3 : channel.keyCount;
+            if (channel.keyCount == 0 ||
+                size_t(channel.keyStart) + channel.keyCount > times.size() ||
+                size_t(channel.valueStart) + valueCount > values.size()) {
+                return false;
+            }
+        }
+        m_channels = std::move(channels);
+        m_times = std::move(times);
+        m_values = std::move(values);
+        m_packedTimes.clear();
+        m_packedValues.clear();
+        m_isCompressed = false;
+        m_duration = 0.0f;
+        for (const auto& channel : m_channels) {
+            m_duration = std::max(m_duration, m_times[channel.keyStart + channel.keyCount - 1]);
+        }
+        return true;
+    }
+
+    bool AnimationClip::AssignCompressed(
+        std::vector<Channel> channels, std::vector<uint16_t> packedTimes,
+        std::vector<uint16_t> packedValues, float duration)
+    {
+        for (const auto& channel : channels) {
+            if (channel.keyCount == 0 ||
+                channel.interpolation == AnimationInterpolation::CubicSpline ||
+                size_t(channel.keyStart) + channel.keyCount > packedTimes.size() ||
+                (size_t(channel.valueStart) + channel.keyCount) * 3 > packedValues.size()) {
+                return false;
+            }
+        }
+        m_channels = std::move(channels);
+        m_times.clear();
+        m_values.clear();
+        m_packedTimes = std::move(packedTimes);
+        m_packedValues = std::move(packedValues);
+        m_duration = duration;
+        m_isCompressed = true;
+        return true;
+    }
+
+    void AnimationClip::Compress(
+        const AnimationCompressSettings& settings, const std::vector<float>& jointLengths,
+        AnimationCompressReport* report, const AnimationSkeleton* skeleton)
+    {
+        if (m_isCompressed) {
+            return;
+        }
+        AnimationCompressReport result;
+        result.sourceBytes = GetDataSize();
+        result.sourceKeys = GetKeyCount();
+
+        auto getJointLength = [&](int node) {
+            float length = settings.minimumJointLength;
+            if (node >= 0 && node < int(jointLengths.size())) {
+                length = std::max(length, jointLengths[node]);
+            }
+            return length;
+        };
+        // 許容誤差の半分をキーの削減に、残りを量子化の誤差に充てる.
+        const float reductionError = settings.maxError * 0.5f;
+        const float timeScale = m_duration > 0.0f ? PackedTimeMax / m_duration : 0.0f;
+
+        std::vector<Channel> channels;
+        std::vector<uint16_t> packedTimes, packedValues;
+        std::vector<float> times;
+        std::vector<XMVECTOR> values;
+        for (const auto& src : m_channels) {
+            // CubicSpline は区間を分割して線形補間のキー列に変換する.
+            times.clear();
+            values.clear();
+            if (src.interpolation == AnimationInterpolation::CubicSpline) {
+                const uint32_t subdivision = std::max(settings.cubicSubdivision, 1u);
+                for (uint32_t k = 0; k < src.keyCount; ++k) {
+                    const float t0 = m_times[src.keyStart + k];
+                    const uint32_t steps = k + 1 < src.keyCount ? subdivision : 1;
+                    for (uint32_t s = 0; s < steps; ++s) {
+                        const float t1 = k + 1 < src.keyCount ? m_times[src.keyStart + k + 1] : t0;
+                        const float time = t0 + (t1 - t0) * float(s) / float(steps);
+                        times.push_back(time);
+                        values.push_back(SampleChannel(src, time, QuaternionBlend::Nlerp));
+                    }
+                }
+            } else {
+                for (uint32_t k = 0; k < src.keyCount; ++k) {
+                    times.push_back(m_times[src.keyStart + k]);
+                    values.push_back(XMLoadFloat4(&m_values[src.valueStart + k]));
+                }
+            }
+
+            Channel dst = src;
+            if (dst.interpolation == AnimationInterpolation::CubicSpline) {
+                dst.interpolation = AnimationInterpolation::Linear;
+            }
+            auto kept = ReduceKeys(times, values, src.path, dst.interpolation, getJointLength(src.targetNode), reductionError);
+            dst.keyStart = uint32_t(packedTimes.size());
+            dst.keyCount = uint32_t(kept.size());
+            dst.valueStart = uint32_t(packedValues.size() / 3);
+
+            // 平行移動・スケールは残したキーの範囲で量子化する.
+            dst.rangeMin = XMFLOAT3(0.0f, 0.0f, 0.0f);
+            dst.rangeExtent = XMFLOAT3(0.0f, 0.0f, 0.0f);
+            if (src.path != AnimationPath::Rotation) {
+                XMVECTOR minValue = values[kept[0]];
+                XMVECTOR maxValue = minValue;
+                for (auto index : kept) {
+                    minValue = XMVectorMin(minValue, values[index]);
+                    maxValue = XMVectorMax(maxValue, values[index]);
+                }
+                XMStoreFloat3(&dst.rangeMin, minValue);
+                XMStoreFloat3(&dst.rangeExtent, XMVectorSubtract(maxValue, minValue));
+            }
+
+            for (auto index : kept) {
+                packedTimes.push_back(uint16_t(std::lround(std::clamp(times[index] * timeScale, 0.0f, PackedTimeMax))));
+                uint16_t packed[3];
+                if (src.path == AnimationPath::Rotation) {
+                    PackRotation(values[index], packed);
+                } else {
+                    PackRange(values[index], dst, packed);
+                }
+                packedValues.insert(packedValues.end(), packed, packed + 3);
+            }
+            channels.push_back(dst);
+        }
+
+        AnimationClip compressed;
+        compressed.AssignCompressed(channels, packedTimes, packedValues, m_duration);
+
+        // 元のキー時刻とその中間で両者を評価し、誤差と評価時間を求める.
+        std::vector<float> sampleTimes(m_times);
+        std::sort(sampleTimes.begin(), sampleTimes.end());
+        sampleTimes.erase(std::unique(sampleTimes.begin(), sampleTimes.end()), sampleTimes.end());
+        for (size_t i = 1, count = sampleTimes.size(); i < count; ++i) {
+            sampleTimes.push_back((sampleTimes[i - 1] + sampleTimes[i]) * 0.5f);
+        }
+        const size_t channelCount = m_channels.size();
+        std::vector<XMVECTOR> sourceValues(sampleTimes.size() * channelCount);
+        std::vector<XMVECTOR> compressedValues(sampleTimes.size() * channelCount);
+        if (channelCount > 0 && !sampleTimes.empty()) {
+            auto timeStart = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < sampleTimes.size(); ++i) {
+                Sample(sampleTimes[i], &sourceValues[i * channelCount]);
+            }
+            auto timeMiddle = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < sampleTimes.size(); ++i) {
+                compressed.Sample(sampleTimes[i], &compressedValues[i * channelCount]);
+            }
+            auto timeEnd = std::chrono::high_resolution_clock::now();
+            result.sourceSampleUs = std::chrono::duration<double, std::micro>(timeMiddle - timeStart).count() / sampleTimes.size();
+            result.compressedSampleUs = std::chrono::duration<double, std::micro>(timeEnd - timeMiddle).count() / sampleTimes.size();
+
+            for (size_t i = 0; i < sourceValues.size(); ++i) {
+                const auto& channel = m_channels[i % channelCount];
+                result.maxError = std::max(result.maxError, MeasureError(
+                    channel.path, sourceValues[i], compressedValues[i], getJointLength(channel.targetNode)));
+            }
+            if (skeleton) {
+                result.maxObjectError = MeasureObjectSpaceError(*this, compressed, *skeleton, sampleTimes);
+            }
+        }
+
+        AssignCompressed(std::move(channels), std::move(packedTimes), std::move(packedValues), m_duration);
+        result.compressedBytes = GetDataSize();
+        result.compressedKeys = GetKeyCount();
+        if (report) {
+            *report = result;
+        }
+    }
+}
@@ -0,0 +1,160 @@
+﻿#include "util/CpuSkinning.h"
+#include "util/AffineTransform.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace util {
+    using namespace DirectX;
+
+    namespace {
+        // 関節行列は転置して格納されているため、先頭 3 行が元の行列の各列となる.
+        inline void XM_CALLCONV AccumulateJoint(
+            const XMFLOAT4X4& joint, float weight, XMVECTOR& c0, XMVECTOR& c1, XMVECTOR& c2)
+        {
+            const XMVECTOR w = XMVectorReplicate(weight);
+            c0 = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&joint.m[0][0])), w, c0);
+            c1 = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&joint.m[1][0])), w, c1);
+            c2 = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&joint.m[2][0])), w, c2);
+        }
+
+        // 最初の関節と同じ向きにそろえて加算する.
+        //  q と -q は同じ回転を表すが、そのまま足すと打ち消し合うため.
+        inline void XM_CALLCONV AccumulateDualQuaternion(
+            const XMFLOAT4* joint, float weight, FXMVECTOR pivot, XMVECTOR& real, XMVECTOR& dual)
+        {
+            const XMVECTOR r = XMLoadFloat4(&joint[0]);
+            const XMVECTOR d = XMLoadFloat4(&joint[1]);
+            XMVECTOR w = XMVectorReplicate(weight);
+            w = XMVectorSelect(w, XMVectorNegate(w), XMVectorLess(XMVector4Dot(pivot, r), XMVectorZero()));
+            real = XMVectorMultiplyAdd(r, w, real);
+            dual = XMVectorMultiplyAdd(d, w, dual);
+        }
+
+        // 全頂点を threadCount 個の連続した範囲に分け、並列に処理する.
+        //  先頭の範囲は呼び出したスレッドで処理する.
+        template<class Func>
+        void ForEachVertexRange(size_t vertexCount, uint32_t threadCount, Func func)
+        {
+            if (threadCount == 0) {
+                threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+            }
+            const size_t rangeCount = std::max<size_t>(std::min<size_t>(threadCount, vertexCount), 1);
+            const size_t rangeSize = (vertexCount + rangeCount - 1) / rangeCount;
+            std::vector<std::thread> threads;
+            threads.reserve(rangeCount - 1);
+            for (size_t i = 1; i < rangeCount; ++i) {
+                threads.emplace_back(func, i * rangeSize, rangeSize);
+            }
+            func(size_t(0), rangeSize);
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+    }
+
+    void BuildJointData(
+        const XMMATRIX* invBindMatrices, const XMFLOAT3X4A* worldMatrices,
+        const uint32_t* jointIndices, size_t jointCount, FXMMATRIX mtxMeshInv,
+        SkinningMethod method, std::vector<XMFLOAT4X4>& palette, void* output)
+    {
+        if (method == SkinningMethod::DualQuaternion) {
+            palette.resize(jointCount);
+            ComputeJointPalette(
+                invBindMatrices, worldMatrices, jointIndices, jointCount, mtxMeshInv, palette.data());
+            ComputeJointDualQuaternions(palette.data(), jointCount, static_cast<XMFLOAT4*>(output));
+        } else {
+            ComputeJointPalette(
+                invBindMatrices, worldMatrices, jointIndices, jointCount, mtxMeshInv, static_cast<XMFLOAT4X4*>(output));
+        }
+    }
+
+    void SkinVertices(
+        const SkinningStreams& src, const XMFLOAT4X4* palette,
+        size_t first, size_t count,
+        XMFLOAT3* dstPositions, XMFLOAT3* dstNormals)
+    {
+        const size_t last = std::min(first + count, src.vertexCount);
+        for (size_t v = first; v < last; ++v) {
+            const auto& joints = src.jointIndices[v];
+            const auto& weights = src.jointWeights[v];
+
+            // 4 つの関節行列をウェイトで合成する.
+            XMVECTOR c0 = XMVectorZero(), c1 = XMVectorZero(), c2 = XMVectorZero();
+            AccumulateJoint(palette[joints.x], weights.x, c0, c1, c2);
+            AccumulateJoint(palette[joints.y], weights.y, c0, c1, c2);
+            AccumulateJoint(palette[joints.z], weights.z, c0, c1, c2);
+            AccumulateJoint(palette[joints.w], weights.w, c0, c1, c2);
+
+            // 列のまま並べて転置し、行ベクトルを掛ける形にする.
+            XMMATRIX columns;
+            columns.r[0] = c0;
+            columns.r[1] = c1;
+            columns.r[2] = c2;
+            columns.r[3] = g_XMIdentityR3;
+            const XMMATRIX mtx = XMMatrixTranspose(columns);
+
+            const XMVECTOR position = XMVector3Transform(XMLoadFloat3(&src.positions[v]), mtx);
+            const XMVECTOR normal = XMVector3TransformNormal(XMLoadFloat3(&src.normals[v]), mtx);
+            XMStoreFloat3(&dstPositions[v], position);
+            XMStoreFloat3(&dstNormals[v], XMVector3Normalize(normal));
+        }
+    }
+
+    void SkinVerticesParallel(
+        const SkinningStreams& src, const XMFLOAT4X4* palette,
+        XMFLOAT3* dstPositions, XMFLOAT3* dstNormals,
+        uint32_t threadCount)
+    {
+        ForEachVertexRange(src.vertexCount, threadCount,
+            [&](size_t first, size_t count) {
+                SkinVertices(src, palette, first, count, dstPositions, dstNormals);
+            });
+    }
+
+    void SkinVerticesDualQuaternion(
+        const SkinningStreams& src, const XMFLOAT4* dualQuaternions,
+        size_t first, size_t count,
+        XMFLOAT3* dstPositions, XMFLOAT3* dstNormals)
+    {
+        const size_t last = std::min(first + count, src.vertexCount);
+        for (size_t v = first; v < last; ++v) {
+            const auto& joints = src.jointIndices[v];
+            const auto& weights = src.jointWeights[v];
+
+            const XMVECTOR pivot = XMLoadFloat4(&dualQuaternions[joints.x * 2]);
+            XMVECTOR real = XMVectorZero(), dual = XMVectorZero();
+            AccumulateDualQuaternion(&dualQuaternions[joints.x * 2], weights.x, pivot, real, dual);
+            AccumulateDualQuaternion(&dualQuaternions[joints.y * 2], weights.y, pivot, real, dual);
+            AccumulateDualQuaternion(&dualQuaternions[joints.z * 2], weights.z, pivot, real, dual);
+            AccumulateDualQuaternion(&dualQuaternions[joints.w * 2], weights.w, pivot, real, dual);
+
+            // 実部の長さで正規化する.
+            const XMVECTOR invLength = XMVectorReciprocal(XMVector4Length(real));
+            real = XMVectorMultiply(real, invLength);
+            dual = XMVectorMultiply(dual, invLength);
+
+            // 平行移動は 2 * dual * conj(real) のベクトル部.
+            XMVECTOR translation = XMVectorMultiply(XMVectorSplatW(real), dual);
+            translation = XMVectorNegativeMultiplySubtract(XMVectorSplatW(dual), real, translation);
+            translation = XMVectorAdd(translation, XMVector3Cross(real, dual));
+            translation = XMVectorAdd(translation, translation);
+
+            const XMVECTOR position = XMVectorAdd(XMVector3Rotate(XMLoadFloat3(&src.positions[v]), real), translation);
+            const XMVECTOR normal = XMVector3Rotate(XMLoadFloat3(&src.normals[v]), real);
+            XMStoreFloat3(&dstPositions[v], position);
+            XMStoreFloat3(&dstNormals[v], XMVector3Normalize(normal));
+        }
+    }
+
+    void SkinVerticesDualQuaternionParallel(
+        const SkinningStreams& src, const XMFLOAT4* dualQuaternions,
+        XMFLOAT3* dstPositions, XMFLOAT3* dstNormals,
+        uint32_t threadCount)
+    {
+        ForEachVertexRange(src.vertexCount, threadCount,
+            [&](size_t first, size_t count) {
+                SkinVerticesDualQuaternion(src, dualQuaternions, first, count, dstPositions, dstNormals);
+            });
+    }
+}
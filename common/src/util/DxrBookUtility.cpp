@@ -21,6 +21,80 @@ namespace util {
         return true;
     }
 
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+    bool MappedFile::Open(const std::wstring& fileName)
+    {
+        Close();
+        m_file = CreateFileW(
+            fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER fileSize{};
+        if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0) {
+            Close();
+            return false;
+        }
+        m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping == nullptr) {
+            Close();
+            return false;
+        }
+        m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (m_data == nullptr) {
+            Close();
+            return false;
+        }
+        m_size = size_t(fileSize.QuadPart);
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (m_data) {
+            UnmapViewOfFile(m_data);
+            m_data = nullptr;
+        }
+        if (m_mapping) {
+            CloseHandle(m_mapping);
+            m_mapping = nullptr;
+        }
+        if (m_file != INVALID_HANDLE_VALUE) {
+            CloseHandle(m_file);
+            m_file = INVALID_HANDLE_VALUE;
+        }
+        m_size = 0;
+    }
+
+    uint64_t ComputeHash64(const void* data, size_t size, uint64_t seed)
+    {
+        const uint64_t Prime = 0x100000001b3ull;
+        auto src = static_cast<const uint8_t*>(data);
+        uint64_t hash = seed;
+
+        // 8 oCgPʂł܂Ƃ߂ďA[̓oCgPʂŏ.
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+            uint64_t v;
+            memcpy(&v, src + i, sizeof(v));
+            hash ^= v;
+            hash *= Prime;
+            hash ^= hash >> 29;
+        }
+        for (; i < size; ++i) {
+            hash ^= src[i];
+            hash *= Prime;
+        }
+        hash ^= uint64_t(size);
+        hash *= Prime;
+        return hash;
+    }
+
     AccelerationStructureBuffers CreateAccelerationStructure(
         std::unique_ptr<dx12::GraphicsDevice>& device,
         const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC& asDesc)
@@ -143,6 +217,23 @@ namespace util {
             resource, &srvDesc);
     }
 
+    dx12::Descriptor CreateByteAddressSRV(
+        std::unique_ptr<dx12::GraphicsDevice>& device,
+        ComPtr<ID3D12Resource> resource,
+        UINT numElements, UINT firstElement)
+    {
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+        srvDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srvDesc.Buffer.NumElements = numElements;
+        srvDesc.Buffer.FirstElement = firstElement;
+        srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
+
+        return device->CreateShaderResourceView(
+            resource, &srvDesc);
+    }
+
     dx12::Descriptor CreateStructuredUAV(
         std::unique_ptr<dx12::GraphicsDevice>& device,
         ComPtr<ID3D12Resource> resource,
@@ -178,7 +269,7 @@ namespace util {
         triangles.IndexBuffer = mesh.indexBuffer->GetGPUVirtualAddress();
         triangles.IndexCount = mesh.indexCount;
         triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
-        triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
+        triangles.IndexFormat = mesh.indexFormat;
         return geometryDesc;
     }
 
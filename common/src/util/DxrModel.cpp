@@ -1,9 +1,13 @@
 ﻿#include "util/DxrModel.h"
 #include <DirectXMath.h>
 #include <filesystem>
+#include <chrono>
 #include <fstream>
 #include <vector>
 #include <queue>
+#include <algorithm>
+#include <execution>
+#include <functional>
 
 #define TINYGLTF_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -14,6 +18,8 @@
 #include "DxrBookFramework.h"
 #include "util/DxrBookUtility.h"
 #include "util/TextureResource.h"
+#include "util/AccessorDecoder.h"
+#include "util/AffineTransform.h"
 
 namespace util {
     using namespace DirectX;
@@ -34,6 +40,192 @@ namespace util {
         return XMLoadFloat4(&v);
     }
 
+    // GLB ファイル内の BIN チャンクの先頭を求める.
+    //  見つからない場合には nullptr を返す.
+    static const uint8_t* FindGlbBinChunk(const uint8_t* data, size_t size) {
+        const uint32_t GlbMagic = 0x46546C67;  // "glTF"
+        const uint32_t ChunkTypeBIN = 0x004E4942;
+        const size_t HeaderSize = 12;
+        const size_t ChunkHeaderSize = 8;
+        if (data == nullptr || size < HeaderSize) {
+            return nullptr;
+        }
+        uint32_t header[3];
+        memcpy(header, data, sizeof(header));
+        if (header[0] != GlbMagic) {
+            return nullptr;
+        }
+        size_t offset = HeaderSize;
+        while (offset + ChunkHeaderSize <= size) {
+            uint32_t chunk[2]; // [0]:長さ, [1]:種類.
+            memcpy(chunk, data + offset, sizeof(chunk));
+            offset += ChunkHeaderSize;
+            if (offset + chunk[0] > size) {
+                break;
+            }
+            if (chunk[1] == ChunkTypeBIN) {
+                return data + offset;
+            }
+            offset += chunk[0];
+        }
+        return nullptr;
+    }
+
+    // アクセサが指すデータの配置を求める.
+    //  バッファの実データを直接参照するためコピーは発生しない.
+    static AccessorLayout GetAccessorLayout(
+        const Model& model, const Accessor& acc, const std::vector<const uint8_t*>& buffers) {
+        AccessorLayout layout;
+        layout.count = acc.count;
+        layout.componentType = static_cast<ComponentType>(acc.componentType);
+        layout.componentCount = uint32_t(GetNumComponentsInType(acc.type));
+        layout.normalized = acc.normalized;
+        if (acc.bufferView >= 0) {
+            const auto& view = model.bufferViews[acc.bufferView];
+            layout.data = buffers[view.buffer] + view.byteOffset + acc.byteOffset;
+            layout.stride = view.byteStride;
+        }
+        return layout;
+    }
+
+    // 頂点属性の形式ごとの1頂点あたりのバイト数.
+    static size_t GetVertexFormatSize(DXGI_FORMAT format) {
+        switch (format) {
+        case DXGI_FORMAT_R32G32B32_FLOAT:
+            return sizeof(float) * 3;
+        case DXGI_FORMAT_R32G32_FLOAT:
+            return sizeof(float) * 2;
+        case DXGI_FORMAT_R16G16_SNORM:
+        case DXGI_FORMAT_R16G16_FLOAT:
+            return sizeof(uint16_t) * 2;
+        case DXGI_FORMAT_R32G32B32A32_UINT:
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            return sizeof(uint32_t) * 4;
+        case DXGI_FORMAT_R8G8B8A8_UINT:
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+            return sizeof(uint8_t) * 4;
+        default:
+            return 0;
+        }
+    }
+
+    // 全ての頂点属性ストリームに対して処理を行う.
+    template<class Visitor, class Func>
+    static void ForEachVertexStream(Visitor& visitor, Func func) {
+        func(visitor.positionBuffer);
+        func(visitor.normalBuffer);
+        func(visitor.texcoordBuffer);
+        func(visitor.jointBuffer);
+        func(visitor.weightBuffer);
+    }
+
+    // プリミティブ単位の処理を、parallel 指定時は並列に、それ以外は順に行う.
+    template<class Iterator, class Func>
+    static void ForEachPrimitive(bool parallel, Iterator first, Iterator last, Func func) {
+        if (parallel) {
+            std::for_each(std::execution::par, first, last, func);
+        } else {
+            std::for_each(first, last, func);
+        }
+    }
+
+    // ベイク済みモデルキャッシュ(.dxrmodel)の識別子とバージョン.
+    static const uint32_t ModelCacheMagic = 0x4D525844;  // "DXRM"
+    static const uint32_t ModelCacheVersion = 11;
+    static const size_t ModelCacheAlignment = 16;
+    static size_t AlignCacheOffset(size_t offset) {
+        return (offset + ModelCacheAlignment - 1) & ~(ModelCacheAlignment - 1);
+    }
+
+    // キャッシュファイルへの書き出し.
+    //  配列は要素数と実データの組で格納し、実データは読み込み時に
+    //  そのまま参照できるよう 16 バイト境界へ揃える.
+    class CacheWriter {
+    public:
+        CacheWriter(std::ofstream& stream) : m_stream(stream) { }
+
+        template<class T>
+        void Write(const T& value) {
+            WriteBytes(&value, sizeof(T));
+        }
+        template<class T>
+        void WriteArray(const T* data, size_t count) {
+            Write(uint64_t(count));
+            Align();
+            WriteBytes(data, sizeof(T) * count);
+        }
+        void WriteString(const std::wstring& str) {
+            Write(uint32_t(str.size()));
+            WriteBytes(str.data(), sizeof(wchar_t) * str.size());
+        }
+        bool IsGood() const { return m_stream.good(); }
+    private:
+        void WriteBytes(const void* data, size_t size) {
+            if (size > 0) {
+                m_stream.write(static_cast<const char*>(data), size);
+                m_offset += size;
+            }
+        }
+        void Align() {
+            const char padding[ModelCacheAlignment] = { 0 };
+            WriteBytes(padding, AlignCacheOffset(m_offset) - m_offset);
+        }
+        std::ofstream& m_stream;
+        size_t m_offset = 0;
+    };
+
+    // キャッシュファイルからの読み込み.
+    //  範囲外の読み取りが発生した場合にはエラー状態となる.
+    class CacheReader {
+    public:
+        CacheReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) { }
+
+        template<class T>
+        T Read() {
+            T value{};
+            if (auto src = Consume(sizeof(T)); src != nullptr) {
+                memcpy(&value, src, sizeof(T));
+            }
+            return value;
+        }
+        template<class T>
+        const T* ReadArray(size_t& count) {
+            count = size_t(Read<uint64_t>());
+            m_offset = AlignCacheOffset(m_offset);
+            if (count > m_size / sizeof(T)) {
+                m_isGood = false;
+            }
+            auto src = m_isGood ? Consume(sizeof(T) * count) : nullptr;
+            if (src == nullptr) {
+                count = 0;
+            }
+            return reinterpret_cast<const T*>(src);
+        }
+        std::wstring ReadString() {
+            auto length = Read<uint32_t>();
+            auto src = Consume(sizeof(wchar_t) * length);
+            if (src == nullptr) {
+                return std::wstring();
+            }
+            return std::wstring(reinterpret_cast<const wchar_t*>(src), length);
+        }
+        bool IsGood() const { return m_isGood; }
+    private:
+        const uint8_t* Consume(size_t size) {
+            if (!m_isGood || m_offset > m_size || size > m_size - m_offset) {
+                m_isGood = false;
+                return nullptr;
+            }
+            auto src = m_data + m_offset;
+            m_offset += size;
+            return src;
+        }
+        const uint8_t* m_data;
+        size_t m_size;
+        size_t m_offset = 0;
+        bool m_isGood = true;
+    };
+
     DxrModel::Node::Node() {
         translation = XMVectorZero();
         scale = XMVectorSet(1.0f, 1.0f, 1.0f, 0.0f);
@@ -51,10 +243,13 @@ namespace util {
     DxrModel::~DxrModel() {
     }
     void DxrModel::Destroy(std::unique_ptr<dx12::GraphicsDevice>& device) {
+        // テクスチャは他のモデルと共有されるため、参照のみを解放する.
+        auto& cache = util::TextureCache::GetInstance();
         for (auto& t : m_textures) {
-            device->DeallocateDescriptor(t.srv);
+            cache.Release(t, device);
         }
-        device->DeallocateDescriptor(m_whiteTex.srv);
+        cache.Release(m_whiteTex, device);
+        m_sharedGeometry.reset();
         m_textures.clear();
         m_nodes.clear();
     }
@@ -62,9 +257,15 @@ namespace util {
     bool DxrModel::LoadFromGltf(
         const std::wstring& fileName, std::unique_ptr<dx12::GraphicsDevice>& device)
     {
+        return LoadFromGltf(fileName, device, ImportSettings());
+    }
+
+    bool DxrModel::LoadFromGltf(
+        const std::wstring& fileName, std::unique_ptr<dx12::GraphicsDevice>& device,
+        const ImportSettings& settings)
+    {
+        const auto timeStart = std::chrono::high_resolution_clock::now();
         std::filesystem::path filePath(fileName);
-        std::vector<char> buffer;
-        util::LoadFile(buffer, fileName);
 
         std::string baseDir;
         if (filePath.is_relative()) {
@@ -74,14 +275,94 @@ namespace util {
         }
         baseDir = filePath.parent_path().string();
 
+        // ファイルの内容を参照する.
+        //  メモリマップが使えない場合には従来通りメモリへ読み込む.
+        //  キャッシュから読み込める場合には元ファイルの内容は参照しない.
+        util::MappedFile mappedFile;
+        std::vector<char> buffer;
+        const uint8_t* fileData = nullptr;
+        size_t fileSize = 0;
+        auto openSourceFile = [&]() {
+            if (fileData != nullptr) {
+                return;
+            }
+            if (settings.useFileMapping && mappedFile.Open(fileName)) {
+                fileData = mappedFile.GetData();
+                fileSize = mappedFile.GetSize();
+            } else {
+                util::LoadFile(buffer, fileName);
+                fileData = reinterpret_cast<const uint8_t*>(buffer.data());
+                fileSize = buffer.size();
+            }
+        };
+
+        // ベイク済みのキャッシュが元ファイルと一致していれば、そちらから読み込む.
+        std::filesystem::path cachePath = filePath;
+        cachePath.replace_extension(L".dxrmodel");
+        CacheStamp stamp;
+        if (settings.useModelCache) {
+            // 読み込み時の加工の設定が変わった場合にも作り直す.
+            const float options[] = {
+                float(settings.allowIndex16), float(settings.optimizeMeshes),
+                float(settings.weldVertices), settings.weldEpsilon,
+                float(settings.compressAttributes), float(settings.maxClusterTriangles),
+                float(settings.compressAnimations), settings.animationCompression.maxError,
+                settings.animationCompression.minimumJointLength,
+                float(settings.animationCompression.cubicSubdivision),
+                float(settings.compressSkinWeights), settings.skinWeightThreshold,
+            };
+            stamp.settingsHash = util::ComputeHash64(options, sizeof(options));
+            std::error_code ec;
+            stamp.sourceSize = uint64_t(std::filesystem::file_size(filePath, ec));
+            stamp.sourceWriteTime = uint64_t(std::filesystem::last_write_time(filePath, ec).time_since_epoch().count());
+
+            util::MappedFile cacheFile;
+            CacheStamp cached;
+            if (cacheFile.Open(cachePath.wstring()) &&
+                ReadCacheStamp(cacheFile.GetData(), cacheFile.GetSize(), cached) &&
+                cached.settingsHash == stamp.settingsHash && cached.sourceSize == stamp.sourceSize) {
+                // サイズと更新日時が一致すれば、元ファイルの内容は読まずにキャッシュを使用する.
+                //  更新日時のみ異なる場合(コピーやチェックアウトなど)は、内容のハッシュ値で照合する.
+                bool isValid = cached.sourceWriteTime == stamp.sourceWriteTime;
+                bool isStampChanged = false;
+                if (!isValid) {
+                    openSourceFile();
+                    stamp.sourceHash = util::ComputeHash64(fileData, fileSize);
+                    isValid = stamp.sourceHash == cached.sourceHash;
+                    isStampChanged = isValid;
+                }
+
+                VertexStreamSource streams;
+                std::vector<ImageSource> images;
+                if (isValid && LoadCache(cacheFile.GetData(), cacheFile.GetSize(), streams, images)) {
+                    BuildNodeIndex();
+                    CreateVertexBuffers(device, streams, settings.keepSkinningSource);
+                    CreateTextures(device, images, settings);
+                    m_whiteTex = util::TextureCache::GetInstance().LoadFromFile(L"white.png", device);
+
+                    // 次回からは更新日時の比較のみで済むよう、キャッシュ側の日時を更新する.
+                    if (isStampChanged) {
+                        cacheFile.Close();
+                        if (!UpdateCacheStamp(cachePath.wstring(), stamp)) {
+                            OutputDebugStringW(L"Failed to update model cache stamp.\n");
+                        }
+                    }
+                    OutputLoadTime(fileName, timeStart, L"cache");
+                    return true;
+                }
+            }
+        }
+
+        openSourceFile();
+        const wchar_t* loadMode = mappedFile.GetData() ? L"mapped" : L"copied";
+
         std::string err, warn;
         TinyGLTF loader;
         Model model;
         bool result = false;
         if (filePath.extension() == L".glb") {
-            result = loader.LoadBinaryFromMemory(&model, &err, &warn, 
-                reinterpret_cast<const uint8_t*>(buffer.data()),
-                uint32_t(buffer.size()), baseDir);
+            result = loader.LoadBinaryFromMemory(&model, &err, &warn,
+                fileData, uint32_t(fileSize), baseDir);
         }
         if (!warn.empty()) {
             OutputDebugStringA(warn.c_str());
@@ -93,105 +374,794 @@ namespace util {
             return false;
         }
 
-        VertexAttributeVisitor visitor;
+        // 各バッファの実データの参照先を決める.
+        //  メモリマップ時は BIN チャンクを直接参照し、tinygltf 側のコピーは解放する.
+        BufferTable buffers(model.buffers.size());
+        for (size_t i = 0; i < model.buffers.size(); ++i) {
+            buffers[i] = model.buffers[i].data.data();
+        }
+        if (mappedFile.GetData() != nullptr && !model.buffers.empty() && model.buffers[0].uri.empty()) {
+            if (auto binChunk = FindGlbBinChunk(fileData, fileSize); binChunk != nullptr) {
+                buffers[0] = binChunk;
+                std::vector<unsigned char>().swap(model.buffers[0].data);
+            }
+        }
+
+        ImportedStreams imported;
+        VertexStreamSource streams;
+        ImportGltf(model, buffers, settings, imported, streams);
+        CreateVertexBuffers(device, streams, settings.keepSkinningSource);
+
+        std::vector<ImageSource> images;
+        for (auto& texture : model.textures) {
+            const auto& image = model.images[texture.source];
+            const auto& view = model.bufferViews[image.bufferView];
+            ImageSource src;
+            src.name = util::ConvertFromUTF8(image.name);
+            src.data = buffers[view.buffer] + view.byteOffset;
+            src.size = view.byteLength;
+            images.emplace_back(src);
+        }
+        CreateTextures(device, images, settings);
+
+        // 次回以降の読み込み用にベイクしておく.
+        if (settings.useModelCache) {
+            stamp.sourceHash = util::ComputeHash64(fileData, fileSize);
+            if (!SaveCache(cachePath.wstring(), stamp, streams, images)) {
+                OutputDebugStringW(L"Failed to write model cache.\n");
+            }
+        }
+
+        m_whiteTex = util::TextureCache::GetInstance().LoadFromFile(L"white.png", device);
+
+        OutputLoadTime(fileName, timeStart, loadMode);
+        return true;
+    }
+
+    void DxrModel::ImportGltf(
+        const tinygltf::Model& model, const BufferTable& buffers, const ImportSettings& settings,
+        ImportedStreams& imported, VertexStreamSource& streams)
+    {
+        auto& visitor = imported.visitor;
         const auto& scene = model.scenes[0];
         for (const auto& nodeIndex : scene.nodes) {
             m_rootNodes.push_back(nodeIndex);
         }
 
         LoadNode(model);
-        LoadMesh(model, visitor);
+        BuildNodeIndex();
+        LoadMesh(model, buffers, settings, visitor);
 
-        LoadSkin(model);
+        LoadSkin(model, buffers);
         LoadMaterial(model);
+        LoadAnimation(model, buffers);
+        if (settings.compressAnimations) {
+            CompressAnimations(settings.animationCompression);
+        }
+
+        BuildIndexStream(visitor.indexBuffer, settings.allowIndex16, imported.indexStream);
 
+        streams.indices = imported.indexStream.data();
+        streams.positions = visitor.positionBuffer.data();
+        streams.normals = visitor.normalBuffer.data();
+        streams.texcoords = visitor.texcoordBuffer.data();
+        streams.joints = visitor.jointBuffer.data();
+        streams.weights = visitor.weightBuffer.data();
+        streams.indexBufferSize = imported.indexStream.size();
+        streams.vertexCount = visitor.positionBuffer.size();
+        streams.skinVertexCount = visitor.jointBuffer.size();
+
+        if (settings.compressSkinWeights) {
+            CompressSkinWeights(visitor, settings.skinWeightThreshold, streams, imported.packedJoints, imported.packedWeights);
+        }
+        if (settings.compressAttributes) {
+            CompressAttributes(visitor, streams, imported.packedNormals, imported.packedTexcoords);
+        }
+    }
+
+    void DxrModel::CreateVertexBuffers(
+        std::unique_ptr<dx12::GraphicsDevice>& device, const VertexStreamSource& streams, bool keepSkinningSource)
+    {
         auto heapType = D3D12_HEAP_TYPE_DEFAULT;
         auto flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-        auto sizePos = sizeof(XMFLOAT3) * visitor.positionBuffer.size();
-        auto sizeNrm = sizeof(XMFLOAT3) * visitor.normalBuffer.size();
-        auto sizeTex = sizeof(XMFLOAT2) * visitor.texcoordBuffer.size();
+        auto sizePos = sizeof(XMFLOAT3) * streams.vertexCount;
+        auto sizeNrm = GetVertexFormatSize(streams.normalFormat) * streams.vertexCount;
+        auto sizeTex = GetVertexFormatSize(streams.texcoordFormat) * streams.vertexCount;
+        m_normalFormat = streams.normalFormat;
+        m_texcoordFormat = streams.texcoordFormat;
 
         // 頂点データの生成.
-        m_vertexAttrib.Position = util::CreateBuffer(device, sizePos, visitor.positionBuffer.data(), heapType, flags, L"PosBuf");
-        m_vertexAttrib.Normal = util::CreateBuffer(device, sizeNrm, visitor.normalBuffer.data(), heapType, flags, L"NormalBuf");
-        m_vertexAttrib.Texcoord = util::CreateBuffer(device, sizeTex, visitor.texcoordBuffer.data(), heapType, flags, L"TexBuf");
+        m_vertexAttrib.Position = util::CreateBuffer(device, sizePos, streams.positions, heapType, flags, L"PosBuf");
+        m_vertexAttrib.Normal = util::CreateBuffer(device, sizeNrm, streams.normals, heapType, flags, L"NormalBuf");
+        m_vertexAttrib.Texcoord = util::CreateBuffer(device, sizeTex, streams.texcoords, heapType, flags, L"TexBuf");
 
         // インデックスバッファ.
-        auto sizeIdx = sizeof(UINT) * visitor.indexBuffer.size();
-        m_indexBuffer = util::CreateBuffer(device, sizeIdx, visitor.indexBuffer.data(), heapType, flags, L"IndexBuf");
+        //  メッシュごとに 16bit/32bit が混在するため、バイト列として確保する.
+        m_indexBuffer = util::CreateBuffer(device, streams.indexBufferSize, streams.indices, heapType, flags, L"IndexBuf");
 
         // スキニングモデル用.
         if ( m_hasSkin ) {
-            auto sizeJoint = sizeof(XMUINT4) * visitor.jointBuffer.size();
-            auto sizeWeight = sizeof(XMFLOAT4) * visitor.weightBuffer.size();
-            m_vertexAttrib.JointIndices = util::CreateBuffer(device, sizeJoint, visitor.jointBuffer.data(), heapType, flags, L"JointIndices");
-            m_vertexAttrib.JointWeights = util::CreateBuffer(device, sizeWeight, visitor.weightBuffer.data(), heapType, flags, L"JointWeights");
+            auto sizeJoint = GetVertexFormatSize(streams.jointFormat) * streams.skinVertexCount;
+            auto sizeWeight = GetVertexFormatSize(streams.weightFormat) * streams.skinVertexCount;
+            m_vertexAttrib.JointIndices = util::CreateBuffer(device, sizeJoint, streams.joints, heapType, flags, L"JointIndices");
+            m_vertexAttrib.JointWeights = util::CreateBuffer(device, sizeWeight, streams.weights, heapType, flags, L"JointWeights");
             // 個数をスキニングで使用する頂点数とする.
             //   (Position と同じ個数となっているものを対象としているのでこれでよい)
-            m_skinInfo.skinVertexCount = UINT(visitor.jointBuffer.size());
+            m_skinInfo.skinVertexCount = UINT(streams.skinVertexCount);
+
+            // シェーダーで関節番号とウェイトの形式を判別するための定数.
+            const bool isPacked = streams.jointFormat == DXGI_FORMAT_R8G8B8A8_UINT;
+            //  群衆では Actor ごとに関節データと変換後の頂点をずらして参照するため、1体あたりの数も持たせる.
+            struct SkinningParameters {
+                UINT influenceEncoding; // 0: uint4/float4, 1: 8bit x4.
+                UINT jointCount;
+                UINT vertexCount;
+                UINT reserved;
+            } skinningParams{};
+            skinningParams.influenceEncoding = isPacked ? 1 : 0;
+            skinningParams.jointCount = UINT(m_skinInfo.joints.size());
+            skinningParams.vertexCount = m_skinInfo.skinVertexCount;
+            m_skinningParameters = util::CreateBuffer(
+                device, sizeof(skinningParams), &skinningParams, heapType, D3D12_RESOURCE_FLAG_NONE, L"SkinningParams");
+
+            // スキニングモデルの法線は float3 のまま格納されている.
+            if (keepSkinningSource) {
+                const auto count = streams.skinVertexCount;
+                const auto normals = static_cast<const XMFLOAT3*>(streams.normals);
+                auto& source = m_skinningSource;
+                source.positions.assign(streams.positions, streams.positions + count);
+                source.normals.assign(normals, normals + count);
+                if (isPacked) {
+                    source.jointIndices.resize(count);
+                    source.jointWeights.resize(count);
+                    const auto joints = static_cast<const uint32_t*>(streams.joints);
+                    const auto weights = static_cast<const uint32_t*>(streams.weights);
+                    for (size_t i = 0; i < count; ++i) {
+                        DecodeSkinInfluences(joints[i], weights[i], source.jointIndices[i], source.jointWeights[i]);
+                    }
+                } else {
+                    const auto joints = static_cast<const XMUINT4*>(streams.joints);
+                    const auto weights = static_cast<const XMFLOAT4*>(streams.weights);
+                    source.jointIndices.assign(joints, joints + count);
+                    source.jointWeights.assign(weights, weights + count);
+                }
+            }
+        }
+    }
+
+    SkinningStreams DxrModel::GetSkinningStreams() const
+    {
+        const auto& source = m_skinningSource;
+        SkinningStreams streams;
+        streams.positions = source.positions.data();
+        streams.normals = source.normals.data();
+        streams.jointIndices = source.jointIndices.data();
+        streams.jointWeights = source.jointWeights.data();
+        streams.vertexCount = source.positions.size();
+        return streams;
+    }
+
+    void DxrModel::CompressAttributes(
+        const VertexAttributeVisitor& visitor, VertexStreamSource& streams,
+        std::vector<uint32_t>& packedNormals, std::vector<uint32_t>& packedTexcoords) const
+    {
+        const auto vertexCount = visitor.positionBuffer.size();
+        if (vertexCount == 0) {
+            return;
+        }
+        const auto normalSizeBefore = GetVertexFormatSize(streams.normalFormat) * vertexCount;
+        const auto texcoordSizeBefore = GetVertexFormatSize(streams.texcoordFormat) * vertexCount;
+
+        // スキニングでは法線を float3 として変換するため、スキンを持たない場合のみ圧縮する.
+        float maxNormalError = 0.0f;
+        if (!m_hasSkin) {
+            packedNormals.resize(vertexCount);
+            EncodeOctahedralNormals(packedNormals.data(), visitor.normalBuffer.data(), vertexCount);
+            streams.normals = packedNormals.data();
+            streams.normalFormat = DXGI_FORMAT_R16G16_SNORM;
+
+            for (size_t i = 0; i < vertexCount; ++i) {
+                auto original = XMLoadFloat3(&visitor.normalBuffer[i]);
+                if (XMVector3Equal(original, XMVectorZero())) {
+                    continue;
+                }
+                auto decoded = DecodeOctahedralNormal(packedNormals[i]);
+                auto angle = XMVectorGetX(XMVector3AngleBetweenVectors(original, XMLoadFloat3(&decoded)));
+                maxNormalError = std::max(maxNormalError, XMConvertToDegrees(angle));
+            }
+        }
 
+        float maxTexcoordError = 0.0f;
+        packedTexcoords.resize(vertexCount);
+        EncodeHalfTexcoords(packedTexcoords.data(), visitor.texcoordBuffer.data(), vertexCount);
+        streams.texcoords = packedTexcoords.data();
+        streams.texcoordFormat = DXGI_FORMAT_R16G16_FLOAT;
+        for (size_t i = 0; i < vertexCount; ++i) {
+            auto decoded = DecodeHalfTexcoord(packedTexcoords[i]);
+            const auto& original = visitor.texcoordBuffer[i];
+            maxTexcoordError = std::max(maxTexcoordError, std::abs(decoded.x - original.x));
+            maxTexcoordError = std::max(maxTexcoordError, std::abs(decoded.y - original.y));
         }
 
-        for (auto& texture : model.textures) {
-            auto image = model.images[texture.source];
-            auto fileName = util::ConvertFromUTF8(image.name);
-            auto view = model.bufferViews[image.bufferView];
-            auto offsetBytes = view.byteOffset;
-            const void* src = &model.buffers[view.buffer].data[offsetBytes];
-            UINT64 size = view.byteLength;
-            
-            auto t = util::LoadTextureFromMemory(src, size, device);
-            t.resource->SetName(fileName.c_str());
-            m_textures.emplace_back(t);
+        // 圧縮前後のメモリ量と復元誤差を出力する.
+        wchar_t message[512];
+        swprintf_s(message,
+            L"CompressAttributes: normal %zu -> %zu bytes (max error %.4f deg), texcoord %zu -> %zu bytes (max error %.6f)\n",
+            normalSizeBefore, GetVertexFormatSize(streams.normalFormat) * vertexCount, maxNormalError,
+            texcoordSizeBefore, GetVertexFormatSize(streams.texcoordFormat) * vertexCount, maxTexcoordError);
+        OutputDebugStringW(message);
+    }
+
+    void DxrModel::CompressSkinWeights(
+        VertexAttributeVisitor& visitor, float threshold, VertexStreamSource& streams,
+        std::vector<uint32_t>& packedJoints, std::vector<uint32_t>& packedWeights) const
+    {
+        const auto vertexCount = visitor.jointBuffer.size();
+        if (!m_hasSkin || vertexCount == 0 ||
+            visitor.weightBuffer.size() != vertexCount || visitor.positionBuffer.size() != vertexCount) {
+            return;
+        }
+        const auto sizeBefore =
+            (GetVertexFormatSize(streams.jointFormat) + GetVertexFormatSize(streams.weightFormat)) * vertexCount;
+
+        // 誤差の計測用に元の値を残しておく.
+        const std::vector<XMUINT4> referenceJoints = visitor.jointBuffer;
+        const std::vector<XMFLOAT4> referenceWeights = visitor.weightBuffer;
+
+        const auto prunedCount = PruneSkinWeights(
+            visitor.jointBuffer.data(), visitor.weightBuffer.data(), vertexCount, threshold);
+
+        // 関節番号が 8bit に収まる場合のみ詰める.
+        if (m_skinInfo.joints.size() <= 256) {
+            packedJoints.resize(vertexCount);
+            packedWeights.resize(vertexCount);
+            EncodeSkinInfluences(
+                packedJoints.data(), packedWeights.data(),
+                visitor.jointBuffer.data(), visitor.weightBuffer.data(), vertexCount);
+            streams.joints = packedJoints.data();
+            streams.weights = packedWeights.data();
+            streams.jointFormat = DXGI_FORMAT_R8G8B8A8_UINT;
+            streams.weightFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+            // 計測は GPU が参照する値(量子化後)で行う.
+            for (size_t i = 0; i < vertexCount; ++i) {
+                DecodeSkinInfluences(packedJoints[i], packedWeights[i], visitor.jointBuffer[i], visitor.weightBuffer[i]);
+            }
+        }
+
+        // 元のウェイトとのスキニング後の位置の差を求める.
+        //  姿勢は最初のアニメーションクリップから数か所を取り出す(クリップが無ければバインドポーズ).
+        TransformHierarchy hierarchy;
+        std::vector<int> hierarchyIndices(m_nodes.size(), TransformHierarchy::InvalidParent);
+        hierarchy.Reserve(m_nodeOrder.size());
+        for (auto index : m_nodeOrder) {
+            const auto& node = m_nodes[index];
+            const int parent = m_nodeParents[index];
+            hierarchyIndices[index] = int(hierarchy.AddNode(
+                parent < 0 ? TransformHierarchy::InvalidParent : hierarchyIndices[parent],
+                node->translation, node->rotation, node->scale));
+        }
+        std::vector<uint32_t> jointIndices;
+        for (auto joint : m_skinInfo.joints) {
+            jointIndices.push_back(uint32_t(hierarchyIndices[joint]));
+        }
+
+        SkinningStreams reference;
+        reference.positions = visitor.positionBuffer.data();
+        reference.normals = visitor.normalBuffer.data();
+        reference.jointIndices = referenceJoints.data();
+        reference.jointWeights = referenceWeights.data();
+        reference.vertexCount = vertexCount;
+        SkinningStreams compressed = reference;
+        compressed.jointIndices = visitor.jointBuffer.data();
+        compressed.jointWeights = visitor.weightBuffer.data();
+
+        const UINT poseCount = m_animations.empty() ? 1 : 16;
+        std::vector<XMVECTOR> values;
+        std::vector<XMFLOAT4X4> palette(jointIndices.size());
+        std::vector<XMFLOAT3> referencePositions(vertexCount), compressedPositions(vertexCount), normals(vertexCount);
+        float maxError = 0.0f;
+        for (UINT pose = 0; pose < poseCount; ++pose) {
+            if (!m_animations.empty()) {
+                const auto& clip = m_animations[0];
+                values.resize(clip.GetChannelCount());
+                clip.Sample(clip.GetDuration() * pose / poseCount, values.data());
+                for (size_t i = 0; i < clip.GetChannelCount(); ++i) {
+                    const auto& channel = clip.GetChannel(i);
+                    if (channel.targetNode < 0 || channel.targetNode >= int(hierarchyIndices.size())) {
+                        continue;
+                    }
+                    const auto index = uint32_t(hierarchyIndices[channel.targetNode]);
+                    switch (channel.path) {
+                    case AnimationPath::Translation:
+                        hierarchy.SetTranslation(index, values[i]);
+                        break;
+                    case AnimationPath::Rotation:
+                        hierarchy.SetRotation(index, values[i]);
+                        break;
+                    case AnimationPath::Scale:
+                        hierarchy.SetScale(index, values[i]);
+                        break;
+                    }
+                }
+            }
+            hierarchy.UpdateMatrices(XMMatrixIdentity());
+            ComputeJointPalette(
+                m_skinInfo.invBindMatrices.data(), hierarchy.GetWorldMatrices(),
+                jointIndices.data(), jointIndices.size(), XMMatrixIdentity(), palette.data());
+
+            SkinVerticesParallel(reference, palette.data(), referencePositions.data(), normals.data());
+            SkinVerticesParallel(compressed, palette.data(), compressedPositions.data(), normals.data());
+            for (size_t i = 0; i < vertexCount; ++i) {
+                const auto diff = XMVectorSubtract(
+                    XMLoadFloat3(&referencePositions[i]), XMLoadFloat3(&compressedPositions[i]));
+                maxError = std::max(maxError, XMVectorGetX(XMVector3Length(diff)));
+            }
+        }
+
+        const auto sizeAfter =
+            (GetVertexFormatSize(streams.jointFormat) + GetVertexFormatSize(streams.weightFormat)) * vertexCount;
+        wchar_t message[512];
+        swprintf_s(message,
+            L"CompressSkinWeights: %zu -> %zu bytes, %zu influences pruned, max position error %.6f (%u poses)\n",
+            sizeBefore, sizeAfter, prunedCount, maxError, poseCount);
+        OutputDebugStringW(message);
+    }
+
+    void DxrModel::CreateTextures(
+        std::unique_ptr<dx12::GraphicsDevice>& device, const std::vector<ImageSource>& images,
+        const ImportSettings& settings)
+    {
+        if (images.empty()) {
+            return;
+        }
+        // 全画像を並列にデコードした後、まとめて転送する.
+        const auto timeStart = std::chrono::high_resolution_clock::now();
+        std::vector<util::ImageMemory> sources;
+        for (const auto& image : images) {
+            sources.push_back(util::ImageMemory{ image.data, image.size });
+        }
+        // 法線マップとして参照される画像は用途を変えて取り込む.
+        for (const auto& material : m_materials) {
+            auto index = material.m_normalTextureIndex;
+            if (index >= 0 && index < int(sources.size())) {
+                sources[index].usage = util::TextureUsage::Normal;
+            }
+        }
+        // 他のモデルと同じ画像はキャッシュで共有される.
+        auto& cache = util::TextureCache::GetInstance();
+        std::vector<util::TextureImportReport> reports;
+        auto textures = cache.Import(sources, settings.mipmaps, settings.textureCompression, device, &reports);
+        const auto timeEnd = std::chrono::high_resolution_clock::now();
+
+        for (size_t i = 0; i < textures.size(); ++i) {
+            if (textures[i].resource) {
+                textures[i].resource->SetName(images[i].name.c_str());
+            }
+            m_textures.emplace_back(textures[i]);
+        }
+
+        // 新たに取り込んだ画像について、デコード(ミップマップ生成を含む)と圧縮の速度・品質を集計する.
+        size_t decodedCount = 0, pixelCount = 0, cacheHits = 0, compressedCount = 0, blockCount = 0;
+        double decodeMs = 0.0, compressMs = 0.0, psnrSum = 0.0;
+        for (const auto& report : reports) {
+            if (report.cacheHit) {
+                ++cacheHits;
+            }
+            if (report.pixelCount > 0) {
+                ++decodedCount;
+                pixelCount += report.pixelCount;
+                decodeMs += report.decodeMs;
+            }
+            if (report.blockCount > 0) {
+                ++compressedCount;
+                blockCount += report.blockCount;
+                compressMs += report.compressMs;
+                psnrSum += report.psnr;
+            }
+        }
+        auto elapsedMs = std::chrono::duration<double, std::milli>(timeEnd - timeStart).count();
+        auto megaPixels = std::max(pixelCount / 1000000.0, 1.0e-6);
+        wchar_t message[256];
+        swprintf_s(message, L"CreateTextures: %zu images, %.3f ms, %zu decoded (%.2f ms/Mpix, mips %s)\n",
+            images.size(), elapsedMs, decodedCount, decodeMs / megaPixels, settings.mipmaps.generateMips ? L"on" : L"off");
+        OutputDebugStringW(message);
+
+        if (settings.textureCompression.compress) {
+            swprintf_s(message,
+                L"CompressTextures: %zu cached, %zu compressed, %zu blocks, %.3f Mblocks/s, avg PSNR %.2f dB\n",
+                cacheHits, compressedCount, blockCount,
+                compressMs > 0.0 ? blockCount / (compressMs * 1000.0) : 0.0,
+                compressedCount > 0 ? psnrSum / compressedCount : 0.0);
+            OutputDebugStringW(message);
+        }
+
+        auto statistics = cache.GetStatistics();
+        swprintf_s(message, L"TextureCache: %zu hits, %zu misses, %zu entries\n",
+            statistics.hits, statistics.misses, statistics.entryCount);
+        OutputDebugStringW(message);
+    }
+
+    void DxrModel::OutputLoadTime(
+        const std::wstring& fileName, std::chrono::high_resolution_clock::time_point timeStart, const wchar_t* mode)
+    {
+        // 読み込みにかかった時間を出力する.
+        const auto timeEnd = std::chrono::high_resolution_clock::now();
+        auto elapsedMs = std::chrono::duration<double, std::milli>(timeEnd - timeStart).count();
+        wchar_t message[512];
+        swprintf_s(message, L"LoadFromGltf: %s %.3f ms (%s)\n", fileName.c_str(), elapsedMs, mode);
+        OutputDebugStringW(message);
+    }
+
+    bool DxrModel::SaveCache(
+        const std::wstring& cacheFile, const CacheStamp& stamp,
+        const VertexStreamSource& streams, const std::vector<ImageSource>& images) const
+    {
+        std::ofstream outfile(cacheFile, std::ios::binary);
+        if (!outfile) {
+            return false;
+        }
+        CacheWriter writer(outfile);
+        writer.Write(ModelCacheMagic);
+        writer.Write(ModelCacheVersion);
+        writer.Write(stamp.settingsHash);
+        writer.Write(stamp.sourceSize);
+        writer.Write(stamp.sourceWriteTime);
+        writer.Write(stamp.sourceHash);
+
+        // 頂点ストリーム.
+        writer.WriteArray(streams.indices, streams.indexBufferSize);
+        writer.WriteArray(streams.positions, streams.vertexCount);
+        writer.Write(uint32_t(streams.normalFormat));
+        writer.WriteArray(static_cast<const uint8_t*>(streams.normals), GetVertexFormatSize(streams.normalFormat) * streams.vertexCount);
+        writer.Write(uint32_t(streams.texcoordFormat));
+        writer.WriteArray(static_cast<const uint8_t*>(streams.texcoords), GetVertexFormatSize(streams.texcoordFormat) * streams.vertexCount);
+        writer.Write(uint32_t(streams.jointFormat));
+        writer.WriteArray(static_cast<const uint8_t*>(streams.joints), GetVertexFormatSize(streams.jointFormat) * streams.skinVertexCount);
+        writer.Write(uint32_t(streams.weightFormat));
+        writer.WriteArray(static_cast<const uint8_t*>(streams.weights), GetVertexFormatSize(streams.weightFormat) * streams.skinVertexCount);
+
+        // ノード.
+        writer.Write(uint32_t(m_nodes.size()));
+        for (const auto& node : m_nodes) {
+            XMFLOAT4 translation, rotation, scale;
+            XMStoreFloat4(&translation, node->translation);
+            XMStoreFloat4(&rotation, node->rotation);
+            XMStoreFloat4(&scale, node->scale);
+            writer.WriteString(node->name);
+            writer.Write(translation);
+            writer.Write(rotation);
+            writer.Write(scale);
+            writer.Write(int32_t(node->meshIndex));
+            writer.WriteArray(node->children.data(), node->children.size());
+        }
+        writer.WriteArray(m_rootNodes.data(), m_rootNodes.size());
+
+        // メッシュ.
+        writer.Write(uint32_t(m_meshGroups.size()));
+        for (const auto& group : m_meshGroups) {
+            writer.WriteArray(group.m_nodeIndices.data(), group.m_nodeIndices.size());
+            writer.WriteArray(group.m_meshes.data(), group.m_meshes.size());
+        }
+
+        // マテリアル.
+        writer.Write(uint32_t(m_materials.size()));
+        for (const auto& material : m_materials) {
+            writer.WriteString(material.m_name);
+            writer.Write(int32_t(material.m_textureIndex));
+            writer.Write(int32_t(material.m_normalTextureIndex));
+            writer.Write(material.m_diffuseColor);
+        }
+
+        // スキン.
+        writer.Write(uint32_t(m_hasSkin ? 1 : 0));
+        writer.WriteString(m_skinInfo.name);
+        writer.WriteArray(m_skinInfo.joints.data(), m_skinInfo.joints.size());
+        writer.WriteArray(m_skinInfo.invBindMatrices.data(), m_skinInfo.invBindMatrices.size());
+
+        // アニメーション.
+        writer.Write(uint32_t(m_animations.size()));
+        for (const auto& clip : m_animations) {
+            writer.WriteString(clip.GetName());
+            writer.Write(uint32_t(clip.IsCompressed() ? 1 : 0));
+            writer.Write(clip.GetDuration());
+            writer.WriteArray(clip.GetChannels().data(), clip.GetChannels().size());
+            writer.WriteArray(clip.GetTimes().data(), clip.GetTimes().size());
+            writer.WriteArray(clip.GetValues().data(), clip.GetValues().size());
+            writer.WriteArray(clip.GetPackedTimes().data(), clip.GetPackedTimes().size());
+            writer.WriteArray(clip.GetPackedValues().data(), clip.GetPackedValues().size());
+        }
+
+        // 埋め込みテクスチャ(エンコード済みの画像データのまま格納).
+        writer.Write(uint32_t(images.size()));
+        for (const auto& image : images) {
+            writer.WriteString(image.name);
+            writer.WriteArray(static_cast<const uint8_t*>(image.data), image.size);
+        }
+        return writer.IsGood();
+    }
+
+    bool DxrModel::ReadCacheStamp(const uint8_t* data, size_t size, CacheStamp& stamp)
+    {
+        CacheReader reader(data, size);
+        if (reader.Read<uint32_t>() != ModelCacheMagic ||
+            reader.Read<uint32_t>() != ModelCacheVersion) {
+            return false;
+        }
+        stamp.settingsHash = reader.Read<uint64_t>();
+        stamp.sourceSize = reader.Read<uint64_t>();
+        stamp.sourceWriteTime = reader.Read<uint64_t>();
+        stamp.sourceHash = reader.Read<uint64_t>();
+        return reader.IsGood();
+    }
+
+    bool DxrModel::UpdateCacheStamp(const std::wstring& cacheFile, const CacheStamp& stamp)
+    {
+        // 識別子とバージョンの直後に並ぶ CacheStamp の部分のみを書き換える.
+        std::fstream file(cacheFile, std::ios::binary | std::ios::in | std::ios::out);
+        if (!file) {
+            return false;
+        }
+        const uint64_t values[] = {
+            stamp.settingsHash, stamp.sourceSize, stamp.sourceWriteTime, stamp.sourceHash
+        };
+        file.seekp(sizeof(ModelCacheMagic) + sizeof(ModelCacheVersion));
+        file.write(reinterpret_cast<const char*>(values), sizeof(values));
+        return file.good();
+    }
+
+    bool DxrModel::LoadCache(
+        const uint8_t* data, size_t size,
+        VertexStreamSource& streams, std::vector<ImageSource>& images)
+    {
+        // 元ファイルとの対応は ReadCacheStamp で確認済みとし、ここでは読み飛ばす.
+        CacheStamp stamp;
+        if (!ReadCacheStamp(data, size, stamp)) {
+            return false;
+        }
+        CacheReader reader(data, size);
+        reader.Read<uint32_t>();    // 識別子.
+        reader.Read<uint32_t>();    // バージョン.
+        reader.Read<CacheStamp>();
+
+        // 頂点ストリームはキャッシュファイル上のデータをそのまま参照する.
+        size_t count = 0;
+        streams.indices = reader.ReadArray<uint8_t>(streams.indexBufferSize);
+        streams.positions = reader.ReadArray<XMFLOAT3>(streams.vertexCount);
+        streams.normalFormat = DXGI_FORMAT(reader.Read<uint32_t>());
+        streams.normals = reader.ReadArray<uint8_t>(count);
+        if (count != GetVertexFormatSize(streams.normalFormat) * streams.vertexCount) {
+            return false;
+        }
+        streams.texcoordFormat = DXGI_FORMAT(reader.Read<uint32_t>());
+        streams.texcoords = reader.ReadArray<uint8_t>(count);
+        if (count != GetVertexFormatSize(streams.texcoordFormat) * streams.vertexCount) {
+            return false;
+        }
+        streams.jointFormat = DXGI_FORMAT(reader.Read<uint32_t>());
+        streams.joints = reader.ReadArray<uint8_t>(count);
+        const auto jointSize = GetVertexFormatSize(streams.jointFormat);
+        streams.skinVertexCount = jointSize ? count / jointSize : 0;
+        if (count != jointSize * streams.skinVertexCount) {
+            return false;
+        }
+        streams.weightFormat = DXGI_FORMAT(reader.Read<uint32_t>());
+        streams.weights = reader.ReadArray<uint8_t>(count);
+        if (count != GetVertexFormatSize(streams.weightFormat) * streams.skinVertexCount) {
+            return false;
+        }
+
+        auto nodeCount = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < nodeCount && reader.IsGood(); ++i) {
+            m_nodes.emplace_back(new Node());
+            auto node = m_nodes.back();
+            node->name = reader.ReadString();
+            auto translation = reader.Read<XMFLOAT4>();
+            auto rotation = reader.Read<XMFLOAT4>();
+            auto scale = reader.Read<XMFLOAT4>();
+            node->translation = XMLoadFloat4(&translation);
+            node->rotation = XMLoadFloat4(&rotation);
+            node->scale = XMLoadFloat4(&scale);
+            node->meshIndex = reader.Read<int32_t>();
+            auto children = reader.ReadArray<int>(count);
+            node->children.assign(children, children + count);
+        }
+        auto rootNodes = reader.ReadArray<int>(count);
+        m_rootNodes.assign(rootNodes, rootNodes + count);
+
+        auto groupCount = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < groupCount && reader.IsGood(); ++i) {
+            m_meshGroups.emplace_back(MeshGroup());
+            auto& group = m_meshGroups.back();
+            auto nodeIndices = reader.ReadArray<int>(count);
+            group.m_nodeIndices.assign(nodeIndices, nodeIndices + count);
+            auto meshes = reader.ReadArray<Mesh>(count);
+            group.m_meshes.assign(meshes, meshes + count);
+        }
+
+        auto materialCount = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < materialCount && reader.IsGood(); ++i) {
+            m_materials.emplace_back(Material());
+            auto& material = m_materials.back();
+            material.m_name = reader.ReadString();
+            material.m_textureIndex = reader.Read<int32_t>();
+            material.m_normalTextureIndex = reader.Read<int32_t>();
+            material.m_diffuseColor = reader.Read<XMFLOAT3>();
+        }
+
+        m_hasSkin = reader.Read<uint32_t>() != 0;
+        m_skinInfo.name = reader.ReadString();
+        auto joints = reader.ReadArray<int>(count);
+        m_skinInfo.joints.assign(joints, joints + count);
+        auto invBindMatrices = reader.ReadArray<XMMATRIX>(count);
+        m_skinInfo.invBindMatrices.assign(invBindMatrices, invBindMatrices + count);
+
+        bool isAnimationValid = true;
+        auto animationCount = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < animationCount && reader.IsGood(); ++i) {
+            m_animations.emplace_back(AnimationClip());
+            auto& clip = m_animations.back();
+            clip.SetName(reader.ReadString());
+            const bool isCompressed = reader.Read<uint32_t>() != 0;
+            const float duration = reader.Read<float>();
+            auto channels = reader.ReadArray<AnimationClip::Channel>(count);
+            std::vector<AnimationClip::Channel> channelArray(channels, channels + count);
+            auto times = reader.ReadArray<float>(count);
+            std::vector<float> timeArray(times, times + count);
+            auto values = reader.ReadArray<XMFLOAT4>(count);
+            std::vector<XMFLOAT4> valueArray(values, values + count);
+            auto packedTimes = reader.ReadArray<uint16_t>(count);
+            std::vector<uint16_t> packedTimeArray(packedTimes, packedTimes + count);
+            auto packedValues = reader.ReadArray<uint16_t>(count);
+            std::vector<uint16_t> packedValueArray(packedValues, packedValues + count);
+            if (isCompressed) {
+                isAnimationValid &= clip.AssignCompressed(
+                    std::move(channelArray), std::move(packedTimeArray), std::move(packedValueArray), duration);
+            } else {
+                isAnimationValid &= clip.Assign(std::move(channelArray), std::move(timeArray), std::move(valueArray));
+            }
         }
 
-        m_whiteTex = util::LoadTextureFromFile(L"white.png", device);
+        auto imageCount = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < imageCount && reader.IsGood(); ++i) {
+            ImageSource image;
+            image.name = reader.ReadString();
+            image.data = reader.ReadArray<uint8_t>(image.size);
+            images.emplace_back(image);
+        }
 
+        if (!reader.IsGood() || !isAnimationValid) {
+            // 壊れたキャッシュは使わずに元ファイルから読み直す.
+            m_nodes.clear();
+            m_rootNodes.clear();
+            m_meshGroups.clear();
+            m_materials.clear();
+            m_skinInfo = SkinInfo();
+            m_hasSkin = false;
+            m_animations.clear();
+            images.clear();
+            return false;
+        }
         return true;
     }
 
     
-    
     std::shared_ptr<DxrModelActor> DxrModel::Create(std::unique_ptr<dx12::GraphicsDevice>& device)
     {
-        std::shared_ptr<DxrModelActor> actor(new DxrModelActor(device, this));
-        std::vector<std::shared_ptr<DxrModelActor::Node>> nodes;
-        nodes.resize(m_nodes.size());
+        return CreateActor(device, nullptr, 0);
+    }
 
-        for (UINT i = 0; i < UINT(m_nodes.size()); ++i) {
-            nodes[i] = std::make_shared<DxrModelActor::Node>();
-            const auto src = m_nodes[i];
-            nodes[i]->translation = src->translation;
-            nodes[i]->rotation = src->rotation;
-            nodes[i]->scale = src->scale;
-            nodes[i]->name = src->name;
+    std::shared_ptr<DxrModelCrowd> DxrModel::CreateCrowd(std::unique_ptr<dx12::GraphicsDevice>& device, UINT count)
+    {
+        if (!m_hasSkin || count == 0) {
+            return nullptr;
+        }
+        std::shared_ptr<DxrModelCrowd> crowd(new DxrModelCrowd(device, this));
+        const auto jointCount = UINT(m_skinInfo.joints.size());
+        const auto vertexCount = m_skinInfo.skinVertexCount;
+        crowd->m_actorCount = count;
+        crowd->m_jointCount = jointCount;
+        crowd->m_skinVertexCount = vertexCount;
+
+        // 変換後の頂点は Actor の順に連結して確保する.
+        auto stride = UINT(sizeof(XMFLOAT3));
+        auto actorVertexSize = size_t(vertexCount) * stride;
+        auto bufferSize = actorVertexSize * count;
+        const auto initialState = D3D12_RESOURCE_STATE_COMMON;
+        crowd->m_vbPositionTransformed = util::CreateBufferUAV(device, bufferSize, initialState, L"CrowdTransformed(Pos)");
+        crowd->m_vbNormalTransformed = util::CreateBufferUAV(device, bufferSize, initialState, L"CrowdTransformed(Nrm)");
+
+        // 関節データもフレームごとの領域内に Actor の順で並べる.
+        auto bufferCount = device->BackBufferCount;
+        auto actorJointSize = UINT(sizeof(XMFLOAT4X4)) * jointCount;
+        auto frameJointSize = size_t(actorJointSize) * count;
+        crowd->m_bufJointMatrices = util::CreateBuffer(
+            device, frameJointSize * bufferCount, nullptr,
+            D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_FLAG_NONE, L"CrowdJointMatrices");
+        for (UINT i = 0; i < bufferCount; ++i) {
+            auto matrixCount = jointCount * count;
+            auto matrixStride = UINT(sizeof(XMFLOAT4X4));
+            auto srv = util::CreateStructuredSRV(
+                device, crowd->m_bufJointMatrices, matrixCount, matrixCount * i, matrixStride);
+            crowd->m_bufJointMatricesDescriptors.push_back(srv);
+
+            // デュアルクォータニオンは各 Actor の領域の先頭に関節ごとに float4 x2 で格納する.
+            //  Actor の領域の間隔は行列と同じのため、シェーダーでは Actor ごとに関節数 x4 要素ずらして参照する.
+            auto dqStride = UINT(sizeof(XMFLOAT4));
+            auto dqCount = matrixCount * (matrixStride / dqStride);
+            auto dqSrv = util::CreateStructuredSRV(
+                device, crowd->m_bufJointMatrices, dqCount, dqCount * i, dqStride);
+            crowd->m_bufJointDualQuatsDescriptors.push_back(dqSrv);
         }
 
-        // 親子解決.
-        for (UINT i = 0; i < UINT(m_nodes.size()); ++i) {
-            const auto src = m_nodes[i];
-            auto node = nodes[i];
-            for (auto idx : src->children) {
-                auto child = nodes[idx];
-                node->children.push_back(child);
-                child->parent = node;
+        // 全 Actor の初期値として元の頂点をまとめてコピーする.
+        {
+            auto command = device->CreateCommandList();
+            for (UINT i = 0; i < count; ++i) {
+                auto dstOffset = actorVertexSize * i;
+                command->CopyBufferRegion(
+                    crowd->m_vbPositionTransformed.Get(), dstOffset, m_vertexAttrib.Position.Get(), 0, actorVertexSize);
+                command->CopyBufferRegion(
+                    crowd->m_vbNormalTransformed.Get(), dstOffset, m_vertexAttrib.Normal.Get(), 0, actorVertexSize);
             }
+            command->Close();
+            device->ExecuteCommandList(command);
+            device->WaitForIdleGpu();
         }
-        for (auto rootNodeIndex : m_rootNodes) {
-            auto rootNode = nodes[rootNodeIndex];
-            actor->m_nodes.push_back(rootNode);
+
+        crowd->m_actors.reserve(count);
+        for (UINT i = 0; i < count; ++i) {
+            crowd->m_actors.push_back(CreateActor(device, crowd.get(), i));
         }
+        return crowd;
+    }
+
+    std::shared_ptr<DxrModelActor> DxrModel::CreateActor(
+        std::unique_ptr<dx12::GraphicsDevice>& device, const DxrModelCrowd* crowd, UINT crowdIndex)
+    {
+        std::shared_ptr<DxrModelActor> actor(new DxrModelActor(device, this));
+        std::vector<std::shared_ptr<DxrModelActor::Node>> nodes;
+        nodes.resize(m_nodes.size());
+
+        // 親が子より前に並ぶ順(m_nodeOrder)で階層へ登録する.
+        auto& hierarchy = actor->m_hierarchy;
+        hierarchy.Reserve(m_nodeOrder.size());
+        actor->m_nodes.reserve(m_nodeOrder.size());
+        for (auto index : m_nodeOrder) {
+            const auto& src = m_nodes[index];
+            auto node = std::make_shared<DxrModelActor::Node>();
+            node->name = &src->name;
+            node->m_hierarchy = &hierarchy;
+
+            auto parentIndex = TransformHierarchy::InvalidParent;
+            const int parent = m_nodeParents[index];
+            if (parent >= 0) {
+                node->parent = nodes[parent];
+                parentIndex = int(nodes[parent]->m_index);
+            }
+            node->m_index = hierarchy.AddNode(parentIndex, src->translation, src->rotation, src->scale);
+            nodes[index] = node;
+            actor->m_nodes.push_back(node);
+        }
+        actor->m_nodeTable = nodes;
+
+        // スキニングしないモデルでは、生成済みの BLAS とディスクリプタを共有する.
+        const bool useShared = !m_hasSkin && m_sharedGeometry;
 
         // マテリアルの生成.
-        for (auto inMaterial : m_materials) {
-            actor->m_materials.emplace_back(new DxrModelActor::Material(device, inMaterial));
-            auto material = actor->m_materials.back();
+        if (useShared) {
+            actor->m_materials = m_sharedGeometry->materials;
+        } else {
+            for (auto inMaterial : m_materials) {
+                actor->m_materials.emplace_back(new DxrModelActor::Material(device, inMaterial));
+                auto material = actor->m_materials.back();
 
-            if (inMaterial.m_textureIndex < 0) {
-                // ダミーテクスチャを使用する.
-                material->SetTexture(m_whiteTex);
-            } else {
-                material->SetTexture(m_textures[inMaterial.m_textureIndex]);
+                if (inMaterial.m_textureIndex < 0) {
+                    // ダミーテクスチャを使用する.
+                    material->SetTexture(m_whiteTex);
+                } else {
+                    material->SetTexture(m_textures[inMaterial.m_textureIndex]);
+                }
             }
         }
 
@@ -206,6 +1176,7 @@ namespace util {
 
             for (auto jointIndex : srcSkinInfo.joints) {
                 dstSkinInfo.jointList.push_back(nodes[jointIndex]);
+                dstSkinInfo.jointIndices.push_back(nodes[jointIndex]->m_index);
             }
             dstSkinInfo.invBindMatrices = srcSkinInfo.invBindMatrices;
             dstSkinInfo.skinVertexCount = srcSkinInfo.skinVertexCount;
@@ -215,42 +1186,72 @@ namespace util {
             auto stride = UINT(sizeof(XMFLOAT3));
             auto bufferSize = vertexCount * stride;
             const auto initialState = D3D12_RESOURCE_STATE_COMMON;
+            auto jointBufferSize = UINT(sizeof(XMMATRIX) * dstSkinInfo.jointList.size());
 
-            // 変換後のデータの格納先を確保する.
-            dstSkinInfo.vbPositionTransformed = util::CreateBufferUAV(device, bufferSize, initialState, L"Transformed(Pos)");
-            dstSkinInfo.vbNormalTransformed = util::CreateBufferUAV(device, bufferSize, initialState, L"Transformed(Nrm)");
-
-            // UAV として使用するのでディスクリプタを準備する.
-            dstSkinInfo.vbPositionDescriptor = util::CreateStructuredUAV(
-                device, dstSkinInfo.vbPositionTransformed, vertexCount, 0, stride);
-            dstSkinInfo.vbNormalDescriptor = util::CreateStructuredUAV(
-                device, dstSkinInfo.vbPositionTransformed, vertexCount, 0, stride);
+            if (crowd) {
+                // 群衆では連結した共有バッファのうち自身の範囲を参照する.
+                //  初期値のコピーは CreateCrowd で全 Actor 分まとめて行う.
+                dstSkinInfo.vbPositionTransformed = crowd->m_vbPositionTransformed;
+                dstSkinInfo.vbNormalTransformed = crowd->m_vbNormalTransformed;
+                dstSkinInfo.bufJointMatrices = crowd->m_bufJointMatrices;
+                dstSkinInfo.vertexOffset = vertexCount * crowdIndex;
+                dstSkinInfo.jointBufferOffset = jointBufferSize * crowdIndex;
+                dstSkinInfo.jointBufferStride = jointBufferSize * crowd->m_actorCount;
+            } else {
+                // 変換後のデータの格納先を確保する.
+                dstSkinInfo.vbPositionTransformed = util::CreateBufferUAV(device, bufferSize, initialState, L"Transformed(Pos)");
+                dstSkinInfo.vbNormalTransformed = util::CreateBufferUAV(device, bufferSize, initialState, L"Transformed(Nrm)");
+
+                // UAV として使用するのでディスクリプタを準備する.
+                dstSkinInfo.vbPositionDescriptor = util::CreateStructuredUAV(
+                    device, dstSkinInfo.vbPositionTransformed, vertexCount, 0, stride);
+                dstSkinInfo.vbNormalDescriptor = util::CreateStructuredUAV(
+                    device, dstSkinInfo.vbPositionTransformed, vertexCount, 0, stride);
+
+                // 更新されたスキニング行列のための定数バッファを確保.
+                auto bufferCount = device->BackBufferCount;
+                auto jointBufferSizeDynamic = jointBufferSize * bufferCount;
+                dstSkinInfo.jointBufferStride = jointBufferSize;
+                dstSkinInfo.bufJointMatrices = util::CreateBuffer(
+                    device, jointBufferSizeDynamic, nullptr, 
+                    D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_FLAG_NONE, L"JointMatrices");
+                for (UINT i = 0; i < bufferCount; ++i) {
+                    auto jointCount = UINT(dstSkinInfo.jointList.size());
+                    auto stride = UINT(sizeof(XMFLOAT4X4));
+                    auto offset = jointCount * i;
+                    auto srv = util::CreateStructuredSRV(device, dstSkinInfo.bufJointMatrices, jointCount, offset, stride);
+                    dstSkinInfo.bufJointMatricesDescriptors.push_back(srv);
+
+                    // デュアルクォータニオンは同じ領域の先頭に関節ごとに float4 x2 で格納する.
+                    auto dqStride = UINT(sizeof(XMFLOAT4));
+                    auto dqOffset = jointCount * (stride / dqStride) * i;
+                    auto dqSrv = util::CreateStructuredSRV(device, dstSkinInfo.bufJointMatrices, jointCount * 2, dqOffset, dqStride);
+                    dstSkinInfo.bufJointDualQuatsDescriptors.push_back(dqSrv);
+                }
+            }
+        }
 
-            // 更新されたスキニング行列のための定数バッファを確保.
-            auto bufferCount = device->BackBufferCount;
-            auto jointBufferSize = UINT(sizeof(XMMATRIX) * dstSkinInfo.jointList.size());
-            auto jointBufferSizeDynamic = jointBufferSize * bufferCount;
-            dstSkinInfo.bufJointMatrices = util::CreateBuffer(
-                device, jointBufferSizeDynamic, nullptr, 
-                D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_FLAG_NONE, L"JointMatrices");
-            for (UINT i = 0; i < bufferCount; ++i) {
-                auto jointCount = UINT(dstSkinInfo.jointList.size());
-                auto stride = UINT(sizeof(XMFLOAT4X4));
-                auto offset = jointCount * i;
-                auto srv = util::CreateStructuredSRV(device, dstSkinInfo.bufJointMatrices, jointCount, offset, stride);
-                dstSkinInfo.bufJointMatricesDescriptors.push_back(srv);
+        // メッシュを参照するノードごとにインスタンスを作成する.
+        for (UINT i = 0; i < UINT(m_meshGroups.size()); ++i) {
+            for (auto nodeIndex : m_meshGroups[i].m_nodeIndices) {
+                DxrModelActor::Instance instance;
+                instance.m_node = nodes[nodeIndex];
+                instance.m_meshGroupIndex = i;
+                actor->m_instances.push_back(instance);
             }
         }
 
-        // BLAS 構築時に設定する行列バッファを確保.
-        actor->CreateMatrixBufferBLAS(UINT(m_meshGroups.size()));
+        // 共有する場合はメッシュの参照をコピーするのみで、BLAS の構築も不要.
+        if (useShared) {
+            actor->m_meshGroups = m_sharedGeometry->meshGroups;
+            return actor;
+        }
 
         // 頂点の属性データごとの SRV を生成.
         //  スキニング時には変換後のバッファに対して生成.
         for (UINT i = 0; i < UINT(m_meshGroups.size()); ++i) {
             actor->m_meshGroups.emplace_back(DxrModelActor::MeshGroup());
             auto& group = actor->m_meshGroups.back();
-            group.m_node = nodes[m_meshGroups[i].m_nodeIndex];
             for (auto& inMesh : m_meshGroups[i].m_meshes) {
                 group.m_meshes.emplace_back(DxrModelActor::Mesh());
                 auto& mesh = group.m_meshes.back();
@@ -259,36 +1260,45 @@ namespace util {
                 auto vertexCount = inMesh.vertexCount;
 
                 mesh.indexCount = inMesh.indexCount;
-                mesh.indexStart = inMesh.indexStart;
+                mesh.indexByteOffset = inMesh.indexByteOffset;
+                mesh.indexFormat = inMesh.indexStride == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
                 mesh.vertexStart = vertexStart;
                 mesh.vertexCount = vertexCount;
+                mesh.boundsMin = inMesh.boundsMin;
+                mesh.boundsMax = inMesh.boundsMax;
 
                 D3D12Resource attrPosition;
                 D3D12Resource attrNormal;
+                auto attrStart = vertexStart;
+                auto normalFormat = DXGI_FORMAT_R32G32B32_FLOAT;
                 if (actor->IsSkinned() == false) {
                     attrPosition = m_vertexAttrib.Position;
                     attrNormal = m_vertexAttrib.Normal;
+                    normalFormat = m_normalFormat;
                 } else {
                     auto& skin = actor->m_skinInfo;
                     attrPosition = skin.vbPositionTransformed;
                     attrNormal = skin.vbNormalTransformed;
+                    attrStart += skin.vertexOffset;
                 }
-                mesh.vbAttrPosision = util::CreateStructuredSRV(device, attrPosition, vertexCount, vertexStart, DXGI_FORMAT_R32G32B32_FLOAT);
-                mesh.vbAttrNormal = util::CreateStructuredSRV(device, attrNormal, vertexCount, vertexStart, DXGI_FORMAT_R32G32B32_FLOAT);
-                mesh.vbAttrTexcoord = util::CreateStructuredSRV(device, m_vertexAttrib.Texcoord, vertexCount, vertexStart, DXGI_FORMAT_R32G32_FLOAT);
-                mesh.indexBuffer = util::CreateStructuredSRV(device, m_indexBuffer, mesh.indexCount, mesh.indexStart, DXGI_FORMAT_R32_UINT);
+                mesh.vbAttrPosision = util::CreateStructuredSRV(device, attrPosition, vertexCount, attrStart, DXGI_FORMAT_R32G32B32_FLOAT);
+                mesh.vbAttrNormal = util::CreateStructuredSRV(device, attrNormal, vertexCount, attrStart, normalFormat);
+                mesh.vbAttrTexcoord = util::CreateStructuredSRV(device, m_vertexAttrib.Texcoord, vertexCount, vertexStart, m_texcoordFormat);
+                // インデックスは 16bit の場合もあるため ByteAddressBuffer として参照する.
+                auto indexWords = util::RoundUp(inMesh.indexCount * inMesh.indexStride, 4) / 4;
+                mesh.indexBuffer = util::CreateByteAddressSRV(device, m_indexBuffer, indexWords, inMesh.indexByteOffset / 4);
                 mesh.material = actor->m_materials[inMesh.materialIndex];
 
                 auto diffuse = m_materials[inMesh.materialIndex].GetDiffuseColor();
                 DxrModelActor::Mesh::MeshParameters meshParams{};
                 meshParams.diffuse = XMFLOAT4{ diffuse.x, diffuse.y, diffuse.z, 1 };
-                meshParams.meshGroupIndex = i;
-                meshParams.strideOfMatrixBuffer = UINT(m_meshGroups.size())*3; // float4換算でのサイズを入れる.
+                meshParams.indexStride = inMesh.indexStride;
+                meshParams.normalEncoding = normalFormat == DXGI_FORMAT_R16G16_SNORM ? 1 : 0;
                 mesh.meshParameters = util::CreateBuffer(device, sizeof(meshParams), &meshParams, D3D12_HEAP_TYPE_DEFAULT);
             }
         }
 
-        if ( m_hasSkin ) {
+        if ( m_hasSkin && !crowd ) {
             auto& skin = actor->m_skinInfo;
             auto command = device->CreateCommandList();
             // 初期値としてコピー.
@@ -299,12 +1309,18 @@ namespace util {
             device->WaitForIdleGpu();
         }
 
-        // 行列用のバッファを更新する.
-        //  スキニングの定数バッファや BLAS 構築時に設定される行列バッファを対象.
+        // スキニング用の行列バッファを更新する.
         actor->ApplyTransform();
 
         // BLAS の生成.
         actor->CreateBLAS();
+
+        // 以降に生成する Actor のために共有しておく.
+        if (!m_hasSkin) {
+            m_sharedGeometry = std::make_shared<DxrModelSharedGeometry>();
+            m_sharedGeometry->materials = actor->m_materials;
+            m_sharedGeometry->meshGroups = actor->m_meshGroups;
+        }
         return actor;
     }
 
@@ -331,120 +1347,240 @@ namespace util {
         }
     }
 
-    void DxrModel::LoadMesh(const tinygltf::Model& inModel, VertexAttributeVisitor& visitor)
+    void DxrModel::BuildNodeIndex()
     {
-        auto& indexBuffer = visitor.indexBuffer;
-        auto& positionBuffer = visitor.positionBuffer;
-        auto& normalBuffer = visitor.normalBuffer;
-        auto& texcoordBuffer = visitor.texcoordBuffer;
-        auto& jointBuffer = visitor.jointBuffer;
-        auto& weightBuffer = visitor.weightBuffer;
-        for (auto& inMesh : inModel.meshes) {
-            m_meshGroups.emplace_back(MeshGroup());
-            auto& meshgrp = m_meshGroups.back();
-            
-            for (auto& primitive : inMesh.primitives) {
-                auto indexStart = static_cast<UINT>(indexBuffer.size());
-                auto vertexStart = static_cast<UINT>(positionBuffer.size());
-                UINT indexCount = 0, vertexCount = 0;
-                bool hasSkin = false;
-
-                const auto& notfound = primitive.attributes.end();
-                if (auto attr = primitive.attributes.find("POSITION"); attr != notfound) {
-                    auto& acc = inModel.accessors[attr->second];
-                    auto& view = inModel.bufferViews[acc.bufferView];
-                    auto offsetBytes = acc.byteOffset + view.byteOffset;
-                    const auto* src = reinterpret_cast<const XMFLOAT3*>(&(inModel.buffers[view.buffer].data[offsetBytes]));
-
-                    vertexCount = UINT(acc.count);
-                    for (UINT i = 0; i < vertexCount; ++i) {
-                        positionBuffer.push_back(src[i]);
-                    }
-                }
-                if (auto attr = primitive.attributes.find("NORMAL"); attr != notfound) {
-                    auto& acc = inModel.accessors[attr->second];
-                    auto& view = inModel.bufferViews[acc.bufferView];
-                    auto offsetBytes = acc.byteOffset + view.byteOffset;
-                    const auto* src = reinterpret_cast<const XMFLOAT3*>(&(inModel.buffers[view.buffer].data[offsetBytes]));
-
-                    vertexCount = UINT(acc.count);
-                    for (UINT i = 0; i < vertexCount; ++i) {
-                        normalBuffer.push_back(src[i]);
-                    }
-                }
-                if (auto attr = primitive.attributes.find("TEXCOORD_0"); attr != notfound) {
-                    auto& acc = inModel.accessors[attr->second];
-                    auto& view = inModel.bufferViews[acc.bufferView];
-                    auto offsetBytes = acc.byteOffset + view.byteOffset;
-                    const auto* src = reinterpret_cast<const XMFLOAT2*>(&(inModel.buffers[view.buffer].data[offsetBytes]));
-
-                    for (UINT i = 0; i < vertexCount; ++i) {
-                        texcoordBuffer.push_back(src[i]);
-                    }
+        const int nodeCount = int(m_nodes.size());
+
+        // 親子解決.
+        std::vector<int> parents(nodeCount, -1);
+        for (int i = 0; i < nodeCount; ++i) {
+            for (auto idx : m_nodes[i]->children) {
+                parents[idx] = i;
+            }
+        }
+
+        // ルートから深さ優先でたどった順に並べる.
+        //  親が先に現れない場合(シーンから外れた部分木)はルートとして扱う.
+        m_nodeOrder.clear();
+        m_nodeOrder.reserve(nodeCount);
+        m_nodeParents.assign(nodeCount, -1);
+        std::vector<bool> visited(nodeCount, false);
+        std::vector<int> stack;
+        auto addSubtree = [&](int rootIndex) {
+            stack.push_back(rootIndex);
+            while (!stack.empty()) {
+                const int index = stack.back();
+                stack.pop_back();
+                if (visited[index]) {
+                    continue;
                 }
-                else {
-                    // UV データが無い場合には、他のものと合わせるべくゼロで埋めておく.
-                    for (UINT i = 0; i < vertexCount; ++i) {
-                        texcoordBuffer.push_back(XMFLOAT2(0.0f, 0.0f));
-                    }
+                visited[index] = true;
+                const int parent = parents[index];
+                if (parent >= 0 && visited[parent]) {
+                    m_nodeParents[index] = parent;
                 }
+                m_nodeOrder.push_back(index);
 
-                // スキニング用のジョイント(インデックス)番号とウェイト値を読み取る.
-                if (auto attr = primitive.attributes.find("JOINTS_0"); attr != notfound) {
-                    auto& acc = inModel.accessors[attr->second];
-                    auto& view = inModel.bufferViews[acc.bufferView];
-                    auto offsetBytes = acc.byteOffset + view.byteOffset;
-                    const auto* src = reinterpret_cast<const uint16_t*>(&(inModel.buffers[view.buffer].data[offsetBytes]));
-
-                    for (UINT i = 0; i < vertexCount; ++i) {
-                        auto idx = i * 4;
-                        auto v = XMUINT4(
-                            src[idx + 0], src[idx + 1], src[idx + 2], src[idx + 3]);
-                        jointBuffer.push_back(v);
-                    }
+                // 元の子の順序でたどるため逆順に積む.
+                const auto& children = m_nodes[index]->children;
+                for (auto it = children.rbegin(); it != children.rend(); ++it) {
+                    stack.push_back(*it);
                 }
-                if (auto attr = primitive.attributes.find("WEIGHTS_0"); attr != notfound) {
-                    auto& acc = inModel.accessors[attr->second];
-                    auto& view = inModel.bufferViews[acc.bufferView];
-                    auto offsetBytes = acc.byteOffset + view.byteOffset;
-                    const auto* src = reinterpret_cast<const XMFLOAT4*>(&(inModel.buffers[view.buffer].data[offsetBytes]));
-
-                    for (UINT i = 0; i < vertexCount; ++i) {
-                        weightBuffer.push_back(src[i]);
-                    }
+            }
+        };
+        for (auto rootNodeIndex : m_rootNodes) {
+            addSubtree(rootNodeIndex);
+        }
+        // シーンから参照されないノードも行列を持たせるため登録しておく.
+        for (int i = 0; i < nodeCount; ++i) {
+            if (parents[i] < 0) {
+                addSubtree(i);
+            }
+        }
+        for (int i = 0; i < nodeCount; ++i) {
+            addSubtree(i);
+        }
+
+        // 名前の索引. 充填率が半分以下になるよう 2 の冪でスロットを確保する.
+        m_nodeNameHashes.resize(nodeCount);
+        size_t slotCount = 16;
+        while (slotCount < size_t(nodeCount) * 2) {
+            slotCount *= 2;
+        }
+        m_nodeNameSlots.assign(slotCount, -1);
+        const size_t mask = slotCount - 1;
+        for (auto index : m_nodeOrder) {
+            const auto& name = m_nodes[index]->name;
+            const auto hash = util::ComputeHash64(name.data(), name.size() * sizeof(wchar_t));
+            m_nodeNameHashes[index] = hash;
+
+            // 同名のノードは先に登録したもの(深さ優先で先に現れるもの)を優先する.
+            size_t slot = size_t(hash) & mask;
+            while (m_nodeNameSlots[slot] >= 0) {
+                const int other = m_nodeNameSlots[slot];
+                if (m_nodeNameHashes[other] == hash && m_nodes[other]->name == name) {
+                    break;
                 }
+                slot = (slot + 1) & mask;
+            }
+            if (m_nodeNameSlots[slot] < 0) {
+                m_nodeNameSlots[slot] = index;
+            }
+        }
+    }
 
-                //　インデックスバッファ用.
-                {
-                    auto& acc = inModel.accessors[primitive.indices];
-                    const auto& view = inModel.bufferViews[acc.bufferView];
-                    const auto& buffer = inModel.buffers[view.buffer];
-                    indexCount = UINT(acc.count);
-                    auto offsetBytes = acc.byteOffset + view.byteOffset;
-                    if (acc.componentType == TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT) {
-                        auto src = reinterpret_cast<const uint32_t*>(&(buffer.data[offsetBytes]));
-
-                        for (size_t index = 0; index < acc.count; index++)
-                        {
-                            indexBuffer.push_back(src[index]);
-                        }
-                    }
-                    if (acc.componentType == TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT) {
-                        auto src = reinterpret_cast<const uint16_t*>(&(buffer.data[offsetBytes]));
-                        for (size_t index = 0; index < acc.count; index++)
-                        {
-                            indexBuffer.push_back(src[index]);
-                        }
-                    }
+    int DxrModel::FindNode(const std::wstring& name) const
+    {
+        if (m_nodeNameSlots.empty()) {
+            return -1;
+        }
+        const size_t mask = m_nodeNameSlots.size() - 1;
+        const auto hash = util::ComputeHash64(name.data(), name.size() * sizeof(wchar_t));
+        for (size_t slot = size_t(hash) & mask; m_nodeNameSlots[slot] >= 0; slot = (slot + 1) & mask) {
+            const int index = m_nodeNameSlots[slot];
+            if (m_nodeNameHashes[index] == hash && m_nodes[index]->name == name) {
+                return index;
+            }
+        }
+        return -1;
+    }
+
+    void DxrModel::FindNodes(const std::wstring* names, size_t count, int* nodeIndices) const
+    {
+        for (size_t i = 0; i < count; ++i) {
+            nodeIndices[i] = FindNode(names[i]);
+        }
+    }
+
+    void DxrModel::LoadMesh(
+        const tinygltf::Model& inModel, const BufferTable& buffers,
+        const ImportSettings& settings, VertexAttributeVisitor& visitor)
+    {
+        // 1パス目: 各プリミティブの頂点数・インデックス数を求め、
+        //  ストリーム内での開始位置を累積して決定する.
+        std::vector<PrimitiveLayout> layouts;
+        UINT vertexTotal = 0, indexTotal = 0;
+        bool hasJoints = false, hasWeights = false;
+        m_meshGroups.reserve(m_meshGroups.size() + inModel.meshes.size());
+        for (auto& inMesh : inModel.meshes) {
+            const auto groupIndex = UINT(m_meshGroups.size());
+            m_meshGroups.emplace_back(MeshGroup());
+            auto& meshgrp = m_meshGroups.back();
+            meshgrp.m_meshes.reserve(inMesh.primitives.size());
+
+            for (auto& primitive : inMesh.primitives) {
+                const auto& attributes = primitive.attributes;
+                UINT vertexCount = 0, indexCount = 0;
+                if (auto attr = attributes.find("POSITION"); attr != attributes.end()) {
+                    vertexCount = UINT(inModel.accessors[attr->second].count);
                 }
+                if (primitive.indices >= 0) {
+                    indexCount = UINT(inModel.accessors[primitive.indices].count);
+                }
+                hasJoints |= attributes.count("JOINTS_0") != 0;
+                hasWeights |= attributes.count("WEIGHTS_0") != 0;
 
+                const auto meshIndex = UINT(meshgrp.m_meshes.size());
                 meshgrp.m_meshes.emplace_back(Mesh());
                 auto& mesh = meshgrp.m_meshes.back();
-                mesh.indexStart = indexStart;
-                mesh.vertexStart = vertexStart;
+                mesh.indexStart = indexTotal;
+                mesh.vertexStart = vertexTotal;
                 mesh.indexCount = indexCount;
                 mesh.vertexCount = vertexCount;
                 mesh.materialIndex = primitive.material;
+
+                layouts.emplace_back(PrimitiveLayout{ &primitive, groupIndex, meshIndex, vertexTotal, vertexCount, indexTotal, indexCount });
+                vertexTotal += vertexCount;
+                indexTotal += indexCount;
+            }
+        }
+
+        // 書き込み先を一括で確保する.
+        //  属性を持たないプリミティブの領域はゼロで埋まるため、各ストリームの要素位置は揃う.
+        visitor.indexBuffer.resize(indexTotal);
+        visitor.positionBuffer.resize(vertexTotal);
+        visitor.normalBuffer.resize(vertexTotal);
+        visitor.texcoordBuffer.resize(vertexTotal, XMFLOAT2(0.0f, 0.0f));
+        if (hasJoints) {
+            visitor.jointBuffer.resize(vertexTotal);
+        }
+        if (hasWeights) {
+            visitor.weightBuffer.resize(vertexTotal);
+        }
+
+        // 2パス目: 各プリミティブは書き込み先が重ならないため並列にデコードする.
+        ForEachPrimitive(settings.parallelImport, layouts.begin(), layouts.end(),
+            [&](const PrimitiveLayout& layout) {
+                DecodePrimitive(inModel, buffers, layout, visitor);
+            });
+
+        if (settings.weldVertices) {
+            // 各プリミティブの範囲内で重複した頂点を統合する.
+            const auto vertexCountBefore = visitor.positionBuffer.size();
+            ForEachPrimitive(settings.parallelImport, layouts.begin(), layouts.end(),
+                [&](PrimitiveLayout& layout) {
+                    WeldPrimitive(layout, visitor, settings.weldEpsilon);
+                });
+            CompactVertexStreams(layouts, visitor);
+
+            wchar_t message[256];
+            swprintf_s(message, L"WeldVertices: %zu -> %zu vertices\n",
+                vertexCountBefore, visitor.positionBuffer.size());
+            OutputDebugStringW(message);
+        }
+
+        if (settings.optimizeMeshes) {
+            // 各プリミティブの範囲内で三角形と頂点を並べ替える.
+            const auto timeStart = std::chrono::high_resolution_clock::now();
+            std::vector<MeshOptimizeReport> reports(layouts.size());
+            ForEachPrimitive(settings.parallelImport, layouts.begin(), layouts.end(),
+                [&](PrimitiveLayout& layout) {
+                    auto index = &layout - layouts.data();
+                    OptimizePrimitive(layout, visitor, reports[index]);
+                });
+            CompactVertexStreams(layouts, visitor);
+            const auto timeEnd = std::chrono::high_resolution_clock::now();
+
+            MeshOptimizeReport total;
+            for (const auto& report : reports) {
+                total.before += report.before;
+                total.after += report.after;
+            }
+            auto elapsedMs = std::chrono::duration<double, std::milli>(timeEnd - timeStart).count();
+            auto triangleCount = std::max<size_t>(total.after.triangleCount, 1);
+            wchar_t message[256];
+            swprintf_s(message,
+                L"OptimizeMeshes: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %.3f ms (%.1f ms/Mtri)\n",
+                total.before.GetACMR(), total.after.GetACMR(),
+                total.before.GetATVR(), total.after.GetATVR(),
+                elapsedMs, elapsedMs * 1000000.0 / triangleCount);
+            OutputDebugStringW(message);
+        }
+
+        {
+            // 各プリミティブの境界を求め、大きなものはクラスタに分割する.
+            //  三角形の並べ替えは順序を保つため、頂点キャッシュ向けの並びはクラスタ内で維持される.
+            const auto timeStart = std::chrono::high_resolution_clock::now();
+            std::vector<std::vector<MeshCluster>> clusters(layouts.size());
+            ForEachPrimitive(settings.parallelImport, layouts.begin(), layouts.end(),
+                [&](const PrimitiveLayout& layout) {
+                    auto index = &layout - layouts.data();
+                    ClusterPrimitive(layout, visitor, settings.maxClusterTriangles, clusters[index]);
+                });
+            // メッシュの配列を組み直すため、以降 layouts のメッシュ番号は使用できない.
+            SplitMeshClusters(clusters);
+            const auto timeEnd = std::chrono::high_resolution_clock::now();
+
+            if (settings.maxClusterTriangles > 0) {
+                size_t geometryCount = 0;
+                for (const auto& group : m_meshGroups) {
+                    geometryCount += group.m_meshes.size();
+                }
+                auto elapsedMs = std::chrono::duration<double, std::milli>(timeEnd - timeStart).count();
+                wchar_t message[256];
+                swprintf_s(message, L"ClusterMeshes: %zu primitives -> %zu geometries, %.3f ms\n",
+                    layouts.size(), geometryCount, elapsedMs);
+                OutputDebugStringW(message);
             }
         }
 
@@ -453,12 +1589,207 @@ namespace util {
             if (meshIndex < 0) {
                 continue;
             }
-            m_meshGroups[meshIndex].m_nodeIndex = nodeIndex;
+            m_meshGroups[meshIndex].m_nodeIndices.push_back(nodeIndex);
+        }
+    }
+
+    void DxrModel::DecodePrimitive(
+        const tinygltf::Model& inModel, const BufferTable& buffers,
+        const PrimitiveLayout& layout, VertexAttributeVisitor& visitor)
+    {
+        const auto& attributes = layout.primitive->attributes;
+        const auto vertexStart = layout.vertexStart;
+        const auto vertexCount = layout.vertexCount;
+
+        // 各属性は成分の型・ストライド・正規化指定に従って展開する.
+        //  頂点を持たないプリミティブはストリームの末尾を指すことがあるため、要素を参照せずに位置を求める.
+        auto decode = [&](const char* name, auto& stream, uint32_t components) {
+            if (auto attr = attributes.find(name); attr != attributes.end() && vertexCount > 0) {
+                auto src = GetAccessorLayout(inModel, inModel.accessors[attr->second], buffers);
+                src.count = std::min<size_t>(src.count, vertexCount);
+                DecodeAccessor(&(stream.data() + vertexStart)->x, components, src);
+            }
+        };
+        decode("POSITION", visitor.positionBuffer, 3);
+        decode("NORMAL", visitor.normalBuffer, 3);
+        decode("TEXCOORD_0", visitor.texcoordBuffer, 2);
+
+        // スキニング用のジョイント(インデックス)番号とウェイト値を読み取る.
+        decode("JOINTS_0", visitor.jointBuffer, 4);
+        decode("WEIGHTS_0", visitor.weightBuffer, 4);
+
+        //　インデックスバッファ用.
+        if (layout.indexCount > 0) {
+            auto& acc = inModel.accessors[layout.primitive->indices];
+            DecodeAccessor(visitor.indexBuffer.data() + layout.indexStart, 1, GetAccessorLayout(inModel, acc, buffers));
+        }
+    }
+
+    void DxrModel::WeldPrimitive(
+        PrimitiveLayout& layout, VertexAttributeVisitor& visitor, float epsilon)
+    {
+        if (layout.indexCount == 0) {
+            return;
+        }
+
+        // 位置・法線・UV・ジョイント・ウェイトを並べて比較用のキーとする.
+        const size_t KeyStride = 16;
+        std::vector<uint64_t> keys(size_t(layout.vertexCount) * KeyStride, 0);
+        auto quantize = [epsilon](uint64_t* dst, const float* src, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                dst[i] = QuantizeVertexValue(src[i], epsilon);
+            }
+        };
+        for (UINT i = 0; i < layout.vertexCount; ++i) {
+            auto v = layout.vertexStart + i;
+            auto key = &keys[i * KeyStride];
+            quantize(key + 0, &visitor.positionBuffer[v].x, 3);
+            quantize(key + 3, &visitor.normalBuffer[v].x, 3);
+            quantize(key + 6, &visitor.texcoordBuffer[v].x, 2);
+            if (!visitor.jointBuffer.empty()) {
+                const auto& joint = visitor.jointBuffer[v];
+                key[8] = joint.x;
+                key[9] = joint.y;
+                key[10] = joint.z;
+                key[11] = joint.w;
+            }
+            if (!visitor.weightBuffer.empty()) {
+                quantize(key + 12, &visitor.weightBuffer[v].x, 4);
+            }
+        }
+
+        std::vector<uint32_t> remap;
+        auto indices = visitor.indexBuffer.data() + layout.indexStart;
+        auto weldedCount = WeldVertices(
+            indices, layout.indexCount, keys.data(), KeyStride, layout.vertexCount, remap);
+        ForEachVertexStream(visitor, [&](auto& stream) {
+            if (!stream.empty()) {
+                RemapVertexStream(stream.data() + layout.vertexStart, layout.vertexCount, remap);
+            }
+        });
+        layout.vertexCount = UINT(weldedCount);
+    }
+
+    void DxrModel::OptimizePrimitive(
+        PrimitiveLayout& layout, VertexAttributeVisitor& visitor, MeshOptimizeReport& report)
+    {
+        if (layout.indexCount < 3) {
+            return;
+        }
+        auto indices = visitor.indexBuffer.data() + layout.indexStart;
+        report.before = AnalyzeVertexCache(indices, layout.indexCount, layout.vertexCount);
+
+        // 三角形の並べ替え後、頂点を参照順に並べ替える.
+        //  参照されない頂点はここで取り除かれる.
+        OptimizeVertexCache(indices, layout.indexCount, layout.vertexCount);
+        std::vector<uint32_t> remap;
+        auto usedCount = OptimizeVertexFetch(indices, layout.indexCount, layout.vertexCount, remap);
+        ForEachVertexStream(visitor, [&](auto& stream) {
+            if (!stream.empty()) {
+                RemapVertexStream(stream.data() + layout.vertexStart, layout.vertexCount, remap);
+            }
+        });
+        layout.vertexCount = UINT(usedCount);
+
+        report.after = AnalyzeVertexCache(indices, layout.indexCount, layout.vertexCount);
+    }
+
+    void DxrModel::ClusterPrimitive(
+        const PrimitiveLayout& layout, VertexAttributeVisitor& visitor,
+        UINT maxClusterTriangles, std::vector<MeshCluster>& clusters)
+    {
+        if (layout.indexCount < 3) {
+            return;
+        }
+        // 上限の指定が無い場合はプリミティブ全体を1つのクラスタとする.
+        size_t maxTriangles = layout.indexCount / 3;
+        if (maxClusterTriangles > 0) {
+            maxTriangles = maxClusterTriangles;
         }
+        BuildMeshClusters(
+            visitor.indexBuffer.data() + layout.indexStart, layout.indexCount,
+            visitor.positionBuffer.data() + layout.vertexStart, maxTriangles, clusters);
+    }
+
+    void DxrModel::SplitMeshClusters(const std::vector<std::vector<MeshCluster>>& clusters)
+    {
+        // メッシュは LoadMesh でプリミティブ順に並べたため、clusters と同じ順に対応する.
+        //  クラスタは元のメッシュの頂点範囲とマテリアルを共有し、インデックスの範囲のみ分ける.
+        size_t primitiveIndex = 0;
+        for (auto& group : m_meshGroups) {
+            std::vector<Mesh> meshes;
+            meshes.reserve(group.m_meshes.size());
+            for (const auto& mesh : group.m_meshes) {
+                const auto& list = clusters[primitiveIndex++];
+                if (list.empty()) {
+                    meshes.push_back(mesh);
+                    continue;
+                }
+                for (const auto& cluster : list) {
+                    meshes.push_back(mesh);
+                    auto& dst = meshes.back();
+                    dst.indexStart = mesh.indexStart + cluster.indexStart;
+                    dst.indexCount = cluster.indexCount;
+                    dst.boundsMin = cluster.boundsMin;
+                    dst.boundsMax = cluster.boundsMax;
+                }
+            }
+            group.m_meshes.swap(meshes);
+        }
+    }
+
+    void DxrModel::CompactVertexStreams(
+        std::vector<PrimitiveLayout>& layouts, VertexAttributeVisitor& visitor)
+    {
+        UINT vertexTotal = 0;
+        for (auto& layout : layouts) {
+            if (layout.vertexStart != vertexTotal) {
+                // 書き込み先は常に読み込み元より前になるため、前から順に移動できる.
+                ForEachVertexStream(visitor, [&](auto& stream) {
+                    if (!stream.empty()) {
+                        auto src = stream.begin() + layout.vertexStart;
+                        std::copy(src, src + layout.vertexCount, stream.begin() + vertexTotal);
+                    }
+                });
+            }
+            layout.vertexStart = vertexTotal;
+            auto& mesh = m_meshGroups[layout.groupIndex].m_meshes[layout.meshIndex];
+            mesh.vertexStart = vertexTotal;
+            mesh.vertexCount = layout.vertexCount;
+            vertexTotal += layout.vertexCount;
+        }
+        ForEachVertexStream(visitor, [&](auto& stream) {
+            if (!stream.empty()) {
+                stream.resize(vertexTotal);
+            }
+        });
+    }
 
+    void DxrModel::BuildIndexStream(const std::vector<UINT>& indices, bool allowIndex16, std::vector<uint8_t>& indexStream)
+    {
+        std::vector<IndexRange> ranges;
+        for (const auto& group : m_meshGroups) {
+            for (const auto& mesh : group.m_meshes) {
+                IndexRange range;
+                range.indexStart = mesh.indexStart;
+                range.indexCount = mesh.indexCount;
+                ranges.push_back(range);
+            }
+        }
+        PackIndexStream(indices, ranges, allowIndex16, indexStream);
+
+        // 決まった形式と格納位置をメッシュへ反映する.
+        auto range = ranges.begin();
+        for (auto& group : m_meshGroups) {
+            for (auto& mesh : group.m_meshes) {
+                mesh.indexStride = range->indexStride;
+                mesh.indexByteOffset = range->byteOffset;
+                ++range;
+            }
+        }
     }
 
-    void DxrModel::LoadSkin(const tinygltf::Model& inModel)
+    void DxrModel::LoadSkin(const tinygltf::Model& inModel, const BufferTable& buffers)
     {
         if (inModel.skins.empty()) {
             m_hasSkin = false;
@@ -473,15 +1804,10 @@ namespace util {
 
         if (inSkin.inverseBindMatrices > -1) {
             const auto& acc = inModel.accessors[inSkin.inverseBindMatrices];
-            const auto& view = inModel.bufferViews[acc.bufferView];
-            const auto& buffer = inModel.buffers[view.buffer];
             m_skinInfo.invBindMatrices.resize(acc.count);
-
-            auto offsetBytes = acc.byteOffset + view.byteOffset;
-            memcpy(
-                m_skinInfo.invBindMatrices.data(),
-                &buffer.data[offsetBytes],
-                acc.count * sizeof(XMMATRIX));
+            DecodeAccessor(
+                reinterpret_cast<float*>(m_skinInfo.invBindMatrices.data()), 16,
+                GetAccessorLayout(inModel, acc, buffers));
         }
     }
     void DxrModel::LoadMaterial(const tinygltf::Model& inModel)
@@ -497,9 +1823,6 @@ namespace util {
                     auto textureIndex = value.second.TextureIndex();
                     material.m_textureIndex = textureIndex;
                 }
-                if (valueName == "normalTexture") {
-                    auto textureIndex = value.second.TextureIndex();
-                }
                 if (valueName == "baseColorFactor") {
                     auto color = value.second.ColorFactor();
                     material.m_diffuseColor = XMFLOAT3(
@@ -507,19 +1830,129 @@ namespace util {
                     );
                 }
             }
+            // 法線マップは additionalValues 側に格納される.
+            if (auto value = inMaterial.additionalValues.find("normalTexture"); value != inMaterial.additionalValues.end()) {
+                material.m_normalTextureIndex = value->second.TextureIndex();
+            }
         }
     }
 
+    void DxrModel::LoadAnimation(const tinygltf::Model& inModel, const BufferTable& buffers)
+    {
+        std::vector<float> times;
+        std::vector<XMFLOAT4> values;
+        for (const auto& inAnimation : inModel.animations) {
+            m_animations.emplace_back(AnimationClip());
+            auto& clip = m_animations.back();
+            clip.SetName(util::ConvertFromUTF8(inAnimation.name));
+
+            for (const auto& inChannel : inAnimation.channels) {
+                // モーフターゲットのウェイト(weights)は扱わない.
+                AnimationPath path;
+                if (inChannel.target_path == "translation") {
+                    path = AnimationPath::Translation;
+                } else if (inChannel.target_path == "rotation") {
+                    path = AnimationPath::Rotation;
+                } else if (inChannel.target_path == "scale") {
+                    path = AnimationPath::Scale;
+                } else {
+                    continue;
+                }
+                if (inChannel.target_node < 0 || inChannel.target_node >= int(m_nodes.size())) {
+                    continue;
+                }
+
+                const auto& sampler = inAnimation.samplers[inChannel.sampler];
+                auto interpolation = AnimationInterpolation::Linear;
+                if (sampler.interpolation == "STEP") {
+                    interpolation = AnimationInterpolation::Step;
+                } else if (sampler.interpolation == "CUBICSPLINE") {
+                    interpolation = AnimationInterpolation::CubicSpline;
+                }
+
+                // 回転の正規化整数形式もここで float へ展開される.
+                const auto& input = inModel.accessors[sampler.input];
+                const auto& output = inModel.accessors[sampler.output];
+                const size_t keyCount = input.count;
+                const size_t valueCount = interpolation == AnimationInterpolation::CubicSpline ? keyCount * 3 : keyCount;
+                if (keyCount == 0 || output.count < valueCount) {
+                    continue;
+                }
+                times.resize(keyCount);
+                DecodeAccessor(times.data(), 1, GetAccessorLayout(inModel, input, buffers));
+                values.assign(output.count, XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+                DecodeAccessor(&values[0].x, 4, GetAccessorLayout(inModel, output, buffers));
+
+                clip.AddChannel(inChannel.target_node, path, interpolation, times.data(), keyCount, values.data());
+            }
+        }
+    }
+
+    void DxrModel::BuildAnimationSkeleton(AnimationSkeleton& skeleton, std::vector<float>& jointLengths) const
+    {
+        const size_t nodeCount = m_nodes.size();
+        skeleton.parents = m_nodeParents;
+        skeleton.translations.resize(nodeCount);
+        skeleton.rotations.resize(nodeCount);
+        skeleton.scales.resize(nodeCount);
+        for (size_t i = 0; i < nodeCount; ++i) {
+            XMStoreFloat3(&skeleton.translations[i], m_nodes[i]->translation);
+            XMStoreFloat4(&skeleton.rotations[i], m_nodes[i]->rotation);
+            XMStoreFloat3(&skeleton.scales[i], m_nodes[i]->scale);
+        }
+
+        // 各ノードの影響範囲として、子孫のノードまでの最大距離を求める.
+        jointLengths.assign(nodeCount, -1.0f);
+        std::function<float(int)> computeLength = [&](int index) {
+            if (jointLengths[index] < 0.0f) {
+                float length = 0.0f;
+                for (auto child : m_nodes[index]->children) {
+                    const float offset = XMVectorGetX(XMVector3Length(m_nodes[child]->translation));
+                    length = std::max(length, offset + computeLength(child));
+                }
+                jointLengths[index] = length;
+            }
+            return jointLengths[index];
+        };
+        for (int i = 0; i < int(nodeCount); ++i) {
+            computeLength(i);
+        }
+    }
+
+    void DxrModel::CompressAnimations(const AnimationCompressSettings& settings)
+    {
+        AnimationSkeleton skeleton;
+        std::vector<float> jointLengths;
+        BuildAnimationSkeleton(skeleton, jointLengths);
+
+        for (auto& clip : m_animations) {
+            AnimationCompressReport report;
+            clip.Compress(settings, jointLengths, &report, &skeleton);
+
+            wchar_t message[512];
+            swprintf_s(message,
+                L"CompressAnimation: %s %zu -> %zu bytes, %zu -> %zu keys (max error %.6f, object space %.6f), sample %.3f -> %.3f us\n",
+                clip.GetName().c_str(), report.sourceBytes, report.compressedBytes,
+                report.sourceKeys, report.compressedKeys, report.maxError, report.maxObjectError,
+                report.sourceSampleUs, report.compressedSampleUs);
+            OutputDebugStringW(message);
+        }
+    }
+
+    int DxrModel::FindAnimation(const std::wstring& name) const
+    {
+        for (size_t i = 0; i < m_animations.size(); ++i) {
+            if (m_animations[i].GetName() == name) {
+                return int(i);
+            }
+        }
+        return -1;
+    }
+
     DxrModelActor::Node::Node() {
-        translation = XMVectorZero();
-        rotation = XMQuaternionIdentity();
-        scale = XMVectorZero();
-        mtxLocal = XMMatrixIdentity();
-        mtxWorld = XMMatrixIdentity();
     }
 
     DxrModelActor::Node::~Node() {
-        children.clear();
     }
 
     DxrModelActor::Material::Material(
@@ -564,86 +1997,98 @@ namespace util {
     void DxrModelActor::ApplyTransform()
     {
         auto frameIndex = m_device->GetCurrentFrameIndex();
-        if (IsSkinned()) {
-            const auto& skin = m_skinInfo;
+        if (IsSkinned() && !m_instances.empty()) {
+            auto& skin = m_skinInfo;
             const auto jointCount = skin.jointList.size();
-            auto meshAttached = m_meshGroups[0].GetNode();
-            auto meshInvMatrix = XMMatrixInverse(nullptr, meshAttached->GetWorldMatrix());
-
-            std::vector<XMMATRIX> matrices(jointCount);
-            for (UINT i = 0; i < UINT(skin.jointList.size()); ++i) {
-                auto node = skin.jointList[i];
-                auto mtx = skin.invBindMatrices[i] * node->GetWorldMatrix() * meshInvMatrix;
-                matrices[i] = XMMatrixTranspose(mtx);
-            }
 
             auto jointCB = GetJointMatrixBuffer();
             void* p = nullptr;
             UINT bufferRegion = UINT(sizeof(XMFLOAT4X4) * jointCount);
             D3D12_RANGE range{ 0, bufferRegion };
-            range.Begin = frameIndex * bufferRegion;
+            range.Begin = frameIndex * skin.jointBufferStride + skin.jointBufferOffset;
             range.End += range.Begin;
-            jointCB->Map(0, &range, &p);
+            // CPU からは読み出さない.
+            D3D12_RANGE readRange{ 0, 0 };
+            jointCB->Map(0, &readRange, &p);
             if (p) {
-                auto dst = static_cast<uint8_t*>(p) + range.Begin;
-                memcpy(dst, matrices.data(), bufferRegion);
+                WriteJointData(static_cast<uint8_t*>(p) + range.Begin);
                 jointCB->Unmap(0, &range);
             }
         }
+    }
 
-        // BLAS の作成・更新時で使うマトリックスのバッファを更新する.
-        std::vector<XMFLOAT3X4> blasMatrices;
-        auto groupCount = UINT(m_meshGroups.size());
-        blasMatrices.resize(groupCount);
-        for (UINT i = 0; i < groupCount; ++i) {
-            auto node = m_meshGroups[i].m_node;
-            if (IsSkinned()) {
-                XMStoreFloat3x4(&blasMatrices[i], node->GetWorldMatrix());
-            } else {
-                // TLASで設定した行列成分を打ち消すために必要.
-                auto invRoot = XMMatrixInverse(nullptr, this->m_mtxWorld);
-                XMStoreFloat3x4(&blasMatrices[i], node->GetWorldMatrix() * invRoot);
-            }
-        }
+    void DxrModelActor::WriteJointData(void* dst)
+    {
+        auto& skin = m_skinInfo;
+        const auto jointCount = skin.jointList.size();
+        auto meshAttached = m_instances[0].GetNode();
+        auto meshInvMatrix = InverseAffine(meshAttached->GetWorldMatrix());
+        BuildJointData(
+            skin.invBindMatrices.data(), m_hierarchy.GetWorldMatrices(),
+            skin.jointIndices.data(), jointCount, meshInvMatrix, m_skinningMethod, skin.palette, dst);
+    }
 
-        auto bufferBytes = UINT(sizeof(XMFLOAT3X4) * groupCount);
-        void* mapped = nullptr;
-        D3D12_RANGE range;
-        range.Begin = bufferBytes * frameIndex;
-        range.End = range.Begin + bufferBytes;
-        m_blasMatrices->Map(0, &range, &mapped);
-        if (mapped) {
-            auto p = static_cast<uint8_t*>(mapped) + range.Begin;
-            memcpy(p, blasMatrices.data(), bufferBytes);
-            m_blasMatrices->Unmap(0, &range);
+    void DxrModelActor::GetJointPalette(std::vector<XMFLOAT4X4>& palette) const
+    {
+        palette.clear();
+        if (!IsSkinned() || m_instances.empty()) {
+            return;
         }
+        const auto& skin = m_skinInfo;
+        auto meshInvMatrix = InverseAffine(m_instances[0].GetNode()->GetWorldMatrix());
+        palette.resize(skin.jointList.size());
+        ComputeJointPalette(
+            skin.invBindMatrices.data(), m_hierarchy.GetWorldMatrices(),
+            skin.jointIndices.data(), palette.size(), meshInvMatrix, palette.data());
     }
 
-    std::shared_ptr<DxrModelActor::Node> DxrModelActor::SearchNode(const std::wstring& name)
+    void DxrModelActor::GetJointDualQuaternions(std::vector<XMFLOAT4>& dualQuaternions) const
     {
-        std::shared_ptr<Node> result = nullptr;
-        for (auto node : m_nodes) {
-            result = SearchNode(node, name);
-            if (result) {
+        std::vector<XMFLOAT4X4> palette;
+        GetJointPalette(palette);
+        dualQuaternions.resize(palette.size() * 2);
+        ComputeJointDualQuaternions(palette.data(), palette.size(), dualQuaternions.data());
+    }
+
+    void DxrModelActor::ApplyAnimation(const AnimationClip& clip, float time, QuaternionBlend blend)
+    {
+        // 全チャンネルをまとめて評価した後、対象のノードへ書き込む.
+        m_animationValues.resize(clip.GetChannelCount());
+        clip.Sample(time, m_animationValues.data(), blend);
+
+        for (size_t i = 0; i < clip.GetChannelCount(); ++i) {
+            const auto& channel = clip.GetChannel(i);
+            if (channel.targetNode < 0 || channel.targetNode >= int(m_nodeTable.size())) {
+                continue;
+            }
+            auto& node = m_nodeTable[channel.targetNode];
+            const auto& value = m_animationValues[i];
+            switch (channel.path) {
+            case AnimationPath::Translation:
+                node->SetTranslation(value);
+                break;
+            case AnimationPath::Rotation:
+                node->SetRotation(value);
+                break;
+            case AnimationPath::Scale:
+                node->SetScale(value);
                 break;
             }
         }
-        return result;
     }
-    std::shared_ptr<DxrModelActor::Node> DxrModelActor::SearchNode(
-        std::shared_ptr<Node> node, const std::wstring& name)
+
+    std::shared_ptr<DxrModelActor::Node> DxrModelActor::SearchNode(const std::wstring& name)
     {
-        if (node->GetName() == name) {
-            return node;
-        }
-        std::shared_ptr<Node> result = nullptr;
-        for (auto child : node->children) {
-            result = SearchNode(child, name);
-            if (result) {
-                break;
-            }
+        // モデル側の名前の索引を共有して引く.
+        const int index = m_modelReference->FindNode(name);
+        return index < 0 ? nullptr : m_nodeTable[index];
+    }
+
+    void DxrModelActor::SearchNodes(const std::wstring* names, size_t count, SpNode* nodes)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            nodes[i] = SearchNode(names[i]);
         }
-        return result;
     }
 
 
@@ -659,6 +2104,12 @@ namespace util {
             m_device->DeallocateDescriptor(m_skinInfo.jointMatricesDescriptor);
             m_device->DeallocateDescriptor(m_skinInfo.vbPositionDescriptor);
             m_device->DeallocateDescriptor(m_skinInfo.vbNormalDescriptor);
+            for (auto& descriptor : m_skinInfo.bufJointMatricesDescriptors) {
+                m_device->DeallocateDescriptor(descriptor);
+            }
+            for (auto& descriptor : m_skinInfo.bufJointDualQuatsDescriptors) {
+                m_device->DeallocateDescriptor(descriptor);
+            }
         }
         m_nodes.clear();
         m_skinInfo.jointList.clear();
@@ -666,36 +2117,43 @@ namespace util {
 
     void DxrModelActor::CreateBLAS()
     {
-        std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> rtGeomDesc;
-        CreateRtGeometryDesc(rtGeomDesc);
-
-        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildASDesc{};
-        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS& inputs = buildASDesc.Inputs;
-        inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
-        inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-        inputs.NumDescs = UINT(rtGeomDesc.size());
-        inputs.pGeometryDescs = rtGeomDesc.data();
-        // 動的更新を考慮するため許可フラグをつける.
-        inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
-
-        // AS 用のバッファを作成.
+        // 全メッシュの BLAS をまとめて構築する.
         auto command = m_device->CreateCommandList();
-
-        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info = {};
-        m_device->GetDevice()->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
-        auto asb = util::CreateAccelerationStructure(
-            m_device, buildASDesc
-        );
-        m_blas = asb.asbuffer;
-        m_blasUpdateBuffer = asb.update;
-
-        buildASDesc.DestAccelerationStructureData = asb.asbuffer->GetGPUVirtualAddress();
-        buildASDesc.ScratchAccelerationStructureData = asb.scratch->GetGPUVirtualAddress();
-
-        command->BuildRaytracingAccelerationStructure(&buildASDesc, 0, nullptr);
-        auto barrier = CD3DX12_RESOURCE_BARRIER::UAV(m_blas.Get());
-        command->ResourceBarrier(1, &barrier);
-
+        std::vector<ComPtr<ID3D12Resource>> scratchBuffers;
+        std::vector<D3D12_RESOURCE_BARRIER> barriers;
+        for (auto& meshGroup : m_meshGroups) {
+            std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> rtGeomDesc;
+            CreateRtGeometryDesc(meshGroup, rtGeomDesc);
+
+            D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildASDesc{};
+            D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS& inputs = buildASDesc.Inputs;
+            inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+            inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+            inputs.NumDescs = UINT(rtGeomDesc.size());
+            inputs.pGeometryDescs = rtGeomDesc.data();
+            // スキニングモデルは頂点が変化するため更新を許可する.
+            //  非スキニングモデルの配置は TLAS のインスタンス行列で行うため BLAS は不変.
+            inputs.Flags = IsSkinned() ?
+                D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE :
+                D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+
+            // AS 用のバッファを作成.
+            auto asb = util::CreateAccelerationStructure(
+                m_device, buildASDesc
+            );
+            meshGroup.m_blas = asb.asbuffer;
+            meshGroup.m_blasUpdateBuffer = asb.update;
+            scratchBuffers.push_back(asb.scratch);
+
+            buildASDesc.DestAccelerationStructureData = asb.asbuffer->GetGPUVirtualAddress();
+            buildASDesc.ScratchAccelerationStructureData = asb.scratch->GetGPUVirtualAddress();
+
+            command->BuildRaytracingAccelerationStructure(&buildASDesc, 0, nullptr);
+            barriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(meshGroup.m_blas.Get()));
+        }
+        if (!barriers.empty()) {
+            command->ResourceBarrier(UINT(barriers.size()), barriers.data());
+        }
         command->Close();
 
         // BLAS の構築完了まで待つ.
@@ -704,115 +2162,110 @@ namespace util {
     }
     void DxrModelActor::UpdateBLAS(ComPtr<ID3D12GraphicsCommandList4> commandList)
     {
-        std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> rtGeomDesc;
-        CreateRtGeometryDesc(rtGeomDesc);
-
-        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildASDesc{};
-        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS& inputs = buildASDesc.Inputs;
-        inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
-        inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-        inputs.NumDescs = UINT(rtGeomDesc.size());
-        inputs.pGeometryDescs = rtGeomDesc.data();
-        // 更新を実施するためフラグを設定する.
-        inputs.Flags =
-            D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE |
-            D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
-        
-        auto frameIndex = m_device->GetCurrentFrameIndex();
-        // インプレース更新を行う.
-        auto update = m_blasUpdateBuffer;
-        buildASDesc.DestAccelerationStructureData = m_blas->GetGPUVirtualAddress();
-        buildASDesc.SourceAccelerationStructureData = m_blas->GetGPUVirtualAddress();
-        buildASDesc.ScratchAccelerationStructureData = update->GetGPUVirtualAddress();
-
-        // BLAS の再構築およびバリアの設定.
-        commandList->BuildRaytracingAccelerationStructure(&buildASDesc, 0, nullptr);
-        auto barrier = CD3DX12_RESOURCE_BARRIER::UAV(m_blas.Get());
-        commandList->ResourceBarrier(1, &barrier);
+        // 頂点が変化しない場合は更新不要.
+        if (IsSkinned() == false) {
+            return;
+        }
+        std::vector<D3D12_RESOURCE_BARRIER> barriers;
+        for (const auto& meshGroup : m_meshGroups) {
+            std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> rtGeomDesc;
+            CreateRtGeometryDesc(meshGroup, rtGeomDesc);
+
+            D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildASDesc{};
+            D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS& inputs = buildASDesc.Inputs;
+            inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+            inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+            inputs.NumDescs = UINT(rtGeomDesc.size());
+            inputs.pGeometryDescs = rtGeomDesc.data();
+            // 更新を実施するためフラグを設定する.
+            inputs.Flags =
+                D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE |
+                D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+
+            // インプレース更新を行う.
+            auto blas = meshGroup.m_blas;
+            buildASDesc.DestAccelerationStructureData = blas->GetGPUVirtualAddress();
+            buildASDesc.SourceAccelerationStructureData = blas->GetGPUVirtualAddress();
+            buildASDesc.ScratchAccelerationStructureData = meshGroup.m_blasUpdateBuffer->GetGPUVirtualAddress();
+
+            // BLAS の再構築.
+            commandList->BuildRaytracingAccelerationStructure(&buildASDesc, 0, nullptr);
+            barriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(blas.Get()));
+        }
+        if (!barriers.empty()) {
+            commandList->ResourceBarrier(UINT(barriers.size()), barriers.data());
+        }
     }
 
-    void DxrModelActor::CreateRtGeometryDesc(std::vector<D3D12_RAYTRACING_GEOMETRY_DESC>& rtGeomDesc) {
-        // 安全な書き込み先(開始位置)を求める.
-        auto frameIndex = m_device->GetCurrentFrameIndex();
-        const auto matrixSize = sizeof(XMFLOAT3X4);
-        const auto matrixBufferSize = m_meshGroups.size() * matrixSize;
-        auto addressBase = m_blasMatrices->GetGPUVirtualAddress();
-        addressBase += matrixBufferSize * frameIndex;
-
+    void DxrModelActor::CreateRtGeometryDesc(
+        const MeshGroup& meshGroup, std::vector<D3D12_RAYTRACING_GEOMETRY_DESC>& rtGeomDesc) {
         ComPtr<ID3D12Resource> positionBuffer;
         if (IsSkinned() == false) {
             positionBuffer = m_modelReference->GetPositionBuffer();
         } else {
             positionBuffer = m_skinInfo.vbPositionTransformed;
         }
-        UINT matrixIndex = 0;
-        for (const auto& meshGroup : m_meshGroups) {
-            auto indexBuffer = m_modelReference->GetIndexBuffer();
-            for (const auto& mesh : meshGroup.m_meshes) {
-                rtGeomDesc.emplace_back(D3D12_RAYTRACING_GEOMETRY_DESC{});
-                auto& desc = rtGeomDesc.back();
-                auto& triangles = desc.Triangles;
-                //BLAS構築時にマトリックスを適用する.
-                triangles.Transform3x4 = addressBase + matrixIndex * matrixSize;
-                desc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
-                triangles.VertexBuffer.StrideInBytes = sizeof(XMFLOAT3);
-                triangles.VertexBuffer.StartAddress = positionBuffer->GetGPUVirtualAddress();
-                triangles.VertexBuffer.StartAddress += mesh.GetVertexStart() * sizeof(XMFLOAT3);
-                triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
-                triangles.VertexCount = mesh.GetVertexCount();
-
-                triangles.IndexBuffer = indexBuffer->GetGPUVirtualAddress();
-                triangles.IndexBuffer += mesh.GetIndexStart() * sizeof(UINT);
-                triangles.IndexCount = mesh.GetIndexCount();
-                triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
-                desc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
-            }
-            matrixIndex++;
-        }
-    }
-
-
-    void DxrModelActor::CreateMatrixBufferBLAS(UINT matrixCount) {
-        // 行列データは各フレームで更新されるため、アクセスする範囲を切り替えて使う.
-        const auto matrixStride = UINT(sizeof(XMFLOAT3X4));
-        const auto matrixCountAll = matrixCount * m_device->BackBufferCount;
-        auto bufferSize = matrixStride * matrixCountAll;
-
-        m_blasMatrices = util::CreateBuffer(m_device, bufferSize, nullptr, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_FLAG_NONE, L"MatrixBuffer(BLAS)");
-
-        // DXR のシェーダー内からのアクセスで使うためにSRVを生成.
-        auto countAsFloat4 = matrixCountAll * 3;
-        m_blasMatrixDescriptor = util::CreateStructuredSRV(m_device, m_blasMatrices.Get(), countAsFloat4, 0, sizeof(XMFLOAT4));
-    }
-
-    void DxrModelActor::UpdateMatrices() {
-        for (auto& node : m_nodes) {
-            node->UpdateMatrixHierarchy(m_mtxWorld);
+        auto indexBuffer = m_modelReference->GetIndexBuffer();
+        for (const auto& mesh : meshGroup.m_meshes) {
+            rtGeomDesc.emplace_back(D3D12_RAYTRACING_GEOMETRY_DESC{});
+            auto& desc = rtGeomDesc.back();
+            auto& triangles = desc.Triangles;
+            desc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
+            triangles.VertexBuffer.StrideInBytes = sizeof(XMFLOAT3);
+            triangles.VertexBuffer.StartAddress = positionBuffer->GetGPUVirtualAddress();
+            triangles.VertexBuffer.StartAddress += (m_skinInfo.vertexOffset + mesh.GetVertexStart()) * sizeof(XMFLOAT3);
+            triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+            triangles.VertexCount = mesh.GetVertexCount();
+
+            triangles.IndexBuffer = indexBuffer->GetGPUVirtualAddress();
+            triangles.IndexBuffer += mesh.GetIndexByteOffset();
+            triangles.IndexCount = mesh.GetIndexCount();
+            triangles.IndexFormat = mesh.GetIndexFormat();
+            desc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
         }
     }
 
-    void DxrModelActor::Node::UpdateLocalMatrix()
+    void DxrModelActor::AppendInstanceDescs(
+        std::vector<D3D12_RAYTRACING_INSTANCE_DESC>& instanceDescs, UINT hitGroupOffset) const
     {
-        auto mtxT = XMMatrixTranslationFromVector(translation);
-        auto mtxR = XMMatrixRotationQuaternion(rotation);
-        auto mtxS = XMMatrixScalingFromVector(scale);
-        mtxLocal = mtxS * mtxR * mtxT;
-    }
+        // メッシュごとのヒットグループのレコードの開始位置.
+        std::vector<UINT> groupHitGroupOffsets(m_meshGroups.size());
+        for (size_t i = 0; i < m_meshGroups.size(); ++i) {
+            groupHitGroupOffsets[i] = hitGroupOffset;
+            hitGroupOffset += UINT(m_meshGroups[i].m_meshes.size());
+        }
 
-    void DxrModelActor::Node::UpdateWorldMatrix(XMMATRIX mtxParent)
-    {
-        mtxWorld = mtxLocal * mtxParent;
+        // ノードのワールド行列は Actor の配置行列を含むため、そのままインスタンスの行列とする.
+        for (const auto& instance : m_instances) {
+            D3D12_RAYTRACING_INSTANCE_DESC desc{};
+            XMStoreFloat3x4(
+                reinterpret_cast<XMFLOAT3X4*>(&desc.Transform), instance.m_node->GetWorldMatrix());
+            desc.InstanceID = 0;
+            desc.InstanceMask = 0xFF;
+            desc.InstanceContributionToHitGroupIndex = groupHitGroupOffsets[instance.m_meshGroupIndex];
+            desc.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
+            desc.AccelerationStructure = m_meshGroups[instance.m_meshGroupIndex].m_blas->GetGPUVirtualAddress();
+            instanceDescs.push_back(desc);
+        }
     }
 
-    void DxrModelActor::Node::UpdateMatrixHierarchy(XMMATRIX mtxParent)
+    void DxrModelActor::UpdateInstanceDescs(D3D12_RAYTRACING_INSTANCE_DESC* instanceDescs) const
     {
-        UpdateLocalMatrix();
-        UpdateWorldMatrix(mtxParent);
-        for (auto& child : children) {
-            child->UpdateMatrixHierarchy(this->mtxWorld);
+        if (!IsTransformChanged()) {
+            return;
+        }
+        for (size_t i = 0; i < m_instances.size(); ++i) {
+            const auto& node = m_instances[i].m_node;
+            if (m_hierarchy.IsWorldChanged(node->m_index)) {
+                XMStoreFloat3x4(
+                    reinterpret_cast<XMFLOAT3X4*>(&instanceDescs[i].Transform), node->GetWorldMatrix());
+            }
         }
     }
 
+    void DxrModelActor::UpdateMatrices() {
+        m_transformUpdate = m_hierarchy.UpdateMatrices(m_mtxWorld);
+    }
 
     UINT DxrModelActor::GetSkinVertexCount() const
     {
@@ -846,13 +2299,98 @@ namespace util {
 
     dx12::Descriptor DxrModelActor::GetJointMatrixDescriptor() const
     {
-        if (IsSkinned()) {
+        // 群衆の Actor は個別のディスクリプタを持たない(DxrModelCrowd 側のものを使用する).
+        if (IsSkinned() && !m_skinInfo.bufJointMatricesDescriptors.empty()) {
             auto writeIndex = GetWriteIndex();
             return m_skinInfo.bufJointMatricesDescriptors[writeIndex];
         }
         return dx12::Descriptor();
     }
 
+    dx12::Descriptor DxrModelActor::GetJointDualQuaternionDescriptor() const
+    {
+        if (IsSkinned() && !m_skinInfo.bufJointDualQuatsDescriptors.empty()) {
+            auto writeIndex = GetWriteIndex();
+            return m_skinInfo.bufJointDualQuatsDescriptors[writeIndex];
+        }
+        return dx12::Descriptor();
+    }
 
 
+    DxrModelCrowd::DxrModelCrowd(
+        std::unique_ptr<dx12::GraphicsDevice>& device,
+        const DxrModel* model) : m_modelReference(model), m_device(device)
+    {
+    }
+    DxrModelCrowd::~DxrModelCrowd()
+    {
+        m_actors.clear();
+        for (auto& descriptor : m_bufJointMatricesDescriptors) {
+            m_device->DeallocateDescriptor(descriptor);
+        }
+        for (auto& descriptor : m_bufJointDualQuatsDescriptors) {
+            m_device->DeallocateDescriptor(descriptor);
+        }
+    }
+
+    void DxrModelCrowd::UpdateMatrices()
+    {
+        // 各 Actor の階層は独立しているため並列に更新できる.
+        std::for_each(std::execution::par, m_actors.begin(), m_actors.end(),
+            [](const std::shared_ptr<DxrModelActor>& actor) { actor->UpdateMatrices(); });
+    }
+
+    bool DxrModelCrowd::IsPoseChanged() const
+    {
+        return std::any_of(m_actors.begin(), m_actors.end(),
+            [](const std::shared_ptr<DxrModelActor>& actor) { return actor->IsPoseChanged(); });
+    }
+
+    void DxrModelCrowd::ApplyTransform()
+    {
+        if (m_actors.empty()) {
+            return;
+        }
+        auto frameIndex = m_device->GetCurrentFrameIndex();
+        size_t frameRegion = sizeof(XMFLOAT4X4) * m_jointCount * m_actorCount;
+        D3D12_RANGE range{ frameIndex * frameRegion, (frameIndex + 1) * frameRegion };
+        // CPU からは読み出さない.
+        D3D12_RANGE readRange{ 0, 0 };
+        void* p = nullptr;
+        m_bufJointMatrices->Map(0, &readRange, &p);
+        if (p) {
+            // 書き込み先は Actor ごとに分かれているため、マップは1回のみとして Actor 単位で並列に求める.
+            auto dst = static_cast<uint8_t*>(p) + range.Begin;
+            std::for_each(std::execution::par, m_actors.begin(), m_actors.end(),
+                [dst](const std::shared_ptr<DxrModelActor>& actor) {
+                    actor->WriteJointData(dst + actor->m_skinInfo.jointBufferOffset);
+                });
+            m_bufJointMatrices->Unmap(0, &range);
+        }
+    }
+
+    void DxrModelCrowd::SetSkinningMethod(SkinningMethod method)
+    {
+        m_skinningMethod = method;
+        for (auto& actor : m_actors) {
+            actor->SetSkinningMethod(method);
+        }
+    }
+
+    dx12::Descriptor DxrModelCrowd::GetJointMatrixDescriptor() const
+    {
+        return m_bufJointMatricesDescriptors[m_device->GetCurrentFrameIndex()];
+    }
+
+    dx12::Descriptor DxrModelCrowd::GetJointDualQuaternionDescriptor() const
+    {
+        return m_bufJointDualQuatsDescriptors[m_device->GetCurrentFrameIndex()];
+    }
+
+    void DxrModelCrowd::UpdateBLAS(ComPtr<ID3D12GraphicsCommandList4> commandList)
+    {
+        for (auto& actor : m_actors) {
+            actor->UpdateBLAS(commandList);
+        }
+    }
 }
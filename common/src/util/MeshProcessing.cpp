@@ -0,0 +1,498 @@
+﻿#include "util/MeshProcessing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <DirectXPackedVector.h>
+
+namespace util {
+
+    namespace {
+        // 並べ替えで想定するキャッシュサイズとスコアの調整値.
+        const int MaxCacheSize = 32;
+        const float CacheDecayPower = 1.5f;
+        const float LastTriangleScore = 0.75f;
+        const float ValenceBoostScale = 2.0f;
+        const float ValenceBoostPower = 0.5f;
+
+        // 頂点のスコアを求める.
+        //  キャッシュ内で新しい頂点ほど、また残りの参照数が少ない頂点ほど高くなる.
+        float ComputeVertexScore(int cachePosition, uint32_t remainingValence)
+        {
+            if (remainingValence == 0) {
+                return -1.0f;
+            }
+            float score = 0.0f;
+            if (cachePosition >= 0) {
+                if (cachePosition < 3) {
+                    // 直前の三角形で使われた頂点は固定値とする.
+                    score = LastTriangleScore;
+                } else {
+                    float scale = 1.0f / (MaxCacheSize - 3);
+                    score = std::pow(1.0f - (cachePosition - 3) * scale, CacheDecayPower);
+                }
+            }
+            score += ValenceBoostScale * std::pow(float(remainingValence), -ValenceBoostPower);
+            return score;
+        }
+    }
+
+    VertexCacheStatistics AnalyzeVertexCache(
+        const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+    {
+        VertexCacheStatistics stats;
+        stats.triangleCount = indexCount / 3;
+        stats.vertexCount = vertexCount;
+
+        // 各頂点が最後にキャッシュへ入った時刻を記録して FIFO を模擬する.
+        std::vector<size_t> timestamps(vertexCount, 0);
+        size_t time = size_t(cacheSize) + 1;
+        for (size_t i = 0; i < indexCount; ++i) {
+            auto v = indices[i];
+            if (time - timestamps[v] > cacheSize) {
+                timestamps[v] = time++;
+                stats.cacheMisses++;
+            }
+        }
+        return stats;
+    }
+
+    void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+    {
+        const size_t triangleCount = indexCount / 3;
+        if (triangleCount == 0) {
+            return;
+        }
+
+        // 頂点ごとに参照している三角形の一覧を作る.
+        std::vector<uint32_t> valence(vertexCount, 0);
+        for (size_t i = 0; i < triangleCount * 3; ++i) {
+            valence[indices[i]]++;
+        }
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            offsets[v + 1] = offsets[v] + valence[v];
+        }
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        {
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t t = 0; t < triangleCount; ++t) {
+                for (size_t k = 0; k < 3; ++k) {
+                    adjacency[fill[indices[t * 3 + k]]++] = uint32_t(t);
+                }
+            }
+        }
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            vertexScore[v] = ComputeVertexScore(-1, valence[v]);
+        }
+        std::vector<float> triangleScore(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        auto scoreTriangle = [&](size_t t) {
+            return vertexScore[indices[t * 3 + 0]] +
+                vertexScore[indices[t * 3 + 1]] +
+                vertexScore[indices[t * 3 + 2]];
+        };
+
+        // 最初の三角形は全体で最もスコアの高いものとする.
+        size_t bestTriangle = 0;
+        for (size_t t = 0; t < triangleCount; ++t) {
+            triangleScore[t] = scoreTriangle(t);
+            if (triangleScore[t] > triangleScore[bestTriangle]) {
+                bestTriangle = t;
+            }
+        }
+
+        std::vector<uint32_t> result;
+        result.reserve(triangleCount * 3);
+        std::vector<uint32_t> cache, newCache;
+        cache.reserve(MaxCacheSize + 3);
+        newCache.reserve(MaxCacheSize + 3);
+        size_t scanCursor = 0;
+
+        while (result.size() < triangleCount * 3) {
+            emitted[bestTriangle] = true;
+            const uint32_t* tri = indices + bestTriangle * 3;
+
+            // 出力した三角形を各頂点の参照一覧から取り除く.
+            newCache.clear();
+            for (size_t k = 0; k < 3; ++k) {
+                auto v = tri[k];
+                result.push_back(v);
+
+                auto begin = adjacency.begin() + offsets[v];
+                auto end = begin + valence[v];
+                auto it = std::find(begin, end, uint32_t(bestTriangle));
+                if (it != end) {
+                    std::iter_swap(it, end - 1);
+                    valence[v]--;
+                }
+                if (std::find(newCache.begin(), newCache.end(), v) == newCache.end()) {
+                    newCache.push_back(v);
+                }
+            }
+
+            // 使用した頂点をキャッシュの先頭へ移動する.
+            for (auto v : cache) {
+                if (std::find(newCache.begin(), newCache.end(), v) == newCache.end()) {
+                    newCache.push_back(v);
+                }
+            }
+            for (size_t i = 0; i < newCache.size(); ++i) {
+                auto v = newCache[i];
+                cachePosition[v] = i < MaxCacheSize ? int(i) : -1;
+                vertexScore[v] = ComputeVertexScore(cachePosition[v], valence[v]);
+            }
+
+            // キャッシュ内の頂点を使う三角形から次の三角形を選ぶ.
+            float bestScore = -1.0f;
+            bool found = false;
+            for (auto v : newCache) {
+                auto begin = adjacency.begin() + offsets[v];
+                auto end = begin + valence[v];
+                for (auto it = begin; it != end; ++it) {
+                    auto t = *it;
+                    triangleScore[t] = scoreTriangle(t);
+                    if (triangleScore[t] > bestScore) {
+                        bestScore = triangleScore[t];
+                        bestTriangle = t;
+                        found = true;
+                    }
+                }
+            }
+            if (newCache.size() > MaxCacheSize) {
+                newCache.resize(MaxCacheSize);
+            }
+            cache.swap(newCache);
+
+            // 候補が無い場合には未出力の三角形から選ぶ.
+            if (!found) {
+                while (scanCursor < triangleCount && emitted[scanCursor]) {
+                    ++scanCursor;
+                }
+                if (scanCursor == triangleCount) {
+                    break;
+                }
+                bestTriangle = scanCursor;
+            }
+        }
+        std::copy(result.begin(), result.end(), indices);
+    }
+
+    size_t WeldVertices(
+        uint32_t* indices, size_t indexCount,
+        const uint64_t* keys, size_t keyStride, size_t vertexCount, std::vector<uint32_t>& remap)
+    {
+        remap.assign(vertexCount, InvalidVertexIndex);
+
+        // オープンアドレス法のハッシュテーブルで、同じキーを持つ最初の頂点を探す.
+        size_t tableSize = 1;
+        while (tableSize < vertexCount * 2) {
+            tableSize <<= 1;
+        }
+        const size_t mask = tableSize - 1;
+        std::vector<uint32_t> table(tableSize, InvalidVertexIndex);
+        const size_t keySize = sizeof(uint64_t) * keyStride;
+
+        uint32_t uniqueCount = 0;
+        for (size_t v = 0; v < vertexCount; ++v) {
+            auto key = keys + v * keyStride;
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for (size_t k = 0; k < keyStride; ++k) {
+                hash ^= key[k];
+                hash *= 0x100000001b3ull;
+                hash ^= hash >> 29;
+            }
+            auto slot = size_t(hash) & mask;
+            while (table[slot] != InvalidVertexIndex) {
+                if (memcmp(keys + table[slot] * keyStride, key, keySize) == 0) {
+                    break;
+                }
+                slot = (slot + 1) & mask;
+            }
+            if (table[slot] == InvalidVertexIndex) {
+                table[slot] = uint32_t(v);
+                remap[v] = uniqueCount++;
+            } else {
+                remap[v] = remap[table[slot]];
+            }
+        }
+
+        for (size_t i = 0; i < indexCount; ++i) {
+            indices[i] = remap[indices[i]];
+        }
+        return uniqueCount;
+    }
+
+    void EncodeOctahedralNormals(uint32_t* dst, const DirectX::XMFLOAT3* src, size_t count)
+    {
+        using namespace DirectX;
+        const XMVECTOR zero = XMVectorZero();
+        const XMVECTOR one = XMVectorSplatOne();
+        for (size_t i = 0; i < count; ++i) {
+            // |x|+|y|+|z| = 1 となる八面体へ射影する.
+            XMVECTOR n = XMLoadFloat3(&src[i]);
+            XMVECTOR sum = XMVector3Dot(XMVectorAbs(n), one);
+            n = XMVectorSelect(XMVectorDivide(n, sum), g_XMIdentityR2, XMVectorEqual(sum, zero));
+
+            // 下半球は対角線で折り返して上半球側へ重ねる.
+            XMVECTOR sign = XMVectorSelect(XMVectorNegate(one), one, XMVectorGreaterOrEqual(n, zero));
+            XMVECTOR yx = XMVectorSwizzle<XM_SWIZZLE_Y, XM_SWIZZLE_X, XM_SWIZZLE_Z, XM_SWIZZLE_W>(XMVectorAbs(n));
+            XMVECTOR folded = XMVectorMultiply(XMVectorSubtract(one, yx), sign);
+            XMVECTOR isLower = XMVectorLess(XMVectorSplatZ(n), zero);
+            XMVECTOR oct = XMVectorSelect(n, folded, isLower);
+
+            PackedVector::XMSHORTN2 packed;
+            PackedVector::XMStoreShortN2(&packed, oct);
+            memcpy(&dst[i], &packed, sizeof(uint32_t));
+        }
+    }
+
+    DirectX::XMFLOAT3 DecodeOctahedralNormal(uint32_t packed)
+    {
+        using namespace DirectX;
+        PackedVector::XMSHORTN2 encoded;
+        memcpy(&encoded, &packed, sizeof(uint32_t));
+        XMFLOAT2 e;
+        XMStoreFloat2(&e, PackedVector::XMLoadShortN2(&encoded));
+
+        XMFLOAT3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+        float t = std::max(-n.z, 0.0f);
+        n.x += n.x >= 0.0f ? -t : t;
+        n.y += n.y >= 0.0f ? -t : t;
+        XMFLOAT3 result;
+        XMStoreFloat3(&result, XMVector3Normalize(XMLoadFloat3(&n)));
+        return result;
+    }
+
+    void EncodeHalfTexcoords(uint32_t* dst, const DirectX::XMFLOAT2* src, size_t count)
+    {
+        using namespace DirectX::PackedVector;
+        XMConvertFloatToHalfStream(
+            reinterpret_cast<HALF*>(dst), sizeof(HALF),
+            &src[0].x, sizeof(float), count * 2);
+    }
+
+    DirectX::XMFLOAT2 DecodeHalfTexcoord(uint32_t packed)
+    {
+        using namespace DirectX::PackedVector;
+        HALF h[2];
+        memcpy(h, &packed, sizeof(uint32_t));
+        return DirectX::XMFLOAT2(XMConvertHalfToFloat(h[0]), XMConvertHalfToFloat(h[1]));
+    }
+
+    size_t PruneSkinWeights(
+        DirectX::XMUINT4* joints, DirectX::XMFLOAT4* weights, size_t count, float threshold)
+    {
+        size_t prunedCount = 0;
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t* j = &joints[i].x;
+            float* w = &weights[i].x;
+
+            // ウェイトの大きい順に並べ替える(4 要素のため挿入ソート).
+            for (int a = 1; a < 4; ++a) {
+                for (int b = a; b > 0 && w[b] > w[b - 1]; --b) {
+                    std::swap(w[b], w[b - 1]);
+                    std::swap(j[b], j[b - 1]);
+                }
+            }
+
+            float sum = w[0];
+            for (int k = 1; k < 4; ++k) {
+                if (w[k] < threshold) {
+                    if (w[k] > 0.0f) {
+                        ++prunedCount;
+                    }
+                    w[k] = 0.0f;
+                    j[k] = 0;
+                }
+                sum += w[k];
+            }
+            if (sum > 0.0f) {
+                for (int k = 0; k < 4; ++k) {
+                    w[k] /= sum;
+                }
+            }
+        }
+        return prunedCount;
+    }
+
+    void EncodeSkinInfluences(
+        uint32_t* dstJoints, uint32_t* dstWeights,
+        const DirectX::XMUINT4* joints, const DirectX::XMFLOAT4* weights, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t* j = &joints[i].x;
+            const float* w = &weights[i].x;
+
+            int quantized[4];
+            int sum = 0, largest = 0;
+            for (int k = 0; k < 4; ++k) {
+                quantized[k] = int(std::lround(std::min(std::max(w[k], 0.0f), 1.0f) * 255.0f));
+                sum += quantized[k];
+                if (w[k] > w[largest]) {
+                    largest = k;
+                }
+            }
+            if (sum > 0) {
+                quantized[largest] = std::min(std::max(quantized[largest] + 255 - sum, 0), 255);
+            }
+
+            uint32_t packedJoints = 0, packedWeights = 0;
+            for (int k = 0; k < 4; ++k) {
+                packedJoints |= (j[k] & 0xFF) << (k * 8);
+                packedWeights |= uint32_t(quantized[k]) << (k * 8);
+            }
+            dstJoints[i] = packedJoints;
+            dstWeights[i] = packedWeights;
+        }
+    }
+
+    void DecodeSkinInfluences(
+        uint32_t packedJoints, uint32_t packedWeights, DirectX::XMUINT4& joints, DirectX::XMFLOAT4& weights)
+    {
+        joints = DirectX::XMUINT4(
+            packedJoints & 0xFF, (packedJoints >> 8) & 0xFF, (packedJoints >> 16) & 0xFF, packedJoints >> 24);
+        weights = DirectX::XMFLOAT4(
+            float(packedWeights & 0xFF) / 255.0f, float((packedWeights >> 8) & 0xFF) / 255.0f,
+            float((packedWeights >> 16) & 0xFF) / 255.0f, float(packedWeights >> 24) / 255.0f);
+    }
+
+    void BuildMeshClusters(
+        uint32_t* indices, size_t indexCount, const DirectX::XMFLOAT3* positions,
+        size_t maxTrianglesPerCluster, std::vector<MeshCluster>& clusters)
+    {
+        using namespace DirectX;
+        clusters.clear();
+        const size_t triangleCount = indexCount / 3;
+        if (triangleCount == 0) {
+            return;
+        }
+        maxTrianglesPerCluster = std::max<size_t>(maxTrianglesPerCluster, 1);
+
+        std::vector<XMFLOAT3> centroids(triangleCount);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            auto p0 = XMLoadFloat3(&positions[indices[t * 3 + 0]]);
+            auto p1 = XMLoadFloat3(&positions[indices[t * 3 + 1]]);
+            auto p2 = XMLoadFloat3(&positions[indices[t * 3 + 2]]);
+            XMStoreFloat3(&centroids[t], XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), 1.0f / 3.0f));
+        }
+
+        // 分割が必要な範囲を積んで処理する.
+        std::vector<uint32_t> order(triangleCount);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            order[t] = uint32_t(t);
+        }
+        std::vector<std::pair<size_t, size_t>> ranges;
+        std::vector<std::pair<size_t, size_t>> stack = { { 0, triangleCount } };
+        while (!stack.empty()) {
+            auto [begin, end] = stack.back();
+            stack.pop_back();
+            if (end - begin <= maxTrianglesPerCluster) {
+                ranges.emplace_back(begin, end);
+                continue;
+            }
+            XMVECTOR minValue = XMLoadFloat3(&centroids[order[begin]]);
+            XMVECTOR maxValue = minValue;
+            for (size_t i = begin + 1; i < end; ++i) {
+                auto c = XMLoadFloat3(&centroids[order[i]]);
+                minValue = XMVectorMin(minValue, c);
+                maxValue = XMVectorMax(maxValue, c);
+            }
+            XMFLOAT3 extent;
+            XMStoreFloat3(&extent, XMVectorSubtract(maxValue, minValue));
+            int axis = 0;
+            if (extent.y > extent.x) {
+                axis = 1;
+            }
+            if (extent.z > (axis == 0 ? extent.x : extent.y)) {
+                axis = 2;
+            }
+
+            // 同じ座標の場合は三角形番号で順序を決める.
+            auto mid = begin + (end - begin) / 2;
+            std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                [&](uint32_t a, uint32_t b) {
+                    auto ca = (&centroids[a].x)[axis];
+                    auto cb = (&centroids[b].x)[axis];
+                    return ca < cb || (ca == cb && a < b);
+                });
+            // 後で前半から順に取り出されるよう、後半を先に積む.
+            stack.emplace_back(mid, end);
+            stack.emplace_back(begin, mid);
+        }
+
+        // クラスタごとに元の順序で並べてインデックスを書き戻す.
+        std::vector<uint32_t> src(indices, indices + triangleCount * 3);
+        for (const auto& [begin, end] : ranges) {
+            std::sort(order.begin() + begin, order.begin() + end);
+
+            MeshCluster cluster;
+            cluster.indexStart = uint32_t(begin * 3);
+            cluster.indexCount = uint32_t((end - begin) * 3);
+            XMVECTOR minValue = XMLoadFloat3(&positions[src[order[begin] * 3]]);
+            XMVECTOR maxValue = minValue;
+            for (size_t i = begin; i < end; ++i) {
+                for (size_t k = 0; k < 3; ++k) {
+                    auto index = src[order[i] * 3 + k];
+                    indices[i * 3 + k] = index;
+                    auto p = XMLoadFloat3(&positions[index]);
+                    minValue = XMVectorMin(minValue, p);
+                    maxValue = XMVectorMax(maxValue, p);
+                }
+            }
+            XMStoreFloat3(&cluster.boundsMin, minValue);
+            XMStoreFloat3(&cluster.boundsMax, maxValue);
+            clusters.push_back(cluster);
+        }
+    }
+
+    size_t OptimizeVertexFetch(
+        uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& remap)
+    {
+        remap.assign(vertexCount, InvalidVertexIndex);
+        uint32_t nextVertex = 0;
+        for (size_t i = 0; i < indexCount; ++i) {
+            auto& index = indices[i];
+            if (remap[index] == InvalidVertexIndex) {
+                remap[index] = nextVertex++;
+            }
+            index = remap[index];
+        }
+        return nextVertex;
+    }
+
+    void PackIndexStream(
+        const std::vector<uint32_t>& indices, std::vector<IndexRange>& ranges,
+        bool allowIndex16, std::vector<uint8_t>& stream)
+    {
+        // 1パス目: 全インデックスが 16bit に収まる範囲は 16bit 形式とし、
+        //  各範囲の格納位置を決める(ビューの開始位置のため 4 バイト境界に揃える).
+        size_t totalSize = 0;
+        for (auto& range : ranges) {
+            auto begin = indices.begin() + range.indexStart;
+            auto fits16 = allowIndex16 &&
+                std::all_of(begin, begin + range.indexCount, [](uint32_t v) { return v <= 0xFFFF; });
+            range.indexStride = fits16 ? sizeof(uint16_t) : sizeof(uint32_t);
+            range.byteOffset = uint32_t(totalSize);
+            totalSize += (size_t(range.indexCount) * range.indexStride + 3) & ~size_t(3);
+        }
+
+        // 2パス目: 決めた形式で詰め直す.
+        stream.assign(totalSize, 0);
+        for (const auto& range : ranges) {
+            auto src = indices.data() + range.indexStart;
+            auto dst = stream.data() + range.byteOffset;
+            if (range.indexStride == sizeof(uint16_t)) {
+                auto dst16 = reinterpret_cast<uint16_t*>(dst);
+                for (uint32_t i = 0; i < range.indexCount; ++i) {
+                    dst16[i] = uint16_t(src[i]);
+                }
+            } else {
+                memcpy(dst, src, sizeof(uint32_t) * range.indexCount);
+            }
+        }
+    }
+}
@@ -1,5 +1,6 @@
 #include "GraphicsDevice.h"
 #include "util/TextureResource.h"
+#include "util/DxrBookUtility.h"
 
 #include <DirectXTex.h>
 #include "d3dx12.h"
@@ -8,76 +9,348 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <execution>
+#include <filesystem>
+#include <chrono>
+#include <cmath>
 
 namespace util {
     using namespace DirectX;
     template<class T>
     using ComPtr = Microsoft::WRL::ComPtr<T>;
 
-    TextureResource LoadTextureFromMemory(
-        const void* data, UINT64 size,
-        std::unique_ptr<dx12::GraphicsDevice>& device)
+    namespace {
+        void CreateTextureSRV(
+            const TexMetadata& metadata, TextureResource& res,
+            std::unique_ptr<dx12::GraphicsDevice>& device)
+        {
+            res.srv = device->AllocateDescriptor();
+            D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+            srvDesc.Format = metadata.format;
+            srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+            if (metadata.IsCubemap()) {
+                srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+                srvDesc.TextureCube.MipLevels = UINT(metadata.mipLevels);
+                srvDesc.TextureCube.MostDetailedMip = 0;
+                srvDesc.TextureCube.ResourceMinLODClamp = 0;
+            }
+            else {
+                srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+                srvDesc.Texture2D.MipLevels = UINT(metadata.mipLevels);
+                srvDesc.Texture2D.MostDetailedMip = 0;
+                srvDesc.Texture2D.ResourceMinLODClamp = 0;
+            }
+            device->GetDevice()->CreateShaderResourceView(res.resource.Get(), &srvDesc, res.srv.hCpu);
+        }
+
+        // 摜̎荞݌ʂʂL[߂.
+        //  摜ɉāAʂɉeݒnbVlɊ܂߂.
+        uint64_t ComputeImageKey(
+            const ImageMemory& source, const MipmapSettings& mipmaps, const TextureCompressSettings& compression)
+        {
+            auto hash = ComputeHash64(source.data, size_t(source.size));
+            const float options[] = {
+                float(source.usage), float(compression.compress), float(compression.highQuality),
+                float(mipmaps.generateMips), float(mipmaps.filter), float(mipmaps.gammaCorrect), mipmaps.alphaReference,
+            };
+            return ComputeHash64(options, sizeof(options), hash);
+        }
+
+        // kς݃f[^̃LbVt@C߂.
+        std::filesystem::path GetCompressedCachePath(
+            const ImageMemory& source, const MipmapSettings& mipmaps, const TextureCompressSettings& compression)
+        {
+            auto hash = ComputeImageKey(source, mipmaps, compression);
+            wchar_t fileName[32];
+            swprintf_s(fileName, L"%016llx.dds", static_cast<unsigned long long>(hash));
+            return std::filesystem::path(compression.cacheDirectory) / fileName;
+        }
+    }
+
+    bool DecodeImage(const ImageMemory& source, DecodedImage& decoded, const MipmapSettings& mipmaps)
     {
-        DirectX::TexMetadata metadata;
-        DirectX::ScratchImage image;
+        // @}bv̓K}␳At@̕␳ɏk.
+        auto mipSettings = mipmaps;
+        if (source.usage == TextureUsage::Normal) {
+            mipSettings.gammaCorrect = false;
+            mipSettings.alphaReference = 0.0f;
+        }
+
+        // WIC ̓XbhƂ COM ̏KvƂȂ.
+        //  ɕʂ̃[hŏς݂̏ꍇ͂̂܂܎gp.
+        HRESULT hrCom = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
 
-        HRESULT hr = E_FAIL;
-        TextureResource res{};
-        hr = LoadFromDDSMemory(data, size, DDS_FLAGS_NONE, &metadata, image);
+        HRESULT hr = LoadFromDDSMemory(source.data, size_t(source.size), DDS_FLAGS_NONE, &decoded.metadata, decoded.image);
         if (FAILED(hr)) {
-            hr = LoadFromWICMemory(data, size, WIC_FLAGS_NONE/*WIC_FLAGS_FORCE_RGB*/, &metadata, image);
+            hr = LoadFromWICMemory(source.data, size_t(source.size), WIC_FLAGS_NONE/*WIC_FLAGS_FORCE_RGB*/, &decoded.metadata, decoded.image);
+        }
+        if (SUCCEEDED(hrCom)) {
+            CoUninitialize();
         }
         if (FAILED(hr)) {
-            return res;
+            decoded.image.Release();
+            return false;
+        }
+        if (mipmaps.generateMips) {
+            // Ɏsꍇ͌̃x݂̂Ŏgp.
+            GenerateMipChain(decoded, mipSettings);
         }
+        return true;
+    }
+
+    bool GenerateMipChain(DecodedImage& decoded, const MipmapSettings& mipmaps)
+    {
+        const auto& metadata = decoded.metadata;
+        if (metadata.mipLevels > 1 || metadata.dimension != TEX_DIMENSION_TEXTURE2D || IsCompressed(metadata.format)) {
+            return true;
+        }
+
+        TEX_FILTER_FLAGS filter = TEX_FILTER_BOX;
+        if (mipmaps.filter == MipmapSettings::Filter::Triangle) {
+            filter = TEX_FILTER_TRIANGLE;
+        }
+        if (mipmaps.gammaCorrect) {
+            filter |= TEX_FILTER_SRGB;
+        }
+
+        // ŏTCY(1x1)܂ł̑Sx𐶐.
+        ScratchImage mipChain;
+        HRESULT hr = GenerateMipMaps(
+            decoded.image.GetImages(), decoded.image.GetImageCount(), metadata, filter, 0, mipChain);
+        if (FAILED(hr)) {
+            return false;
+        }
+
+        // kŃAt@ωAAt@eXgŔʐςς̂␳.
+        //  ʂ̊i[͌̃~bv`FCƓ`ŊmۂĂKv.
+        //  ␳Ɏsꍇ͕␳Õ~bv`FCgp.
+        if (mipmaps.alphaReference > 0.0f && HasAlpha(metadata.format)) {
+            ScratchImage scaled;
+            hr = scaled.Initialize(mipChain.GetMetadata());
+            if (SUCCEEDED(hr)) {
+                hr = ScaleMipMapsAlphaForCoverage(
+                    mipChain.GetImages(), mipChain.GetImageCount(), mipChain.GetMetadata(),
+                    0, mipmaps.alphaReference, scaled);
+            }
+            if (SUCCEEDED(hr)) {
+                mipChain = std::move(scaled);
+            } else {
+                wchar_t message[128];
+                swprintf_s(message, L"ScaleMipMapsAlphaForCoverage failed (hr=0x%08X).\n", unsigned(hr));
+                OutputDebugStringW(message);
+            }
+        }
+
+        decoded.metadata = mipChain.GetMetadata();
+        decoded.image = std::move(mipChain);
+        return true;
+    }
+
+    std::vector<DecodedImage> DecodeImages(const std::vector<ImageMemory>& sources, const MipmapSettings& mipmaps)
+    {
+        // e摜͓ƗĂ邽߁AݐɊmۂĕɏ.
+        std::vector<DecodedImage> decoded(sources.size());
+        std::for_each(std::execution::par, sources.begin(), sources.end(),
+            [&](const ImageMemory& source) {
+                auto index = &source - sources.data();
+                DecodeImage(source, decoded[index], mipmaps);
+            });
+        return decoded;
+    }
+
+    DXGI_FORMAT SelectBlockCompressionFormat(
+        TextureUsage usage, const DecodedImage& decoded, bool highQuality)
+    {
+        const auto& metadata = decoded.metadata;
+        if (decoded.image.GetImageCount() == 0 || IsCompressed(metadata.format) ||
+            metadata.dimension != TEX_DIMENSION_TEXTURE2D ||
+            (metadata.width % 4) != 0 || (metadata.height % 4) != 0) {
+            return DXGI_FORMAT_UNKNOWN;
+        }
+        if (usage == TextureUsage::Normal) {
+            return DXGI_FORMAT_BC5_UNORM;
+        }
+        if (highQuality) {
+            return DXGI_FORMAT_BC7_UNORM;
+        }
+        return decoded.image.IsAlphaAllOpaque() ? DXGI_FORMAT_BC1_UNORM : DXGI_FORMAT_BC3_UNORM;
+    }
+
+    bool CompressImage(DecodedImage& decoded, DXGI_FORMAT format, float* psnr)
+    {
+        ScratchImage compressed;
+        HRESULT hr = Compress(
+            decoded.image.GetImages(), decoded.image.GetImageCount(), decoded.metadata,
+            format, TEX_COMPRESS_PARALLEL, TEX_THRESHOLD_DEFAULT, compressed);
+        if (FAILED(hr)) {
+            return false;
+        }
+
+        if (psnr) {
+            // l͈̔͂ [0,1] Ƃċ߂. 덷ꍇ͏lƂ.
+            float mse = 0.0f;
+            *psnr = 0.0f;
+            if (SUCCEEDED(ComputeMSE(*decoded.image.GetImage(0, 0, 0), *compressed.GetImage(0, 0, 0), mse, nullptr))) {
+                *psnr = mse > 0.0f ? 10.0f * std::log10(1.0f / mse) : 99.0f;
+            }
+        }
+
+        decoded.metadata = compressed.GetMetadata();
+        decoded.image = std::move(compressed);
+        return true;
+    }
+
+    bool ImportImage(
+        const ImageMemory& source, DecodedImage& decoded,
+        const MipmapSettings& mipmaps, const TextureCompressSettings& compression,
+        TextureImportReport* report)
+    {
+        TextureImportReport result;
+        std::filesystem::path cachePath;
+        if (compression.compress && !compression.cacheDirectory.empty()) {
+            cachePath = GetCompressedCachePath(source, mipmaps, compression);
+            MappedFile cacheFile;
+            if (cacheFile.Open(cachePath.wstring()) &&
+                SUCCEEDED(LoadFromDDSMemory(cacheFile.GetData(), cacheFile.GetSize(), DDS_FLAGS_NONE, &decoded.metadata, decoded.image))) {
+                result.cacheHit = true;
+                result.format = decoded.metadata.format;
+                if (report) {
+                    *report = result;
+                }
+                return true;
+            }
+        }
+
+        const auto timeDecodeStart = std::chrono::high_resolution_clock::now();
+        if (!DecodeImage(source, decoded, mipmaps)) {
+            return false;
+        }
+        const auto timeDecodeEnd = std::chrono::high_resolution_clock::now();
+        result.decodeMs = std::chrono::duration<double, std::milli>(timeDecodeEnd - timeDecodeStart).count();
+        result.pixelCount = decoded.metadata.width * decoded.metadata.height;
+
+        // kłȂꍇ͔񈳏k̂܂܎gp.
+        auto format = DXGI_FORMAT_UNKNOWN;
+        if (compression.compress) {
+            format = SelectBlockCompressionFormat(source.usage, decoded, compression.highQuality);
+        }
+        size_t blockCount = 0;
+        for (size_t i = 0; i < decoded.image.GetImageCount(); ++i) {
+            const auto& image = decoded.image.GetImages()[i];
+            blockCount += ((image.width + 3) / 4) * ((image.height + 3) / 4);
+        }
+        const auto timeStart = std::chrono::high_resolution_clock::now();
+        if (format != DXGI_FORMAT_UNKNOWN && CompressImage(decoded, format, &result.psnr)) {
+            const auto timeEnd = std::chrono::high_resolution_clock::now();
+            result.compressMs = std::chrono::duration<double, std::milli>(timeEnd - timeStart).count();
+            result.blockCount = blockCount;
+
+            if (!cachePath.empty()) {
+                std::error_code ec;
+                std::filesystem::create_directories(cachePath.parent_path(), ec);
+                SaveToDDSFile(
+                    decoded.image.GetImages(), decoded.image.GetImageCount(), decoded.metadata,
+                    DDS_FLAGS_NONE, cachePath.c_str());
+            }
+        }
+        result.format = decoded.metadata.format;
+        if (report) {
+            *report = result;
+        }
+        return true;
+    }
+
+    std::vector<DecodedImage> ImportImages(
+        const std::vector<ImageMemory>& sources,
+        const MipmapSettings& mipmaps, const TextureCompressSettings& compression,
+        std::vector<TextureImportReport>* reports)
+    {
+        std::vector<DecodedImage> decoded(sources.size());
+        if (reports) {
+            reports->assign(sources.size(), TextureImportReport());
+        }
+        std::for_each(std::execution::par, sources.begin(), sources.end(),
+            [&](const ImageMemory& source) {
+                auto index = &source - sources.data();
+                ImportImage(source, decoded[index], mipmaps, compression, reports ? &(*reports)[index] : nullptr);
+            });
+        return decoded;
+    }
 
-        CreateTexture(device->GetDevice().Get(), metadata, &res.resource);
+    std::vector<TextureResource> CreateTexturesFromImages(
+        const std::vector<DecodedImage>& images,
+        std::unique_ptr<dx12::GraphicsDevice>& device)
+    {
+        auto d3d12Device = device->GetDevice();
+        std::vector<TextureResource> textures(images.size());
+
+        // 1pX: eNX`𐶐AXe[WOobt@̔zu߂.
+        std::vector<std::vector<D3D12_SUBRESOURCE_DATA>> subresources(images.size());
+        std::vector<UINT64> stagingOffsets(images.size());
+        UINT64 totalBytes = 0;
+        for (size_t i = 0; i < images.size(); ++i) {
+            const auto& src = images[i];
+            if (src.image.GetImageCount() == 0) {
+                continue;
+            }
+            CreateTexture(d3d12Device.Get(), src.metadata, &textures[i].resource);
+            PrepareUpload(d3d12Device.Get(), src.image.GetImages(), src.image.GetImageCount(), src.metadata, subresources[i]);
+
+            stagingOffsets[i] = totalBytes;
+            totalBytes += GetRequiredIntermediateSize(textures[i].resource.Get(), 0, UINT(subresources[i].size()));
+            // eeNX`̓] 512 oCgEɔzu.
+            const UINT64 alignment = D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT;
+            totalBytes = (totalBytes + alignment - 1) & ~(alignment - 1);
+        }
+        if (totalBytes == 0) {
+            return textures;
+        }
 
-        ComPtr<ID3D12Resource> srcBuffer;
-        std::vector<D3D12_SUBRESOURCE_DATA> subresources;
-        PrepareUpload(device->GetDevice().Get(), image.GetImages(), image.GetImageCount(), metadata, subresources);
-        const auto totalBytes = GetRequiredIntermediateSize(res.resource.Get(), 0, UINT(subresources.size()));
-        
         auto staging = device->CreateBuffer(
             totalBytes, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_HEAP_TYPE_UPLOAD);
         staging->SetName(L"Tex-Staging");
 
+        // 2pX: SeNX`̓]1̃R}hXgɐς.
         auto command = device->CreateCommandList();
-        UpdateSubresources(
-            command.Get(),
-            res.resource.Get(),
-            staging.Get(),
-            0, 0, UINT(subresources.size()), subresources.data());
-        auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(res.resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-        command->ResourceBarrier(1, &barrier);
+        std::vector<D3D12_RESOURCE_BARRIER> barriers;
+        for (size_t i = 0; i < images.size(); ++i) {
+            auto& res = textures[i];
+            if (!res.resource) {
+                continue;
+            }
+            UpdateSubresources(
+                command.Get(),
+                res.resource.Get(),
+                staging.Get(),
+                stagingOffsets[i], 0, UINT(subresources[i].size()), subresources[i].data());
+            barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(
+                res.resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+
+            // VF[_[\[Xr[̍쐬.
+            CreateTextureSRV(images[i].metadata, res, device);
+        }
+        command->ResourceBarrier(UINT(barriers.size()), barriers.data());
         command->Close();
 
         // ]Jn.
         device->ExecuteCommandList(command);
 
-        // VF[_[\[Xr[̍쐬.
-        res.srv = device->AllocateDescriptor();
-        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
-        srvDesc.Format = metadata.format;
-        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        if (metadata.IsCubemap()) {
-            srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
-            srvDesc.TextureCube.MipLevels = UINT(metadata.mipLevels);
-            srvDesc.TextureCube.MostDetailedMip = 0;
-            srvDesc.TextureCube.ResourceMinLODClamp = 0;
-        }
-        else {
-            srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-            srvDesc.Texture2D.MipLevels = UINT(metadata.mipLevels);
-            srvDesc.Texture2D.MostDetailedMip = 0;
-            srvDesc.Texture2D.ResourceMinLODClamp = 0;
-        }
-        device->GetDevice()->CreateShaderResourceView(res.resource.Get(), &srvDesc, res.srv.hCpu);
-
         // ̊҂.
         device->WaitForIdleGpu();
 
-        return res;
+        return textures;
+    }
+
+    TextureResource LoadTextureFromMemory(
+        const void* data, UINT64 size,
+        std::unique_ptr<dx12::GraphicsDevice>& device)
+    {
+        std::vector<DecodedImage> images(1);
+        if (!DecodeImage(ImageMemory{ data, size }, images[0])) {
+            return TextureResource{};
+        }
+        return CreateTexturesFromImages(images, device)[0];
     }
 
     TextureResource LoadTextureFromFile(
@@ -94,5 +367,156 @@ namespace util {
         return LoadTextureFromMemory(buf.data(), buf.size(), device);
     }
 
-}
+    TextureCache& TextureCache::GetInstance()
+    {
+        static TextureCache instance;
+        return instance;
+    }
+
+    TextureResource TextureCache::LoadFromFile(
+        const std::wstring& fileName,
+        std::unique_ptr<dx12::GraphicsDevice>& device)
+    {
+        // t@C͓eǂ܂ɃpXŔ肷.
+        const auto path = std::filesystem::absolute(fileName).wstring();
+        const auto key = ComputeHash64(path.data(), path.size() * sizeof(wchar_t), ComputeHash64("file", 4));
 
+        TextureResource texture;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (AcquireLocked(key, texture)) {
+                m_statistics.hits++;
+                return texture;
+            }
+            m_statistics.misses++;
+        }
+        texture = LoadTextureFromFile(fileName, device);
+        if (texture.resource) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            RegisterLocked(key, texture, device);
+            AcquireLocked(key, texture);
+        }
+        return texture;
+    }
+
+    TextureResource TextureCache::LoadFromMemory(
+        const void* data, UINT64 size,
+        std::unique_ptr<dx12::GraphicsDevice>& device)
+    {
+        std::vector<ImageMemory> sources = { ImageMemory{ data, size } };
+        return Import(sources, MipmapSettings(), TextureCompressSettings(), device)[0];
+    }
+
+    std::vector<TextureResource> TextureCache::Import(
+        const std::vector<ImageMemory>& sources,
+        const MipmapSettings& mipmaps, const TextureCompressSettings& compression,
+        std::unique_ptr<dx12::GraphicsDevice>& device,
+        std::vector<TextureImportReport>* reports)
+    {
+        std::vector<uint64_t> keys(sources.size());
+        std::for_each(std::execution::par, sources.begin(), sources.end(),
+            [&](const ImageMemory& source) {
+                auto index = &source - sources.data();
+                keys[index] = ComputeImageKey(source, mipmaps, compression);
+            });
+
+        // LbVɖ̂W߂. Ăяoł̏d1ɂ܂Ƃ߂.
+        std::vector<TextureResource> textures(sources.size());
+        std::vector<ImageMemory> missSources;
+        std::vector<uint64_t> missKeys;
+        std::vector<size_t> missIndices;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (size_t i = 0; i < sources.size(); ++i) {
+                if (AcquireLocked(keys[i], textures[i])) {
+                    m_statistics.hits++;
+                    continue;
+                }
+                if (std::find(missKeys.begin(), missKeys.end(), keys[i]) == missKeys.end()) {
+                    missSources.push_back(sources[i]);
+                    missKeys.push_back(keys[i]);
+                    m_statistics.misses++;
+                } else {
+                    m_statistics.hits++;
+                }
+                missIndices.push_back(i);
+            }
+        }
+        if (reports) {
+            reports->assign(sources.size(), TextureImportReport());
+        }
+        if (missSources.empty()) {
+            return textures;
+        }
+
+        std::vector<TextureImportReport> missReports;
+        auto decoded = ImportImages(missSources, mipmaps, compression, &missReports);
+        auto created = CreateTexturesFromImages(decoded, device);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < created.size(); ++i) {
+            if (created[i].resource) {
+                RegisterLocked(missKeys[i], created[i], device);
+            }
+        }
+        for (auto index : missIndices) {
+            auto found = std::find(missKeys.begin(), missKeys.end(), keys[index]) - missKeys.begin();
+            if (reports) {
+                (*reports)[index] = missReports[found];
+            }
+            // fR[hɎŝ͋̂܂ܕԂ.
+            AcquireLocked(keys[index], textures[index]);
+        }
+        return textures;
+    }
+
+    void TextureCache::Release(const TextureResource& texture, std::unique_ptr<dx12::GraphicsDevice>& device)
+    {
+        if (!texture.resource) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_keyOfResource.find(texture.resource.Get());
+        if (found == m_keyOfResource.end()) {
+            return;
+        }
+        auto entry = m_entries.find(found->second);
+        if (--entry->second.refCount == 0) {
+            device->DeallocateDescriptor(entry->second.texture.srv);
+            m_entries.erase(entry);
+            m_keyOfResource.erase(found);
+        }
+    }
+
+    TextureCache::Statistics TextureCache::GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto statistics = m_statistics;
+        statistics.entryCount = m_entries.size();
+        return statistics;
+    }
+
+    bool TextureCache::AcquireLocked(uint64_t key, TextureResource& texture)
+    {
+        auto found = m_entries.find(key);
+        if (found == m_entries.end()) {
+            return false;
+        }
+        found->second.refCount++;
+        texture = found->second.texture;
+        return true;
+    }
+
+    void TextureCache::RegisterLocked(uint64_t key, TextureResource& texture, std::unique_ptr<dx12::GraphicsDevice>& device)
+    {
+        // ʂ̃Xbhɓo^Ăꍇ͂gÂ͔j.
+        //  QƃJEg AcquireLocked ő₷.
+        if (m_entries.count(key) != 0) {
+            device->DeallocateDescriptor(texture.srv);
+            return;
+        }
+        m_entries[key] = Entry{ texture, 0 };
+        m_keyOfResource[texture.resource.Get()] = key;
+    }
+
+}
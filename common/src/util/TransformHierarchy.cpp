@@ -0,0 +1,107 @@
+﻿#include "util/TransformHierarchy.h"
+#include "util/AffineTransform.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace util {
+    using namespace DirectX;
+
+    namespace {
+        // S * R * T の行列を組み立てる. 回転行列の各行をスケールし、平行移動を4行目に置く.
+        XMMATRIX ComposeAffine(FXMVECTOR translation, FXMVECTOR rotation, FXMVECTOR scale)
+        {
+            XMMATRIX m = XMMatrixRotationQuaternion(rotation);
+            m.r[0] = XMVectorMultiply(m.r[0], XMVectorSplatX(scale));
+            m.r[1] = XMVectorMultiply(m.r[1], XMVectorSplatY(scale));
+            m.r[2] = XMVectorMultiply(m.r[2], XMVectorSplatZ(scale));
+            m.r[3] = XMVectorSelect(g_XMIdentityR3, translation, g_XMSelect1110);
+            return m;
+        }
+    }
+
+    void TransformHierarchy::Clear()
+    {
+        m_translations.clear();
+        m_rotations.clear();
+        m_scales.clear();
+        m_localMatrices.clear();
+        m_worldMatrices.clear();
+        m_parents.clear();
+        m_localDirty.clear();
+        m_worldChanged.clear();
+        m_hasRootMatrix = false;
+    }
+
+    void TransformHierarchy::Reserve(size_t nodeCount)
+    {
+        m_translations.reserve(nodeCount);
+        m_rotations.reserve(nodeCount);
+        m_scales.reserve(nodeCount);
+        m_localMatrices.reserve(nodeCount);
+        m_worldMatrices.reserve(nodeCount);
+        m_parents.reserve(nodeCount);
+        m_localDirty.reserve(nodeCount);
+        m_worldChanged.reserve(nodeCount);
+    }
+
+    uint32_t TransformHierarchy::AddNode(int parent, FXMVECTOR translation, FXMVECTOR rotation, FXMVECTOR scale)
+    {
+        assert(parent < int(m_parents.size()));
+        const auto index = uint32_t(m_parents.size());
+        m_translations.emplace_back();
+        m_rotations.emplace_back();
+        m_scales.emplace_back();
+        XMStoreFloat4A(&m_translations.back(), translation);
+        XMStoreFloat4A(&m_rotations.back(), rotation);
+        XMStoreFloat4A(&m_scales.back(), scale);
+
+        XMFLOAT3X4A identity;
+        XMStoreFloat3x4A(&identity, XMMatrixIdentity());
+        m_localMatrices.push_back(identity);
+        m_worldMatrices.push_back(identity);
+        m_parents.push_back(parent);
+        m_localDirty.push_back(1);
+        m_worldChanged.push_back(0);
+        return index;
+    }
+
+    TransformUpdateResult TransformHierarchy::UpdateMatrices(FXMMATRIX mtxRoot)
+    {
+        XMFLOAT4X4 rootMatrix;
+        XMStoreFloat4x4(&rootMatrix, mtxRoot);
+        const bool isRootChanged = !m_hasRootMatrix || memcmp(&rootMatrix, &m_rootMatrix, sizeof(rootMatrix)) != 0;
+        m_rootMatrix = rootMatrix;
+        m_hasRootMatrix = true;
+
+        // 親は必ず前にあるため、走査した時点で親の更新の有無は確定している.
+        TransformUpdateResult result;
+        const XMMATRIX root = mtxRoot;
+        const size_t nodeCount = m_parents.size();
+        for (size_t i = 0; i < nodeCount; ++i) {
+            const int parent = m_parents[i];
+            const bool isParentChanged = parent == InvalidParent ? isRootChanged : m_worldChanged[parent] != 0;
+            const bool isLocalDirty = m_localDirty[i] != 0;
+            m_worldChanged[i] = uint8_t(isParentChanged || isLocalDirty);
+            if (!m_worldChanged[i]) {
+                continue;
+            }
+
+            XMMATRIX local;
+            if (isLocalDirty) {
+                local = ComposeAffine(
+                    XMLoadFloat4A(&m_translations[i]), XMLoadFloat4A(&m_rotations[i]), XMLoadFloat4A(&m_scales[i]));
+                XMStoreFloat3x4A(&m_localMatrices[i], local);
+                m_localDirty[i] = 0;
+                result.localChanged++;
+            } else {
+                local = XMLoadFloat3x4A(&m_localMatrices[i]);
+            }
+            const XMMATRIX world = MultiplyAffine(
+                local, parent == InvalidParent ? root : XMLoadFloat3x4A(&m_worldMatrices[parent]));
+            XMStoreFloat3x4A(&m_worldMatrices[i], world);
+            result.worldChanged++;
+        }
+        return result;
+    }
+}